@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECAST_PROFILER_H
+#define RECAST_PROFILER_H
+
+#include <atomic>
+#include <mutex>
+
+#include "Recast.h"
+
+struct duFileIO;
+struct duProfileThread;
+
+/// A timed span recorded by a duProfiler.
+struct duProfileSpan
+{
+	const char* name;		///< The name of the span. Static string.
+	int label;				///< The rcTimerLabel of the span, or -1 for user spans.
+	int tileX, tileY;		///< The tile being built when the span started, or -1.
+	int depth;				///< The number of spans enclosing this one on its thread.
+	long long start;		///< The start time, in nanoseconds since the profiler was created or reset.
+	long long duration;		///< The duration in nanoseconds.
+};
+
+/// Duration statistics of the spans sharing a name.
+struct duProfileStats
+{
+	const char* name;
+	int count;
+	long long total;		///< Nanoseconds.
+	long long min, max;		///< Nanoseconds.
+	long long p50, p90, p99;	///< Percentiles, in nanoseconds.
+};
+
+/// Time spent building a tile: the sum of its top level spans.
+struct duProfileTileStats
+{
+	int tileX, tileY;
+	int spanCount;
+	long long total;		///< Nanoseconds.
+};
+
+/// Records timed spans from any number of build threads.
+///
+/// Each thread records into its own ring buffer, allocated the first time the thread records a
+/// span, so recording takes no lock. Once a buffer is full its oldest spans are overwritten.
+/// Spans nest: a span started while another is open on the same thread is its child.
+///
+/// The recording functions may be called from any thread at the same time. The other
+/// functions (stats, export and reset) must be called while no thread records.
+class duProfiler
+{
+public:
+	///  @param[in]		spansPerThread	The capacity of the ring buffer of each thread.
+	duProfiler(int spansPerThread = 65536);
+	~duProfiler();
+
+	/// @name Recording
+	///@{
+
+	/// Sets the tile attributed to the spans started next on the calling thread.
+	/// Use -1 when the thread is not building a tile.
+	void setTile(int tx, int ty);
+
+	/// Starts a span on the calling thread.
+	///  @param[in]		name	The name of the span. Must be a static string.
+	///  @param[in]		label	The rcTimerLabel of the span, -1 for user spans.
+	void beginSpan(const char* name, int label = -1);
+
+	/// Ends the last span started on the calling thread.
+	void endSpan();
+
+	///@}
+
+	/// The accumulated time of all the spans of a timer label, in microseconds, or -1 if there
+	/// are none.
+	int getLabelTime(const rcTimerLabel label) const;
+
+	/// Clears all the spans and accumulated times.
+	void reset();
+
+	/// The number of threads which recorded spans.
+	int getThreadCount() const;
+
+	/// Copies the spans of a thread, oldest first.
+	///  @param[in]		thread		The index of the thread. [Limit: < #getThreadCount()]
+	///  @param[out]	spans		The spans. [opt]
+	///  @param[in]		maxSpans	The capacity of @p spans.
+	/// @return The number of spans of the thread, which may be larger than @p maxSpans.
+	int getSpans(const int thread, duProfileSpan* spans, const int maxSpans) const;
+
+	/// The number of spans overwritten because a ring buffer was full.
+	long long getDroppedSpanCount() const;
+
+	/// Computes the duration statistics of the spans, grouped by name, slowest total first.
+	/// @return The number of names, which may be larger than @p maxStats.
+	int getStats(duProfileStats* stats, const int maxStats) const;
+
+	/// Computes the build time of the tiles, slowest first.
+	/// @return The number of tiles, which may be larger than @p maxStats.
+	int getTileStats(duProfileTileStats* stats, const int maxStats) const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	duProfiler(const duProfiler&);
+	duProfiler& operator=(const duProfiler&);
+
+	duProfileThread* getThread();
+	long long now() const;
+	int collectSpans(duProfileSpan* spans) const;
+
+	unsigned int m_serial;
+	int m_spansPerThread;
+	long long m_startTime;
+
+	mutable std::mutex m_threadsMutex;
+	duProfileThread** m_threads;
+	int m_threadCount;
+	int m_threadCapacity;
+
+	std::atomic<long long> m_labelTime[RC_MAX_TIMERS];
+	std::atomic<int> m_labelCount[RC_MAX_TIMERS];
+};
+
+/// Build context recording the Recast timers into a duProfiler.
+///
+/// Unlike the usual contexts, a single instance can be shared by all the build threads:
+/// the timers of each thread are tracked separately by the profiler. Log messages are
+/// discarded, derive from this class to keep them.
+class duProfilerContext : public rcContext
+{
+public:
+	duProfilerContext(duProfiler* profiler);
+
+	/// Sets the tile attributed to the timers started next on the calling thread.
+	void setTile(int tx, int ty) { m_profiler->setTile(tx, ty); }
+
+	duProfiler* getProfiler() const { return m_profiler; }
+
+protected:
+	virtual void doResetTimers();
+	virtual void doStartTimer(const rcTimerLabel label);
+	virtual void doStopTimer(const rcTimerLabel label);
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const;
+
+private:
+	duProfiler* m_profiler;
+};
+
+/// Returns a readable name of a timer label.
+const char* duGetTimerLabelName(const rcTimerLabel label);
+
+/// Writes the spans in the Chrome trace event format, for chrome://tracing or Perfetto.
+bool duDumpChromeTrace(const duProfiler& profiler, duFileIO* io);
+
+/// Logs the duration statistics of the spans and the slowest tiles.
+void duLogProfileStats(rcContext& ctx, const duProfiler& profiler, const int maxTiles = 10);
+
+#endif // RECAST_PROFILER_H
@@ -0,0 +1,579 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+#include "RecastProfiler.h"
+#include "RecastAlloc.h"
+#include "RecastDump.h"
+
+#ifdef WIN32
+#	define snprintf _snprintf
+#endif
+
+// Deeper spans are counted but not recorded.
+static const int DU_PROFILE_MAX_DEPTH = 32;
+
+struct duOpenSpan
+{
+	const char* name;
+	int label;
+	int tileX, tileY;
+	long long start;
+};
+
+struct duProfileThread
+{
+	std::thread::id id;
+	duProfileSpan* spans;
+	int capacity;
+	long long written;
+	int tileX, tileY;
+	duOpenSpan stack[DU_PROFILE_MAX_DEPTH];
+	int depth;
+};
+
+// The thread buffer used last by the calling thread, so that recording does not need to
+// look it up in the profiler.
+struct duThreadCache
+{
+	unsigned int serial;
+	duProfileThread* thread;
+};
+
+static thread_local duThreadCache t_cache = { 0, 0 };
+static std::atomic<unsigned int> s_nextSerial(1);
+
+duProfiler::duProfiler(int spansPerThread) :
+	m_serial(s_nextSerial.fetch_add(1)),
+	m_spansPerThread(rcMax(spansPerThread, 1)),
+	m_startTime(0),
+	m_threads(0),
+	m_threadCount(0),
+	m_threadCapacity(0)
+{
+	m_startTime = now();
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		m_labelTime[i] = 0;
+		m_labelCount[i] = 0;
+	}
+}
+
+duProfiler::~duProfiler()
+{
+	for (int i = 0; i < m_threadCount; ++i)
+	{
+		rcFree(m_threads[i]->spans);
+		rcFree(m_threads[i]);
+	}
+	rcFree(m_threads);
+}
+
+long long duProfiler::now() const
+{
+	const long long t = (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+	return t - m_startTime;
+}
+
+duProfileThread* duProfiler::getThread()
+{
+	if (t_cache.serial == m_serial)
+		return t_cache.thread;
+
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	// The buffers outlive the build of a tile.
+	rcScopedArena noArena(0);
+
+	const std::thread::id id = std::this_thread::get_id();
+	duProfileThread* thread = 0;
+	for (int i = 0; i < m_threadCount; ++i)
+	{
+		if (m_threads[i]->id == id)
+		{
+			thread = m_threads[i];
+			break;
+		}
+	}
+
+	if (!thread)
+	{
+		if (m_threadCount == m_threadCapacity)
+		{
+			const int capacity = rcMax(8, m_threadCapacity*2);
+			duProfileThread** threads = (duProfileThread**)rcAlloc(sizeof(duProfileThread*)*capacity, RC_ALLOC_PERM);
+			if (!threads)
+				return 0;
+			if (m_threadCount)
+				memcpy(threads, m_threads, sizeof(duProfileThread*)*m_threadCount);
+			rcFree(m_threads);
+			m_threads = threads;
+			m_threadCapacity = capacity;
+		}
+		thread = (duProfileThread*)rcAlloc(sizeof(duProfileThread), RC_ALLOC_PERM);
+		if (!thread)
+			return 0;
+		thread->spans = (duProfileSpan*)rcAlloc(sizeof(duProfileSpan)*m_spansPerThread, RC_ALLOC_PERM);
+		if (!thread->spans)
+		{
+			rcFree(thread);
+			return 0;
+		}
+		new(&thread->id) std::thread::id(id);
+		thread->capacity = m_spansPerThread;
+		thread->written = 0;
+		thread->tileX = -1;
+		thread->tileY = -1;
+		thread->depth = 0;
+		m_threads[m_threadCount++] = thread;
+	}
+
+	t_cache.serial = m_serial;
+	t_cache.thread = thread;
+	return thread;
+}
+
+void duProfiler::setTile(int tx, int ty)
+{
+	duProfileThread* thread = getThread();
+	if (!thread)
+		return;
+	thread->tileX = tx;
+	thread->tileY = ty;
+}
+
+void duProfiler::beginSpan(const char* name, int label)
+{
+	duProfileThread* thread = getThread();
+	if (!thread)
+		return;
+	if (thread->depth < DU_PROFILE_MAX_DEPTH)
+	{
+		duOpenSpan& open = thread->stack[thread->depth];
+		open.name = name;
+		open.label = label;
+		open.tileX = thread->tileX;
+		open.tileY = thread->tileY;
+		open.start = now();
+	}
+	thread->depth++;
+}
+
+void duProfiler::endSpan()
+{
+	duProfileThread* thread = getThread();
+	if (!thread || thread->depth == 0)
+		return;
+	thread->depth--;
+	if (thread->depth >= DU_PROFILE_MAX_DEPTH)
+		return;
+
+	const duOpenSpan& open = thread->stack[thread->depth];
+	duProfileSpan& span = thread->spans[thread->written % thread->capacity];
+	span.name = open.name;
+	span.label = open.label;
+	span.tileX = open.tileX;
+	span.tileY = open.tileY;
+	span.depth = thread->depth;
+	span.start = open.start;
+	span.duration = now() - open.start;
+	thread->written++;
+
+	if (open.label >= 0 && open.label < RC_MAX_TIMERS)
+	{
+		m_labelTime[open.label].fetch_add(span.duration, std::memory_order_relaxed);
+		m_labelCount[open.label].fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+int duProfiler::getLabelTime(const rcTimerLabel label) const
+{
+	if (m_labelCount[label].load(std::memory_order_relaxed) == 0)
+		return -1;
+	return (int)(m_labelTime[label].load(std::memory_order_relaxed) / 1000);
+}
+
+void duProfiler::reset()
+{
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	for (int i = 0; i < m_threadCount; ++i)
+	{
+		m_threads[i]->written = 0;
+		m_threads[i]->depth = 0;
+	}
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		m_labelTime[i] = 0;
+		m_labelCount[i] = 0;
+	}
+	m_startTime = 0;
+	m_startTime = now();
+}
+
+int duProfiler::getThreadCount() const
+{
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	return m_threadCount;
+}
+
+int duProfiler::getSpans(const int thread, duProfileSpan* spans, const int maxSpans) const
+{
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	if (thread < 0 || thread >= m_threadCount)
+		return 0;
+	const duProfileThread* t = m_threads[thread];
+	const int count = (int)rcMin(t->written, (long long)t->capacity);
+	if (spans)
+	{
+		const long long first = t->written - count;
+		const int n = rcMin(count, maxSpans);
+		for (int i = 0; i < n; ++i)
+			spans[i] = t->spans[(first + i) % t->capacity];
+	}
+	return count;
+}
+
+long long duProfiler::getDroppedSpanCount() const
+{
+	std::lock_guard<std::mutex> lock(m_threadsMutex);
+	long long dropped = 0;
+	for (int i = 0; i < m_threadCount; ++i)
+		dropped += rcMax(0LL, m_threads[i]->written - m_threads[i]->capacity);
+	return dropped;
+}
+
+// Copies the spans of all the threads, or returns their count if spans is null.
+int duProfiler::collectSpans(duProfileSpan* spans) const
+{
+	int count = 0;
+	const int threadCount = getThreadCount();
+	for (int i = 0; i < threadCount; ++i)
+		count += getSpans(i, spans ? spans + count : 0, spans ? 0x7fffffff : 0);
+	return count;
+}
+
+static bool compareSpanNameDuration(const duProfileSpan& a, const duProfileSpan& b)
+{
+	const int cmp = strcmp(a.name, b.name);
+	if (cmp != 0)
+		return cmp < 0;
+	return a.duration < b.duration;
+}
+
+static bool compareStatsTotal(const duProfileStats& a, const duProfileStats& b)
+{
+	return a.total > b.total;
+}
+
+// Nearest rank percentile of sorted durations.
+static long long percentile(const duProfileSpan* spans, const int count, const int pc)
+{
+	const int rank = (count * pc + 99) / 100;
+	return spans[rcClamp(rank - 1, 0, count - 1)].duration;
+}
+
+int duProfiler::getStats(duProfileStats* stats, const int maxStats) const
+{
+	const int spanCount = collectSpans(0);
+	if (!spanCount)
+		return 0;
+	duProfileSpan* spans = (duProfileSpan*)rcAlloc(sizeof(duProfileSpan)*spanCount, RC_ALLOC_TEMP);
+	duProfileStats* groups = (duProfileStats*)rcAlloc(sizeof(duProfileStats)*spanCount, RC_ALLOC_TEMP);
+	if (!spans || !groups)
+	{
+		rcFree(spans);
+		rcFree(groups);
+		return 0;
+	}
+	collectSpans(spans);
+	std::sort(spans, spans + spanCount, compareSpanNameDuration);
+
+	int groupCount = 0;
+	for (int i = 0; i < spanCount; )
+	{
+		int j = i;
+		long long total = 0;
+		while (j < spanCount && strcmp(spans[j].name, spans[i].name) == 0)
+			total += spans[j++].duration;
+		const int n = j - i;
+		duProfileStats& s = groups[groupCount++];
+		s.name = spans[i].name;
+		s.count = n;
+		s.total = total;
+		s.min = spans[i].duration;
+		s.max = spans[j-1].duration;
+		s.p50 = percentile(spans + i, n, 50);
+		s.p90 = percentile(spans + i, n, 90);
+		s.p99 = percentile(spans + i, n, 99);
+		i = j;
+	}
+	std::sort(groups, groups + groupCount, compareStatsTotal);
+
+	if (stats)
+		memcpy(stats, groups, sizeof(duProfileStats)*rcMin(groupCount, maxStats));
+
+	rcFree(spans);
+	rcFree(groups);
+	return groupCount;
+}
+
+static bool compareSpanTile(const duProfileSpan& a, const duProfileSpan& b)
+{
+	if (a.tileY != b.tileY)
+		return a.tileY < b.tileY;
+	return a.tileX < b.tileX;
+}
+
+static bool compareTileTotal(const duProfileTileStats& a, const duProfileTileStats& b)
+{
+	return a.total > b.total;
+}
+
+int duProfiler::getTileStats(duProfileTileStats* stats, const int maxStats) const
+{
+	const int spanCount = collectSpans(0);
+	if (!spanCount)
+		return 0;
+	duProfileSpan* spans = (duProfileSpan*)rcAlloc(sizeof(duProfileSpan)*spanCount, RC_ALLOC_TEMP);
+	duProfileTileStats* tiles = (duProfileTileStats*)rcAlloc(sizeof(duProfileTileStats)*spanCount, RC_ALLOC_TEMP);
+	if (!spans || !tiles)
+	{
+		rcFree(spans);
+		rcFree(tiles);
+		return 0;
+	}
+	collectSpans(spans);
+
+	// Keep the top level spans of the tiles.
+	int n = 0;
+	for (int i = 0; i < spanCount; ++i)
+	{
+		if (spans[i].depth == 0 && spans[i].tileX != -1)
+			spans[n++] = spans[i];
+	}
+	std::sort(spans, spans + n, compareSpanTile);
+
+	int tileCount = 0;
+	for (int i = 0; i < n; )
+	{
+		duProfileTileStats& t = tiles[tileCount++];
+		t.tileX = spans[i].tileX;
+		t.tileY = spans[i].tileY;
+		t.spanCount = 0;
+		t.total = 0;
+		while (i < n && spans[i].tileX == t.tileX && spans[i].tileY == t.tileY)
+		{
+			t.spanCount++;
+			t.total += spans[i++].duration;
+		}
+	}
+	std::sort(tiles, tiles + tileCount, compareTileTotal);
+
+	if (stats)
+		memcpy(stats, tiles, sizeof(duProfileTileStats)*rcMin(tileCount, maxStats));
+
+	rcFree(spans);
+	rcFree(tiles);
+	return tileCount;
+}
+
+duProfilerContext::duProfilerContext(duProfiler* profiler) :
+	m_profiler(profiler)
+{
+}
+
+// Would clear the timers of the other threads, use duProfiler::reset() between builds instead.
+void duProfilerContext::doResetTimers()
+{
+}
+
+void duProfilerContext::doStartTimer(const rcTimerLabel label)
+{
+	m_profiler->beginSpan(duGetTimerLabelName(label), label);
+}
+
+void duProfilerContext::doStopTimer(const rcTimerLabel /*label*/)
+{
+	m_profiler->endSpan();
+}
+
+int duProfilerContext::doGetAccumulatedTime(const rcTimerLabel label) const
+{
+	return m_profiler->getLabelTime(label);
+}
+
+const char* duGetTimerLabelName(const rcTimerLabel label)
+{
+	switch (label)
+	{
+	case RC_TIMER_TOTAL: return "Total";
+	case RC_TIMER_TEMP: return "Temp";
+	case RC_TIMER_RASTERIZE_TRIANGLES: return "Rasterize";
+	case RC_TIMER_BUILD_COMPACTHEIGHTFIELD: return "Build Compact";
+	case RC_TIMER_BUILD_CONTOURS: return "Build Contours";
+	case RC_TIMER_BUILD_CONTOURS_TRACE: return "Trace Contours";
+	case RC_TIMER_BUILD_CONTOURS_SIMPLIFY: return "Simplify Contours";
+	case RC_TIMER_FILTER_BORDER: return "Filter Border";
+	case RC_TIMER_FILTER_WALKABLE: return "Filter Walkable";
+	case RC_TIMER_MEDIAN_AREA: return "Median Area";
+	case RC_TIMER_FILTER_LOW_OBSTACLES: return "Filter Low Obstacles";
+	case RC_TIMER_BUILD_POLYMESH: return "Build Polymesh";
+	case RC_TIMER_MERGE_POLYMESH: return "Merge Polymeshes";
+	case RC_TIMER_ERODE_AREA: return "Erode Area";
+	case RC_TIMER_MARK_BOX_AREA: return "Mark Box Area";
+	case RC_TIMER_MARK_CYLINDER_AREA: return "Mark Cylinder Area";
+	case RC_TIMER_MARK_CONVEXPOLY_AREA: return "Mark Convex Area";
+	case RC_TIMER_BUILD_DISTANCEFIELD: return "Build Distance Field";
+	case RC_TIMER_BUILD_DISTANCEFIELD_DIST: return "Distance";
+	case RC_TIMER_BUILD_DISTANCEFIELD_BLUR: return "Blur";
+	case RC_TIMER_BUILD_REGIONS: return "Build Regions";
+	case RC_TIMER_BUILD_REGIONS_WATERSHED: return "Watershed";
+	case RC_TIMER_BUILD_REGIONS_EXPAND: return "Expand Regions";
+	case RC_TIMER_BUILD_REGIONS_FLOOD: return "Find Basins";
+	case RC_TIMER_BUILD_REGIONS_FILTER: return "Filter Regions";
+	case RC_TIMER_BUILD_LAYERS: return "Build Layers";
+	case RC_TIMER_BUILD_POLYMESHDETAIL: return "Build Polymesh Detail";
+	case RC_TIMER_MERGE_POLYMESHDETAIL: return "Merge Polymesh Details";
+	default: return "Unknown";
+	}
+}
+
+static bool ioprintf(duFileIO* io, const char* format, ...)
+{
+	char line[512];
+	va_list ap;
+	va_start(ap, format);
+	const int n = vsnprintf(line, sizeof(line), format, ap);
+	va_end(ap);
+	if (n < 0)
+		return false;
+	return io->write(line, (size_t)rcMin(n, (int)sizeof(line) - 1));
+}
+
+// Escapes a string for JSON, truncating it if needed.
+static void escapeJson(const char* str, char* out, const int maxOut)
+{
+	int n = 0;
+	for (const char* c = str; *c && n < maxOut - 7; ++c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			out[n++] = '\\';
+			out[n++] = *c;
+		}
+		else if ((unsigned char)*c < 0x20)
+			n += snprintf(out + n, 7, "\\u%04x", (unsigned char)*c);
+		else
+			out[n++] = *c;
+	}
+	out[n] = '\0';
+}
+
+bool duDumpChromeTrace(const duProfiler& profiler, duFileIO* io)
+{
+	if (!io || !io->isWriting())
+		return false;
+
+	if (!ioprintf(io, "{\"traceEvents\":[\n"))
+		return false;
+
+	bool first = true;
+	const int threadCount = profiler.getThreadCount();
+	for (int i = 0; i < threadCount; ++i)
+	{
+		const int count = profiler.getSpans(i, 0, 0);
+		if (!count)
+			continue;
+		duProfileSpan* spans = (duProfileSpan*)rcAlloc(sizeof(duProfileSpan)*count, RC_ALLOC_TEMP);
+		if (!spans)
+			return false;
+		profiler.getSpans(i, spans, count);
+		for (int j = 0; j < count; ++j)
+		{
+			const duProfileSpan& s = spans[j];
+			char name[256];
+			escapeJson(s.name, name, sizeof(name));
+			bool ok;
+			// Timestamps are in microseconds.
+			if (s.tileX != -1)
+			{
+				ok = ioprintf(io, "%s{\"name\":\"%s\",\"cat\":\"recast\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"tileX\":%d,\"tileY\":%d}}",
+							  first ? "" : ",\n", name, i, s.start/1000.0, s.duration/1000.0, s.tileX, s.tileY);
+			}
+			else
+			{
+				ok = ioprintf(io, "%s{\"name\":\"%s\",\"cat\":\"recast\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+							  first ? "" : ",\n", name, i, s.start/1000.0, s.duration/1000.0);
+			}
+			first = false;
+			if (!ok)
+			{
+				rcFree(spans);
+				return false;
+			}
+		}
+		rcFree(spans);
+	}
+
+	return ioprintf(io, "\n],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+void duLogProfileStats(rcContext& ctx, const duProfiler& profiler, const int maxTiles)
+{
+	const int statCount = profiler.getStats(0, 0);
+	if (statCount)
+	{
+		duProfileStats* stats = (duProfileStats*)rcAlloc(sizeof(duProfileStats)*statCount, RC_ALLOC_TEMP);
+		if (stats)
+		{
+			profiler.getStats(stats, statCount);
+			ctx.log(RC_LOG_PROGRESS, "Build Stages\tcount\ttotal\tp50\tp90\tp99\tmax (ms)");
+			for (int i = 0; i < statCount; ++i)
+			{
+				const duProfileStats& s = stats[i];
+				ctx.log(RC_LOG_PROGRESS, "- %s:\t%d\t%.2f\t%.3f\t%.3f\t%.3f\t%.3f", s.name, s.count,
+						s.total/1e6, s.p50/1e6, s.p90/1e6, s.p99/1e6, s.max/1e6);
+			}
+			rcFree(stats);
+		}
+	}
+
+	const int tileCount = rcMin(profiler.getTileStats(0, 0), maxTiles);
+	if (tileCount > 0)
+	{
+		duProfileTileStats* tiles = (duProfileTileStats*)rcAlloc(sizeof(duProfileTileStats)*tileCount, RC_ALLOC_TEMP);
+		if (tiles)
+		{
+			profiler.getTileStats(tiles, tileCount);
+			ctx.log(RC_LOG_PROGRESS, "Slowest Tiles");
+			for (int i = 0; i < tileCount; ++i)
+				ctx.log(RC_LOG_PROGRESS, "- (%d,%d):\t%.2fms", tiles[i].tileX, tiles[i].tileY, tiles[i].total/1e6);
+			rcFree(tiles);
+		}
+	}
+
+	const long long dropped = profiler.getDroppedSpanCount();
+	if (dropped)
+		ctx.log(RC_LOG_WARNING, "%lld spans dropped, increase the profiler capacity.", dropped);
+}
@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURFLOWFIELD_H
+#define DETOURFLOWFIELD_H
+
+#include "DetourNavMesh.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+
+/// The cost to reach a goal from every polygon of a navigation mesh, for many agents heading to the same goal.
+///
+/// The field is built with a Dijkstra search from the goal over the whole polygon graph. Each polygon stores
+/// its cost to the goal and the next polygon toward the goal, so the path of an agent is read back in time
+/// proportional to its length, without searching.
+///
+/// The costs are the distances between the polygon edge midpoints, scaled by the area costs of the filter,
+/// like the costs of dtNavMeshQuery::findPolysAroundCircle(). With DT_VIRTUAL_QUERYFILTER, the costs are
+/// given by dtQueryFilter::getCost(), from the neighbour polygon into the polygon toward the goal. Only the
+/// links present in both directions are followed, so one-way off-mesh connections are not used.
+///
+/// When tiles are added, removed or rebuilt, #update searches again only the polygons whose path went through
+/// the changed tiles, and the polygons which can now reach the goal through them. Changing the flags of the
+/// polygons is not detected, build the field again instead.
+/// @ingroup detour
+class dtFlowField
+{
+public:
+	dtFlowField();
+	~dtFlowField();
+
+	/// Initializes the field.
+	///  @param[in]		nav		The navigation mesh of the field.
+	/// @return The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav);
+
+	/// Builds the field toward a goal.
+	///  @param[in]		navquery	The query object used to check the polygons, attached to the navigation mesh of the field.
+	///  @param[in]		goalRef		The reference of the goal polygon.
+	///  @param[in]		goalPos		The goal position. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter. It is kept by the field and used by #update.
+	/// @return The status flags for the operation.
+	dtStatus build(const dtNavMeshQuery* navquery, dtPolyRef goalRef, const float* goalPos, const dtQueryFilter* filter);
+
+	/// Updates the field after tiles were added, removed or rebuilt.
+	///  @param[in]		navquery	The query object used to check the polygons.
+	/// @return The status flags for the operation. Fails if the goal polygon was removed, build the field again then.
+	dtStatus update(const dtNavMeshQuery* navquery);
+
+	/// Returns the cost to reach the goal from a polygon, or FLT_MAX if the goal cannot be reached.
+	///  @param[in]		ref		The reference of the polygon.
+	float getCost(dtPolyRef ref) const;
+
+	/// Returns the next polygon toward the goal, or zero if the polygon is the goal or cannot reach it.
+	///  @param[in]		ref		The reference of the polygon.
+	dtPolyRef getNextPoly(dtPolyRef ref) const;
+
+	/// Returns true if the goal can be reached from a polygon.
+	///  @param[in]		ref		The reference of the polygon.
+	bool isReachable(dtPolyRef ref) const;
+
+	/// Reads the path from a polygon to the goal.
+	///  @param[in]		startRef	The reference of the start polygon.
+	///  @param[out]	path		The path, from the start polygon to the goal polygon. [(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons of the path.
+	///  @param[in]		maxPath		The maximum number of polygons the path buffer can hold. [Limit: >= 1]
+	/// @return The status flags for the operation. The path is truncated with DT_BUFFER_TOO_SMALL if it does not fit.
+	dtStatus getCorridor(dtPolyRef startRef, dtPolyRef* path, int* pathCount, const int maxPath) const;
+
+	/// The reference of the goal polygon.
+	dtPolyRef getGoalRef() const { return m_goalRef; }
+
+	/// The goal position. [(x, y, z)]
+	const float* getGoalPos() const { return m_goalPos; }
+
+	/// The navigation mesh of the field.
+	const dtNavMesh* getNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtFlowField(const dtFlowField&);
+	dtFlowField& operator=(const dtFlowField&);
+
+	struct TileField
+	{
+		unsigned int changeCount;	///< The change count of the tile the field was computed for.
+		int polyCount;			///< The number of polygons of the tile, zero if there was no tile.
+		int capacity;
+		float* costs;			///< The cost to the goal of each polygon.
+		dtPolyRef* next;		///< The next polygon toward the goal of each polygon.
+		unsigned char* marks;	///< Scratch state of each polygon during the updates.
+	};
+
+	struct OpenNode
+	{
+		float cost;
+		dtPolyRef ref;
+	};
+
+	void purge();
+	bool getIndex(dtPolyRef ref, int& it, int& ip) const;
+	dtStatus resetTile(const int it);
+	void getNodePos(dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly, float* pos) const;
+	bool isPathValid(dtPolyRef ref);
+	dtStatus pushOpen(dtPolyRef ref, const float cost);
+	OpenNode popOpen();
+	dtStatus expand(const dtNavMeshQuery* navquery);
+
+	const dtNavMesh* m_nav;
+	const dtQueryFilter* m_filter;
+	TileField* m_tiles;
+	int m_maxTiles;
+
+	dtPolyRef m_goalRef;
+	float m_goalPos[3];
+
+	OpenNode* m_open;			///< Binary heap of the polygons to expand, sorted by cost.
+	int m_nopen;
+	int m_openCapacity;
+	dtPolyRef* m_stack;			///< Scratch buffer of the polygons of a path.
+	int m_stackCapacity;
+};
+
+#endif // DETOURFLOWFIELD_H
@@ -102,7 +102,11 @@ static const int DT_MAX_AREAS = 64;
 enum dtTileFlags
 {
 	/// The navigation mesh owns the tile memory and is responsible for freeing it.
-	DT_TILE_FREE_DATA = 0x01
+	DT_TILE_FREE_DATA = 0x01,
+
+	/// The tile memory was allocated from a dtTileDataPool, and is released to the pool
+	/// instead of being freed with dtFree(). Used with #DT_TILE_FREE_DATA.
+	DT_TILE_POOLED_DATA = 0x02
 };
 
 /// Vertex flags returned by dtNavMeshQuery::findStraightPath.
@@ -121,10 +125,11 @@ enum dtStraightPathOptions
 };
 
 
-/// Options for dtNavMeshQuery::initSlicedFindPath and updateSlicedFindPath
+/// Options for dtNavMeshQuery::findPath, initSlicedFindPath and updateSlicedFindPath
 enum dtFindPathOptions
 {
-	DT_FINDPATH_ANY_ANGLE	= 0x02		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_ANY_ANGLE	= 0x02,		///< use raycasts during pathfind to "shortcut" (raycast still consider costs)
+	DT_FINDPATH_BIDIRECTIONAL	= 0x04	///< search from both ends of the path at once (findPath only)
 };
 
 /// Options for dtNavMeshQuery::raycast
@@ -284,6 +289,9 @@ struct dtMeshHeader
 struct dtMeshTile
 {
 	unsigned int salt;					///< Counter describing modifications to the tile.
+	/// Incremented each time a tile is added to or removed from this slot. Unlike the salt, it also changes
+	/// when a tile is replaced at the same reference.
+	unsigned int changeCount;
 
 	unsigned int linksFreeList;			///< Index to the next free link.
 	dtMeshHeader* header;				///< The tile header.
@@ -336,6 +344,8 @@ struct dtNavMeshParams
 	int maxPolys;					///< The maximum number of polygons each tile can contain. This and maxTiles are used to calculate how many bits are needed to identify tiles and polygons uniquely.
 };
 
+class dtNavMeshConnectivity;
+
 /// A navigation mesh based on tiles of convex polygons.
 /// @ingroup detour
 class dtNavMesh
@@ -520,6 +530,20 @@ public:
 	
 	/// @}
 
+	/// @{
+	/// @name Connectivity
+
+	/// Starts tracking the islands of the mesh for the specified include flag masks.
+	///  @param[in]	includeFlags	The include flag masks. [(flags) * @p count]
+	///  @param[in]	count			The number of masks, or zero to stop tracking.
+	/// @return The status flags for the operation.
+	dtStatus initConnectivity(const unsigned short* includeFlags, const int count);
+
+	/// The island index of the mesh, or null if it is not tracked.
+	const dtNavMeshConnectivity* getConnectivity() const { return m_connectivity; }
+
+	/// @}
+
 	/// @{
 	/// @name Encoding and Decoding
 	/// These functions are generally meant for internal use only.
@@ -672,6 +696,7 @@ private:
 	dtMeshTile** m_posLookup;			///< Tile hash lookup.
 	dtMeshTile* m_nextFree;				///< Freelist of tiles.
 	dtMeshTile* m_tiles;				///< List of tiles.
+	dtNavMeshConnectivity* m_connectivity;	///< Island index. [opt]
 		
 #ifndef DT_POLYREF64
 	unsigned int m_saltBits;			///< Number of salt bits in the tile ID.
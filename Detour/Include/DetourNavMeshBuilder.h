@@ -21,6 +21,20 @@
 
 #include "DetourAlloc.h"
 
+class dtTileDataPool;
+
+/// The strategies used to build the bounding volume tree of a tile.
+/// @see dtNavMeshCreateParams::bvTreeBuildMethod
+/// @ingroup detour
+enum dtBVTreeBuildMethod
+{
+	/// Split the polygons at the median of the longest axis. (Default)
+	DT_BVTREE_MEDIAN = 0,
+	/// Split the polygons using a binned surface area heuristic.
+	/// Produces tighter trees and replaces the per node sort by a linear binning pass.
+	DT_BVTREE_SAH = 1
+};
+
 /// Represents the source data used to build an navigation mesh tile.
 /// @ingroup detour
 struct dtNavMeshCreateParams
@@ -101,6 +115,10 @@ struct dtNavMeshCreateParams
 	/// @note The BVTree is not normally needed for layered navigation meshes.
 	bool buildBvTree;
 
+	/// The method used to build the bounding volume tree. (See: #dtBVTreeBuildMethod)
+	/// Ignored if #buildBvTree is false. [Default: #DT_BVTREE_MEDIAN]
+	int bvTreeBuildMethod;
+
 	/// @}
 };
 
@@ -109,8 +127,10 @@ struct dtNavMeshCreateParams
 ///  @param[in]		params		Tile creation data.
 ///  @param[out]	outData		The resulting tile data.
 ///  @param[out]	outDataSize	The size of the tile data array.
+///  @param[in]		dataPool	The pool to allocate the tile data from, instead of dtAlloc(). [opt]
 /// @return True if the tile data was successfully created.
-bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize);
+bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize,
+						 dtTileDataPool* dataPool = 0);
 
 /// Swaps the endianness of the tile data's header (#dtMeshHeader).
 ///  @param[in,out]	data		The tile data array.
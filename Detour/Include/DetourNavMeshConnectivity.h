@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHCONNECTIVITY_H
+#define DETOURNAVMESHCONNECTIVITY_H
+
+#include "DetourNavMesh.h"
+
+/// The island id of polygons which do not pass the include flags of a mask.
+static const unsigned int DT_NULL_ISLAND = 0;
+
+/// Connected components (islands) of the polygon graph of a navigation mesh.
+///
+/// Each polygon gets an island id per include flag mask: polygons sharing at least one flag
+/// with the mask are connected through their links. The index is kept up to date by the
+/// navigation mesh when tiles are added or removed and when polygon flags change.
+///
+/// The links are followed regardless of their direction. Polygons on different islands can
+/// never reach each other, polygons on the same island can reach each other unless the way
+/// goes through a one-way off-mesh connection.
+///
+/// Created by dtNavMesh::initConnectivity().
+/// @ingroup detour
+class dtNavMeshConnectivity
+{
+public:
+	dtNavMeshConnectivity();
+	~dtNavMeshConnectivity();
+
+	/// Initializes the index and labels the tiles already in the navigation mesh.
+	///  @param[in]		nav				The navigation mesh.
+	///  @param[in]		includeFlags	The include flag masks to track. [(flags) * @p count]
+	///  @param[in]		count			The number of masks. [Limit: > 0]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const unsigned short* includeFlags, const int count);
+
+	/// @name Navigation mesh notifications
+	/// Called by dtNavMesh, the tile links must be up to date.
+	/// @{
+
+	/// Labels the polygons of a tile which has just been added and connected.
+	void tileAdded(const dtMeshTile* tile);
+
+	/// Releases the labels of a tile about to be removed. The islands it was part of
+	/// are split, if needed, by the next update().
+	void tileRemoved(const dtMeshTile* tile);
+
+	/// Updates the labels after the flags of the polygon changed. Disabled polygons may split
+	/// their islands, this is done by the next update().
+	void polyFlagsChanged(const dtMeshTile* tile, const int polyIdx, const unsigned short oldFlags);
+
+	/// Relabels the islands which may have been split, must be called after a batch of changes
+	/// before the index is queried.
+	void update();
+
+	/// @}
+
+	/// Returns the island of a polygon.
+	///  @param[in]		ref		A valid polygon reference.
+	///  @param[in]		mask	The index of the include flag mask.
+	/// @returns The island id, or #DT_NULL_ISLAND if the polygon does not pass the mask.
+	unsigned int getPolyIsland(dtPolyRef ref, const int mask) const;
+
+	/// Finds the mask to use for a query filter with the specified include flags.
+	/// Any mask containing all the include flags gives valid answers, the one with
+	/// the fewest extra flags is returned.
+	///  @param[in]		includeFlags	The include flags of the query filter.
+	/// @returns The index of the mask, or -1 if no mask contains all the flags.
+	int findMask(const unsigned short includeFlags) const;
+
+	/// The number of include flag masks.
+	inline int getMaskCount() const { return m_maskCount; }
+
+	/// The include flags of a mask.
+	inline unsigned short getMaskFlags(const int mask) const { return m_masks[mask]; }
+
+	/// The number of island ids in use, including the ones of removed islands not compacted yet.
+	inline int getIslandIdCount() const { return m_idCount; }
+
+	/// The number of tiles scanned by the last relabelling of the islands which may have been split.
+	inline int getRelabelledTileCount() const { return m_relabelledTileCount; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshConnectivity(const dtNavMeshConnectivity&);
+	dtNavMeshConnectivity& operator=(const dtNavMeshConnectivity&);
+
+	struct TileNode
+	{
+		int tile;
+		int next;
+	};
+
+	void clear();
+	int getTileIndex(const dtMeshTile* tile) const;
+	bool allocTileIds(const dtMeshTile* tile);
+	unsigned int allocId(const int tile);
+	void addIslandTile(const unsigned int id, const int tile);
+	void freeIslandTiles(const unsigned int id);
+	void rebuildIslandTiles();
+	unsigned int findRoot(unsigned int id);
+	void unite(unsigned int a, unsigned int b);
+	void uniteIncomingOffMeshLinks(const dtMeshTile* tile);
+	void uniteLinks(const dtMeshTile* tile, const int polyIdx);
+	void markDirty(const unsigned int id);
+	void relabelDirty();
+	void flatten();
+	void compact();
+
+	const dtNavMesh* m_nav;
+	unsigned short* m_masks;
+	int m_maskCount;
+
+	/// Island id of each polygon and mask, per tile index. [(id) * polyCount * maskCount]
+	unsigned int** m_tileIds;
+	int m_maxTiles;
+
+	/// Union-find parent of each island id. Outside of the updates the parent of an id is its root.
+	unsigned int* m_parent;
+	int m_idCount;
+	int m_idCapacity;
+	int m_compactAt;
+	bool m_needFlatten;
+
+	/// The tiles of the polygons of each root island id, a list of nodes per id. The lists may hold
+	/// the same tile several times, or tiles which do not hold the island anymore.
+	int* m_firstTileNode;
+	int* m_lastTileNode;
+	TileNode* m_tileNodes;
+	int m_tileNodeCount;
+	int m_tileNodeCapacity;
+	int m_freeTileNode;
+	bool m_tileListsLost;	///< A list could not be extended, the next relabelling scans all the tiles.
+	int m_relabelledTileCount;
+
+	/// Roots of the islands touched by removals since the last update.
+	unsigned int* m_dirty;
+	int m_dirtyCount;
+	int m_dirtyCapacity;
+};
+
+#endif // DETOURNAVMESHCONNECTIVITY_H
@@ -192,6 +192,23 @@ public:
 					  const dtQueryFilter* filter,
 					  dtPolyRef* path, int* pathCount, const int maxPath) const;
 
+	/// Finds a path from the start polygon to the end polygon.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	path		An ordered list of polygon references representing the path. (Start to end.) 
+	///  							[(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons returned in the @p path array.
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		options		Query options. (see: #dtFindPathOptions, only #DT_FINDPATH_BIDIRECTIONAL is used)
+	dtStatus findPath(dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos,
+					  const dtQueryFilter* filter,
+					  dtPolyRef* path, int* pathCount, const int maxPath,
+					  const unsigned int options) const;
+
 	/// Finds the straight path from the start to the end position within the polygon corridor.
 	///  @param[in]		startPos			Path start position. [(x, y, z)]
 	///  @param[in]		endPos				Path end position. [(x, y, z)]
@@ -338,6 +355,26 @@ public:
 	dtStatus findNearestPoly(const float* center, const float* halfExtents,
 							 const dtQueryFilter* filter,
 							 dtPolyRef* nearestRef, float* nearestPt, bool* isOverPoly) const;
+
+	/// Finds the polygon nearest to each of the specified center points.
+	/// Gives the same results as calling #findNearestPoly for every point, but the points are grouped
+	/// by tile and nearby points share the traversal of the tile's bounding volume tree.
+	/// [opt] means the specified parameter can be a null pointer, in that case the output parameter will not be set.
+	///
+	///  @param[in]		centers		The center of the search box of each point. [(x, y, z) * @p count]
+	///  @param[in]		count		The number of points. [Limit: >= 0]
+	///  @param[in]		halfExtents	The search distance along each axis, shared by all the points. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	nearestRefs	The reference id of the nearest polygon of each point. Set to 0 if no polygon is found.
+	///  							[(polyRef) * @p count]
+	///  @param[out]	nearestPts	The nearest point on the polygon of each point. Unchanged if no polygon is found.
+	///  							[opt] [(x, y, z) * @p count]
+	///  @param[out]	isOverPoly	Set to true if the point's X/Z coordinate lies inside its polygon, false otherwise.
+	///  							Unchanged if no polygon is found. [opt] [(bool) * @p count]
+	/// @returns The status flags for the query.
+	dtStatus findNearestPolyBatch(const float* centers, const int count, const float* halfExtents,
+								  const dtQueryFilter* filter,
+								  dtPolyRef* nearestRefs, float* nearestPts, bool* isOverPoly) const;
 	
 	/// Finds polygons that overlap the search box.
 	///  @param[in]		center		The center of the search box. [(x, y, z)]
@@ -507,6 +544,14 @@ public:
 	///  @param[in]		filter		The filter to apply.
 	bool isValidPolyRef(dtPolyRef ref, const dtQueryFilter* filter) const;
 
+	/// Returns false if no path can connect the polygons, using the island index of the
+	/// navigation mesh. (See: dtNavMesh::initConnectivity)
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		filter		The filter to apply.
+	/// @returns False if the polygons are known to be disconnected, true if they may be connected.
+	bool arePolysConnected(dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter) const;
+
 	/// Returns true if the polygon reference is in the closed list. 
 	///  @param[in]		ref		The reference id of the polygon to check.
 	/// @returns True if the polygon is in closed list.
@@ -556,6 +601,12 @@ private:
 
 	// Gets the path leading to the specified end node.
 	dtStatus getPathToNode(struct dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const;
+
+	// Bidirectional variant of findPath, the input has been validated.
+	dtStatus findPathBidirectional(dtPolyRef startRef, dtPolyRef endRef,
+								   const float* startPos, const float* endPos,
+								   const dtQueryFilter* filter,
+								   dtPolyRef* path, int* pathCount, const int maxPath) const;
 	
 	const dtNavMesh* m_nav;				///< Pointer to navmesh data.
 
@@ -575,6 +626,8 @@ private:
 	class dtNodePool* m_tinyNodePool;	///< Pointer to small node pool.
 	class dtNodePool* m_nodePool;		///< Pointer to node pool.
 	class dtNodeQueue* m_openList;		///< Pointer to open list queue.
+	/// Pointer to the open list of the backward search of findPath, allocated by the first bidirectional search.
+	mutable class dtNodeQueue* m_reverseOpenList;
 };
 
 /// Allocates a query object using the Detour allocator.
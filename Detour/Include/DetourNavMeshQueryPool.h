@@ -0,0 +1,236 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURNAVMESHQUERYPOOL_H
+#define DETOURNAVMESHQUERYPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+
+/// The kind of query run by a #dtQueryJob.
+/// @ingroup detour
+enum dtQueryJobType
+{
+	DT_QUERYJOB_NONE = 0,
+	DT_QUERYJOB_FIND_PATH,				///< dtNavMeshQuery::findPath
+	DT_QUERYJOB_RAYCAST,				///< dtNavMeshQuery::raycast
+	DT_QUERYJOB_DISTANCE_TO_WALL,		///< dtNavMeshQuery::findDistanceToWall
+	DT_QUERYJOB_POLYS_AROUND_CIRCLE,	///< dtNavMeshQuery::findPolysAroundCircle
+};
+
+/// The state of a #dtQueryJob.
+/// @ingroup detour
+enum dtQueryJobState
+{
+	DT_QUERYJOB_IDLE = 0,				///< The job has not been submitted, or has been reset.
+	DT_QUERYJOB_QUEUED,					///< The job waits in a worker queue or is being processed.
+	DT_QUERYJOB_COMPLETED,				///< The results are available.
+};
+
+struct dtQueryJob;
+
+/// Called on the worker thread once the results of a job are available.
+/// The job is not reported as completed until the callback returns.
+typedef void (*dtQueryJobCallback)(dtQueryJob* job, void* userData);
+
+/// A query run asynchronously by a #dtNavMeshQueryPool.
+///
+/// The job, its filter and its result buffers are owned by the caller and must stay alive
+/// until the job is completed. Use one of the set methods to describe the query, then submit
+/// the job with dtNavMeshQueryPool::submit().
+/// @ingroup detour
+struct dtQueryJob
+{
+	dtQueryJob();
+
+	/// Describes a dtNavMeshQuery::findPath query. The results are stored in #polys and #polyCount.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		endRef		The reference id of the end polygon.
+	///  @param[in]		startPos	A position within the start polygon. [(x, y, z)]
+	///  @param[in]		endPos		A position within the end polygon. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	path		Storage for the path. [(polyRef) * @p maxPath]
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold. [Limit: >= 1]
+	///  @param[in]		options		Query options. (see: #dtFindPathOptions)
+	void setFindPath(dtPolyRef startRef, dtPolyRef endRef, const float* startPos, const float* endPos,
+					 const dtQueryFilter* filter, dtPolyRef* path, const int maxPath,
+					 const unsigned int options = 0);
+
+	/// Describes a dtNavMeshQuery::raycast query. The results are stored in #hit.
+	///  @param[in]		startRef	The reference id of the start polygon.
+	///  @param[in]		startPos	A position within the start polygon representing the start of the ray. [(x, y, z)]
+	///  @param[in]		endPos		The position to cast the ray toward. [(x, y, z)]
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[in]		options		Govern how the raycast behaves. See dtRaycastOptions
+	///  @param[out]	path		Storage for the visited polygons. [opt] [(polyRef) * @p maxPath]
+	///  @param[in]		maxPath		The maximum number of polygons the @p path array can hold.
+	void setRaycast(dtPolyRef startRef, const float* startPos, const float* endPos,
+					const dtQueryFilter* filter, const unsigned int options,
+					dtPolyRef* path, const int maxPath);
+
+	/// Describes a dtNavMeshQuery::findDistanceToWall query. The results are stored in #hitDist,
+	/// #hitPos and #hitNormal.
+	///  @param[in]		startRef	The reference id of the polygon containing @p centerPos.
+	///  @param[in]		centerPos	The center of the search circle. [(x, y, z)]
+	///  @param[in]		maxRadius	The radius of the search circle.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	void setDistanceToWall(dtPolyRef startRef, const float* centerPos, const float maxRadius,
+						   const dtQueryFilter* filter);
+
+	/// Describes a dtNavMeshQuery::findPolysAroundCircle query. The results are stored in #polys,
+	/// #parents, #costs and #polyCount.
+	///  @param[in]		startRef	The reference id of the polygon where the search starts.
+	///  @param[in]		centerPos	The center of the search circle. [(x, y, z)]
+	///  @param[in]		radius		The radius of the search circle.
+	///  @param[in]		filter		The polygon filter to apply to the query.
+	///  @param[out]	resultRef	The reference ids of the polygons touched by the circle. [opt]
+	///  @param[out]	resultParent	The reference ids of the parent polygons for each result. [opt]
+	///  @param[out]	resultCost	The search cost from @p centerPos to the polygon. [opt]
+	///  @param[in]		maxResult	The maximum number of polygons the result arrays can hold.
+	void setPolysAroundCircle(dtPolyRef startRef, const float* centerPos, const float radius,
+							  const dtQueryFilter* filter,
+							  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+							  const int maxResult);
+
+	/// Sets the function called on the worker thread when the job completes.
+	///  @param[in]		cb			The callback. [opt]
+	///  @param[in]		userData	Passed to the callback. [opt]
+	void setCallback(dtQueryJobCallback cb, void* userData);
+
+	/// Returns true once the results of the job are available.
+	inline bool isCompleted() const { return state.load(std::memory_order_acquire) == DT_QUERYJOB_COMPLETED; }
+
+	/// @name Inputs
+	/// @{
+	int type;						///< The query to run. (See: #dtQueryJobType)
+	dtPolyRef startRef;				///< The start polygon.
+	dtPolyRef endRef;				///< The end polygon. (findPath)
+	float startPos[3];				///< The start, or center, position. [(x, y, z)]
+	float endPos[3];				///< The end position. (findPath, raycast) [(x, y, z)]
+	float radius;					///< The search radius. (findDistanceToWall, findPolysAroundCircle)
+	unsigned int options;			///< The query options. (findPath, raycast)
+	const dtQueryFilter* filter;	///< The polygon filter to apply to the query.
+	int maxPolys;					///< The capacity of the result arrays.
+	/// @}
+
+	/// @name Outputs
+	/// @{
+	dtStatus status;				///< The status returned by the query.
+	dtPolyRef* polys;				///< The polygons found by the query. [(polyRef) * #maxPolys]
+	dtPolyRef* parents;				///< The parent of each result polygon. (findPolysAroundCircle) [opt]
+	float* costs;					///< The cost of each result polygon. (findPolysAroundCircle) [opt]
+	int polyCount;					///< The number of polygons stored in #polys.
+	dtRaycastHit hit;				///< The raycast hit. The path of the hit uses #polys. (raycast)
+	float hitDist;					///< The distance to the nearest wall. (findDistanceToWall)
+	float hitPos[3];				///< The nearest position on the wall. (findDistanceToWall) [(x, y, z)]
+	float hitNormal[3];				///< The normal of the nearest wall. (findDistanceToWall) [(x, y, z)]
+	/// @}
+
+	dtQueryJobCallback callback;	///< Called on the worker thread on completion. [opt]
+	void* userData;					///< Passed to #callback. [opt]
+
+	std::atomic<int> state;			///< The state of the job. (See: #dtQueryJobState)
+	std::atomic<dtQueryJob*> next;	///< Link used by the worker queues. Do not modify.
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtQueryJob(const dtQueryJob&);
+	dtQueryJob& operator=(const dtQueryJob&);
+};
+
+struct dtQueryWorker;
+
+/// Runs navigation mesh queries on a set of worker threads.
+///
+/// The pool owns one dtNavMeshQuery per worker thread. Jobs can be submitted from any thread;
+/// each worker has a lock free multiple producer, single consumer queue and the jobs are handed
+/// to the least busy worker. Completion is reported through the job callback, by polling
+/// dtQueryJob::isCompleted() or by blocking in wait().
+///
+/// The queries only read the navigation mesh, so the mesh must not be modified (tiles added
+/// or removed, flags or areas changed, ...) while jobs are in flight. Use waitAll() before
+/// changing it.
+/// @ingroup detour
+class dtNavMeshQueryPool
+{
+public:
+	dtNavMeshQueryPool();
+	~dtNavMeshQueryPool();
+
+	/// Initializes the pool and starts the worker threads.
+	///  @param[in]		nav			Pointer to the dtNavMesh object to use for all queries.
+	///  @param[in]		maxNodes	Maximum number of search nodes of each query. [Limits: 0 < value <= 65535]
+	///  @param[in]		threadCount	The number of worker threads. [Limit: > 0]
+	/// @returns The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const int maxNodes, const int threadCount);
+
+	/// Runs the jobs still queued, then stops and joins the worker threads.
+	void shutdown();
+
+	/// Queues a job. The job must be idle or completed.
+	///  @param[in]		job		The job to run.
+	/// @returns The status flags for the operation.
+	dtStatus submit(dtQueryJob* job);
+
+	/// Blocks until the job is completed.
+	///  @param[in]		job		A submitted job.
+	/// @returns The status of the query.
+	dtStatus wait(const dtQueryJob* job);
+
+	/// Blocks until all the submitted jobs are completed.
+	void waitAll();
+
+	/// The number of worker threads.
+	inline int getThreadCount() const { return m_threadCount; }
+
+	/// The navigation mesh the pool queries.
+	inline const dtNavMesh* getNavMesh() const { return m_nav; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtNavMeshQueryPool(const dtNavMeshQueryPool&);
+	dtNavMeshQueryPool& operator=(const dtNavMeshQueryPool&);
+
+	static void workerMain(dtNavMeshQueryPool* pool, dtQueryWorker* worker);
+	void complete(dtQueryJob* job);
+
+	const dtNavMesh* m_nav;
+	dtQueryWorker* m_workers;
+	int m_threadCount;
+	std::atomic<unsigned int> m_nextWorker;
+	std::atomic<int> m_pendingJobs;
+	std::atomic<int> m_waiters;
+	std::mutex m_waitMutex;
+	std::condition_variable m_waitCond;
+};
+
+/// Allocates a query pool object using the Detour allocator.
+/// @return An allocated query pool object, or null on failure.
+/// @ingroup detour
+dtNavMeshQueryPool* dtAllocNavMeshQueryPool();
+
+/// Frees the specified query pool object using the Detour allocator.
+///  @param[in]		pool		A query pool object allocated using #dtAllocNavMeshQueryPool
+/// @ingroup detour
+void dtFreeNavMeshQueryPool(dtNavMeshQueryPool* pool);
+
+#endif // DETOURNAVMESHQUERYPOOL_H
@@ -0,0 +1,146 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURPATHCACHE_H
+#define DETOURPATHCACHE_H
+
+#include "DetourNavMesh.h"
+
+class dtNavMeshQuery;
+class dtQueryFilter;
+
+/// Usage statistics of a #dtPathCache.
+/// @ingroup detour
+struct dtPathCacheStats
+{
+	int lookups;		///< The number of paths looked up.
+	int hits;			///< The number of paths found in the cache.
+	int invalidations;	///< The number of paths found in the cache, but discarded because a polygon is not valid anymore.
+	int evictions;		///< The number of paths discarded to store newer paths.
+	int stores;			///< The number of paths stored.
+	int pathCount;		///< The number of paths in the cache.
+};
+
+/// A cache of the paths between polygons, to skip the searches of the paths which are requested again and again,
+/// for example between the spawn points and the objectives of a level.
+///
+/// The paths are looked up by their start and end polygons, and the filter they were searched with. A cached
+/// path is discarded when one of its polygons does not pass the filter anymore, or when a tile of the path or
+/// a neighbour of one was added, removed or rebuilt, since a shorter path may go through it now. The tiles are
+/// compared with a hash of their change counts. When the cache is full, the least recently used path is replaced.
+///
+/// Only complete paths are cached, and they are not adapted to the positions in the start and end polygons. The
+/// costs of dtNavMeshQuery::findPath() depend on the start and end positions, so with other positions in large start
+/// or end polygons, a cached path is still a valid corridor but may not be the shortest one. Use
+/// dtNavMeshQuery::findStraightPath() with the actual positions to follow it, and the optimizations of
+/// dtPathCorridor (DetourCrowd) to shorten it.
+///
+/// The cache must not be used by several threads at the same time.
+/// @ingroup detour
+class dtPathCache
+{
+public:
+	dtPathCache();
+	~dtPathCache();
+
+	/// Initializes the cache.
+	///  @param[in]		maxPaths		The maximum number of paths to cache. [Limit: > 0]
+	///  @param[in]		maxPathSize		The maximum number of polygons of a cached path. [Limit: > 0]
+	/// @return The status flags for the operation.
+	dtStatus init(const int maxPaths, const int maxPathSize);
+
+	/// Looks up a path.
+	///  @param[in]		navquery	The query object used to check the polygons of the path.
+	///  @param[in]		startRef	The reference of the start polygon.
+	///  @param[in]		endRef		The reference of the end polygon.
+	///  @param[in]		filter		The filter the path must have been searched with.
+	///  @param[out]	path		The path. [(polyRef) * @p pathCount]
+	///  @param[out]	pathCount	The number of polygons of the path.
+	///  @param[in]		maxPath		The maximum number of polygons the path buffer can hold.
+	/// @return True if the path was in the cache, and fits in the path buffer.
+	bool find(const dtNavMeshQuery* navquery, dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter,
+			  dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Stores a complete path. Paths longer than the maximum size of the cache are not stored.
+	///  @param[in]		navquery	The query object the path was searched with.
+	///  @param[in]		filter		The filter the path was searched with.
+	///  @param[in]		path		The path, from the start polygon to the end polygon. [(polyRef) * @p pathCount]
+	///  @param[in]		pathCount	The number of polygons of the path.
+	void store(const dtNavMeshQuery* navquery, const dtQueryFilter* filter, const dtPolyRef* path, const int pathCount);
+
+	/// Finds a path with the cache, or with dtNavMeshQuery::findPath() and stores the result if it is complete.
+	/// Same parameters and result as dtNavMeshQuery::findPath(), but a cached path may have been searched
+	/// with other start and end positions.
+	dtStatus findPath(dtNavMeshQuery* navquery, dtPolyRef startRef, dtPolyRef endRef,
+					  const float* startPos, const float* endPos, const dtQueryFilter* filter,
+					  dtPolyRef* path, int* pathCount, const int maxPath);
+
+	/// Discards all the paths.
+	void clear();
+
+	/// Gets the usage statistics of the cache.
+	///  @param[out]	stats	The statistics.
+	void getStats(dtPathCacheStats& stats) const;
+
+	/// Gets the ratio of lookups which found a path. [Limits: 0 <= value <= 1]
+	float getHitRate() const;
+
+	/// Resets the counters of the statistics.
+	void resetStats();
+
+	/// Computes the hash of the settings of a filter used to look up the paths.
+	/// The state of the filters derived from dtQueryFilter, with DT_VIRTUAL_QUERYFILTER, is not hashed.
+	static unsigned int hashFilter(const dtQueryFilter* filter);
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPathCache(const dtPathCache&);
+	dtPathCache& operator=(const dtPathCache&);
+
+	struct Entry
+	{
+		dtPolyRef startRef;
+		dtPolyRef endRef;
+		unsigned int filterHash;
+		unsigned int tilesHash;	///< The hash of the change counts of the tiles of the path and of their neighbours.
+		int pathCount;
+		int prev, next;		///< Neighbours in the list of recently used entries, or of free entries.
+		int nextInBucket;
+	};
+
+	void purge();
+	int findEntry(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const;
+	void removeEntry(const int i);
+	void unlinkEntry(const int i);
+	void linkEntryFirst(const int i);
+	int getBucket(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const;
+	static unsigned int hashTiles(const dtNavMesh* nav, const dtPolyRef* path, const int pathCount);
+
+	Entry* m_entries;
+	dtPolyRef* m_paths;			///< The path of each entry, @p m_maxPathSize polygons each.
+	int* m_buckets;
+	int m_bucketMask;
+	int m_maxPaths;
+	int m_maxPathSize;
+	int m_first;				///< The most recently used entry.
+	int m_last;					///< The least recently used entry.
+	int m_firstFree;
+	dtPathCacheStats m_stats;
+};
+
+#endif // DETOURPATHCACHE_H
@@ -0,0 +1,115 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURPOLYREFREMAP_H
+#define DETOURPOLYREFREMAP_H
+
+#include "DetourNavMesh.h"
+
+/// Translates the references of the polygons of rebuilt tiles to the polygons which replaced them.
+///
+/// Rebuilding a tile changes its salt, and every reference to its polygons becomes invalid, even
+/// when the polygons are the same. Surround the removal and the addition of a tile with
+/// #beginTileRebuild and #endTileRebuild, and the old references can be translated with #remap
+/// to the polygons of the new tile at the same location, for example to repair path corridors
+/// instead of searching new paths.
+///
+/// A polygon is replaced by the polygon of the new tile under its center, or else under one of its
+/// vertices. The polygons without flags, and the off-mesh connections, are never replaced.
+///
+/// A tile spliced by the tile cache keeps its ref, so its polygons keep their base. The rebuilds of
+/// a same base are composed into one, which replaces the polygons of the tile before the first of
+/// them by the polygons after the last one.
+/// @ingroup detour
+class dtPolyRefRemap
+{
+public:
+	dtPolyRefRemap();
+	~dtPolyRefRemap();
+
+	/// Initializes the remap.
+	///  @param[in]		nav				The navigation mesh of the tiles.
+	///  @param[in]		maxRebuilds		The number of tile rebuilds to remember. The oldest rebuilds
+	///  								are forgotten, and their polygons are not remapped anymore. [Limit: > 0]
+	/// @return The status flags for the operation.
+	dtStatus init(const dtNavMesh* nav, const int maxRebuilds);
+
+	/// Records the polygons of a tile which is about to be removed or replaced.
+	///  @param[in]		ref		The reference of the tile. Nothing is recorded if zero.
+	/// @return The status flags for the operation.
+	dtStatus beginTileRebuild(const dtTileRef ref);
+
+	/// Finds the polygons which replace the polygons recorded by #beginTileRebuild.
+	///  @param[in]		ref		The reference of the new tile, zero if the tile was only removed.
+	/// @return The status flags for the operation.
+	dtStatus endTileRebuild(const dtTileRef ref);
+
+	/// Returns the polygon which replaced a polygon of a rebuilt tile, following the later rebuilds.
+	///  @param[in]		ref		The reference of the polygon.
+	/// @return The reference of the replacing polygon, or zero if the polygon is not in a remembered
+	/// rebuild or was not replaced.
+	dtPolyRef remap(const dtPolyRef ref) const;
+
+	/// Forgets all the rebuilds.
+	void clear();
+
+	/// The navigation mesh of the tiles.
+	const dtNavMesh* getNavMesh() const { return m_nav; }
+
+	/// The number of remembered rebuilds.
+	int getRebuildCount() const { return m_nrebuilds; }
+
+	/// Incremented each time a rebuild is recorded. Unlike #getRebuildCount, it also changes when
+	/// the oldest rebuild is forgotten or when the rebuilds of a spliced tile are composed.
+	unsigned int getChangeCount() const { return m_changeCount; }
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtPolyRefRemap(const dtPolyRefRemap&);
+	dtPolyRefRemap& operator=(const dtPolyRefRemap&);
+
+	struct Rebuild
+	{
+		dtPolyRef base;			///< The reference of the first polygon of the old tile.
+		dtPolyRef newBase;		///< The reference of the first polygon of the new tile, zero if the tile was removed.
+		dtPolyRef* newRefs;		///< The replacing polygon of each polygon of the old tile.
+		int polyCount;			///< The number of polygons of the old tile.
+		int capacity;			///< The size of the replacing polygons buffer.
+	};
+
+	void purge();
+	/// The rebuild at an age, 0 being the oldest.
+	Rebuild& getRebuild(const int age) { return m_rebuilds[(m_next - m_nrebuilds + age + m_maxRebuilds) % m_maxRebuilds]; }
+	void removeRebuild(const int age);
+	bool composeRebuild(Rebuild& prev, const Rebuild& next) const;
+
+	const dtNavMesh* m_nav;
+	Rebuild* m_rebuilds;		///< Ring buffer of the rebuilds.
+	int m_maxRebuilds;
+	int m_nrebuilds;
+	int m_next;					///< The slot of the next rebuild.
+	unsigned int m_changeCount;
+
+	dtPolyRef m_pendingBase;	///< The first polygon of the tile recorded by #beginTileRebuild, zero if none.
+	float* m_pendingPoints;		///< The sample points of each recorded polygon.
+	unsigned char* m_pendingPointCounts;
+	int m_pendingPolyCount;
+	int m_pendingCapacity;
+};
+
+#endif // DETOURPOLYREFREMAP_H
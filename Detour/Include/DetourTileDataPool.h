@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef DETOURTILEDATAPOOL_H
+#define DETOURTILEDATAPOOL_H
+
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+
+/// The number of size classes of a #dtTileDataPool. Larger buffers are not pooled.
+static const int DT_TILEDATA_SIZE_CLASSES = 65;
+
+/// Memory usage of a #dtTileDataPool.
+/// @ingroup detour
+struct dtTileDataPoolStats
+{
+	int allocCount;				///< The number of buffers allocated from the pool.
+	int reuseCount;				///< The number of allocations served by a free buffer.
+	int liveCount;				///< The number of buffers in use.
+	int freeCount;				///< The number of free buffers kept for reuse.
+	size_t liveBytes;			///< The size requested for the buffers in use.
+	size_t reservedBytes;		///< The size of the buffers in use and of the free buffers.
+	size_t peakReservedBytes;	///< The high-water mark of #reservedBytes.
+	/// The part of #reservedBytes not used by tile data: the free buffers, and the space
+	/// left at the end of the buffers in use by rounding to size classes. [Limits: 0 <= value <= 1]
+	float fragmentation;
+};
+
+/// A pool of tile data buffers, recycled between the tiles of similar sizes.
+///
+/// The buffers are rounded up to size classes, four per power of two, and released buffers
+/// are kept in a free list per size class for the next tiles. When tiles are rebuilt over and
+/// over, as by dtTileCache, this keeps the memory usage stable and avoids the locks of the
+/// general purpose allocator. The buffers are allocated with dtAlloc().
+///
+/// The pool can be used from several threads at the same time.
+///
+/// Pass the pool to dtCreateNavMeshData(), and add the tiles to the navigation mesh with
+/// the #DT_TILE_FREE_DATA and #DT_TILE_POOLED_DATA flags. All the buffers must be released
+/// before the pool is destroyed.
+/// @ingroup detour
+class dtTileDataPool
+{
+public:
+	///  @param[in]		maxFreeBytes	The maximum total size of the free buffers kept for reuse.
+	explicit dtTileDataPool(size_t maxFreeBytes = 64 << 20);
+	~dtTileDataPool();
+
+	/// Allocates a buffer.
+	///  @param[in]		size	The size of the buffer, in bytes. [Limit: > 0]
+	/// @return The buffer, or null if the allocation failed.
+	unsigned char* allocate(const int size);
+
+	/// Releases a buffer to the pool it was allocated from.
+	///  @param[in]		data	A buffer returned by #allocate. [opt]
+	static void release(unsigned char* data);
+
+	/// Frees the buffers kept for reuse.
+	void trim();
+
+	/// Gets the memory usage of the pool.
+	///  @param[out]	stats	The memory usage.
+	void getStats(dtTileDataPoolStats& stats) const;
+
+	/// The size of the buffers of a size class, in bytes.
+	static int getSizeClassSize(const int sizeClass);
+
+	/// The size class of a buffer size, or -1 if buffers of this size are not pooled.
+	static int getSizeClass(const int size);
+
+private:
+	struct SizeClass
+	{
+		mutable std::mutex lock;
+		void* freeList;
+		int freeCount;
+	};
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtTileDataPool(const dtTileDataPool&);
+	dtTileDataPool& operator=(const dtTileDataPool&);
+
+	void releaseBuffer(unsigned char* mem);
+	void addReserved(const size_t size);
+
+	SizeClass m_classes[DT_TILEDATA_SIZE_CLASSES];
+	size_t m_maxFreeBytes;
+
+	std::atomic<size_t> m_freeBytes;
+	std::atomic<size_t> m_reservedBytes;
+	std::atomic<size_t> m_peakReservedBytes;
+	std::atomic<size_t> m_liveBytes;
+	std::atomic<int> m_liveCount;
+	std::atomic<int> m_allocCount;
+	std::atomic<int> m_reuseCount;
+};
+
+#endif // DETOURTILEDATAPOOL_H
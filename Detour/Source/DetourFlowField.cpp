@@ -0,0 +1,571 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include <float.h>
+#include "DetourFlowField.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+// The states of the polygons during an update.
+static const unsigned char MARK_UNKNOWN = 0;
+static const unsigned char MARK_VALID = 1;		// The path of the polygon reaches the goal.
+static const unsigned char MARK_INVALID = 2;	// The path of the polygon went through a changed tile.
+static const unsigned char MARK_SEEDED = 3;		// The polygon is expanded again.
+
+// Finds the middle of the portal from a polygon to its neighbour, like dtNavMeshQuery::getEdgeMidPoint().
+// Returns false if the polygon has no link to the neighbour.
+static bool getPortalMidPoint(dtPolyRef from, const dtPoly* fromPoly, const dtMeshTile* fromTile,
+							  dtPolyRef to, const dtPoly* toPoly, const dtMeshTile* toTile, float* mid)
+{
+	const dtLink* link = 0;
+	for (unsigned int i = fromPoly->firstLink; i != DT_NULL_LINK; i = fromTile->links[i].next)
+	{
+		if (fromTile->links[i].ref == to)
+		{
+			link = &fromTile->links[i];
+			break;
+		}
+	}
+	if (!link)
+		return false;
+
+	if (fromPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		dtVcopy(mid, &fromTile->verts[fromPoly->verts[link->edge]*3]);
+		return true;
+	}
+
+	if (toPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+	{
+		for (unsigned int i = toPoly->firstLink; i != DT_NULL_LINK; i = toTile->links[i].next)
+		{
+			if (toTile->links[i].ref == from)
+			{
+				dtVcopy(mid, &toTile->verts[toPoly->verts[toTile->links[i].edge]*3]);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	const float* v0 = &fromTile->verts[fromPoly->verts[link->edge]*3];
+	const float* v1 = &fromTile->verts[fromPoly->verts[(link->edge+1) % (int)fromPoly->vertCount]*3];
+	float tmin = 0.0f, tmax = 1.0f;
+	// Links at the tile boundaries can cover only a part of the edge.
+	if (link->side != 0xff && (link->bmin != 0 || link->bmax != 255))
+	{
+		const float s = 1.0f/255.0f;
+		tmin = link->bmin*s;
+		tmax = link->bmax*s;
+	}
+	dtVlerp(mid, v0, v1, (tmin + tmax) * 0.5f);
+
+	return true;
+}
+
+dtFlowField::dtFlowField() :
+	m_nav(0),
+	m_filter(0),
+	m_tiles(0),
+	m_maxTiles(0),
+	m_goalRef(0),
+	m_open(0),
+	m_nopen(0),
+	m_openCapacity(0),
+	m_stack(0),
+	m_stackCapacity(0)
+{
+	dtVset(m_goalPos, 0, 0, 0);
+}
+
+dtFlowField::~dtFlowField()
+{
+	purge();
+}
+
+void dtFlowField::purge()
+{
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		dtFree(m_tiles[i].costs);
+		dtFree(m_tiles[i].next);
+		dtFree(m_tiles[i].marks);
+	}
+	dtFree(m_tiles);
+	m_tiles = 0;
+	m_maxTiles = 0;
+	dtFree(m_open);
+	m_open = 0;
+	m_nopen = 0;
+	m_openCapacity = 0;
+	dtFree(m_stack);
+	m_stack = 0;
+	m_stackCapacity = 0;
+	m_goalRef = 0;
+	m_filter = 0;
+}
+
+dtStatus dtFlowField::init(const dtNavMesh* nav)
+{
+	if (!nav)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+	const int maxTiles = nav->getMaxTiles();
+	m_tiles = (TileField*)dtAlloc(sizeof(TileField)*maxTiles, DT_ALLOC_PERM);
+	if (!m_tiles)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_tiles, 0, sizeof(TileField)*maxTiles);
+	m_maxTiles = maxTiles;
+	m_nav = nav;
+
+	return DT_SUCCESS;
+}
+
+bool dtFlowField::getIndex(dtPolyRef ref, int& it, int& ip) const
+{
+	if (!m_tiles || !ref)
+		return false;
+	unsigned int salt, tileIndex, polyIndex;
+	m_nav->decodePolyId(ref, salt, tileIndex, polyIndex);
+	if ((int)tileIndex >= m_maxTiles)
+		return false;
+	const TileField& field = m_tiles[tileIndex];
+	if ((int)polyIndex >= field.polyCount)
+		return false;
+	// The tile may have changed since the field was updated.
+	const dtMeshTile* tile = m_nav->getTile((int)tileIndex);
+	if (!tile->header || tile->salt != salt || tile->changeCount != field.changeCount)
+		return false;
+	it = (int)tileIndex;
+	ip = (int)polyIndex;
+	return true;
+}
+
+dtStatus dtFlowField::resetTile(const int it)
+{
+	TileField& field = m_tiles[it];
+	const dtMeshTile* tile = m_nav->getTile(it);
+	const int npolys = tile->header ? tile->header->polyCount : 0;
+	if (npolys > field.capacity)
+	{
+		dtFree(field.costs);
+		dtFree(field.next);
+		dtFree(field.marks);
+		field.costs = (float*)dtAlloc(sizeof(float)*npolys, DT_ALLOC_PERM);
+		field.next = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*npolys, DT_ALLOC_PERM);
+		field.marks = (unsigned char*)dtAlloc(sizeof(unsigned char)*npolys, DT_ALLOC_PERM);
+		if (!field.costs || !field.next || !field.marks)
+		{
+			dtFree(field.costs);
+			dtFree(field.next);
+			dtFree(field.marks);
+			memset(&field, 0, sizeof(field));
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		field.capacity = npolys;
+	}
+
+	field.changeCount = tile->changeCount;
+	field.polyCount = npolys;
+	for (int i = 0; i < npolys; ++i)
+	{
+		field.costs[i] = FLT_MAX;
+		field.next[i] = 0;
+		field.marks[i] = MARK_UNKNOWN;
+	}
+
+	return DT_SUCCESS;
+}
+
+void dtFlowField::getNodePos(dtPolyRef ref, const dtMeshTile* tile, const dtPoly* poly, float* pos) const
+{
+	if (ref == m_goalRef)
+	{
+		dtVcopy(pos, m_goalPos);
+		return;
+	}
+
+	// The agents enter the polygon on the portal from the next polygon.
+	const dtPolyRef next = getNextPoly(ref);
+	const dtMeshTile* nextTile = 0;
+	const dtPoly* nextPoly = 0;
+	if (next)
+	{
+		m_nav->getTileAndPolyByRefUnsafe(next, &nextTile, &nextPoly);
+		if (getPortalMidPoint(ref, poly, tile, next, nextPoly, nextTile, pos))
+			return;
+	}
+
+	dtVset(pos, 0, 0, 0);
+	for (int i = 0; i < (int)poly->vertCount; ++i)
+		dtVadd(pos, pos, &tile->verts[poly->verts[i]*3]);
+	dtVscale(pos, pos, 1.0f / (float)poly->vertCount);
+}
+
+dtStatus dtFlowField::pushOpen(dtPolyRef ref, const float cost)
+{
+	if (m_nopen >= m_openCapacity)
+	{
+		const int capacity = m_openCapacity ? m_openCapacity*2 : 64;
+		OpenNode* open = (OpenNode*)dtAlloc(sizeof(OpenNode)*capacity, DT_ALLOC_PERM);
+		if (!open)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		if (m_nopen)
+			memcpy(open, m_open, sizeof(OpenNode)*m_nopen);
+		dtFree(m_open);
+		m_open = open;
+		m_openCapacity = capacity;
+	}
+
+	// Bubble up.
+	int i = m_nopen++;
+	while (i > 0)
+	{
+		const int parent = (i-1)/2;
+		if (m_open[parent].cost <= cost)
+			break;
+		m_open[i] = m_open[parent];
+		i = parent;
+	}
+	m_open[i].cost = cost;
+	m_open[i].ref = ref;
+
+	return DT_SUCCESS;
+}
+
+dtFlowField::OpenNode dtFlowField::popOpen()
+{
+	const OpenNode result = m_open[0];
+	const OpenNode last = m_open[--m_nopen];
+
+	// Trickle down.
+	int i = 0;
+	for (;;)
+	{
+		int child = i*2+1;
+		if (child >= m_nopen)
+			break;
+		if (child+1 < m_nopen && m_open[child+1].cost < m_open[child].cost)
+			child++;
+		if (last.cost <= m_open[child].cost)
+			break;
+		m_open[i] = m_open[child];
+		i = child;
+	}
+	if (m_nopen > 0)
+		m_open[i] = last;
+
+	return result;
+}
+
+dtStatus dtFlowField::expand(const dtNavMeshQuery* navquery)
+{
+	while (m_nopen > 0)
+	{
+		const OpenNode best = popOpen();
+		int it, ip;
+		if (!getIndex(best.ref, it, ip) || best.cost > m_tiles[it].costs[ip])
+			continue;
+
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(best.ref, &bestTile, &bestPoly);
+		float bestPos[3];
+		getNodePos(best.ref, bestTile, bestPoly, bestPos);
+#ifdef DT_VIRTUAL_QUERYFILTER
+		// The polygon after the best one toward the goal.
+		const dtPolyRef nextRef = m_tiles[it].next[ip];
+		const dtMeshTile* nextTile = 0;
+		const dtPoly* nextPoly = 0;
+		if (nextRef)
+			m_nav->getTileAndPolyByRefUnsafe(nextRef, &nextTile, &nextPoly);
+#else
+		const float areaCost = m_filter->getAreaCost(bestPoly->getArea());
+#endif
+
+		for (unsigned int i = bestPoly->firstLink; i != DT_NULL_LINK; i = bestTile->links[i].next)
+		{
+			const dtPolyRef neighbourRef = bestTile->links[i].ref;
+			int nit, nip;
+			if (!getIndex(neighbourRef, nit, nip))
+				continue;
+
+			// The agents move from the neighbour into the best polygon, it must link back to it.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+			float neighbourPos[3];
+			if (!getPortalMidPoint(neighbourRef, neighbourPoly, neighbourTile, best.ref, bestPoly, bestTile, neighbourPos))
+				continue;
+
+			// The cost of the path inside the best polygon.
+#ifdef DT_VIRTUAL_QUERYFILTER
+			const float cost = best.cost + m_filter->getCost(neighbourPos, bestPos, neighbourRef, neighbourTile, neighbourPoly,
+															 best.ref, bestTile, bestPoly, nextRef, nextTile, nextPoly);
+#else
+			const float cost = best.cost + dtVdist(neighbourPos, bestPos) * areaCost;
+#endif
+			TileField& field = m_tiles[nit];
+			if (cost >= field.costs[nip])
+				continue;
+			if (!navquery->isValidPolyRef(neighbourRef, m_filter))
+				continue;
+
+			field.costs[nip] = cost;
+			field.next[nip] = best.ref;
+			const dtStatus status = pushOpen(neighbourRef, cost);
+			if (dtStatusFailed(status))
+				return status;
+		}
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtFlowField::build(const dtNavMeshQuery* navquery, dtPolyRef goalRef, const float* goalPos, const dtQueryFilter* filter)
+{
+	dtAssert(m_nav);
+
+	if (!navquery || navquery->getAttachedNavMesh() != m_nav || !goalPos || !dtVisfinite(goalPos) || !filter)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (!navquery->isValidPolyRef(goalRef, filter))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	m_goalRef = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtStatus status = resetTile(i);
+		if (dtStatusFailed(status))
+			return status;
+	}
+
+	m_filter = filter;
+	m_goalRef = goalRef;
+	dtVcopy(m_goalPos, goalPos);
+
+	int it, ip;
+	if (!getIndex(goalRef, it, ip))
+		return DT_FAILURE | DT_INVALID_PARAM;
+	m_tiles[it].costs[ip] = 0.0f;
+	m_nopen = 0;
+	const dtStatus status = pushOpen(goalRef, 0.0f);
+	if (dtStatusFailed(status))
+		return status;
+
+	return expand(navquery);
+}
+
+bool dtFlowField::isPathValid(dtPolyRef ref)
+{
+	// Walk toward the goal until a polygon of known state, then give that state to the walked polygons.
+	int n = 0;
+	unsigned char state = MARK_INVALID;
+	dtPolyRef cur = ref;
+	for (;;)
+	{
+		int it, ip;
+		if (!getIndex(cur, it, ip) || m_tiles[it].costs[ip] == FLT_MAX)
+			break;
+		const TileField& field = m_tiles[it];
+		if (field.marks[ip] != MARK_UNKNOWN)
+		{
+			state = field.marks[ip];
+			break;
+		}
+
+		if (n >= m_stackCapacity)
+		{
+			const int capacity = m_stackCapacity ? m_stackCapacity*2 : 64;
+			dtPolyRef* stack = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*capacity, DT_ALLOC_PERM);
+			if (!stack)
+				return false;
+			if (n)
+				memcpy(stack, m_stack, sizeof(dtPolyRef)*n);
+			dtFree(m_stack);
+			m_stack = stack;
+			m_stackCapacity = capacity;
+		}
+		m_stack[n++] = cur;
+
+		if (cur == m_goalRef)
+		{
+			state = MARK_VALID;
+			break;
+		}
+		cur = field.next[ip];
+	}
+
+	for (int i = 0; i < n; ++i)
+	{
+		int it, ip;
+		getIndex(m_stack[i], it, ip);
+		m_tiles[it].marks[ip] = state;
+	}
+
+	return state == MARK_VALID;
+}
+
+dtStatus dtFlowField::update(const dtNavMeshQuery* navquery)
+{
+	dtAssert(m_nav);
+
+	if (!navquery || navquery->getAttachedNavMesh() != m_nav || !m_goalRef)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	// Reset the tiles which were added, removed or rebuilt.
+	bool changed = false;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = m_nav->getTile(i);
+		TileField& field = m_tiles[i];
+		if (tile->changeCount == field.changeCount)
+		{
+			for (int j = 0; j < field.polyCount; ++j)
+				field.marks[j] = MARK_UNKNOWN;
+			continue;
+		}
+		const dtStatus status = resetTile(i);
+		if (dtStatusFailed(status))
+			return status;
+		// Mark the new polygons to expand their neighbours.
+		for (int j = 0; j < field.polyCount; ++j)
+			field.marks[j] = MARK_INVALID;
+		changed = true;
+	}
+	if (!changed)
+		return DT_SUCCESS;
+
+	int goalTile, goalPoly;
+	if (!getIndex(m_goalRef, goalTile, goalPoly))
+	{
+		m_goalRef = 0;
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// Forget the paths which went through the changed tiles.
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const TileField& field = m_tiles[i];
+		if (!field.polyCount)
+			continue;
+		const dtPolyRef base = m_nav->getPolyRefBase(m_nav->getTile(i));
+		for (int j = 0; j < field.polyCount; ++j)
+		{
+			if (field.marks[j] == MARK_UNKNOWN && field.costs[j] != FLT_MAX)
+				isPathValid(base | (dtPolyRef)j);
+		}
+	}
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		TileField& field = m_tiles[i];
+		for (int j = 0; j < field.polyCount; ++j)
+		{
+			if (field.marks[j] == MARK_INVALID)
+			{
+				field.costs[j] = FLT_MAX;
+				field.next[j] = 0;
+			}
+		}
+	}
+
+	// Expand again from the valid polygons around the forgotten and the new polygons. The expansion also
+	// lowers the costs of the polygons which are closer to the goal through the new polygons.
+	m_nopen = 0;
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const TileField& field = m_tiles[i];
+		if (!field.polyCount)
+			continue;
+		const dtMeshTile* tile = m_nav->getTile(i);
+		for (int j = 0; j < field.polyCount; ++j)
+		{
+			if (field.marks[j] != MARK_INVALID)
+				continue;
+			const dtPoly* poly = &tile->polys[j];
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				const dtPolyRef neighbourRef = tile->links[k].ref;
+				int nit, nip;
+				if (!getIndex(neighbourRef, nit, nip))
+					continue;
+				TileField& neighbourField = m_tiles[nit];
+				if (neighbourField.marks[nip] != MARK_VALID || neighbourField.costs[nip] == FLT_MAX)
+					continue;
+				neighbourField.marks[nip] = MARK_SEEDED;
+				const dtStatus status = pushOpen(neighbourRef, neighbourField.costs[nip]);
+				if (dtStatusFailed(status))
+					return status;
+			}
+		}
+	}
+
+	return expand(navquery);
+}
+
+float dtFlowField::getCost(dtPolyRef ref) const
+{
+	int it, ip;
+	if (!getIndex(ref, it, ip))
+		return FLT_MAX;
+	return m_tiles[it].costs[ip];
+}
+
+dtPolyRef dtFlowField::getNextPoly(dtPolyRef ref) const
+{
+	int it, ip;
+	if (!getIndex(ref, it, ip))
+		return 0;
+	return m_tiles[it].next[ip];
+}
+
+bool dtFlowField::isReachable(dtPolyRef ref) const
+{
+	return getCost(ref) != FLT_MAX;
+}
+
+dtStatus dtFlowField::getCorridor(dtPolyRef startRef, dtPolyRef* path, int* pathCount, const int maxPath) const
+{
+	if (!path || !pathCount || maxPath <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+	if (!isReachable(startRef))
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	int n = 0;
+	for (dtPolyRef cur = startRef; cur; cur = getNextPoly(cur))
+	{
+		if (n >= maxPath)
+		{
+			*pathCount = n;
+			return DT_SUCCESS | DT_BUFFER_TOO_SMALL;
+		}
+		path[n++] = cur;
+	}
+	*pathCount = n;
+
+	// The tiles of the path changed since the last update.
+	if (path[n-1] != m_goalRef)
+		return DT_SUCCESS | DT_PARTIAL_RESULT;
+
+	return DT_SUCCESS;
+}
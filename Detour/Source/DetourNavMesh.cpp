@@ -20,6 +20,8 @@
 #include <string.h>
 #include <stdio.h>
 #include "DetourNavMesh.h"
+#include "DetourNavMeshConnectivity.h"
+#include "DetourTileDataPool.h"
 #include "DetourNode.h"
 #include "DetourCommon.h"
 #include "DetourMath.h"
@@ -134,6 +136,15 @@ inline void freeLink(dtMeshTile* tile, unsigned int link)
 	tile->linksFreeList = link;
 }
 
+// Frees the data of a tile owning it.
+inline void freeTileData(dtMeshTile& tile)
+{
+	if (tile.flags & DT_TILE_POOLED_DATA)
+		dtTileDataPool::release(tile.data);
+	else
+		dtFree(tile.data);
+}
+
 
 dtNavMesh* dtAllocNavMesh()
 {
@@ -193,7 +204,8 @@ dtNavMesh::dtNavMesh() :
 	m_tileLutMask(0),
 	m_posLookup(0),
 	m_nextFree(0),
-	m_tiles(0)
+	m_tiles(0),
+	m_connectivity(0)
 {
 #ifndef DT_POLYREF64
 	m_saltBits = 0;
@@ -208,11 +220,16 @@ dtNavMesh::dtNavMesh() :
 
 dtNavMesh::~dtNavMesh()
 {
+	if (m_connectivity)
+	{
+		m_connectivity->~dtNavMeshConnectivity();
+		dtFree(m_connectivity);
+	}
 	for (int i = 0; i < m_maxTiles; ++i)
 	{
 		if (m_tiles[i].flags & DT_TILE_FREE_DATA)
 		{
-			dtFree(m_tiles[i].data);
+			freeTileData(m_tiles[i]);
 			m_tiles[i].data = 0;
 			m_tiles[i].dataSize = 0;
 		}
@@ -904,6 +921,9 @@ int dtNavMesh::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, co
 /// should not be reused in other nav meshes until the tile has been successfully
 /// removed from this nav mesh.
 ///
+/// Data allocated from a dtTileDataPool is released to the pool when the tile is removed
+/// if both the #DT_TILE_FREE_DATA and #DT_TILE_POOLED_DATA flags are set.
+///
 /// @see dtCreateNavMeshData, #removeTile
 dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 							dtTileRef lastRef, dtTileRef* result)
@@ -1007,6 +1027,7 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 
 	// Init tile.
 	tile->header = header;
+	tile->changeCount++;
 	tile->data = data;
 	tile->dataSize = dataSize;
 	tile->flags = flags;
@@ -1047,6 +1068,12 @@ dtStatus dtNavMesh::addTile(unsigned char* data, int dataSize, int flags,
 			connectExtOffMeshLinks(neis[j], tile, dtOppositeTile(i));
 		}
 	}
+
+	if (m_connectivity)
+	{
+		m_connectivity->tileAdded(tile);
+		m_connectivity->update();
+	}
 	
 	if (result)
 		*result = getTileRef(tile);
@@ -1248,6 +1275,9 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	dtMeshTile* tile = &m_tiles[tileIndex];
 	if (tile->salt != tileSalt)
 		return DT_FAILURE | DT_INVALID_PARAM;
+
+	if (m_connectivity)
+		m_connectivity->tileRemoved(tile);
 	
 	// Remove tile from hash lookup.
 	int h = computeTileHash(tile->header->x,tile->header->y,m_tileLutMask);
@@ -1292,7 +1322,7 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	if (tile->flags & DT_TILE_FREE_DATA)
 	{
 		// Owns data
-		dtFree(tile->data);
+		freeTileData(*tile);
 		tile->data = 0;
 		tile->dataSize = 0;
 		if (data) *data = 0;
@@ -1305,6 +1335,7 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	}
 
 	tile->header = 0;
+	tile->changeCount++;
 	tile->flags = 0;
 	tile->linksFreeList = 0;
 	tile->polys = 0;
@@ -1329,9 +1360,49 @@ dtStatus dtNavMesh::removeTile(dtTileRef ref, unsigned char** data, int* dataSiz
 	tile->next = m_nextFree;
 	m_nextFree = tile;
 
+	if (m_connectivity)
+		m_connectivity->update();
+
 	return DT_SUCCESS;
 }
 
+/// @par
+///
+/// The index is updated by #addTile, #removeTile, #setPolyFlags and #restoreTileState.
+/// Calling it again replaces the tracked masks, a @p count of zero releases the index.
+///
+/// @see dtNavMeshConnectivity, dtNavMeshQuery::arePolysConnected
+dtStatus dtNavMesh::initConnectivity(const unsigned short* includeFlags, const int count)
+{
+	if (count <= 0)
+	{
+		if (m_connectivity)
+		{
+			m_connectivity->~dtNavMeshConnectivity();
+			dtFree(m_connectivity);
+			m_connectivity = 0;
+		}
+		return DT_SUCCESS;
+	}
+
+	if (!m_connectivity)
+	{
+		void* mem = dtAlloc(sizeof(dtNavMeshConnectivity), DT_ALLOC_PERM);
+		if (!mem)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		m_connectivity = new(mem) dtNavMeshConnectivity;
+	}
+
+	dtStatus status = m_connectivity->init(this, includeFlags, count);
+	if (dtStatusFailed(status))
+	{
+		m_connectivity->~dtNavMeshConnectivity();
+		dtFree(m_connectivity);
+		m_connectivity = 0;
+	}
+	return status;
+}
+
 dtTileRef dtNavMesh::getTileRef(const dtMeshTile* tile) const
 {
 	if (!tile) return 0;
@@ -1442,9 +1513,15 @@ dtStatus dtNavMesh::restoreTileState(dtMeshTile* tile, const unsigned char* data
 	{
 		dtPoly* p = &tile->polys[i];
 		const dtPolyState* s = &polyStates[i];
+		const unsigned short oldFlags = p->flags;
 		p->flags = s->flags;
 		p->setArea(s->area);
+		if (m_connectivity && oldFlags != p->flags)
+			m_connectivity->polyFlagsChanged(tile, i, oldFlags);
 	}
+
+	if (m_connectivity)
+		m_connectivity->update();
 	
 	return DT_SUCCESS;
 }
@@ -1536,7 +1613,14 @@ dtStatus dtNavMesh::setPolyFlags(dtPolyRef ref, unsigned short flags)
 	dtPoly* poly = &tile->polys[ip];
 	
 	// Change flags.
+	const unsigned short oldFlags = poly->flags;
 	poly->flags = flags;
+
+	if (m_connectivity && oldFlags != flags)
+	{
+		m_connectivity->polyFlagsChanged(tile, (int)ip, oldFlags);
+		m_connectivity->update();
+	}
 	
 	return DT_SUCCESS;
 }
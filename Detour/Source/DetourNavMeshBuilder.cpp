@@ -24,6 +24,7 @@
 #include "DetourCommon.h"
 #include "DetourMath.h"
 #include "DetourNavMeshBuilder.h"
+#include "DetourTileDataPool.h"
 #include "DetourAlloc.h"
 #include "DetourAssert.h"
 
@@ -110,7 +111,170 @@ inline int longestAxis(unsigned short x, unsigned short y, unsigned short z)
 	return axis;
 }
 
-static void subdivide(BVItem* items, int nitems, int imin, int imax, int& curNode, dtBVNode* nodes)
+// Number of bins used by the surface area heuristic.
+static const int BV_SAH_BIN_COUNT = 16;
+// Deeper subtrees fall back to median splits to bound the recursion depth.
+static const int BV_SAH_MAX_DEPTH = 48;
+// Smaller subtrees are split at the median, binning them costs more than it saves.
+static const int BV_SAH_MIN_ITEMS = 8;
+
+struct BVBin
+{
+	unsigned short bmin[3];
+	unsigned short bmax[3];
+	int count;
+};
+
+inline void copyBounds(unsigned short* bmin, unsigned short* bmax, const unsigned short* omin, const unsigned short* omax)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		bmin[i] = omin[i];
+		bmax[i] = omax[i];
+	}
+}
+
+inline void expandBounds(unsigned short* bmin, unsigned short* bmax, const unsigned short* omin, const unsigned short* omax)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		if (omin[i] < bmin[i]) bmin[i] = omin[i];
+		if (omax[i] > bmax[i]) bmax[i] = omax[i];
+	}
+}
+
+inline float boundsHalfArea(const unsigned short* bmin, const unsigned short* bmax)
+{
+	// Quantized bounds are inclusive, so a flat box still has some area.
+	const float dx = (float)(bmax[0] - bmin[0]) + 1.0f;
+	const float dy = (float)(bmax[1] - bmin[1]) + 1.0f;
+	const float dz = (float)(bmax[2] - bmin[2]) + 1.0f;
+	return dx*dy + dy*dz + dz*dx;
+}
+
+inline int itemCentroid(const BVItem& it, const int axis)
+{
+	return (int)it.bmin[axis] + (int)it.bmax[axis];
+}
+
+inline int itemBin(const BVItem& it, const int axis, const int cmin, const float scale)
+{
+	const int b = (int)((float)(itemCentroid(it, axis) - cmin) * scale);
+	return dtMin(b, BV_SAH_BIN_COUNT-1);
+}
+
+// Finds the split of items [imin, imax) which minimizes the surface area heuristic, partitions
+// the items around it and returns the split index, or -1 if the items cannot be separated.
+static int partitionSAH(BVItem* items, const int imin, const int imax)
+{
+	int cmin[3], cmax[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		cmin[i] = itemCentroid(items[imin], i);
+		cmax[i] = cmin[i];
+	}
+	for (int i = imin+1; i < imax; ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+		{
+			const int c = itemCentroid(items[i], j);
+			cmin[j] = dtMin(cmin[j], c);
+			cmax[j] = dtMax(cmax[j], c);
+		}
+	}
+
+	BVBin bins[BV_SAH_BIN_COUNT];
+	float rightCost[BV_SAH_BIN_COUNT];
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestBin = 0;
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (cmin[axis] == cmax[axis])
+			continue;
+		const float scale = (float)BV_SAH_BIN_COUNT / (float)(cmax[axis] - cmin[axis] + 1);
+
+		for (int i = 0; i < BV_SAH_BIN_COUNT; ++i)
+			bins[i].count = 0;
+		for (int i = imin; i < imax; ++i)
+		{
+			const BVItem& it = items[i];
+			BVBin& bin = bins[itemBin(it, axis, cmin[axis], scale)];
+			if (bin.count == 0)
+				copyBounds(bin.bmin, bin.bmax, it.bmin, it.bmax);
+			else
+				expandBounds(bin.bmin, bin.bmax, it.bmin, it.bmax);
+			bin.count++;
+		}
+
+		// Sweep from the right to get the cost of every right hand side.
+		unsigned short bmin[3], bmax[3];
+		int count = 0;
+		for (int i = BV_SAH_BIN_COUNT-1; i > 0; --i)
+		{
+			const BVBin& bin = bins[i];
+			if (bin.count)
+			{
+				if (count == 0)
+					copyBounds(bmin, bmax, bin.bmin, bin.bmax);
+				else
+					expandBounds(bmin, bmax, bin.bmin, bin.bmax);
+				count += bin.count;
+			}
+			rightCost[i] = count ? boundsHalfArea(bmin, bmax) * (float)count : 0.0f;
+		}
+
+		// Sweep from the left and evaluate the split after each bin.
+		count = 0;
+		for (int i = 0; i < BV_SAH_BIN_COUNT-1; ++i)
+		{
+			const BVBin& bin = bins[i];
+			if (bin.count)
+			{
+				if (count == 0)
+					copyBounds(bmin, bmax, bin.bmin, bin.bmax);
+				else
+					expandBounds(bmin, bmax, bin.bmin, bin.bmax);
+				count += bin.count;
+			}
+			if (count == 0 || count == imax-imin)
+				continue;
+			const float cost = boundsHalfArea(bmin, bmax) * (float)count + rightCost[i+1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = i;
+			}
+		}
+	}
+
+	if (bestAxis == -1)
+		return -1;
+
+	// Partition the items in place around the best bin.
+	const float scale = (float)BV_SAH_BIN_COUNT / (float)(cmax[bestAxis] - cmin[bestAxis] + 1);
+	int left = imin;
+	int right = imax-1;
+	while (left <= right)
+	{
+		if (itemBin(items[left], bestAxis, cmin[bestAxis], scale) <= bestBin)
+		{
+			left++;
+		}
+		else
+		{
+			dtSwap(items[left], items[right]);
+			right--;
+		}
+	}
+
+	return left;
+}
+
+static void subdivide(BVItem* items, int nitems, int imin, int imax, int& curNode, dtBVNode* nodes,
+					  const int method, const int depth)
 {
 	int inum = imax - imin;
 	int icur = curNode;
@@ -135,32 +299,39 @@ static void subdivide(BVItem* items, int nitems, int imin, int imax, int& curNod
 		// Split
 		calcExtends(items, nitems, imin, imax, node.bmin, node.bmax);
 		
-		int	axis = longestAxis(node.bmax[0] - node.bmin[0],
-							   node.bmax[1] - node.bmin[1],
-							   node.bmax[2] - node.bmin[2]);
-		
-		if (axis == 0)
-		{
-			// Sort along x-axis
-			qsort(items+imin, inum, sizeof(BVItem), compareItemX);
-		}
-		else if (axis == 1)
-		{
-			// Sort along y-axis
-			qsort(items+imin, inum, sizeof(BVItem), compareItemY);
-		}
-		else
+		int isplit = -1;
+		if (method == DT_BVTREE_SAH && depth < BV_SAH_MAX_DEPTH && inum >= BV_SAH_MIN_ITEMS)
+			isplit = partitionSAH(items, imin, imax);
+
+		if (isplit == -1)
 		{
-			// Sort along z-axis
-			qsort(items+imin, inum, sizeof(BVItem), compareItemZ);
+			int	axis = longestAxis(node.bmax[0] - node.bmin[0],
+								   node.bmax[1] - node.bmin[1],
+								   node.bmax[2] - node.bmin[2]);
+			
+			if (axis == 0)
+			{
+				// Sort along x-axis
+				qsort(items+imin, inum, sizeof(BVItem), compareItemX);
+			}
+			else if (axis == 1)
+			{
+				// Sort along y-axis
+				qsort(items+imin, inum, sizeof(BVItem), compareItemY);
+			}
+			else
+			{
+				// Sort along z-axis
+				qsort(items+imin, inum, sizeof(BVItem), compareItemZ);
+			}
+			
+			isplit = imin+inum/2;
 		}
 		
-		int isplit = imin+inum/2;
-		
 		// Left
-		subdivide(items, nitems, imin, isplit, curNode, nodes);
+		subdivide(items, nitems, imin, isplit, curNode, nodes, method, depth+1);
 		// Right
-		subdivide(items, nitems, isplit, imax, curNode, nodes);
+		subdivide(items, nitems, isplit, imax, curNode, nodes, method, depth+1);
 		
 		int iescape = curNode - icur;
 		// Negative index means escape.
@@ -233,7 +404,7 @@ static int createBVTree(dtNavMeshCreateParams* params, dtBVNode* nodes, int /*nn
 	}
 	
 	int curNode = 0;
-	subdivide(items, params->polyCount, 0, params->polyCount, curNode, nodes);
+	subdivide(items, params->polyCount, 0, params->polyCount, curNode, nodes, params->bvTreeBuildMethod, 0);
 	
 	dtFree(items);
 	
@@ -272,12 +443,14 @@ static unsigned char classifyOffMeshPoint(const float* pt, const float* bmin, co
 
 /// @par
 /// 
-/// The output data array is allocated using the detour allocator (dtAlloc()).  The method
-/// used to free the memory will be determined by how the tile is added to the navigation
-/// mesh.
+/// The output data array is allocated using the detour allocator (dtAlloc()), or from
+/// @p dataPool if provided.  The method used to free the memory will be determined by how
+/// the tile is added to the navigation mesh.  Tiles allocated from a pool must be added with
+/// the #DT_TILE_POOLED_DATA flag, or released with dtTileDataPool::release().
 ///
-/// @see dtNavMesh, dtNavMesh::addTile()
-bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize)
+/// @see dtNavMesh, dtNavMesh::addTile(), dtTileDataPool
+bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData, int* outDataSize,
+						 dtTileDataPool* dataPool)
 {
 	if (params->nvp > DT_VERTS_PER_POLYGON)
 		return false;
@@ -438,7 +611,8 @@ bool dtCreateNavMeshData(dtNavMeshCreateParams* params, unsigned char** outData,
 						 detailMeshesSize + detailVertsSize + detailTrisSize +
 						 bvTreeSize + offMeshConsSize;
 						 
-	unsigned char* data = (unsigned char*)dtAlloc(sizeof(unsigned char)*dataSize, DT_ALLOC_PERM);
+	unsigned char* data = dataPool ? dataPool->allocate(dataSize) :
+		(unsigned char*)dtAlloc(sizeof(unsigned char)*dataSize, DT_ALLOC_PERM);
 	if (!data)
 	{
 		dtFree(offMeshConClass);
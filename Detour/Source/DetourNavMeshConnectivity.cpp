@@ -0,0 +1,789 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include <stdlib.h>
+#include "DetourNavMeshConnectivity.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+// Temporary island id of the polygons being relabelled.
+static const unsigned int DT_PENDING_ISLAND = 0xffffffff;
+
+// Island ids are compacted once there are this many times more ids than after the last compaction.
+static const int DT_ISLAND_COMPACT_RATIO = 4;
+static const int DT_ISLAND_MIN_CAPACITY = 256;
+
+struct dtIslandStackItem
+{
+	int tile;
+	int poly;
+};
+
+static int findLocalRoot(int* parent, int i)
+{
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+static int compareTiles(const void* a, const void* b)
+{
+	const int ta = *(const int*)a;
+	const int tb = *(const int*)b;
+	return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static int compareIds(const void* a, const void* b)
+{
+	const unsigned int ia = *(const unsigned int*)a;
+	const unsigned int ib = *(const unsigned int*)b;
+	return ia < ib ? -1 : (ia > ib ? 1 : 0);
+}
+
+// Returns the index of a tile in a sorted array of tiles, or -1.
+static int findSortedTile(const int* tiles, const int count, const int tile)
+{
+	const int* found = (const int*)bsearch(&tile, tiles, count, sizeof(int), compareTiles);
+	return found ? (int)(found - tiles) : -1;
+}
+
+/// @class dtNavMeshConnectivity
+///
+/// The polygons connected inside a tile share an island id, islands spanning several tiles
+/// are merged with a union-find over the ids. Adding a tile or enabling a polygon only merges
+/// islands. Removing a tile or disabling a polygon may split the islands it was part of: their
+/// polygons are found in the tiles listed for each island, and labelled again with a flood fill.
+/// The other islands and their tiles are not visited.
+///
+/// Ids of merged and removed islands are reclaimed by compacting the ids once they outnumber
+/// the islands.
+///
+/// @see dtNavMesh::initConnectivity, dtNavMeshQuery::arePolysConnected
+
+dtNavMeshConnectivity::dtNavMeshConnectivity() :
+	m_nav(0),
+	m_masks(0),
+	m_maskCount(0),
+	m_tileIds(0),
+	m_maxTiles(0),
+	m_parent(0),
+	m_idCount(0),
+	m_idCapacity(0),
+	m_compactAt(0),
+	m_needFlatten(false),
+	m_firstTileNode(0),
+	m_lastTileNode(0),
+	m_tileNodes(0),
+	m_tileNodeCount(0),
+	m_tileNodeCapacity(0),
+	m_freeTileNode(-1),
+	m_tileListsLost(false),
+	m_relabelledTileCount(0),
+	m_dirty(0),
+	m_dirtyCount(0),
+	m_dirtyCapacity(0)
+{
+}
+
+dtNavMeshConnectivity::~dtNavMeshConnectivity()
+{
+	clear();
+}
+
+void dtNavMeshConnectivity::clear()
+{
+	if (m_tileIds)
+	{
+		for (int i = 0; i < m_maxTiles; ++i)
+			dtFree(m_tileIds[i]);
+	}
+	dtFree(m_tileIds);
+	dtFree(m_masks);
+	dtFree(m_parent);
+	dtFree(m_dirty);
+	dtFree(m_firstTileNode);
+	dtFree(m_lastTileNode);
+	dtFree(m_tileNodes);
+	m_nav = 0;
+	m_masks = 0;
+	m_maskCount = 0;
+	m_tileIds = 0;
+	m_maxTiles = 0;
+	m_parent = 0;
+	m_idCount = 0;
+	m_idCapacity = 0;
+	m_compactAt = 0;
+	m_needFlatten = false;
+	m_dirty = 0;
+	m_dirtyCount = 0;
+	m_dirtyCapacity = 0;
+	m_firstTileNode = 0;
+	m_lastTileNode = 0;
+	m_tileNodes = 0;
+	m_tileNodeCount = 0;
+	m_tileNodeCapacity = 0;
+	m_freeTileNode = -1;
+	m_tileListsLost = false;
+	m_relabelledTileCount = 0;
+}
+
+dtStatus dtNavMeshConnectivity::init(const dtNavMesh* nav, const unsigned short* includeFlags, const int count)
+{
+	if (!nav || !includeFlags || count <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	clear();
+
+	m_nav = nav;
+	m_maxTiles = nav->getMaxTiles();
+	m_masks = (unsigned short*)dtAlloc(sizeof(unsigned short) * count, DT_ALLOC_PERM);
+	m_tileIds = (unsigned int**)dtAlloc(sizeof(unsigned int*) * m_maxTiles, DT_ALLOC_PERM);
+	m_parent = (unsigned int*)dtAlloc(sizeof(unsigned int) * DT_ISLAND_MIN_CAPACITY, DT_ALLOC_PERM);
+	m_firstTileNode = (int*)dtAlloc(sizeof(int) * DT_ISLAND_MIN_CAPACITY, DT_ALLOC_PERM);
+	m_lastTileNode = (int*)dtAlloc(sizeof(int) * DT_ISLAND_MIN_CAPACITY, DT_ALLOC_PERM);
+	if (!m_masks || !m_tileIds || !m_parent || !m_firstTileNode || !m_lastTileNode)
+	{
+		clear();
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+	memcpy(m_masks, includeFlags, sizeof(unsigned short) * count);
+	m_maskCount = count;
+	memset(m_tileIds, 0, sizeof(unsigned int*) * m_maxTiles);
+	m_idCapacity = DT_ISLAND_MIN_CAPACITY;
+	m_parent[0] = DT_NULL_ISLAND;
+	m_firstTileNode[0] = -1;
+	m_lastTileNode[0] = -1;
+	m_idCount = 1;
+	m_compactAt = DT_ISLAND_MIN_CAPACITY;
+
+	for (int i = 0; i < m_maxTiles; ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (tile && tile->header)
+			tileAdded(tile);
+	}
+	update();
+
+	return DT_SUCCESS;
+}
+
+int dtNavMeshConnectivity::getTileIndex(const dtMeshTile* tile) const
+{
+	return (int)m_nav->decodePolyIdTile(m_nav->getPolyRefBase(tile));
+}
+
+bool dtNavMeshConnectivity::allocTileIds(const dtMeshTile* tile)
+{
+	const int it = getTileIndex(tile);
+	dtFree(m_tileIds[it]);
+	const int n = tile->header->polyCount * m_maskCount;
+	m_tileIds[it] = (unsigned int*)dtAlloc(sizeof(unsigned int) * dtMax(n, 1), DT_ALLOC_PERM);
+	if (!m_tileIds[it])
+		return false;
+	memset(m_tileIds[it], 0, sizeof(unsigned int) * n);
+	return true;
+}
+
+unsigned int dtNavMeshConnectivity::allocId(const int tile)
+{
+	if (m_idCount >= m_idCapacity)
+	{
+		const int capacity = m_idCapacity * 2;
+		unsigned int* parent = (unsigned int*)dtAlloc(sizeof(unsigned int) * capacity, DT_ALLOC_PERM);
+		int* firstTileNode = (int*)dtAlloc(sizeof(int) * capacity, DT_ALLOC_PERM);
+		int* lastTileNode = (int*)dtAlloc(sizeof(int) * capacity, DT_ALLOC_PERM);
+		if (!parent || !firstTileNode || !lastTileNode)
+		{
+			dtFree(parent);
+			dtFree(firstTileNode);
+			dtFree(lastTileNode);
+			return DT_NULL_ISLAND;
+		}
+		memcpy(parent, m_parent, sizeof(unsigned int) * m_idCount);
+		memcpy(firstTileNode, m_firstTileNode, sizeof(int) * m_idCount);
+		memcpy(lastTileNode, m_lastTileNode, sizeof(int) * m_idCount);
+		dtFree(m_parent);
+		dtFree(m_firstTileNode);
+		dtFree(m_lastTileNode);
+		m_parent = parent;
+		m_firstTileNode = firstTileNode;
+		m_lastTileNode = lastTileNode;
+		m_idCapacity = capacity;
+	}
+	const unsigned int id = (unsigned int)m_idCount++;
+	m_parent[id] = id;
+	m_firstTileNode[id] = -1;
+	m_lastTileNode[id] = -1;
+	addIslandTile(id, tile);
+	return id;
+}
+
+void dtNavMeshConnectivity::addIslandTile(const unsigned int id, const int tile)
+{
+	const int last = m_lastTileNode[id];
+	if (last != -1 && m_tileNodes[last].tile == tile)
+		return;
+
+	int node = m_freeTileNode;
+	if (node != -1)
+	{
+		m_freeTileNode = m_tileNodes[node].next;
+	}
+	else
+	{
+		if (m_tileNodeCount >= m_tileNodeCapacity)
+		{
+			const int capacity = dtMax(DT_ISLAND_MIN_CAPACITY, m_tileNodeCapacity * 2);
+			TileNode* nodes = (TileNode*)dtAlloc(sizeof(TileNode) * capacity, DT_ALLOC_PERM);
+			if (!nodes)
+			{
+				m_tileListsLost = true;
+				return;
+			}
+			if (m_tileNodeCount)
+				memcpy(nodes, m_tileNodes, sizeof(TileNode) * m_tileNodeCount);
+			dtFree(m_tileNodes);
+			m_tileNodes = nodes;
+			m_tileNodeCapacity = capacity;
+		}
+		node = m_tileNodeCount++;
+	}
+
+	m_tileNodes[node].tile = tile;
+	m_tileNodes[node].next = -1;
+	if (last != -1)
+		m_tileNodes[last].next = node;
+	else
+		m_firstTileNode[id] = node;
+	m_lastTileNode[id] = node;
+}
+
+void dtNavMeshConnectivity::freeIslandTiles(const unsigned int id)
+{
+	if (m_firstTileNode[id] == -1)
+		return;
+	m_tileNodes[m_lastTileNode[id]].next = m_freeTileNode;
+	m_freeTileNode = m_firstTileNode[id];
+	m_firstTileNode[id] = -1;
+	m_lastTileNode[id] = -1;
+}
+
+// Lists the tiles of the islands again from their polygons, dropping the duplicates.
+void dtNavMeshConnectivity::rebuildIslandTiles()
+{
+	m_tileNodeCount = 0;
+	m_freeTileNode = -1;
+	m_tileListsLost = false;
+	for (int i = 0; i < m_idCount; ++i)
+	{
+		m_firstTileNode[i] = -1;
+		m_lastTileNode[i] = -1;
+	}
+	for (int it = 0; it < m_maxTiles; ++it)
+	{
+		const unsigned int* ids = m_tileIds[it];
+		if (!ids)
+			continue;
+		const int n = m_nav->getTile(it)->header->polyCount * m_maskCount;
+		for (int i = 0; i < n; ++i)
+		{
+			if (ids[i] != DT_NULL_ISLAND)
+				addIslandTile(findRoot(ids[i]), it);
+		}
+	}
+}
+
+unsigned int dtNavMeshConnectivity::findRoot(unsigned int id)
+{
+	while (m_parent[id] != id)
+	{
+		m_parent[id] = m_parent[m_parent[id]];
+		id = m_parent[id];
+	}
+	return id;
+}
+
+void dtNavMeshConnectivity::unite(unsigned int a, unsigned int b)
+{
+	a = findRoot(a);
+	b = findRoot(b);
+	if (a == b)
+		return;
+	// Keep the oldest id, so that islands tend to keep their id when they grow.
+	const unsigned int root = dtMin(a, b);
+	const unsigned int child = dtMax(a, b);
+	m_parent[child] = root;
+	m_needFlatten = true;
+
+	// The root island gets the tiles of the child.
+	if (m_firstTileNode[child] != -1)
+	{
+		if (m_lastTileNode[root] != -1)
+			m_tileNodes[m_lastTileNode[root]].next = m_firstTileNode[child];
+		else
+			m_firstTileNode[root] = m_firstTileNode[child];
+		m_lastTileNode[root] = m_lastTileNode[child];
+		m_firstTileNode[child] = -1;
+		m_lastTileNode[child] = -1;
+	}
+}
+
+// Merges the islands of a polygon with the islands of the polygons it links to.
+void dtNavMeshConnectivity::uniteLinks(const dtMeshTile* tile, const int polyIdx)
+{
+	const unsigned int* ids = m_tileIds[getTileIndex(tile)];
+	const dtPoly* poly = &tile->polys[polyIdx];
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		const dtPolyRef ref = tile->links[i].ref;
+		if (!ref)
+			continue;
+		const unsigned int* neiIds = m_tileIds[m_nav->decodePolyIdTile(ref)];
+		if (!neiIds)
+			continue;
+		const unsigned int ip = m_nav->decodePolyIdPoly(ref);
+		for (int m = 0; m < m_maskCount; ++m)
+		{
+			const unsigned int a = ids[polyIdx * m_maskCount + m];
+			const unsigned int b = neiIds[ip * m_maskCount + m];
+			if (a != DT_NULL_ISLAND && b != DT_NULL_ISLAND && a != b)
+				unite(a, b);
+		}
+	}
+}
+
+// One-way off-mesh connections landing in the tile are only linked from the connection,
+// which can be stored in any tile around.
+void dtNavMeshConnectivity::uniteIncomingOffMeshLinks(const dtMeshTile* tile)
+{
+	const int tileIdx = getTileIndex(tile);
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			const int nneis = m_nav->getTilesAt(tile->header->x + dx, tile->header->y + dy, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				const dtMeshTile* nei = neis[j];
+				if (nei == tile || !m_tileIds[getTileIndex(nei)])
+					continue;
+				for (int k = 0; k < nei->header->offMeshConCount; ++k)
+				{
+					const int conPoly = nei->offMeshCons[k].poly;
+					const dtPoly* poly = &nei->polys[conPoly];
+					for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = nei->links[i].next)
+					{
+						if ((int)m_nav->decodePolyIdTile(nei->links[i].ref) == tileIdx)
+						{
+							uniteLinks(nei, conPoly);
+							break;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void dtNavMeshConnectivity::tileAdded(const dtMeshTile* tile)
+{
+	if (!allocTileIds(tile))
+		return;
+
+	const int tileIdx = getTileIndex(tile);
+	unsigned int* ids = m_tileIds[tileIdx];
+	const int polyCount = tile->header->polyCount;
+	int* local = (int*)dtAlloc(sizeof(int) * dtMax(polyCount, 1), DT_ALLOC_TEMP);
+	if (!local)
+		return;
+
+	// Label the components inside the tile first, so that the tile needs one id per
+	// component rather than one per polygon.
+	for (int m = 0; m < m_maskCount; ++m)
+	{
+		const unsigned short mask = m_masks[m];
+		for (int i = 0; i < polyCount; ++i)
+			local[i] = (tile->polys[i].flags & mask) ? i : -1;
+		for (int i = 0; i < polyCount; ++i)
+		{
+			if (local[i] == -1)
+				continue;
+			const dtPoly* poly = &tile->polys[i];
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				const dtPolyRef ref = tile->links[k].ref;
+				if (!ref || (int)m_nav->decodePolyIdTile(ref) != tileIdx)
+					continue;
+				const int j = (int)m_nav->decodePolyIdPoly(ref);
+				if (local[j] == -1)
+					continue;
+				const int a = findLocalRoot(local, i);
+				const int b = findLocalRoot(local, j);
+				if (a != b)
+					local[dtMax(a, b)] = dtMin(a, b);
+			}
+		}
+		for (int i = 0; i < polyCount; ++i)
+		{
+			if (local[i] == -1)
+				continue;
+			const int root = findLocalRoot(local, i);
+			if (ids[root * m_maskCount + m] == DT_NULL_ISLAND)
+				ids[root * m_maskCount + m] = allocId(tileIdx);
+			ids[i * m_maskCount + m] = ids[root * m_maskCount + m];
+		}
+	}
+	dtFree(local);
+
+	// Merge with the neighbour tiles.
+	for (int i = 0; i < polyCount; ++i)
+		uniteLinks(tile, i);
+	uniteIncomingOffMeshLinks(tile);
+}
+
+void dtNavMeshConnectivity::tileRemoved(const dtMeshTile* tile)
+{
+	const int tileIdx = getTileIndex(tile);
+	unsigned int* ids = m_tileIds[tileIdx];
+	if (!ids)
+		return;
+	const int n = tile->header->polyCount * m_maskCount;
+	for (int i = 0; i < n; ++i)
+	{
+		if (ids[i] != DT_NULL_ISLAND)
+			markDirty(ids[i]);
+	}
+	dtFree(ids);
+	m_tileIds[tileIdx] = 0;
+}
+
+void dtNavMeshConnectivity::polyFlagsChanged(const dtMeshTile* tile, const int polyIdx, const unsigned short oldFlags)
+{
+	const int tileIdx = getTileIndex(tile);
+	unsigned int* ids = m_tileIds[tileIdx];
+	if (!ids)
+		return;
+	const unsigned short flags = tile->polys[polyIdx].flags;
+	bool gained = false;
+	for (int m = 0; m < m_maskCount; ++m)
+	{
+		const bool before = (oldFlags & m_masks[m]) != 0;
+		const bool after = (flags & m_masks[m]) != 0;
+		unsigned int& id = ids[polyIdx * m_maskCount + m];
+		if (before && !after && id != DT_NULL_ISLAND)
+		{
+			markDirty(id);
+			id = DT_NULL_ISLAND;
+		}
+		else if (!before && after)
+		{
+			id = allocId(tileIdx);
+			gained = true;
+		}
+	}
+	if (gained)
+	{
+		uniteLinks(tile, polyIdx);
+		uniteIncomingOffMeshLinks(tile);
+	}
+}
+
+void dtNavMeshConnectivity::markDirty(const unsigned int id)
+{
+	const unsigned int root = findRoot(id);
+	for (int i = 0; i < m_dirtyCount; ++i)
+	{
+		if (m_dirty[i] == root)
+			return;
+	}
+	if (m_dirtyCount >= m_dirtyCapacity)
+	{
+		const int capacity = dtMax(16, m_dirtyCapacity * 2);
+		unsigned int* dirty = (unsigned int*)dtAlloc(sizeof(unsigned int) * capacity, DT_ALLOC_PERM);
+		if (!dirty)
+			return;
+		if (m_dirtyCount)
+			memcpy(dirty, m_dirty, sizeof(unsigned int) * m_dirtyCount);
+		dtFree(m_dirty);
+		m_dirty = dirty;
+		m_dirtyCapacity = capacity;
+	}
+	m_dirty[m_dirtyCount++] = root;
+}
+
+void dtNavMeshConnectivity::update()
+{
+	if (m_dirtyCount)
+		relabelDirty();
+	if (m_needFlatten)
+		flatten();
+	if (m_idCount > m_compactAt)
+		compact();
+}
+
+void dtNavMeshConnectivity::relabelDirty()
+{
+	// The dirty islands may have been merged since they were marked.
+	int rootCount = 0;
+	for (int i = 0; i < m_dirtyCount; ++i)
+	{
+		const unsigned int root = findRoot(m_dirty[i]);
+		int j = 0;
+		while (j < rootCount && m_dirty[j] != root)
+			j++;
+		if (j == rootCount)
+			m_dirty[rootCount++] = root;
+	}
+	m_dirtyCount = 0;
+	qsort(m_dirty, rootCount, sizeof(unsigned int), compareIds);
+
+	// Only the tiles of the dirty islands can hold their polygons.
+	int maxTileCount = 0;
+	if (m_tileListsLost)
+	{
+		maxTileCount = m_maxTiles;
+	}
+	else
+	{
+		for (int i = 0; i < rootCount; ++i)
+		{
+			for (int n = m_firstTileNode[m_dirty[i]]; n != -1; n = m_tileNodes[n].next)
+				maxTileCount++;
+		}
+	}
+	int* tiles = (int*)dtAlloc(sizeof(int) * dtMax(maxTileCount, 1), DT_ALLOC_TEMP);
+	unsigned int* tileLastIds = (unsigned int*)dtAlloc(sizeof(unsigned int) * dtMax(maxTileCount, 1), DT_ALLOC_TEMP);
+	if (!tiles || !tileLastIds)
+	{
+		dtFree(tiles);
+		dtFree(tileLastIds);
+		return;
+	}
+	int tileCount = 0;
+	if (m_tileListsLost)
+	{
+		for (int it = 0; it < m_maxTiles; ++it)
+		{
+			if (m_tileIds[it])
+				tiles[tileCount++] = it;
+		}
+	}
+	else
+	{
+		for (int i = 0; i < rootCount; ++i)
+		{
+			for (int n = m_firstTileNode[m_dirty[i]]; n != -1; n = m_tileNodes[n].next)
+			{
+				if (m_tileIds[m_tileNodes[n].tile])
+					tiles[tileCount++] = m_tileNodes[n].tile;
+			}
+		}
+		qsort(tiles, tileCount, sizeof(int), compareTiles);
+		int unique = 0;
+		for (int i = 0; i < tileCount; ++i)
+		{
+			if (unique == 0 || tiles[unique - 1] != tiles[i])
+				tiles[unique++] = tiles[i];
+		}
+		tileCount = unique;
+	}
+	for (int i = 0; i < rootCount; ++i)
+		freeIslandTiles(m_dirty[i]);
+	m_relabelledTileCount = tileCount;
+
+	// Find the polygons of the dirty islands.
+	int pendingCount = 0;
+	for (int t = 0; t < tileCount; ++t)
+	{
+		unsigned int* ids = m_tileIds[tiles[t]];
+		const int n = m_nav->getTile(tiles[t])->header->polyCount * m_maskCount;
+		for (int i = 0; i < n; ++i)
+		{
+			if (ids[i] == DT_NULL_ISLAND)
+				continue;
+			const unsigned int root = findRoot(ids[i]);
+			if (bsearch(&root, m_dirty, rootCount, sizeof(unsigned int), compareIds))
+			{
+				ids[i] = DT_PENDING_ISLAND;
+				pendingCount++;
+			}
+		}
+	}
+
+	dtIslandStackItem* stack = pendingCount ? (dtIslandStackItem*)dtAlloc(sizeof(dtIslandStackItem) * pendingCount, DT_ALLOC_TEMP) : 0;
+	if (!stack)
+	{
+		dtFree(tiles);
+		dtFree(tileLastIds);
+		return;
+	}
+
+	// Flood fill them again.
+	for (int m = 0; m < m_maskCount; ++m)
+	{
+		for (int t = 0; t < tileCount; ++t)
+			tileLastIds[t] = DT_NULL_ISLAND;
+		for (int t = 0; t < tileCount; ++t)
+		{
+			const int it = tiles[t];
+			unsigned int* ids = m_tileIds[it];
+			const int polyCount = m_nav->getTile(it)->header->polyCount;
+			for (int ip = 0; ip < polyCount; ++ip)
+			{
+				if (ids[ip * m_maskCount + m] != DT_PENDING_ISLAND)
+					continue;
+
+				const unsigned int id = allocId(it);
+				ids[ip * m_maskCount + m] = id;
+				if (id == DT_NULL_ISLAND)
+					continue;
+				tileLastIds[t] = id;
+				int stackSize = 0;
+				stack[stackSize].tile = it;
+				stack[stackSize].poly = ip;
+				stackSize++;
+				while (stackSize > 0)
+				{
+					stackSize--;
+					const int curTile = stack[stackSize].tile;
+					const dtMeshTile* tile = m_nav->getTile(curTile);
+					const dtPoly* poly = &tile->polys[stack[stackSize].poly];
+					for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+					{
+						const dtPolyRef ref = tile->links[k].ref;
+						if (!ref)
+							continue;
+						const int neiTile = (int)m_nav->decodePolyIdTile(ref);
+						unsigned int* neiIds = m_tileIds[neiTile];
+						if (!neiIds)
+							continue;
+						const int neiPoly = (int)m_nav->decodePolyIdPoly(ref);
+						unsigned int& neiId = neiIds[neiPoly * m_maskCount + m];
+						if (neiId == DT_PENDING_ISLAND)
+						{
+							neiId = id;
+							// Pending polygons are only in the scanned tiles.
+							if (neiTile != curTile)
+							{
+								const int nt = findSortedTile(tiles, tileCount, neiTile);
+								if (tileLastIds[nt] != id)
+								{
+									// The island may have been merged into an older one already.
+									tileLastIds[nt] = id;
+									addIslandTile(findRoot(id), neiTile);
+								}
+							}
+							stack[stackSize].tile = neiTile;
+							stack[stackSize].poly = neiPoly;
+							stackSize++;
+						}
+						else if (neiId != DT_NULL_ISLAND && neiId != id)
+						{
+							// Reached through a one-way link from an island filled earlier.
+							unite(id, neiId);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	dtFree(stack);
+	dtFree(tiles);
+	dtFree(tileLastIds);
+
+	if (m_tileListsLost)
+		rebuildIslandTiles();
+}
+
+void dtNavMeshConnectivity::flatten()
+{
+	for (int i = 1; i < m_idCount; ++i)
+		m_parent[i] = findRoot((unsigned int)i);
+	m_needFlatten = false;
+}
+
+void dtNavMeshConnectivity::compact()
+{
+	unsigned int* remap = (unsigned int*)dtAlloc(sizeof(unsigned int) * m_idCount, DT_ALLOC_TEMP);
+	if (!remap)
+		return;
+	memset(remap, 0, sizeof(unsigned int) * m_idCount);
+
+	unsigned int next = 1;
+	for (int it = 0; it < m_maxTiles; ++it)
+	{
+		unsigned int* ids = m_tileIds[it];
+		if (!ids)
+			continue;
+		const int n = m_nav->getTile(it)->header->polyCount * m_maskCount;
+		for (int i = 0; i < n; ++i)
+		{
+			if (ids[i] == DT_NULL_ISLAND)
+				continue;
+			const unsigned int root = m_parent[ids[i]];
+			if (!remap[root])
+				remap[root] = next++;
+			ids[i] = remap[root];
+		}
+	}
+	dtFree(remap);
+
+	for (unsigned int i = 0; i < next; ++i)
+		m_parent[i] = i;
+	m_idCount = (int)next;
+	m_compactAt = dtMax(DT_ISLAND_MIN_CAPACITY, m_idCount * DT_ISLAND_COMPACT_RATIO);
+	rebuildIslandTiles();
+}
+
+unsigned int dtNavMeshConnectivity::getPolyIsland(dtPolyRef ref, const int mask) const
+{
+	dtAssert(mask >= 0 && mask < m_maskCount);
+	const unsigned int it = m_nav->decodePolyIdTile(ref);
+	if ((int)it >= m_maxTiles || !m_tileIds[it])
+		return DT_NULL_ISLAND;
+	const unsigned int ip = m_nav->decodePolyIdPoly(ref);
+	return m_parent[m_tileIds[it][ip * m_maskCount + mask]];
+}
+
+int dtNavMeshConnectivity::findMask(const unsigned short includeFlags) const
+{
+	int best = -1;
+	int bestExtra = 0;
+	for (int m = 0; m < m_maskCount; ++m)
+	{
+		if (includeFlags & ~m_masks[m])
+			continue;
+		int extra = 0;
+		for (unsigned short bits = (unsigned short)(m_masks[m] & ~includeFlags); bits; bits &= (unsigned short)(bits - 1))
+			extra++;
+		if (best == -1 || extra < bestExtra)
+		{
+			best = m;
+			bestExtra = extra;
+		}
+	}
+	return best;
+}
@@ -17,9 +17,11 @@
 //
 
 #include <float.h>
+#include <stdlib.h>
 #include <string.h>
 #include "DetourNavMeshQuery.h"
 #include "DetourNavMesh.h"
+#include "DetourNavMeshConnectivity.h"
 #include "DetourNode.h"
 #include "DetourCommon.h"
 #include "DetourMath.h"
@@ -102,6 +104,9 @@ inline float dtQueryFilter::getCost(const float* pa, const float* pb,
 	
 static const float H_SCALE = 0.999f; // Search heuristic scale.
 
+// Node state of the backward search of the bidirectional findPath, the other state bits hold the tile crossing side.
+static const unsigned char DT_NODE_REVERSE_SEARCH = 1 << (DT_NODE_STATE_BITS - 1);
+
 
 dtNavMeshQuery* dtAllocNavMeshQuery()
 {
@@ -144,7 +149,8 @@ dtNavMeshQuery::dtNavMeshQuery() :
 	m_nav(0),
 	m_tinyNodePool(0),
 	m_nodePool(0),
-	m_openList(0)
+	m_openList(0),
+	m_reverseOpenList(0)
 {
 	memset(&m_query, 0, sizeof(dtQueryData));
 }
@@ -157,9 +163,12 @@ dtNavMeshQuery::~dtNavMeshQuery()
 		m_nodePool->~dtNodePool();
 	if (m_openList)
 		m_openList->~dtNodeQueue();
+	if (m_reverseOpenList)
+		m_reverseOpenList->~dtNodeQueue();
 	dtFree(m_tinyNodePool);
 	dtFree(m_nodePool);
 	dtFree(m_openList);
+	dtFree(m_reverseOpenList);
 }
 
 /// @par 
@@ -219,6 +228,14 @@ dtStatus dtNavMeshQuery::init(const dtNavMesh* nav, const int maxNodes)
 	{
 		m_openList->clear();
 	}
+
+	// The open list of the backward search is allocated by the first bidirectional search.
+	if (m_reverseOpenList && m_reverseOpenList->getCapacity() < maxNodes)
+	{
+		m_reverseOpenList->~dtNodeQueue();
+		dtFree(m_reverseOpenList);
+		m_reverseOpenList = 0;
+	}
 	
 	return DT_SUCCESS;
 }
@@ -620,6 +637,22 @@ dtStatus dtNavMeshQuery::getPolyHeight(dtPolyRef ref, const float* pos, float* h
 		: DT_FAILURE | DT_INVALID_PARAM;
 }
 
+// Returns the distance used to rank the polygons found around a point by findNearestPoly.
+static float nearestPolyDistanceSqr(const dtMeshTile* tile, const float* center, const float* closestPtPoly,
+									const bool posOverPoly)
+{
+	// If a point is directly over a polygon and closer than
+	// climb height, favor that instead of straight line nearest point.
+	float diff[3];
+	dtVsub(diff, center, closestPtPoly);
+	if (posOverPoly)
+	{
+		const float d = dtAbs(diff[1]) - tile->header->walkableClimb;
+		return d > 0 ? d*d : 0;
+	}
+	return dtVlenSqr(diff);
+}
+
 class dtFindNearestPolyQuery : public dtPolyQuery
 {
 	const dtNavMeshQuery* m_query;
@@ -649,23 +682,9 @@ public:
 		{
 			dtPolyRef ref = refs[i];
 			float closestPtPoly[3];
-			float diff[3];
 			bool posOverPoly = false;
-			float d;
 			m_query->closestPointOnPoly(ref, m_center, closestPtPoly, &posOverPoly);
-
-			// If a point is directly over a polygon and closer than
-			// climb height, favor that instead of straight line nearest point.
-			dtVsub(diff, m_center, closestPtPoly);
-			if (posOverPoly)
-			{
-				d = dtAbs(diff[1]) - tile->header->walkableClimb;
-				d = d > 0 ? d*d : 0;			
-			}
-			else
-			{
-				d = dtVlenSqr(diff);
-			}
+			const float d = nearestPolyDistanceSqr(tile, m_center, closestPtPoly, posOverPoly);
 			
 			if (d < m_nearestDistanceSqr)
 			{
@@ -729,6 +748,338 @@ dtStatus dtNavMeshQuery::findNearestPoly(const float* center, const float* halfE
 	return DT_SUCCESS;
 }
 
+namespace
+{
+// A point of a findNearestPolyBatch query, paired with one of the tiles its search box touches.
+struct dtNearestPolyBatchItem
+{
+	int tx, ty;
+	unsigned int order;	///< Morton code of the point, keeps nearby points next to each other.
+	int index;			///< Index of the point in the query.
+};
+
+// Number of points sharing a bounding volume tree traversal.
+const int NEAREST_POLY_BATCH_SIZE = 32;
+
+inline unsigned int mortonSpread(unsigned int v)
+{
+	v &= 0xffff;
+	v = (v | (v << 8)) & 0x00ff00ff;
+	v = (v | (v << 4)) & 0x0f0f0f0f;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+int compareNearestPolyBatchItem(const void* va, const void* vb)
+{
+	const dtNearestPolyBatchItem* a = (const dtNearestPolyBatchItem*)va;
+	const dtNearestPolyBatchItem* b = (const dtNearestPolyBatchItem*)vb;
+	// Same tile order as queryPolygons, so that ties are resolved the same way.
+	if (a->ty != b->ty) return a->ty < b->ty ? -1 : 1;
+	if (a->tx != b->tx) return a->tx < b->tx ? -1 : 1;
+	if (a->order != b->order) return a->order < b->order ? -1 : 1;
+	if (a->index != b->index) return a->index < b->index ? -1 : 1;
+	return 0;
+}
+
+// Returns a lower bound of nearestPolyDistanceSqr for any polygon within the specified bounds.
+inline float nearestPolyDistanceSqrLowerBound(const dtMeshTile* tile, const float* center, const float* bmin, const float* bmax)
+{
+	float distSqr = 0;
+	for (int i = 0; i < 3; ++i)
+	{
+		float d = 0;
+		if (center[i] < bmin[i])
+			d = bmin[i] - center[i];
+		else if (center[i] > bmax[i])
+			d = center[i] - bmax[i];
+		distSqr += d*d;
+	}
+	// A point over a polygon has no horizontal distance to its bounds either, so the climb
+	// tolerance of nearestPolyDistanceSqr only applies to the vertical distance.
+	const float d = dtMathSqrtf(distSqr) - tile->header->walkableClimb;
+	return d > 0 ? d*d : 0;
+}
+
+// Shared state of a findNearestPolyBatch query.
+struct dtNearestPolyBatch
+{
+	const dtNavMeshQuery* query;
+	const float* centers;
+	const float* halfExtents;
+	const dtQueryFilter* filter;
+	dtPolyRef* nearestRefs;
+	float* nearestPts;
+	bool* isOverPoly;
+	float* nearestDistanceSqr;
+
+	void processPoly(const dtMeshTile* tile, const dtPolyRef ref, const int index, const float* pbmin, const float* pbmax) const
+	{
+		const float* center = &centers[index*3];
+		// Skip the polygons which cannot be closer than the current nearest one.
+		if (nearestPolyDistanceSqrLowerBound(tile, center, pbmin, pbmax) >= nearestDistanceSqr[index])
+			return;
+
+		float closestPtPoly[3];
+		bool posOverPoly = false;
+		query->closestPointOnPoly(ref, center, closestPtPoly, &posOverPoly);
+		const float d = nearestPolyDistanceSqr(tile, center, closestPtPoly, posOverPoly);
+		if (d < nearestDistanceSqr[index])
+		{
+			nearestDistanceSqr[index] = d;
+			nearestRefs[index] = ref;
+			if (nearestPts)
+				dtVcopy(&nearestPts[index*3], closestPtPoly);
+			if (isOverPoly)
+				isOverPoly[index] = posOverPoly;
+		}
+	}
+};
+}
+
+// Finds the nearest polygons of up to NEAREST_POLY_BATCH_SIZE points in a tile with a single traversal
+// of the tile's bounding volume tree, using the union of the points' search boxes.
+static void findNearestPolyInTileBatch(const dtNavMesh* nav, const dtMeshTile* tile, const dtNearestPolyBatch& batch,
+									   const dtNearestPolyBatchItem* items, const int nitems)
+{
+	dtAssert(nitems <= NEAREST_POLY_BATCH_SIZE);
+
+	const dtPolyRef base = nav->getPolyRefBase(tile);
+	float qmin[NEAREST_POLY_BATCH_SIZE][3], qmax[NEAREST_POLY_BATCH_SIZE][3];
+	for (int i = 0; i < nitems; ++i)
+	{
+		const float* center = &batch.centers[items[i].index*3];
+		dtVsub(qmin[i], center, batch.halfExtents);
+		dtVadd(qmax[i], center, batch.halfExtents);
+	}
+
+	if (tile->bvTree)
+	{
+		const dtBVNode* node = &tile->bvTree[0];
+		const dtBVNode* end = &tile->bvTree[tile->header->bvNodeCount];
+		const float* tbmin = tile->header->bmin;
+		const float* tbmax = tile->header->bmax;
+		const float qfac = tile->header->bvQuantFactor;
+		const float cs = 1.0f / qfac;
+
+		// Calculate the quantized box of each point, the same way as queryPolygonsInTile, and their union.
+		unsigned short bmin[NEAREST_POLY_BATCH_SIZE][3], bmax[NEAREST_POLY_BATCH_SIZE][3];
+		unsigned short umin[3] = { 0xffff, 0xffff, 0xffff };
+		unsigned short umax[3] = { 0, 0, 0 };
+		for (int i = 0; i < nitems; ++i)
+		{
+			for (int j = 0; j < 3; ++j)
+			{
+				const float minv = dtClamp(qmin[i][j], tbmin[j], tbmax[j]) - tbmin[j];
+				const float maxv = dtClamp(qmax[i][j], tbmin[j], tbmax[j]) - tbmin[j];
+				bmin[i][j] = (unsigned short)(qfac * minv) & 0xfffe;
+				bmax[i][j] = (unsigned short)(qfac * maxv + 1) | 1;
+				umin[j] = dtMin(umin[j], bmin[i][j]);
+				umax[j] = dtMax(umax[j], bmax[i][j]);
+			}
+		}
+
+		// Traverse tree
+		while (node < end)
+		{
+			const bool overlap = dtOverlapQuantBounds(umin, umax, node->bmin, node->bmax);
+			const bool isLeafNode = node->i >= 0;
+
+			if (isLeafNode && overlap)
+			{
+				const dtPolyRef ref = base | (dtPolyRef)node->i;
+				bool passed = false;
+				bool filtered = false;
+				float pbmin[3], pbmax[3];
+				for (int i = 0; i < nitems; ++i)
+				{
+					if (!dtOverlapQuantBounds(bmin[i], bmax[i], node->bmin, node->bmax))
+						continue;
+					if (!filtered)
+					{
+						passed = batch.filter->passFilter(ref, tile, &tile->polys[node->i]);
+						filtered = true;
+						// The quantized maximums are rounded down and the values outside of the tile
+						// are clamped, widen the bounds accordingly.
+						for (int j = 0; j < 3; ++j)
+						{
+							pbmin[j] = node->bmin[j] == 0 ? -FLT_MAX : tbmin[j] + node->bmin[j] * cs;
+							pbmax[j] = node->bmax[j] == 0xffff ? FLT_MAX : tbmin[j] + (node->bmax[j] + 1) * cs;
+						}
+					}
+					if (!passed)
+						break;
+					batch.processPoly(tile, ref, items[i].index, pbmin, pbmax);
+				}
+			}
+
+			if (overlap || isLeafNode)
+				node++;
+			else
+			{
+				const int escapeIndex = -node->i;
+				node += escapeIndex;
+			}
+		}
+	}
+	else
+	{
+		float bmin[3], bmax[3];
+		for (int i = 0; i < tile->header->polyCount; ++i)
+		{
+			const dtPoly* p = &tile->polys[i];
+			// Do not return off-mesh connection polygons.
+			if (p->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+				continue;
+			// Must pass filter
+			const dtPolyRef ref = base | (dtPolyRef)i;
+			if (!batch.filter->passFilter(ref, tile, p))
+				continue;
+			// Calc polygon bounds.
+			const float* v = &tile->verts[p->verts[0]*3];
+			dtVcopy(bmin, v);
+			dtVcopy(bmax, v);
+			for (int j = 1; j < p->vertCount; ++j)
+			{
+				v = &tile->verts[p->verts[j]*3];
+				dtVmin(bmin, v);
+				dtVmax(bmax, v);
+			}
+			for (int j = 0; j < nitems; ++j)
+			{
+				if (dtOverlapBounds(qmin[j], qmax[j], bmin, bmax))
+					batch.processPoly(tile, ref, items[j].index, bmin, bmax);
+			}
+		}
+	}
+}
+
+/// @par
+///
+/// The points are sorted by the tiles their search box touches. Within a tile, spatially close
+/// points are processed in groups that share a single traversal of the tile's bounding volume tree.
+/// This saves most of the per call overhead when many points are resolved at once, for instance
+/// when spawning agents or validating positions.
+///
+/// @note If the search box of a point does not intersect any polygons, its reference
+/// will be zero. So if in doubt, check the reference before using the nearest point.
+///
+/// @see findNearestPoly
+dtStatus dtNavMeshQuery::findNearestPolyBatch(const float* centers, const int count, const float* halfExtents,
+											  const dtQueryFilter* filter,
+											  dtPolyRef* nearestRefs, float* nearestPts, bool* isOverPoly) const
+{
+	dtAssert(m_nav);
+
+	if (count < 0 || (count > 0 && (!centers || !nearestRefs)) ||
+		!halfExtents || !dtVisfinite(halfExtents) || !filter)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// Count the tiles touched by the search box of every point.
+	int nitems = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const float* center = &centers[i*3];
+		if (!dtVisfinite(center))
+			return DT_FAILURE | DT_INVALID_PARAM;
+
+		float bmin[3], bmax[3];
+		dtVsub(bmin, center, halfExtents);
+		dtVadd(bmax, center, halfExtents);
+		int minx, miny, maxx, maxy;
+		m_nav->calcTileLoc(bmin, &minx, &miny);
+		m_nav->calcTileLoc(bmax, &maxx, &maxy);
+		nitems += (maxx - minx + 1) * (maxy - miny + 1);
+		nearestRefs[i] = 0;
+	}
+
+	if (nitems == 0)
+		return DT_SUCCESS;
+
+	dtNearestPolyBatchItem* items = (dtNearestPolyBatchItem*)dtAlloc(sizeof(dtNearestPolyBatchItem)*nitems, DT_ALLOC_TEMP);
+	float* nearestDistanceSqr = (float*)dtAlloc(sizeof(float)*count, DT_ALLOC_TEMP);
+	if (!items || !nearestDistanceSqr)
+	{
+		dtFree(items);
+		dtFree(nearestDistanceSqr);
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	const dtNavMeshParams* params = m_nav->getParams();
+	const float mortonScaleX = 1024.0f / params->tileWidth;
+	const float mortonScaleZ = 1024.0f / params->tileHeight;
+
+	int n = 0;
+	for (int i = 0; i < count; ++i)
+	{
+		const float* center = &centers[i*3];
+		float bmin[3], bmax[3];
+		dtVsub(bmin, center, halfExtents);
+		dtVadd(bmax, center, halfExtents);
+		int minx, miny, maxx, maxy;
+		m_nav->calcTileLoc(bmin, &minx, &miny);
+		m_nav->calcTileLoc(bmax, &maxx, &maxy);
+
+		const unsigned int mx = (unsigned int)(int)((center[0] - params->orig[0]) * mortonScaleX);
+		const unsigned int mz = (unsigned int)(int)((center[2] - params->orig[2]) * mortonScaleZ);
+		const unsigned int order = mortonSpread(mx) | (mortonSpread(mz) << 1);
+
+		for (int y = miny; y <= maxy; ++y)
+		{
+			for (int x = minx; x <= maxx; ++x)
+			{
+				dtNearestPolyBatchItem& item = items[n++];
+				item.tx = x;
+				item.ty = y;
+				item.order = order;
+				item.index = i;
+			}
+		}
+		nearestDistanceSqr[i] = FLT_MAX;
+	}
+
+	qsort(items, nitems, sizeof(dtNearestPolyBatchItem), compareNearestPolyBatchItem);
+
+	dtNearestPolyBatch batch;
+	batch.query = this;
+	batch.centers = centers;
+	batch.halfExtents = halfExtents;
+	batch.filter = filter;
+	batch.nearestRefs = nearestRefs;
+	batch.nearestPts = nearestPts;
+	batch.isOverPoly = isOverPoly;
+	batch.nearestDistanceSqr = nearestDistanceSqr;
+
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+
+	int first = 0;
+	while (first < nitems)
+	{
+		// Find the points touching the same tile.
+		int last = first + 1;
+		while (last < nitems && items[last].tx == items[first].tx && items[last].ty == items[first].ty)
+			last++;
+
+		const int nneis = m_nav->getTilesAt(items[first].tx, items[first].ty, neis, MAX_NEIS);
+		for (int j = 0; j < nneis; ++j)
+		{
+			for (int k = first; k < last; k += NEAREST_POLY_BATCH_SIZE)
+				findNearestPolyInTileBatch(m_nav, neis[j], batch, &items[k], dtMin(NEAREST_POLY_BATCH_SIZE, last - k));
+		}
+
+		first = last;
+	}
+
+	dtFree(items);
+	dtFree(nearestDistanceSqr);
+
+	return DT_SUCCESS;
+}
+
 void dtNavMeshQuery::queryPolygonsInTile(const dtMeshTile* tile, const float* qmin, const float* qmax,
 										 const dtQueryFilter* filter, dtPolyQuery* query) const
 {
@@ -1164,6 +1515,452 @@ dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
 	return status;
 }
 
+namespace
+{
+/// One-way off-mesh connections landing in a tile. Their landing polygon has no link back
+/// to them, so the backward search of findPath cannot find them from the polygon links.
+struct dtIncomingOffMeshLinks
+{
+	static const int MAX_LINKS = 128;
+	const dtMeshTile* tile;
+	dtPolyRef from[MAX_LINKS];
+	dtPolyRef to[MAX_LINKS];
+	int count;
+	bool overflow;	///< Some links were not stored, stays set until the next query.
+
+	void reset()
+	{
+		tile = 0;
+		count = 0;
+		overflow = false;
+	}
+};
+}
+
+// Off-mesh connections can only land in their own tile location or in one of the 8 neighbours.
+static void findIncomingOffMeshLinks(const dtNavMesh* nav, const dtMeshTile* tile, dtIncomingOffMeshLinks& incoming)
+{
+	incoming.tile = tile;
+	incoming.count = 0;
+
+	const unsigned int tileIdx = nav->decodePolyIdTile(nav->getPolyRefBase(tile));
+	static const int MAX_NEIS = 32;
+	const dtMeshTile* neis[MAX_NEIS];
+	for (int dy = -1; dy <= 1; ++dy)
+	{
+		for (int dx = -1; dx <= 1; ++dx)
+		{
+			const int nneis = nav->getTilesAt(tile->header->x + dx, tile->header->y + dy, neis, MAX_NEIS);
+			for (int j = 0; j < nneis; ++j)
+			{
+				const dtMeshTile* nei = neis[j];
+				for (int k = 0; k < nei->header->offMeshConCount; ++k)
+				{
+					const dtOffMeshConnection* con = &nei->offMeshCons[k];
+					if (con->flags & DT_OFFMESH_CON_BIDIR)
+						continue;
+					const dtPoly* conPoly = &nei->polys[con->poly];
+					for (unsigned int i = conPoly->firstLink; i != DT_NULL_LINK; i = nei->links[i].next)
+					{
+						const dtLink& link = nei->links[i];
+						// The start point is always linked back to the connection, only the end point matters.
+						if (link.edge != 1 || nav->decodePolyIdTile(link.ref) != tileIdx)
+							continue;
+						if (incoming.count >= dtIncomingOffMeshLinks::MAX_LINKS)
+						{
+							incoming.overflow = true;
+							return;
+						}
+						incoming.from[incoming.count] = nav->getPolyRefBase(nei) | (dtPolyRef)con->poly;
+						incoming.to[incoming.count] = link.ref;
+						incoming.count++;
+					}
+				}
+			}
+		}
+	}
+}
+
+/// @par
+///
+/// With #DT_FINDPATH_BIDIRECTIONAL, the path is searched from both ends at once, each side
+/// with its own open list, always expanding the side with the fewest open nodes. The search
+/// stops once the cheapest open node of either side cannot improve the best path through a
+/// polygon reached by both sides. Both searches share the node pool. The open list of the
+/// backward search is allocated by the first bidirectional search of the query object.
+///
+/// If one side runs out of polygons before the searches meet, the start and end polygons are
+/// not connected and the search stops right away, instead of exploring everything reachable
+/// from the start polygon. The partial path then leads to the polygon nearest to the end position
+/// found so far by the forward search, which may differ from the one found by the regular search.
+/// When the island index of the navigation mesh tells the polygons are not connected, no search
+/// is done and the partial path only contains the start polygon. (See: #arePolysConnected)
+///
+/// When the filter rejects the end polygon, the regular search is used, and gives its partial path.
+///
+dtStatus dtNavMeshQuery::findPath(dtPolyRef startRef, dtPolyRef endRef,
+								  const float* startPos, const float* endPos,
+								  const dtQueryFilter* filter,
+								  dtPolyRef* path, int* pathCount, const int maxPath,
+								  const unsigned int options) const
+{
+	if (!(options & DT_FINDPATH_BIDIRECTIONAL))
+		return findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+
+	dtAssert(m_nav);
+	dtAssert(m_nodePool);
+	dtAssert(m_openList);
+
+	if (!pathCount)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	*pathCount = 0;
+
+	// Validate input
+	if (!m_nav->isValidPolyRef(startRef) || !m_nav->isValidPolyRef(endRef) ||
+		!startPos || !dtVisfinite(startPos) ||
+		!endPos || !dtVisfinite(endPos) ||
+		!filter || !path || maxPath <= 0)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	if (startRef == endRef)
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS;
+	}
+
+	// The regular search never enters an end polygon rejected by the filter, and returns
+	// a partial path. Do the same instead of starting the backward search from it.
+	const dtMeshTile* endTile = 0;
+	const dtPoly* endPoly = 0;
+	m_nav->getTileAndPolyByRefUnsafe(endRef, &endTile, &endPoly);
+	if (!filter->passFilter(endRef, endTile, endPoly))
+		return findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+
+	if (!arePolysConnected(startRef, endRef, filter))
+	{
+		path[0] = startRef;
+		*pathCount = 1;
+		return DT_SUCCESS | DT_PARTIAL_RESULT;
+	}
+
+	return findPathBidirectional(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+}
+
+dtStatus dtNavMeshQuery::findPathBidirectional(dtPolyRef startRef, dtPolyRef endRef,
+											   const float* startPos, const float* endPos,
+											   const dtQueryFilter* filter,
+											   dtPolyRef* path, int* pathCount, const int maxPath) const
+{
+	if (!m_reverseOpenList)
+	{
+		m_reverseOpenList = new (dtAlloc(sizeof(dtNodeQueue), DT_ALLOC_PERM)) dtNodeQueue(m_nodePool->getMaxNodes());
+		if (!m_reverseOpenList)
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	m_nodePool->clear();
+	m_openList->clear();
+	m_reverseOpenList->clear();
+
+	// The forward search runs from the start polygon, the backward search from the end polygon.
+	// Backward nodes are stored with the DT_NODE_REVERSE_SEARCH state, their parent is the next
+	// polygon toward the end and their position is on the edge leading to that polygon.
+	dtNode* startNode = m_nodePool->getNode(startRef, 0);
+	dtVcopy(startNode->pos, startPos);
+	startNode->pidx = 0;
+	startNode->cost = 0;
+	startNode->total = dtVdist(startPos, endPos) * H_SCALE;
+	startNode->id = startRef;
+	startNode->flags = DT_NODE_OPEN;
+	m_openList->push(startNode);
+
+	dtNode* endNode = m_nodePool->getNode(endRef, DT_NODE_REVERSE_SEARCH);
+	dtVcopy(endNode->pos, endPos);
+	endNode->pidx = 0;
+	endNode->cost = 0;
+	endNode->total = startNode->total;
+	endNode->id = endRef;
+	endNode->flags = DT_NODE_OPEN;
+	m_reverseOpenList->push(endNode);
+
+	dtNodeQueue* openLists[2] = { m_openList, m_reverseOpenList };
+
+	int openCount[2] = { 1, 1 };
+	bool outOfNodes[2] = { false, false };
+
+	dtNode* lastBestNode = startNode;
+	float lastBestNodeCost = startNode->total;
+
+	dtNode* meetForward = 0;
+	dtNode* meetBackward = 0;
+	float meetCost = FLT_MAX;
+
+	dtIncomingOffMeshLinks incoming;
+	incoming.reset();
+
+	for (;;)
+	{
+		// A side which has visited all the polygons it can reach has found all the paths,
+		// the best meeting if any is the path, otherwise the polygons are not connected.
+		// Sides which could not store all their nodes, or may have missed off-mesh links,
+		// cannot tell and the other side goes on alone.
+		if (openCount[0] == 0 && (openCount[1] == 0 || !outOfNodes[0]))
+			break;
+		if (openCount[1] == 0 && !outOfNodes[1] && !incoming.overflow)
+			break;
+
+		// Each side pops nodes in increasing total cost, which is a lower bound of the cost of
+		// any path through the node. Once either cheapest open node is not cheaper than the best
+		// meeting, no path can improve it.
+		float bound = 0;
+		if (openCount[0] > 0)
+			bound = openLists[0]->top()->total;
+		if (openCount[1] > 0)
+			bound = dtMax(bound, openLists[1]->top()->total);
+		if (bound >= meetCost)
+			break;
+
+		// Expand the side with the smallest frontier, so that a small island around either
+		// end is exhausted quickly.
+		const int side = (openCount[1] == 0 || (openCount[0] > 0 && openCount[0] <= openCount[1])) ? 0 : 1;
+		const bool reverse = side == 1;
+
+		// Remove node from open list and put it in closed list.
+		dtNode* bestNode = openLists[side]->pop();
+		bestNode->flags &= ~DT_NODE_OPEN;
+		bestNode->flags |= DT_NODE_CLOSED;
+		openCount[side]--;
+
+		// Get current poly and tile.
+		// The API input has been checked already, skip checking internal data.
+		const dtPolyRef bestRef = bestNode->id;
+		const dtMeshTile* bestTile = 0;
+		const dtPoly* bestPoly = 0;
+		m_nav->getTileAndPolyByRefUnsafe(bestRef, &bestTile, &bestPoly);
+
+		// Get parent poly and tile, toward the end polygon for the backward search.
+		dtPolyRef parentRef = 0;
+		const dtMeshTile* parentTile = 0;
+		const dtPoly* parentPoly = 0;
+		if (bestNode->pidx)
+			parentRef = m_nodePool->getNodeAtIdx(bestNode->pidx)->id;
+		if (parentRef)
+			m_nav->getTileAndPolyByRefUnsafe(parentRef, &parentTile, &parentPoly);
+
+		if (reverse && bestPoly->getType() == DT_POLYTYPE_GROUND && incoming.tile != bestTile)
+			findIncomingOffMeshLinks(m_nav, bestTile, incoming);
+
+		unsigned int linkIdx = bestPoly->firstLink;
+		int incomingIdx = 0;
+		for (;;)
+		{
+			dtPolyRef neighbourRef = 0;
+			unsigned char crossSide = 0;
+			if (linkIdx != DT_NULL_LINK)
+			{
+				const dtLink& link = bestTile->links[linkIdx];
+				linkIdx = link.next;
+				neighbourRef = link.ref;
+				// deal explicitly with crossing tile boundaries
+				if (link.side != 0xff)
+					crossSide = link.side >> 1;
+			}
+			else if (reverse && bestPoly->getType() == DT_POLYTYPE_GROUND && incomingIdx < incoming.count)
+			{
+				const int i = incomingIdx++;
+				if (incoming.to[i] != bestRef)
+					continue;
+				neighbourRef = incoming.from[i];
+			}
+			else
+			{
+				break;
+			}
+
+			// Skip invalid ids and do not expand back to where we came from.
+			if (!neighbourRef || neighbourRef == parentRef)
+				continue;
+
+			// Get neighbour poly and tile.
+			// The API input has been checked already, skip checking internal data.
+			const dtMeshTile* neighbourTile = 0;
+			const dtPoly* neighbourPoly = 0;
+			m_nav->getTileAndPolyByRefUnsafe(neighbourRef, &neighbourTile, &neighbourPoly);
+
+			if (!filter->passFilter(neighbourRef, neighbourTile, neighbourPoly))
+				continue;
+
+			// The end point of a one-way off-mesh connection is not linked back to it.
+			if (reverse && bestPoly->getType() == DT_POLYTYPE_OFFMESH_CONNECTION)
+			{
+				bool linked = false;
+				for (unsigned int i = neighbourPoly->firstLink; i != DT_NULL_LINK; i = neighbourTile->links[i].next)
+				{
+					if (neighbourTile->links[i].ref == bestRef)
+					{
+						linked = true;
+						break;
+					}
+				}
+				if (!linked)
+					continue;
+			}
+
+			// get the node
+			dtNode* neighbourNode = m_nodePool->getNode(neighbourRef, reverse ? (DT_NODE_REVERSE_SEARCH | crossSide) : crossSide);
+			if (!neighbourNode)
+			{
+				outOfNodes[side] = true;
+				continue;
+			}
+
+			// Calculate cost and heuristic, along the direction of the path.
+			float cost = 0;
+			float heuristic = 0;
+			if (!reverse)
+			{
+				// If the node is visited the first time, calculate node position.
+				if (neighbourNode->flags == 0)
+				{
+					getEdgeMidPoint(bestRef, bestPoly, bestTile,
+									neighbourRef, neighbourPoly, neighbourTile,
+									neighbourNode->pos);
+				}
+				const float curCost = filter->getCost(bestNode->pos, neighbourNode->pos,
+													  parentRef, parentTile, parentPoly,
+													  bestRef, bestTile, bestPoly,
+													  neighbourRef, neighbourTile, neighbourPoly);
+				cost = bestNode->cost + curCost;
+				heuristic = dtVdist(neighbourNode->pos, endPos)*H_SCALE;
+			}
+			else
+			{
+				if (neighbourNode->flags == 0)
+				{
+					getEdgeMidPoint(neighbourRef, neighbourPoly, neighbourTile,
+									bestRef, bestPoly, bestTile,
+									neighbourNode->pos);
+				}
+				const float curCost = filter->getCost(neighbourNode->pos, bestNode->pos,
+													  neighbourRef, neighbourTile, neighbourPoly,
+													  bestRef, bestTile, bestPoly,
+													  parentRef, parentTile, parentPoly);
+				cost = bestNode->cost + curCost;
+				heuristic = dtVdist(neighbourNode->pos, startPos)*H_SCALE;
+			}
+
+			const float total = cost + heuristic;
+
+			// The node is already in open list and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_OPEN) && total >= neighbourNode->total)
+				continue;
+			// The node is already visited and process, and the new result is worse, skip.
+			if ((neighbourNode->flags & DT_NODE_CLOSED) && total >= neighbourNode->total)
+				continue;
+
+			// Add or update the node.
+			neighbourNode->pidx = m_nodePool->getNodeIdx(bestNode);
+			neighbourNode->id = neighbourRef;
+			neighbourNode->flags = (neighbourNode->flags & ~DT_NODE_CLOSED);
+			neighbourNode->cost = cost;
+			neighbourNode->total = total;
+
+			if (neighbourNode->flags & DT_NODE_OPEN)
+			{
+				// Already in open, update node location.
+				openLists[side]->modify(neighbourNode);
+			}
+			else
+			{
+				// Put the node in open list.
+				neighbourNode->flags |= DT_NODE_OPEN;
+				openLists[side]->push(neighbourNode);
+				openCount[side]++;
+			}
+
+			// Update nearest node to target so far.
+			if (!reverse && heuristic < lastBestNodeCost)
+			{
+				lastBestNodeCost = heuristic;
+				lastBestNode = neighbourNode;
+			}
+
+			// Check if the other search has reached the polygon too.
+			dtNode* nodes[DT_MAX_STATES_PER_NODE];
+			const int n = m_nodePool->findNodes(neighbourRef, nodes, DT_MAX_STATES_PER_NODE);
+			for (int j = 0; j < n; ++j)
+			{
+				if (!nodes[j]->flags || ((nodes[j]->state & DT_NODE_REVERSE_SEARCH) != 0) == reverse)
+					continue;
+				dtNode* forwardNode = reverse ? nodes[j] : neighbourNode;
+				dtNode* backwardNode = reverse ? neighbourNode : nodes[j];
+
+				const dtNode* prevNode = m_nodePool->getNodeAtIdx(forwardNode->pidx);
+				const dtNode* nextNode = m_nodePool->getNodeAtIdx(backwardNode->pidx);
+				const dtPolyRef prevRef = prevNode ? prevNode->id : 0;
+				const dtPolyRef nextRef = nextNode ? nextNode->id : 0;
+				// Both sides come from the same polygon, the path would go back and forth.
+				if (prevRef && prevRef == nextRef)
+					continue;
+
+				const dtMeshTile* prevTile = 0;
+				const dtPoly* prevPoly = 0;
+				const dtMeshTile* nextTile = 0;
+				const dtPoly* nextPoly = 0;
+				if (prevRef)
+					m_nav->getTileAndPolyByRefUnsafe(prevRef, &prevTile, &prevPoly);
+				if (nextRef)
+					m_nav->getTileAndPolyByRefUnsafe(nextRef, &nextTile, &nextPoly);
+				const float joinCost = filter->getCost(forwardNode->pos, backwardNode->pos,
+													   prevRef, prevTile, prevPoly,
+													   neighbourRef, neighbourTile, neighbourPoly,
+													   nextRef, nextTile, nextPoly);
+				const float meet = forwardNode->cost + joinCost + backwardNode->cost;
+				if (meet < meetCost)
+				{
+					meetCost = meet;
+					meetForward = forwardNode;
+					meetBackward = backwardNode;
+				}
+			}
+		}
+	}
+
+	dtStatus status;
+	if (meetForward)
+	{
+		status = getPathToNode(meetForward, path, pathCount, maxPath);
+
+		// The meeting polygon is already in the path, append the polygons of the backward search.
+		int n = *pathCount;
+		for (dtNode* node = m_nodePool->getNodeAtIdx(meetBackward->pidx); node; node = m_nodePool->getNodeAtIdx(node->pidx))
+		{
+			if (n >= maxPath)
+			{
+				status |= DT_BUFFER_TOO_SMALL;
+				break;
+			}
+			path[n++] = node->id;
+		}
+		*pathCount = n;
+	}
+	else
+	{
+		status = getPathToNode(lastBestNode, path, pathCount, maxPath);
+		if (lastBestNode->id != endRef)
+			status |= DT_PARTIAL_RESULT;
+	}
+
+	if (outOfNodes[0] || outOfNodes[1])
+		status |= DT_OUT_OF_NODES;
+
+	return status;
+}
+
 dtStatus dtNavMeshQuery::getPathToNode(dtNode* endNode, dtPolyRef* path, int* pathCount, int maxPath) const
 {
 	// Find the length of the entire path.
@@ -3668,6 +4465,32 @@ bool dtNavMeshQuery::isValidPolyRef(dtPolyRef ref, const dtQueryFilter* filter)
 	return true;
 }
 
+/// @par
+///
+/// The check takes constant time. The polygons are connected when they are on the same island
+/// of the mask picked by dtNavMeshConnectivity::findMask(): among the masks tracked by the index
+/// containing all the include flags of the filter, the one with the fewest extra flags. When
+/// the index is not initialized, no mask matches or a polygon does not pass the mask, the
+/// function returns true.
+///
+/// Filters overriding passFilter() must not accept polygons lacking their include flags,
+/// or the answer may be wrong.
+///
+bool dtNavMeshQuery::arePolysConnected(dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter) const
+{
+	const dtNavMeshConnectivity* connectivity = m_nav->getConnectivity();
+	if (!connectivity)
+		return true;
+	const int mask = connectivity->findMask(filter->getIncludeFlags());
+	if (mask == -1)
+		return true;
+	const unsigned int startIsland = connectivity->getPolyIsland(startRef, mask);
+	const unsigned int endIsland = connectivity->getPolyIsland(endRef, mask);
+	if (startIsland == DT_NULL_ISLAND || endIsland == DT_NULL_ISLAND)
+		return true;
+	return startIsland == endIsland;
+}
+
 /// @par
 ///
 /// The closed list is the list of polygons that were fully evaluated during 
@@ -0,0 +1,441 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include <thread>
+#include "DetourNavMeshQueryPool.h"
+#include "DetourNode.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+#include <new>
+
+/// Worker thread state. Each worker owns a query object and an intrusive MPSC queue
+/// (Vyukov style): producers only exchange the head, the worker is the single consumer of the tail.
+struct dtQueryWorker
+{
+	dtQueryWorker() : query(0), head(&stub), tail(&stub), pending(0), sleeping(false), stop(false) {}
+
+	dtNavMeshQuery* query;
+	std::thread thread;
+
+	std::atomic<dtQueryJob*> head;
+	dtQueryJob* tail;
+	dtQueryJob stub;
+
+	/// Number of jobs pushed and not popped yet.
+	std::atomic<int> pending;
+	std::atomic<bool> sleeping;
+	std::atomic<bool> stop;
+	std::mutex mutex;
+	std::condition_variable cond;
+};
+
+static void pushJob(dtQueryWorker* worker, dtQueryJob* job)
+{
+	job->next.store(0, std::memory_order_relaxed);
+	dtQueryJob* prev = worker->head.exchange(job, std::memory_order_acq_rel);
+	prev->next.store(job, std::memory_order_release);
+}
+
+// Returns null when the queue is empty, or when a producer is in the middle of a push.
+static dtQueryJob* popJob(dtQueryWorker* worker)
+{
+	dtQueryJob* tail = worker->tail;
+	dtQueryJob* next = tail->next.load(std::memory_order_acquire);
+	if (tail == &worker->stub)
+	{
+		if (!next)
+			return 0;
+		worker->tail = next;
+		tail = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+	if (next)
+	{
+		worker->tail = next;
+		return tail;
+	}
+	if (tail != worker->head.load(std::memory_order_acquire))
+		return 0;
+	pushJob(worker, &worker->stub);
+	next = tail->next.load(std::memory_order_acquire);
+	if (next)
+	{
+		worker->tail = next;
+		return tail;
+	}
+	return 0;
+}
+
+static void runJob(const dtNavMeshQuery* query, dtQueryJob* job)
+{
+	switch (job->type)
+	{
+	case DT_QUERYJOB_FIND_PATH:
+		job->status = query->findPath(job->startRef, job->endRef, job->startPos, job->endPos, job->filter,
+									  job->polys, &job->polyCount, job->maxPolys, job->options);
+		break;
+	case DT_QUERYJOB_RAYCAST:
+		memset(&job->hit, 0, sizeof(job->hit));
+		job->hit.path = job->polys;
+		job->hit.maxPath = job->polys ? job->maxPolys : 0;
+		job->status = query->raycast(job->startRef, job->startPos, job->endPos, job->filter, job->options, &job->hit);
+		job->polyCount = job->hit.pathCount;
+		break;
+	case DT_QUERYJOB_DISTANCE_TO_WALL:
+		job->status = query->findDistanceToWall(job->startRef, job->startPos, job->radius, job->filter,
+												&job->hitDist, job->hitPos, job->hitNormal);
+		break;
+	case DT_QUERYJOB_POLYS_AROUND_CIRCLE:
+		job->status = query->findPolysAroundCircle(job->startRef, job->startPos, job->radius, job->filter,
+												   job->polys, job->parents, job->costs, &job->polyCount, job->maxPolys);
+		break;
+	default:
+		job->status = DT_FAILURE | DT_INVALID_PARAM;
+		break;
+	}
+}
+
+
+dtQueryJob::dtQueryJob() :
+	type(DT_QUERYJOB_NONE),
+	startRef(0),
+	endRef(0),
+	radius(0),
+	options(0),
+	filter(0),
+	maxPolys(0),
+	status(0),
+	polys(0),
+	parents(0),
+	costs(0),
+	polyCount(0),
+	hitDist(0),
+	callback(0),
+	userData(0),
+	state(DT_QUERYJOB_IDLE),
+	next(0)
+{
+	dtVset(startPos, 0, 0, 0);
+	dtVset(endPos, 0, 0, 0);
+	dtVset(hitPos, 0, 0, 0);
+	dtVset(hitNormal, 0, 0, 0);
+	memset(&hit, 0, sizeof(hit));
+}
+
+void dtQueryJob::setFindPath(dtPolyRef sref, dtPolyRef eref, const float* spos, const float* epos,
+							 const dtQueryFilter* f, dtPolyRef* path, const int maxPath,
+							 const unsigned int opts)
+{
+	type = DT_QUERYJOB_FIND_PATH;
+	startRef = sref;
+	endRef = eref;
+	dtVcopy(startPos, spos);
+	dtVcopy(endPos, epos);
+	filter = f;
+	options = opts;
+	polys = path;
+	parents = 0;
+	costs = 0;
+	maxPolys = maxPath;
+}
+
+void dtQueryJob::setRaycast(dtPolyRef sref, const float* spos, const float* epos,
+							const dtQueryFilter* f, const unsigned int opts,
+							dtPolyRef* path, const int maxPath)
+{
+	type = DT_QUERYJOB_RAYCAST;
+	startRef = sref;
+	endRef = 0;
+	dtVcopy(startPos, spos);
+	dtVcopy(endPos, epos);
+	filter = f;
+	options = opts;
+	polys = path;
+	parents = 0;
+	costs = 0;
+	maxPolys = maxPath;
+}
+
+void dtQueryJob::setDistanceToWall(dtPolyRef sref, const float* centerPos, const float maxRadius,
+								   const dtQueryFilter* f)
+{
+	type = DT_QUERYJOB_DISTANCE_TO_WALL;
+	startRef = sref;
+	endRef = 0;
+	dtVcopy(startPos, centerPos);
+	radius = maxRadius;
+	filter = f;
+	polys = 0;
+	parents = 0;
+	costs = 0;
+	maxPolys = 0;
+}
+
+void dtQueryJob::setPolysAroundCircle(dtPolyRef sref, const float* centerPos, const float r,
+									  const dtQueryFilter* f,
+									  dtPolyRef* resultRef, dtPolyRef* resultParent, float* resultCost,
+									  const int maxResult)
+{
+	type = DT_QUERYJOB_POLYS_AROUND_CIRCLE;
+	startRef = sref;
+	endRef = 0;
+	dtVcopy(startPos, centerPos);
+	radius = r;
+	filter = f;
+	polys = resultRef;
+	parents = resultParent;
+	costs = resultCost;
+	maxPolys = maxResult;
+}
+
+void dtQueryJob::setCallback(dtQueryJobCallback cb, void* data)
+{
+	callback = cb;
+	userData = data;
+}
+
+
+dtNavMeshQueryPool* dtAllocNavMeshQueryPool()
+{
+	void* mem = dtAlloc(sizeof(dtNavMeshQueryPool), DT_ALLOC_PERM);
+	if (!mem) return 0;
+	return new(mem) dtNavMeshQueryPool;
+}
+
+void dtFreeNavMeshQueryPool(dtNavMeshQueryPool* pool)
+{
+	if (!pool) return;
+	pool->~dtNavMeshQueryPool();
+	dtFree(pool);
+}
+
+/// @class dtNavMeshQueryPool
+///
+/// Every worker thread owns its dtNavMeshQuery, so the node pools and open lists are never
+/// shared. The jobs are not stolen between workers: a job is handed to the worker with the
+/// fewest pending jobs when it is submitted, starting the search at a round robin index so
+/// that equally busy workers share the load.
+///
+/// Jobs can be submitted while others run, but not concurrently with init() or shutdown().
+///
+/// @see dtQueryJob, dtNavMeshQuery
+
+dtNavMeshQueryPool::dtNavMeshQueryPool() :
+	m_nav(0),
+	m_workers(0),
+	m_threadCount(0),
+	m_nextWorker(0),
+	m_pendingJobs(0),
+	m_waiters(0)
+{
+}
+
+dtNavMeshQueryPool::~dtNavMeshQueryPool()
+{
+	shutdown();
+}
+
+dtStatus dtNavMeshQueryPool::init(const dtNavMesh* nav, const int maxNodes, const int threadCount)
+{
+	if (!nav || maxNodes <= 0 || maxNodes > DT_NULL_IDX || threadCount <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	shutdown();
+
+	m_workers = (dtQueryWorker*)dtAlloc(sizeof(dtQueryWorker) * threadCount, DT_ALLOC_PERM);
+	if (!m_workers)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	for (int i = 0; i < threadCount; ++i)
+		new(&m_workers[i]) dtQueryWorker;
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		dtQueryWorker* worker = &m_workers[i];
+		worker->query = dtAllocNavMeshQuery();
+		if (!worker->query)
+		{
+			m_threadCount = threadCount;
+			shutdown();
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		const dtStatus status = worker->query->init(nav, maxNodes);
+		if (dtStatusFailed(status))
+		{
+			m_threadCount = threadCount;
+			shutdown();
+			return status;
+		}
+	}
+
+	m_nav = nav;
+	m_threadCount = threadCount;
+	for (int i = 0; i < threadCount; ++i)
+		m_workers[i].thread = std::thread(workerMain, this, &m_workers[i]);
+
+	return DT_SUCCESS;
+}
+
+void dtNavMeshQueryPool::shutdown()
+{
+	if (!m_workers)
+		return;
+
+	for (int i = 0; i < m_threadCount; ++i)
+	{
+		dtQueryWorker* worker = &m_workers[i];
+		{
+			std::lock_guard<std::mutex> lock(worker->mutex);
+			worker->stop.store(true);
+		}
+		worker->cond.notify_one();
+	}
+	for (int i = 0; i < m_threadCount; ++i)
+	{
+		dtQueryWorker* worker = &m_workers[i];
+		if (worker->thread.joinable())
+			worker->thread.join();
+		dtFreeNavMeshQuery(worker->query);
+		worker->~dtQueryWorker();
+	}
+	dtFree(m_workers);
+
+	m_workers = 0;
+	m_threadCount = 0;
+	m_nav = 0;
+}
+
+dtStatus dtNavMeshQueryPool::submit(dtQueryJob* job)
+{
+	if (!job || job->type == DT_QUERYJOB_NONE)
+		return DT_FAILURE | DT_INVALID_PARAM;
+	if (!m_workers)
+		return DT_FAILURE;
+	if (job->state.load(std::memory_order_acquire) == DT_QUERYJOB_QUEUED)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	job->status = 0;
+	job->polyCount = 0;
+	job->state.store(DT_QUERYJOB_QUEUED, std::memory_order_relaxed);
+	m_pendingJobs.fetch_add(1);
+
+	// Least busy worker, equally busy workers are taken in round robin order.
+	const int first = (int)(m_nextWorker.fetch_add(1, std::memory_order_relaxed) % (unsigned int)m_threadCount);
+	dtQueryWorker* worker = &m_workers[first];
+	int bestPending = worker->pending.load(std::memory_order_relaxed);
+	for (int i = 1; i < m_threadCount && bestPending > 0; ++i)
+	{
+		dtQueryWorker* w = &m_workers[(first + i) % m_threadCount];
+		const int pending = w->pending.load(std::memory_order_relaxed);
+		if (pending < bestPending)
+		{
+			worker = w;
+			bestPending = pending;
+		}
+	}
+
+	// Counted before the push, so that the worker does not fall asleep while the push completes.
+	worker->pending.fetch_add(1);
+	pushJob(worker, job);
+	if (worker->sleeping.load())
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->cond.notify_one();
+	}
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtNavMeshQueryPool::wait(const dtQueryJob* job)
+{
+	dtAssert(job);
+	if (job->state.load() != DT_QUERYJOB_COMPLETED)
+	{
+		m_waiters.fetch_add(1);
+		{
+			std::unique_lock<std::mutex> lock(m_waitMutex);
+			while (job->state.load() != DT_QUERYJOB_COMPLETED)
+				m_waitCond.wait(lock);
+		}
+		m_waiters.fetch_sub(1);
+	}
+	return job->status;
+}
+
+void dtNavMeshQueryPool::waitAll()
+{
+	if (m_pendingJobs.load() == 0)
+		return;
+	m_waiters.fetch_add(1);
+	{
+		std::unique_lock<std::mutex> lock(m_waitMutex);
+		while (m_pendingJobs.load() != 0)
+			m_waitCond.wait(lock);
+	}
+	m_waiters.fetch_sub(1);
+}
+
+void dtNavMeshQueryPool::complete(dtQueryJob* job)
+{
+	if (job->callback)
+		job->callback(job, job->userData);
+
+	// The job belongs to the caller again as soon as it is marked completed, do not touch it after.
+	job->state.store(DT_QUERYJOB_COMPLETED);
+	m_pendingJobs.fetch_sub(1);
+	if (m_waiters.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(m_waitMutex);
+		m_waitCond.notify_all();
+	}
+}
+
+void dtNavMeshQueryPool::workerMain(dtNavMeshQueryPool* pool, dtQueryWorker* worker)
+{
+	for (;;)
+	{
+		dtQueryJob* job = popJob(worker);
+		if (job)
+		{
+			worker->pending.fetch_sub(1);
+			runJob(worker->query, job);
+			pool->complete(job);
+			continue;
+		}
+
+		if (worker->pending.load() > 0)
+		{
+			// A producer is between the pending count and the link of its job.
+			std::this_thread::yield();
+			continue;
+		}
+		if (worker->stop.load())
+			break;
+
+		// The sleeping flag is raised before checking the pending count for the last time,
+		// so a producer either sees the flag and wakes us up, or its job is seen here.
+		worker->sleeping.store(true);
+		{
+			std::unique_lock<std::mutex> lock(worker->mutex);
+			while (worker->pending.load() == 0 && !worker->stop.load())
+				worker->cond.wait(lock);
+		}
+		worker->sleeping.store(false);
+	}
+}
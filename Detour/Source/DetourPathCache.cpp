@@ -0,0 +1,333 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "DetourPathCache.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+// FNV-1a
+inline unsigned int hashBytes(unsigned int h, const void* data, const int size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (int i = 0; i < size; ++i)
+		h = (h ^ bytes[i]) * 16777619u;
+	return h;
+}
+
+dtPathCache::dtPathCache() :
+	m_entries(0),
+	m_paths(0),
+	m_buckets(0),
+	m_bucketMask(0),
+	m_maxPaths(0),
+	m_maxPathSize(0),
+	m_first(-1),
+	m_last(-1),
+	m_firstFree(-1)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+dtPathCache::~dtPathCache()
+{
+	purge();
+}
+
+void dtPathCache::purge()
+{
+	dtFree(m_entries);
+	m_entries = 0;
+	dtFree(m_paths);
+	m_paths = 0;
+	dtFree(m_buckets);
+	m_buckets = 0;
+	m_maxPaths = 0;
+	m_maxPathSize = 0;
+}
+
+dtStatus dtPathCache::init(const int maxPaths, const int maxPathSize)
+{
+	if (maxPaths <= 0 || maxPathSize <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+
+	int nbuckets = 1;
+	while (nbuckets < maxPaths*2)
+		nbuckets <<= 1;
+	m_entries = (Entry*)dtAlloc(sizeof(Entry)*maxPaths, DT_ALLOC_PERM);
+	m_paths = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*maxPaths*maxPathSize, DT_ALLOC_PERM);
+	m_buckets = (int*)dtAlloc(sizeof(int)*nbuckets, DT_ALLOC_PERM);
+	if (!m_entries || !m_paths || !m_buckets)
+	{
+		purge();
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	}
+
+	m_maxPaths = maxPaths;
+	m_maxPathSize = maxPathSize;
+	m_bucketMask = nbuckets-1;
+	clear();
+	resetStats();
+
+	return DT_SUCCESS;
+}
+
+void dtPathCache::clear()
+{
+	for (int i = 0; i <= m_bucketMask && m_buckets; ++i)
+		m_buckets[i] = -1;
+	for (int i = 0; i < m_maxPaths; ++i)
+	{
+		m_entries[i].pathCount = 0;
+		m_entries[i].next = i+1 < m_maxPaths ? i+1 : -1;
+	}
+	m_firstFree = m_maxPaths > 0 ? 0 : -1;
+	m_first = -1;
+	m_last = -1;
+	m_stats.pathCount = 0;
+}
+
+unsigned int dtPathCache::hashFilter(const dtQueryFilter* filter)
+{
+	unsigned int h = 2166136261u;
+	const unsigned short includeFlags = filter->getIncludeFlags();
+	const unsigned short excludeFlags = filter->getExcludeFlags();
+	h = hashBytes(h, &includeFlags, sizeof(includeFlags));
+	h = hashBytes(h, &excludeFlags, sizeof(excludeFlags));
+	for (int i = 0; i < DT_MAX_AREAS; ++i)
+	{
+		const float cost = filter->getAreaCost(i);
+		h = hashBytes(h, &cost, sizeof(cost));
+	}
+	return h;
+}
+
+int dtPathCache::getBucket(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const
+{
+	unsigned int h = filterHash;
+	h = hashBytes(h, &startRef, sizeof(startRef));
+	h = hashBytes(h, &endRef, sizeof(endRef));
+	return (int)(h & (unsigned int)m_bucketMask);
+}
+
+unsigned int dtPathCache::hashTiles(const dtNavMesh* nav, const dtPolyRef* path, const int pathCount)
+{
+	static const int MAX_LAYERS = 32;
+	const dtMeshTile* tiles[MAX_LAYERS];
+	unsigned int h = 2166136261u;
+	unsigned int prevTile = ~0u;
+	for (int i = 0; i < pathCount; ++i)
+	{
+		// The consecutive polygons are mostly in the same tile.
+		const unsigned int it = nav->decodePolyIdTile(path[i]);
+		if (it == prevTile)
+			continue;
+		prevTile = it;
+		const dtMeshTile* tile = nav->getTile((int)it);
+		if (!tile || !tile->header)
+			continue;
+
+		// The tile itself is one of the tiles around it.
+		for (int y = tile->header->y - 1; y <= tile->header->y + 1; ++y)
+		{
+			for (int x = tile->header->x - 1; x <= tile->header->x + 1; ++x)
+			{
+				const int ntiles = nav->getTilesAt(x, y, tiles, MAX_LAYERS);
+				for (int j = 0; j < ntiles; ++j)
+				{
+					const dtTileRef ref = nav->getTileRef(tiles[j]);
+					h = hashBytes(h, &ref, sizeof(ref));
+					h = hashBytes(h, &tiles[j]->changeCount, sizeof(tiles[j]->changeCount));
+				}
+			}
+		}
+	}
+	return h;
+}
+
+int dtPathCache::findEntry(dtPolyRef startRef, dtPolyRef endRef, const unsigned int filterHash) const
+{
+	for (int i = m_buckets[getBucket(startRef, endRef, filterHash)]; i != -1; i = m_entries[i].nextInBucket)
+	{
+		const Entry& e = m_entries[i];
+		if (e.startRef == startRef && e.endRef == endRef && e.filterHash == filterHash)
+			return i;
+	}
+	return -1;
+}
+
+void dtPathCache::unlinkEntry(const int i)
+{
+	Entry& e = m_entries[i];
+	if (e.prev != -1)
+		m_entries[e.prev].next = e.next;
+	else
+		m_first = e.next;
+	if (e.next != -1)
+		m_entries[e.next].prev = e.prev;
+	else
+		m_last = e.prev;
+}
+
+void dtPathCache::linkEntryFirst(const int i)
+{
+	Entry& e = m_entries[i];
+	e.prev = -1;
+	e.next = m_first;
+	if (m_first != -1)
+		m_entries[m_first].prev = i;
+	else
+		m_last = i;
+	m_first = i;
+}
+
+void dtPathCache::removeEntry(const int i)
+{
+	Entry& e = m_entries[i];
+	int* prev = &m_buckets[getBucket(e.startRef, e.endRef, e.filterHash)];
+	while (*prev != i)
+		prev = &m_entries[*prev].nextInBucket;
+	*prev = e.nextInBucket;
+
+	unlinkEntry(i);
+	e.pathCount = 0;
+	e.next = m_firstFree;
+	m_firstFree = i;
+	m_stats.pathCount--;
+}
+
+bool dtPathCache::find(const dtNavMeshQuery* navquery, dtPolyRef startRef, dtPolyRef endRef, const dtQueryFilter* filter,
+					   dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	dtAssert(navquery);
+	dtAssert(filter);
+	dtAssert(m_entries);
+
+	m_stats.lookups++;
+	const int i = findEntry(startRef, endRef, hashFilter(filter));
+	if (i == -1)
+		return false;
+
+	// The tiles of the path may have been rebuilt, or the flags of the polygons changed.
+	const Entry& e = m_entries[i];
+	const dtPolyRef* cached = &m_paths[i*m_maxPathSize];
+	bool valid = true;
+	for (int j = 0; j < e.pathCount && valid; ++j)
+		valid = navquery->isValidPolyRef(cached[j], filter);
+	// The tiles around the path may give a shorter path.
+	if (valid)
+		valid = hashTiles(navquery->getAttachedNavMesh(), cached, e.pathCount) == e.tilesHash;
+	if (!valid)
+	{
+		removeEntry(i);
+		m_stats.invalidations++;
+		return false;
+	}
+	if (e.pathCount > maxPath)
+		return false;
+
+	memcpy(path, cached, sizeof(dtPolyRef)*e.pathCount);
+	*pathCount = e.pathCount;
+	unlinkEntry(i);
+	linkEntryFirst(i);
+	m_stats.hits++;
+
+	return true;
+}
+
+void dtPathCache::store(const dtNavMeshQuery* navquery, const dtQueryFilter* filter, const dtPolyRef* path, const int pathCount)
+{
+	dtAssert(navquery);
+	dtAssert(filter);
+	dtAssert(m_entries);
+
+	if (pathCount <= 0 || pathCount > m_maxPathSize)
+		return;
+
+	const dtPolyRef startRef = path[0];
+	const dtPolyRef endRef = path[pathCount-1];
+	const unsigned int filterHash = hashFilter(filter);
+	int i = findEntry(startRef, endRef, filterHash);
+	if (i != -1)
+	{
+		unlinkEntry(i);
+	}
+	else
+	{
+		// Replace the least recently used path when full.
+		if (m_firstFree == -1)
+		{
+			removeEntry(m_last);
+			m_stats.evictions++;
+		}
+		i = m_firstFree;
+		m_firstFree = m_entries[i].next;
+
+		Entry& e = m_entries[i];
+		e.startRef = startRef;
+		e.endRef = endRef;
+		e.filterHash = filterHash;
+		const int bucket = getBucket(startRef, endRef, filterHash);
+		e.nextInBucket = m_buckets[bucket];
+		m_buckets[bucket] = i;
+		m_stats.pathCount++;
+	}
+
+	m_entries[i].pathCount = pathCount;
+	m_entries[i].tilesHash = hashTiles(navquery->getAttachedNavMesh(), path, pathCount);
+	memcpy(&m_paths[i*m_maxPathSize], path, sizeof(dtPolyRef)*pathCount);
+	linkEntryFirst(i);
+	m_stats.stores++;
+}
+
+dtStatus dtPathCache::findPath(dtNavMeshQuery* navquery, dtPolyRef startRef, dtPolyRef endRef,
+							   const float* startPos, const float* endPos, const dtQueryFilter* filter,
+							   dtPolyRef* path, int* pathCount, const int maxPath)
+{
+	dtAssert(navquery);
+
+	if (find(navquery, startRef, endRef, filter, path, pathCount, maxPath))
+		return DT_SUCCESS;
+
+	const dtStatus status = navquery->findPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+	if (dtStatusSucceed(status) && !dtStatusDetail(status, DT_PARTIAL_RESULT) && !dtStatusDetail(status, DT_BUFFER_TOO_SMALL))
+		store(navquery, filter, path, *pathCount);
+
+	return status;
+}
+
+void dtPathCache::getStats(dtPathCacheStats& stats) const
+{
+	stats = m_stats;
+}
+
+float dtPathCache::getHitRate() const
+{
+	return m_stats.lookups > 0 ? (float)m_stats.hits / (float)m_stats.lookups : 0.0f;
+}
+
+void dtPathCache::resetStats()
+{
+	const int pathCount = m_stats.pathCount;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.pathCount = pathCount;
+}
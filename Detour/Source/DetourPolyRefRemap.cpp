@@ -0,0 +1,325 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include <float.h>
+#include "DetourPolyRefRemap.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+// The center of a polygon, then its vertices moved toward the center.
+static const int MAX_SAMPLE_POINTS = 1 + DT_VERTS_PER_POLYGON;
+
+// How far the vertices are moved toward the center, so that the sample points are inside the polygon.
+static const float VERTEX_SAMPLE_INSET = 0.25f;
+
+// Finds the polygon of a tile under a point, or -1. The polygon at hintIndex is tested first.
+static int findPolyUnderPoint(const dtMeshTile* tile, const float* pt, const int hintIndex)
+{
+	const float climb = tile->header->walkableClimb;
+	int best = -1;
+	float bestDist = FLT_MAX;
+	float verts[DT_VERTS_PER_POLYGON*3];
+	const int npolys = tile->header->polyCount;
+	for (int n = -1; n < npolys; ++n)
+	{
+		const int i = n < 0 ? hintIndex : n;
+		if (i < 0 || i >= npolys || (n >= 0 && i == hintIndex))
+			continue;
+		const dtPoly* poly = &tile->polys[i];
+		if (poly->getType() != DT_POLYTYPE_GROUND || !poly->flags)
+			continue;
+
+		float ymin = FLT_MAX, ymax = -FLT_MAX;
+		for (int j = 0; j < poly->vertCount; ++j)
+		{
+			const float* v = &tile->verts[poly->verts[j]*3];
+			dtVcopy(&verts[j*3], v);
+			ymin = dtMin(ymin, v[1]);
+			ymax = dtMax(ymax, v[1]);
+		}
+		const float dist = pt[1] < ymin ? ymin - pt[1] : (pt[1] > ymax ? pt[1] - ymax : 0.0f);
+		if (dist > climb || dist >= bestDist)
+			continue;
+		if (!dtPointInPolygon(pt, verts, poly->vertCount))
+			continue;
+		best = i;
+		bestDist = dist;
+		if (dist == 0.0f)
+			break;
+	}
+	return best;
+}
+
+dtPolyRefRemap::dtPolyRefRemap() :
+	m_nav(0),
+	m_rebuilds(0),
+	m_maxRebuilds(0),
+	m_nrebuilds(0),
+	m_next(0),
+	m_changeCount(0),
+	m_pendingBase(0),
+	m_pendingPoints(0),
+	m_pendingPointCounts(0),
+	m_pendingPolyCount(0),
+	m_pendingCapacity(0)
+{
+}
+
+dtPolyRefRemap::~dtPolyRefRemap()
+{
+	purge();
+}
+
+void dtPolyRefRemap::purge()
+{
+	for (int i = 0; i < m_maxRebuilds; ++i)
+		dtFree(m_rebuilds[i].newRefs);
+	dtFree(m_rebuilds);
+	m_rebuilds = 0;
+	m_maxRebuilds = 0;
+	m_nrebuilds = 0;
+	m_next = 0;
+	dtFree(m_pendingPoints);
+	m_pendingPoints = 0;
+	dtFree(m_pendingPointCounts);
+	m_pendingPointCounts = 0;
+	m_pendingCapacity = 0;
+	m_pendingPolyCount = 0;
+	m_pendingBase = 0;
+}
+
+dtStatus dtPolyRefRemap::init(const dtNavMesh* nav, const int maxRebuilds)
+{
+	if (!nav || maxRebuilds <= 0)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	purge();
+	m_rebuilds = (Rebuild*)dtAlloc(sizeof(Rebuild)*maxRebuilds, DT_ALLOC_PERM);
+	if (!m_rebuilds)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(m_rebuilds, 0, sizeof(Rebuild)*maxRebuilds);
+	m_maxRebuilds = maxRebuilds;
+	m_nav = nav;
+
+	return DT_SUCCESS;
+}
+
+void dtPolyRefRemap::clear()
+{
+	m_nrebuilds = 0;
+	m_next = 0;
+	m_pendingBase = 0;
+	m_pendingPolyCount = 0;
+}
+
+dtStatus dtPolyRefRemap::beginTileRebuild(const dtTileRef ref)
+{
+	dtAssert(m_nav);
+
+	m_pendingBase = 0;
+	m_pendingPolyCount = 0;
+	if (!ref)
+		return DT_SUCCESS;
+	const dtMeshTile* tile = m_nav->getTileByRef(ref);
+	if (!tile || !tile->header)
+		return DT_FAILURE | DT_INVALID_PARAM;
+
+	const int npolys = tile->header->polyCount;
+	if (npolys > m_pendingCapacity)
+	{
+		dtFree(m_pendingPoints);
+		dtFree(m_pendingPointCounts);
+		m_pendingPoints = (float*)dtAlloc(sizeof(float)*npolys*MAX_SAMPLE_POINTS*3, DT_ALLOC_PERM);
+		m_pendingPointCounts = (unsigned char*)dtAlloc(npolys, DT_ALLOC_PERM);
+		if (!m_pendingPoints || !m_pendingPointCounts)
+		{
+			dtFree(m_pendingPoints);
+			dtFree(m_pendingPointCounts);
+			m_pendingPoints = 0;
+			m_pendingPointCounts = 0;
+			m_pendingCapacity = 0;
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+		m_pendingCapacity = npolys;
+	}
+
+	// The tile data is freed when it is removed, keep the points to look up in the new tile.
+	for (int i = 0; i < npolys; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		float* points = &m_pendingPoints[i*MAX_SAMPLE_POINTS*3];
+		if (poly->getType() != DT_POLYTYPE_GROUND)
+		{
+			m_pendingPointCounts[i] = 0;
+			continue;
+		}
+
+		float* center = &points[0];
+		dtVset(center, 0, 0, 0);
+		for (int j = 0; j < poly->vertCount; ++j)
+			dtVadd(center, center, &tile->verts[poly->verts[j]*3]);
+		dtVscale(center, center, 1.0f / poly->vertCount);
+		for (int j = 0; j < poly->vertCount; ++j)
+			dtVlerp(&points[(1+j)*3], &tile->verts[poly->verts[j]*3], center, VERTEX_SAMPLE_INSET);
+		m_pendingPointCounts[i] = (unsigned char)(1 + poly->vertCount);
+	}
+	m_pendingBase = m_nav->getPolyRefBase(tile);
+	m_pendingPolyCount = npolys;
+
+	return DT_SUCCESS;
+}
+
+dtStatus dtPolyRefRemap::endTileRebuild(const dtTileRef ref)
+{
+	dtAssert(m_nav);
+
+	if (!m_pendingBase)
+		return DT_SUCCESS;
+	const dtMeshTile* tile = ref ? m_nav->getTileByRef(ref) : 0;
+	if (ref && (!tile || !tile->header))
+	{
+		m_pendingBase = 0;
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// Overwrite the oldest rebuild when full.
+	Rebuild& rebuild = m_rebuilds[m_next];
+	if (m_pendingPolyCount > rebuild.capacity)
+	{
+		dtFree(rebuild.newRefs);
+		rebuild.newRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*m_pendingPolyCount, DT_ALLOC_PERM);
+		rebuild.capacity = rebuild.newRefs ? m_pendingPolyCount : 0;
+		if (!rebuild.newRefs)
+		{
+			m_pendingBase = 0;
+			return DT_FAILURE | DT_OUT_OF_MEMORY;
+		}
+	}
+	const dtPolyRef newBase = tile ? m_nav->getPolyRefBase(tile) : 0;
+	rebuild.base = m_pendingBase;
+	rebuild.newBase = newBase;
+	rebuild.polyCount = m_pendingPolyCount;
+
+	for (int i = 0; i < m_pendingPolyCount; ++i)
+	{
+		rebuild.newRefs[i] = 0;
+		if (!tile)
+			continue;
+		// The rebuilt polygons are often at the same index.
+		const float* points = &m_pendingPoints[i*MAX_SAMPLE_POINTS*3];
+		for (int j = 0; j < m_pendingPointCounts[i]; ++j)
+		{
+			const int poly = findPolyUnderPoint(tile, &points[j*3], i);
+			if (poly != -1)
+			{
+				rebuild.newRefs[i] = newBase | (dtPolyRef)poly;
+				break;
+			}
+		}
+	}
+
+	m_next = (m_next + 1) % m_maxRebuilds;
+	m_nrebuilds = dtMin(m_nrebuilds + 1, m_maxRebuilds);
+	m_changeCount++;
+	m_pendingBase = 0;
+
+	// A spliced tile keeps its base, and the refs of its polygons do not tell before which rebuild
+	// they were taken. Keep one mapping per base: the previous rebuild of the base is composed with
+	// this one, or replaced by it when the tile was removed since.
+	for (int i = m_nrebuilds - 2; i >= 0; --i)
+	{
+		Rebuild& prev = getRebuild(i);
+		if (prev.base != rebuild.base)
+			continue;
+		if (prev.newBase == rebuild.base && composeRebuild(prev, rebuild))
+			dtSwap(prev, getRebuild(m_nrebuilds - 1));
+		removeRebuild(i);
+		break;
+	}
+
+	return DT_SUCCESS;
+}
+
+void dtPolyRefRemap::removeRebuild(const int age)
+{
+	// Move the later rebuilds, the removed one is reused by the next rebuild.
+	for (int i = age; i < m_nrebuilds - 1; ++i)
+		dtSwap(getRebuild(i), getRebuild(i + 1));
+	m_nrebuilds--;
+	m_next = (m_next - 1 + m_maxRebuilds) % m_maxRebuilds;
+}
+
+bool dtPolyRefRemap::composeRebuild(Rebuild& prev, const Rebuild& next) const
+{
+	// The splices keep the index of the polygons, and add the new ones after them.
+	const int npolys = dtMax(prev.polyCount, next.polyCount);
+	if (npolys > prev.capacity)
+	{
+		dtPolyRef* newRefs = (dtPolyRef*)dtAlloc(sizeof(dtPolyRef)*npolys, DT_ALLOC_PERM);
+		if (!newRefs)
+			return false;
+		if (prev.polyCount)
+			memcpy(newRefs, prev.newRefs, sizeof(dtPolyRef)*prev.polyCount);
+		dtFree(prev.newRefs);
+		prev.newRefs = newRefs;
+		prev.capacity = npolys;
+	}
+
+	for (int i = 0; i < prev.polyCount; ++i)
+	{
+		if (!prev.newRefs[i])
+			continue;
+		const unsigned int ip = m_nav->decodePolyIdPoly(prev.newRefs[i]);
+		prev.newRefs[i] = (int)ip < next.polyCount ? next.newRefs[ip] : 0;
+	}
+	for (int i = prev.polyCount; i < npolys; ++i)
+		prev.newRefs[i] = next.newRefs[i];
+	prev.polyCount = npolys;
+	prev.newBase = next.newBase;
+
+	return true;
+}
+
+dtPolyRef dtPolyRefRemap::remap(const dtPolyRef ref) const
+{
+	if (!m_nav || !ref)
+		return 0;
+
+	// Follow the rebuilds from the oldest, a polygon can be replaced several times.
+	dtPolyRef result = ref;
+	bool remapped = false;
+	for (int i = 0; i < m_nrebuilds; ++i)
+	{
+		const Rebuild& rebuild = m_rebuilds[(m_next - m_nrebuilds + i + m_maxRebuilds) % m_maxRebuilds];
+		unsigned int salt, it, ip;
+		m_nav->decodePolyId(result, salt, it, ip);
+		if (m_nav->encodePolyId(salt, it, 0) != rebuild.base)
+			continue;
+		// The polygon was added after the rebuild.
+		if ((int)ip >= rebuild.polyCount)
+			continue;
+		result = rebuild.newRefs[ip];
+		remapped = true;
+		if (!result)
+			return 0;
+	}
+
+	return remapped ? result : 0;
+}
@@ -0,0 +1,235 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include "DetourTileDataPool.h"
+#include "DetourCommon.h"
+#include "DetourAlloc.h"
+#include "DetourAssert.h"
+
+// Size classes: 256 bytes, then four classes per power of two up to 16MB.
+static const int DT_TILEDATA_MIN_SIZE_LOG2 = 8;
+static const int DT_TILEDATA_MAX_SIZE_LOG2 = 24;
+
+// Stored before the data of each buffer. Keeps the data aligned to 16 bytes.
+struct dtTileDataHeader
+{
+	dtTileDataPool* pool;
+	int sizeClass;
+	int size;
+};
+static const int DT_TILEDATA_HEADER_SIZE = 16;
+
+inline dtTileDataHeader* getHeader(unsigned char* mem)
+{
+	return (dtTileDataHeader*)mem;
+}
+
+// Free buffers are linked through their data.
+inline void*& nextFree(void* mem)
+{
+	return *(void**)((unsigned char*)mem + DT_TILEDATA_HEADER_SIZE);
+}
+
+dtTileDataPool::dtTileDataPool(size_t maxFreeBytes) :
+	m_maxFreeBytes(maxFreeBytes),
+	m_freeBytes(0),
+	m_reservedBytes(0),
+	m_peakReservedBytes(0),
+	m_liveBytes(0),
+	m_liveCount(0),
+	m_allocCount(0),
+	m_reuseCount(0)
+{
+	for (int i = 0; i < DT_TILEDATA_SIZE_CLASSES; ++i)
+	{
+		m_classes[i].freeList = 0;
+		m_classes[i].freeCount = 0;
+	}
+}
+
+dtTileDataPool::~dtTileDataPool()
+{
+	dtAssert(m_liveCount.load() == 0);
+	trim();
+}
+
+int dtTileDataPool::getSizeClass(const int size)
+{
+	if (size <= (1 << DT_TILEDATA_MIN_SIZE_LOG2))
+		return 0;
+	if (size > (1 << DT_TILEDATA_MAX_SIZE_LOG2))
+		return -1;
+	// Sizes in (2^p, 2^(p+1)] are split in four steps of 2^(p-2).
+	const int p = (int)dtIlog2((unsigned int)(size - 1));
+	const int step = ((size - 1) - (1 << p)) >> (p - 2);
+	return (p - DT_TILEDATA_MIN_SIZE_LOG2)*4 + step + 1;
+}
+
+int dtTileDataPool::getSizeClassSize(const int sizeClass)
+{
+	if (sizeClass <= 0)
+		return 1 << DT_TILEDATA_MIN_SIZE_LOG2;
+	const int p = DT_TILEDATA_MIN_SIZE_LOG2 + (sizeClass-1)/4;
+	const int step = (sizeClass-1) % 4;
+	return (1 << p) + (step+1) * (1 << (p-2));
+}
+
+void dtTileDataPool::addReserved(const size_t size)
+{
+	const size_t reserved = m_reservedBytes.fetch_add(size) + size;
+	size_t peak = m_peakReservedBytes.load();
+	while (reserved > peak && !m_peakReservedBytes.compare_exchange_weak(peak, reserved))
+	{
+	}
+}
+
+unsigned char* dtTileDataPool::allocate(const int size)
+{
+	if (size <= 0)
+		return 0;
+
+	const int sizeClass = getSizeClass(size);
+	unsigned char* mem = 0;
+	if (sizeClass == -1)
+	{
+		mem = (unsigned char*)dtAlloc(DT_TILEDATA_HEADER_SIZE + size, DT_ALLOC_PERM);
+		if (!mem)
+			return 0;
+		addReserved(size);
+	}
+	else
+	{
+		const int classSize = getSizeClassSize(sizeClass);
+		SizeClass& sc = m_classes[sizeClass];
+		{
+			std::lock_guard<std::mutex> lock(sc.lock);
+			if (sc.freeList)
+			{
+				mem = (unsigned char*)sc.freeList;
+				sc.freeList = nextFree(mem);
+				sc.freeCount--;
+			}
+		}
+		if (mem)
+		{
+			m_freeBytes -= classSize;
+			m_reuseCount++;
+		}
+		else
+		{
+			mem = (unsigned char*)dtAlloc(DT_TILEDATA_HEADER_SIZE + classSize, DT_ALLOC_PERM);
+			if (!mem)
+				return 0;
+			addReserved(classSize);
+		}
+	}
+
+	dtTileDataHeader* header = getHeader(mem);
+	header->pool = this;
+	header->sizeClass = sizeClass;
+	header->size = size;
+
+	m_liveBytes += size;
+	m_liveCount++;
+	m_allocCount++;
+
+	return mem + DT_TILEDATA_HEADER_SIZE;
+}
+
+void dtTileDataPool::release(unsigned char* data)
+{
+	if (!data)
+		return;
+	unsigned char* mem = data - DT_TILEDATA_HEADER_SIZE;
+	getHeader(mem)->pool->releaseBuffer(mem);
+}
+
+void dtTileDataPool::releaseBuffer(unsigned char* mem)
+{
+	const dtTileDataHeader* header = getHeader(mem);
+	const int sizeClass = header->sizeClass;
+	m_liveBytes -= header->size;
+	m_liveCount--;
+
+	if (sizeClass == -1)
+	{
+		m_reservedBytes -= header->size;
+		dtFree(mem);
+		return;
+	}
+
+	const size_t classSize = getSizeClassSize(sizeClass);
+	if (m_freeBytes.fetch_add(classSize) + classSize > m_maxFreeBytes)
+	{
+		m_freeBytes -= classSize;
+		m_reservedBytes -= classSize;
+		dtFree(mem);
+		return;
+	}
+
+	SizeClass& sc = m_classes[sizeClass];
+	std::lock_guard<std::mutex> lock(sc.lock);
+	nextFree(mem) = sc.freeList;
+	sc.freeList = mem;
+	sc.freeCount++;
+}
+
+void dtTileDataPool::trim()
+{
+	for (int i = 0; i < DT_TILEDATA_SIZE_CLASSES; ++i)
+	{
+		SizeClass& sc = m_classes[i];
+		void* freeList;
+		int freeCount;
+		{
+			std::lock_guard<std::mutex> lock(sc.lock);
+			freeList = sc.freeList;
+			freeCount = sc.freeCount;
+			sc.freeList = 0;
+			sc.freeCount = 0;
+		}
+		while (freeList)
+		{
+			void* next = nextFree(freeList);
+			dtFree(freeList);
+			freeList = next;
+		}
+		const size_t size = (size_t)freeCount * getSizeClassSize(i);
+		m_freeBytes -= size;
+		m_reservedBytes -= size;
+	}
+}
+
+void dtTileDataPool::getStats(dtTileDataPoolStats& stats) const
+{
+	stats.allocCount = m_allocCount.load();
+	stats.reuseCount = m_reuseCount.load();
+	stats.liveCount = m_liveCount.load();
+	stats.freeCount = 0;
+	for (int i = 0; i < DT_TILEDATA_SIZE_CLASSES; ++i)
+	{
+		const SizeClass& sc = m_classes[i];
+		std::lock_guard<std::mutex> lock(sc.lock);
+		stats.freeCount += sc.freeCount;
+	}
+	stats.liveBytes = m_liveBytes.load();
+	stats.reservedBytes = m_reservedBytes.load();
+	stats.peakReservedBytes = m_peakReservedBytes.load();
+	stats.fragmentation = stats.reservedBytes > 0 ?
+		(float)(stats.reservedBytes - dtMin(stats.liveBytes, stats.reservedBytes)) / (float)stats.reservedBytes : 0.0f;
+}
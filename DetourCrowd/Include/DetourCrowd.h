@@ -169,6 +169,7 @@ struct dtCrowdAgent
 	dtPathQueueRef targetPathqRef;		///< Path finder ref.
 	bool targetReplan;					///< Flag indicating that the current path is being replanned.
 	float targetReplanTime;				/// <Time since the agent's target was replanned.
+	unsigned int remapChangeCount;		///< The change count of the poly ref remap when the corridor was last remapped.
 };
 
 struct dtCrowdAgentAnimation
@@ -226,6 +227,8 @@ class dtCrowd
 	int m_velocitySampleCount;
 
 	dtNavMeshQuery* m_navquery;
+	
+	const class dtPolyRefRemap* m_polyRefRemap;
 
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
 	void updateMoveRequest(const float dt);
@@ -347,6 +350,15 @@ public:
 
 	/// Gets the query object used by the crowd.
 	const dtNavMeshQuery* getNavMeshQuery() const { return m_navquery; }
+	
+	/// Sets the rebuilds of the tiles used to repair the paths of the agents after the tiles are rebuilt,
+	/// instead of planning them again. [opt]
+	/// The remap must outlive the crowd, or be reset to null.
+	void setPolyRefRemap(const class dtPolyRefRemap* remap);
+	
+	/// Sets the cache of the paths searched by the path queue of the crowd. [opt]
+	/// The cache must outlive the crowd, or be reset to null.
+	void setPathCache(class dtPathCache* cache) { m_pathq.setPathCache(cache); }
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
@@ -81,6 +81,25 @@ public:
 	bool trimInvalidPath(dtPolyRef safeRef, const float* safePos,
 						 dtNavMeshQuery* navquery, const dtQueryFilter* filter);
 	
+	/// Replaces the polygons of the corridor which are not valid anymore with the polygons which
+	/// replaced them in rebuilt tiles, so that the corridor does not need to be planned again.
+	/// The corridor is left unchanged if one of these polygons was not replaced, or if the
+	/// replacing polygons are not connected to the rest of the corridor.
+	///  @param[in]		remap		The rebuilds of the tiles.
+	///  @param[in]		navquery	The query object used to build the corridor.
+	///  @param[in]		filter		The filter to apply to the operation.
+	/// @return True if the corridor was changed.
+	bool remapInvalidPath(const class dtPolyRefRemap& remap, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+	
+	/// Replaces the invalid sections of the corridor with local paths from the valid polygon before
+	/// them to the valid polygon after them.
+	/// The sections already replaced are kept when a later section cannot be replaced.
+	///  @param[in]		maxIterations	The maximum number of nodes to search for all the sections.
+	///  @param[in]		navquery		The query object used to build the corridor.
+	///  @param[in]		filter			The filter to apply to the operation.
+	/// @return True if the whole corridor is valid.
+	bool repairInvalidPath(const int maxIterations, dtNavMeshQuery* navquery, const dtQueryFilter* filter);
+	
 	/// Checks the current corridor path to see if its polygon references remain valid. 
 	///  @param[in]		maxLookAhead	The number of polygons from the beginning of the corridor to search.
 	///  @param[in]		navquery		The query object used to build the corridor.
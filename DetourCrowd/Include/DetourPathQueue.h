@@ -49,6 +49,7 @@ class dtPathQueue
 	int m_maxPathSize;
 	int m_queueHead;
 	dtNavMeshQuery* m_navquery;
+	class dtPathCache* m_pathCache;
 	
 	void purge();
 	
@@ -69,6 +70,11 @@ public:
 	dtStatus getPathResult(dtPathQueueRef ref, dtPolyRef* path, int* pathSize, const int maxPath);
 	
 	inline const dtNavMeshQuery* getNavQuery() const { return m_navquery; }
+	
+	/// Sets the cache to look up the paths in before searching them, and to store the complete paths found in. [opt]
+	/// The cache must outlive the queue, or be reset to null.
+	void setPathCache(class dtPathCache* cache) { m_pathCache = cache; }
+	class dtPathCache* getPathCache() const { return m_pathCache; }
 
 private:
 	// Explicitly disabled copy constructor and copy assignment operator.
@@ -27,6 +27,7 @@
 #include "DetourCommon.h"
 #include "DetourMath.h"
 #include "DetourAssert.h"
+#include "DetourPolyRefRemap.h"
 #include "DetourAlloc.h"
 
 
@@ -339,7 +340,8 @@ dtCrowd::dtCrowd() :
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_polyRefRemap(0)
 {
 }
 
@@ -474,6 +476,14 @@ const dtObstacleAvoidanceParams* dtCrowd::getObstacleAvoidanceParams(const int i
 	return 0;
 }
 
+void dtCrowd::setPolyRefRemap(const dtPolyRefRemap* remap)
+{
+	m_polyRefRemap = remap;
+	// The corridors were not checked against the rebuilds of this remap, check them on the next update.
+	for (int i = 0; i < m_maxAgents; ++i)
+		m_agents[i].remapChangeCount = remap ? remap->getChangeCount() - 1 : 0;
+}
+
 int dtCrowd::getAgentCount() const
 {
 	return m_maxAgents;
@@ -544,6 +554,7 @@ int dtCrowd::addAgent(const float* pos, const dtCrowdAgentParams* params)
 
 	ag->topologyOptTime = 0;
 	ag->targetReplanTime = 0;
+	ag->remapChangeCount = m_polyRefRemap ? m_polyRefRemap->getChangeCount() : 0;
 	ag->nneis = 0;
 	
 	dtVset(ag->dvel, 0,0,0);
@@ -941,6 +952,7 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 {
 	static const int CHECK_LOOKAHEAD = 10;
 	static const float TARGET_REPLAN_DELAY = 1.0; // seconds
+	static const int MAX_REPAIR_ITER = 64;
 	
 	for (int i = 0; i < nagents; ++i)
 	{
@@ -952,6 +964,17 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 		ag->targetReplanTime += dt;
 
 		bool replan = false;
+		
+		// Keep the path through the polygons of the tiles rebuilt since the last check.
+		if (m_polyRefRemap && ag->remapChangeCount != m_polyRefRemap->getChangeCount())
+		{
+			ag->remapChangeCount = m_polyRefRemap->getChangeCount();
+			if (ag->corridor.remapInvalidPath(*m_polyRefRemap, m_navquery, &m_filters[ag->params.queryFilterType]))
+			{
+				dtVcopy(ag->npos, ag->corridor.getPos());
+				ag->boundary.reset();
+			}
+		}
 
 		// First check that the current location is valid.
 		const int idx = getAgentIndex(ag);
@@ -995,6 +1018,16 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 		// Try to recover move request position.
 		if (ag->targetState != DT_CROWDAGENT_TARGET_NONE && ag->targetState != DT_CROWDAGENT_TARGET_FAILED)
 		{
+			if (m_polyRefRemap && !m_navquery->isValidPolyRef(ag->targetRef, &m_filters[ag->params.queryFilterType]))
+			{
+				// The corridor ends at the polygon which replaced the target.
+				const dtPolyRef targetRef = m_polyRefRemap->remap(ag->targetRef);
+				if (targetRef && targetRef == ag->corridor.getLastPoly())
+				{
+					ag->targetRef = targetRef;
+					dtVcopy(ag->targetPos, ag->corridor.getTarget());
+				}
+			}
 			if (!m_navquery->isValidPolyRef(ag->targetRef, &m_filters[ag->params.queryFilterType]))
 			{
 				// Current target is not valid, try to reposition.
@@ -1014,13 +1047,15 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 			}
 		}
 
-		// If nearby corridor is not valid, replan.
+		// If nearby corridor is not valid, try to repair it locally, or else replan.
 		if (!ag->corridor.isValid(CHECK_LOOKAHEAD, m_navquery, &m_filters[ag->params.queryFilterType]))
 		{
 			// Fix current path.
 //			ag->corridor.trimInvalidPath(agentRef, agentPos, m_navquery, &m_filter);
-//			ag->boundary.reset();
-			replan = true;
+			if (!replan && ag->corridor.repairInvalidPath(MAX_REPAIR_ITER, m_navquery, &m_filters[ag->params.queryFilterType]))
+				ag->boundary.reset();
+			else
+				replan = true;
 		}
 		
 		// If the end of the path is near and it is not the requested location, replan.
@@ -19,6 +19,7 @@
 #include <string.h>
 #include "DetourPathCorridor.h"
 #include "DetourNavMeshQuery.h"
+#include "DetourPolyRefRemap.h"
 #include "DetourCommon.h"
 #include "DetourAssert.h"
 #include "DetourAlloc.h"
@@ -579,6 +580,163 @@ bool dtPathCorridor::trimInvalidPath(dtPolyRef safeRef, const float* safePos,
 	return true;
 }
 
+static bool arePolysConnected(const dtNavMesh* nav, const dtPolyRef from, const dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(from, &tile, &poly);
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == to)
+			return true;
+	}
+	return false;
+}
+
+// Returns the polygon to use in place of a polygon of the corridor, or 0.
+static dtPolyRef getValidPolyRef(const dtPolyRef ref, const dtPolyRefRemap& remap,
+								 dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	if (navquery->isValidPolyRef(ref, filter))
+		return ref;
+	const dtPolyRef newRef = remap.remap(ref);
+	return navquery->isValidPolyRef(newRef, filter) ? newRef : 0;
+}
+
+/// @par
+///
+/// Use this after tiles were rebuilt, before #isValid, to keep the corridor when the polygons of
+/// the rebuilt tiles are still there with new references. The polygons replaced by the same polygon
+/// are merged, and the position and the target are moved into the first and last polygons if they were replaced.
+bool dtPathCorridor::remapInvalidPath(const dtPolyRefRemap& remap, dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	dtAssert(navquery);
+	dtAssert(filter);
+	dtAssert(m_path);
+	
+	const dtNavMesh* nav = navquery->getAttachedNavMesh();
+	
+	// Check that the whole path can be remapped before changing it.
+	bool changed = false;
+	dtPolyRef prev = 0;
+	bool prevChanged = false;
+	for (int i = 0; i < m_npath; ++i)
+	{
+		const dtPolyRef ref = getValidPolyRef(m_path[i], remap, navquery, filter);
+		if (!ref)
+			return false;
+		const bool refChanged = ref != m_path[i];
+		changed |= refChanged;
+		if (ref == prev)
+			continue;
+		// The links between the polygons which were not replaced did not change.
+		if (prev && (prevChanged || refChanged) && !arePolysConnected(nav, prev, ref))
+			return false;
+		prev = ref;
+		prevChanged = refChanged;
+	}
+	if (!changed)
+		return false;
+	
+	const bool firstChanged = !navquery->isValidPolyRef(m_path[0], filter);
+	const bool lastChanged = !navquery->isValidPolyRef(m_path[m_npath-1], filter);
+	int n = 0;
+	for (int i = 0; i < m_npath; ++i)
+	{
+		const dtPolyRef ref = getValidPolyRef(m_path[i], remap, navquery, filter);
+		if (n > 0 && m_path[n-1] == ref)
+			continue;
+		m_path[n++] = ref;
+	}
+	m_npath = n;
+	
+	float closest[3];
+	if (firstChanged)
+	{
+		navquery->closestPointOnPoly(m_path[0], m_pos, closest, 0);
+		dtVcopy(m_pos, closest);
+	}
+	if (lastChanged)
+	{
+		navquery->closestPointOnPoly(m_path[m_npath-1], m_target, closest, 0);
+		dtVcopy(m_target, closest);
+	}
+	
+	return true;
+}
+
+static void getPolyCenter(const dtNavMesh* nav, const dtPolyRef ref, float* center)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	nav->getTileAndPolyByRefUnsafe(ref, &tile, &poly);
+	dtCalcPolyCenter(center, poly->verts, (int)poly->vertCount, tile->verts);
+}
+
+/// @par
+///
+/// Use this when a short section of a long corridor becomes invalid, for example when an obstacle is
+/// added on the path, instead of planning the whole path again. Each invalid section is searched with a
+/// local A* search from the polygon before it to the polygon after it, and replaced by the path found.
+/// The search can only find paths of up to 32 polygons.
+///
+/// The first polygon of the corridor must be valid, see #fixPathStart. If the last polygon is not valid,
+/// the corridor cannot be repaired.
+bool dtPathCorridor::repairInvalidPath(const int maxIterations, dtNavMeshQuery* navquery, const dtQueryFilter* filter)
+{
+	dtAssert(navquery);
+	dtAssert(filter);
+	dtAssert(m_path);
+	
+	static const int MAX_RES = 32;
+	dtPolyRef res[MAX_RES];
+	
+	const dtNavMesh* nav = navquery->getAttachedNavMesh();
+	int iterationsLeft = maxIterations;
+	int i = 0;
+	for (;;)
+	{
+		// Find the next invalid section.
+		while (i < m_npath && navquery->isValidPolyRef(m_path[i], filter))
+			i++;
+		if (i == m_npath)
+			return true;
+		if (i == 0)
+			return false;
+		int j = i+1;
+		while (j < m_npath && !navquery->isValidPolyRef(m_path[j], filter))
+			j++;
+		if (j == m_npath)
+			return false;
+		
+		const int start = i-1;
+		float startPos[3], endPos[3];
+		if (start == 0)
+			dtVcopy(startPos, m_pos);
+		else
+			getPolyCenter(nav, m_path[start], startPos);
+		if (j == m_npath-1)
+			dtVcopy(endPos, m_target);
+		else
+			getPolyCenter(nav, m_path[j], endPos);
+		
+		navquery->initSlicedFindPath(m_path[start], m_path[j], startPos, endPos, filter);
+		int iterations = 0;
+		dtStatus status = navquery->updateSlicedFindPath(iterationsLeft, &iterations);
+		iterationsLeft -= iterations;
+		if (!dtStatusSucceed(status) || dtStatusInProgress(status))
+			return false;
+		int nres = 0;
+		status = navquery->finalizeSlicedFindPath(res, &nres, MAX_RES);
+		if (dtStatusFailed(status) || dtStatusDetail(status, DT_PARTIAL_RESULT) || nres < 2 || res[nres-1] != m_path[j])
+			return false;
+		
+		// The local path starts at the polygon before the section, and joins the corridor again after it.
+		m_npath = start + dtMergeCorridorStartShortcut(m_path+start, m_npath-start, m_maxPath-start, res, nres);
+		i = start;
+	}
+}
+
 /// @par
 ///
 /// The path can be invalidated if there are structural changes to the underlying navigation mesh, or the state of 
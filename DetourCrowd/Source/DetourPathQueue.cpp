@@ -20,6 +20,7 @@
 #include "DetourPathQueue.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshQuery.h"
+#include "DetourPathCache.h"
 #include "DetourAlloc.h"
 #include "DetourCommon.h"
 
@@ -28,7 +29,8 @@ dtPathQueue::dtPathQueue() :
 	m_nextHandle(1),
 	m_maxPathSize(0),
 	m_queueHead(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_pathCache(0)
 {
 	for (int i = 0; i < MAX_QUEUE; ++i)
 		m_queue[i].path = 0;
@@ -111,6 +113,13 @@ void dtPathQueue::update(const int maxIters)
 		// Handle query start.
 		if (q.status == 0)
 		{
+			// Paths found before are not searched again.
+			if (m_pathCache && m_pathCache->find(m_navquery, q.startRef, q.endRef, q.filter, q.path, &q.npath, m_maxPathSize))
+			{
+				q.status = DT_SUCCESS;
+				m_queueHead++;
+				continue;
+			}
 			q.status = m_navquery->initSlicedFindPath(q.startRef, q.endRef, q.startPos, q.endPos, q.filter);
 		}		
 		// Handle query in progress.
@@ -123,6 +132,9 @@ void dtPathQueue::update(const int maxIters)
 		if (dtStatusSucceed(q.status))
 		{
 			q.status = m_navquery->finalizeSlicedFindPath(q.path, &q.npath, m_maxPathSize);
+			if (m_pathCache && dtStatusSucceed(q.status) &&
+				!dtStatusDetail(q.status, DT_PARTIAL_RESULT) && !dtStatusDetail(q.status, DT_BUFFER_TOO_SMALL))
+				m_pathCache->store(m_navquery, q.filter, q.path, q.npath);
 		}
 
 		if (iterCount <= 0)
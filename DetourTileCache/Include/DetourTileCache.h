@@ -107,6 +107,16 @@ public:
 	struct dtTileCacheAlloc* getAlloc() { return m_talloc; }
 	struct dtTileCacheCompressor* getCompressor() { return m_tcomp; }
 	const dtTileCacheParams* getParams() const { return &m_params; }
+
+	/// Sets the pool to allocate the navmesh tile data built by #buildNavMeshTile from. [opt]
+	/// The pool must outlive the tiles built from it.
+	void setTileDataPool(class dtTileDataPool* pool) { m_dataPool = pool; }
+	class dtTileDataPool* getTileDataPool() const { return m_dataPool; }
+	
+	/// Sets the remap to record the navmesh tiles rebuilt by the tile cache in. [opt]
+	/// Only the rebuilds of the tiles of the navmesh of the remap are recorded.
+	void setPolyRefRemap(class dtPolyRefRemap* remap) { m_polyRefRemap = remap; }
+	class dtPolyRefRemap* getPolyRefRemap() const { return m_polyRefRemap; }
 	
 	inline int getTileCount() const { return m_params.maxTiles; }
 	inline const dtCompressedTile* getTile(const int i) const { return &m_tiles[i]; }
@@ -148,6 +158,11 @@ public:
 						dtCompressedTileRef* results, int* resultCount, const int maxResults) const;
 	
 	/// Updates the tile cache by rebuilding tiles touched by unfinished obstacle requests.
+	/// A touched layer whose walkable cells are the same as when its navmesh tile was last built
+	/// is not rebuilt, as long as that navmesh tile is still in @p navmesh.
+	/// Otherwise only the regions around the changed cells are partitioned again, and the navmesh tile
+	/// keeps its ref, as well as the polygons which did not change. The polygons which changed are left
+	/// in the tile with no flags until a rebuild compacts the tile, when there are more of them than walkable ones.
 	///  @param[in]		dt			The time step size. Currently not used.
 	///  @param[in]		navmesh		The mesh to affect when rebuilding tiles.
 	///  @param[out]	upToDate	Whether the tile cache is fully up to date with obstacle requests and tile rebuilds.
@@ -157,6 +172,8 @@ public:
 	
 	dtStatus buildNavMeshTilesAt(const int tx, const int ty, class dtNavMesh* navmesh);
 	
+	/// Builds the navmesh tile of a tile cache layer, with the obstacles touching it, and replaces
+	/// the tile of the navmesh.
 	dtStatus buildNavMeshTile(const dtCompressedTileRef ref, class dtNavMesh* navmesh);
 	
 	void calcTightTileBounds(const struct dtTileCacheLayerHeader* header, float* bmin, float* bmax) const;
@@ -222,12 +239,43 @@ private:
 		dtObstacleRef ref;
 	};
 	
+	/// What the last navmesh tile built from a tile cache layer was built from.
+	struct TileBuildState
+	{
+		unsigned char* nullCells;			///< One bit per cell of the layer, set if the cell was not walkable.
+		int nullCellsSize;					///< The size of the bits, in bytes.
+		const class dtNavMesh* navmesh;		///< The navmesh the tile was added to, null if not built.
+		const struct dtMeshTile* navTile;	///< The navmesh tile, null if the layer was empty.
+		unsigned int navTileChangeCount;	///< The change count of the navmesh tile when it was added.
+		unsigned char* regs;				///< The regions of the layer, null if not recorded.
+		int regsSize;						///< The number of regions cells.
+	};
+	
+	dtStatus buildNavMeshTile(const dtCompressedTileRef ref, class dtNavMesh* navmesh, const bool skipUnchanged);
+	
+	/// Returns true if the navmesh tile of a layer was built by the last build of the layer, and is still in the navmesh.
+	bool isNavMeshTileBuilt(const TileBuildState& state, const struct dtTileCacheLayerHeader* header,
+							const class dtNavMesh* navmesh) const;
+	
+	/// Finds the cells which became walkable or not walkable since the last build of a layer.
+	///  @param[out]	changedMin	The minimum x and y of the changed cells.
+	///  @param[out]	changedMax	The maximum x and y of the changed cells.
+	/// @return False if no cell changed.
+	bool getChangedCells(const TileBuildState& state, const struct dtTileCacheLayer& layer,
+						 int* changedMin, int* changedMax) const;
+	
+	/// Records the walkable cells, the regions and the navmesh tile of a build.
+	void setTileBuildState(TileBuildState& state, const struct dtTileCacheLayer& layer, const class dtNavMesh* navmesh);
+	
+	static void resetTileBuildState(TileBuildState& state);
+	
 	int m_tileLutSize;						///< Tile hash lookup size (must be pot).
 	int m_tileLutMask;						///< Tile hash lookup mask.
 	
 	dtCompressedTile** m_posLookup;			///< Tile hash lookup.
 	dtCompressedTile* m_nextFreeTile;		///< Freelist of tiles.
 	dtCompressedTile* m_tiles;				///< List of tiles.
+	TileBuildState* m_buildStates;			///< The last build of each tile, used to skip rebuilds which would not change anything.
 	
 	unsigned int m_saltBits;				///< Number of salt bits in the tile ID.
 	unsigned int m_tileBits;				///< Number of tile bits in the tile ID.
@@ -237,6 +285,8 @@ private:
 	dtTileCacheAlloc* m_talloc;
 	dtTileCacheCompressor* m_tcomp;
 	dtTileCacheMeshProcess* m_tmproc;
+	dtTileDataPool* m_dataPool;
+	dtPolyRefRemap* m_polyRefRemap;
 	
 	dtTileCacheObstacle* m_obstacles;
 	dtTileCacheObstacle* m_nextFreeObstacle;
@@ -93,6 +93,59 @@ struct dtTileCacheAlloc
 	}
 };
 
+/// A linear allocator for the temporary data of tile builds, reused from one build to the next.
+///
+/// Allocations bump a pointer in the current block, and freeing does nothing unless the
+/// pointer is the last allocation. #reset releases everything at once and merges the blocks,
+/// so that the next build of a similar size fits in a single block. Unlike a fixed size buffer,
+/// a build never fails because the arena is full.
+///
+/// Not thread safe, use one arena per thread building tiles.
+/// The blocks are allocated with #dtAlloc.
+struct dtTileCacheArena : public dtTileCacheAlloc
+{
+	///  @param[in]		blockSize	The minimum size of the blocks, in bytes.
+	explicit dtTileCacheArena(size_t blockSize = 64*1024);
+	virtual ~dtTileCacheArena();
+
+	virtual void reset();
+	virtual void* alloc(const size_t size);
+	virtual void free(void* ptr);
+
+	/// The number of bytes allocated since the last reset.
+	size_t getUsedSize() const { return m_used; }
+
+	/// The largest number of bytes allocated between two resets.
+	size_t getPeakSize() const { return m_peak; }
+
+	/// The total size of the blocks, in bytes.
+	size_t getCapacity() const { return m_capacity; }
+
+private:
+	struct Block
+	{
+		Block* next;
+		size_t size;
+	};
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	dtTileCacheArena(const dtTileCacheArena&);
+	dtTileCacheArena& operator=(const dtTileCacheArena&);
+
+	bool addBlock(size_t size);
+	void freeBlocks();
+
+	Block* m_blocks;	///< The current block, followed by the previous ones.
+	unsigned char* m_top;
+	unsigned char* m_end;
+	void* m_last;
+	size_t m_blockSize;
+	size_t m_used;
+	size_t m_peak;
+	size_t m_capacity;
+	int m_blockCount;
+};
+
 struct dtTileCacheCompressor
 {
 	virtual ~dtTileCacheCompressor();
@@ -137,6 +190,24 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 								 dtTileCacheLayer& layer,
 								 const int walkableClimb);
 
+/// Rebuilds the regions of a layer after a change limited to a rectangle of cells.
+/// The regions of the previous build which do not overlap the rectangle, and whose cells are all
+/// still walkable, are kept as they were, so that their contours and polygons do not change.
+/// The other walkable cells are partitioned again.
+///  @param[in]		alloc			The allocator of the temporary data.
+///  @param[in,out]	layer			The layer, with the areas after the change.
+///  @param[in]		walkableClimb	The maximum height difference between connected cells. [Units: vx]
+///  @param[in]		prevRegs		The regions of the previous build of the layer. [Size: width * height]
+///  @param[in]		minx, miny		The lower corner of the changed cells, inclusive. [Units: vx]
+///  @param[in]		maxx, maxy		The upper corner of the changed cells, inclusive. [Units: vx]
+/// @return The status flags. Fails with #DT_BUFFER_TOO_SMALL if the regions do not fit in the region ids,
+/// a full rebuild may still succeed.
+dtStatus dtBuildTileCacheRegionsPartial(dtTileCacheAlloc* alloc,
+										dtTileCacheLayer& layer,
+										const int walkableClimb,
+										const unsigned char* prevRegs,
+										const int minx, const int miny, const int maxx, const int maxy);
+
 dtStatus dtBuildTileCacheContours(dtTileCacheAlloc* alloc,
 								  dtTileCacheLayer& layer,
 								  const int walkableClimb, 	const float maxError,
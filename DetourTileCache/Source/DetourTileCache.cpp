@@ -2,6 +2,8 @@
 #include "DetourTileCacheBuilder.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourNavMesh.h"
+#include "DetourTileDataPool.h"
+#include "DetourPolyRefRemap.h"
 #include "DetourCommon.h"
 #include "DetourMath.h"
 #include "DetourAlloc.h"
@@ -60,17 +62,271 @@ struct NavMeshTileBuildContext
 };
 
 
+// Records a navmesh tile about to be replaced in the remap, if it is a remap of the navmesh.
+static void beginNavMeshTileRebuild(dtPolyRefRemap* remap, const dtNavMesh* navmesh, const dtTileRef ref)
+{
+	if (remap && remap->getNavMesh() == navmesh)
+		remap->beginTileRebuild(ref);
+}
+
+static void endNavMeshTileRebuild(dtPolyRefRemap* remap, const dtNavMesh* navmesh, const dtTileRef ref)
+{
+	if (remap && remap->getNavMesh() == navmesh)
+		remap->endTileRebuild(ref);
+}
+
+static const unsigned short SPLICE_NULL_IDX = 0xffff;
+
+// Writes the quantized vertices of a polygon, starting from its smallest vertex so that the
+// same polygon built again gives the same vertices.
+static void getCanonicalPolyVerts(const unsigned short* verts, const unsigned short* poly, const int nv,
+								  unsigned short* out)
+{
+	int first = 0;
+	for (int i = 1; i < nv; ++i)
+	{
+		const unsigned short* v = &verts[poly[i]*3];
+		const unsigned short* f = &verts[poly[first]*3];
+		if (v[0] < f[0] || (v[0] == f[0] && (v[2] < f[2] || (v[2] == f[2] && v[1] < f[1]))))
+			first = i;
+	}
+	for (int i = 0; i < nv; ++i)
+	{
+		const unsigned short* v = &verts[poly[(first+i) % nv]*3];
+		out[i*3+0] = v[0];
+		out[i*3+1] = v[1];
+		out[i*3+2] = v[2];
+	}
+}
+
+static unsigned int hashPoly(const unsigned short* canonVerts, const int nv, const unsigned char area,
+							 const unsigned short flags)
+{
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	h = (h ^ area) * 16777619u;
+	h = (h ^ flags) * 16777619u;
+	h = (h ^ (unsigned int)nv) * 16777619u;
+	for (int i = 0; i < nv*3; ++i)
+		h = (h ^ canonVerts[i]) * 16777619u;
+	return h;
+}
+
+static int countPolyVerts(const unsigned short* poly, const int nvp)
+{
+	for (int i = 0; i < nvp; ++i)
+		if (poly[i] == SPLICE_NULL_IDX)
+			return i;
+	return nvp;
+}
+
+struct SpliceBuffers
+{
+	inline SpliceBuffers() : oldVerts(0), oldHash(0), buckets(0), next(0), matched(0), newToFinal(0),
+		oldVertToFinal(0), verts(0), polys(0), areas(0), flags(0) {}
+	inline ~SpliceBuffers()
+	{
+		dtFree(oldVerts);
+		dtFree(oldHash);
+		dtFree(buckets);
+		dtFree(next);
+		dtFree(matched);
+		dtFree(newToFinal);
+		dtFree(oldVertToFinal);
+		dtFree(verts);
+		dtFree(polys);
+		dtFree(areas);
+		dtFree(flags);
+	}
+	unsigned short* oldVerts;
+	unsigned int* oldHash;
+	int* buckets;
+	int* next;
+	unsigned char* matched;
+	unsigned short* newToFinal;
+	unsigned short* oldVertToFinal;
+	unsigned short* verts;
+	unsigned short* polys;
+	unsigned char* areas;
+	unsigned short* flags;
+};
+
+/// Creates the navmesh data of a rebuilt tile, with the polygons which were already in the current tile
+/// at their current index, so that their refs stay valid once the data replaces the tile at the same ref.
+/// The other polygons of the current tile are kept as unwalkable polygons without links, and the new
+/// polygons are added after them.
+/// Returns false when it does not apply, then the data must be created the usual way, which also removes
+/// the unwalkable polygons.
+static bool createSplicedNavMeshData(const dtMeshTile* oldTile, const dtNavMeshCreateParams& params,
+									 const int maxPolys, unsigned char** outData, int* outDataSize,
+									 dtTileDataPool* pool)
+{
+	const dtMeshHeader* header = oldTile->header;
+	if (!header || header->offMeshConCount || params.offMeshConCount || params.nvp != DT_VERTS_PER_POLYGON)
+		return false;
+	if (!dtVequal(header->bmin, params.bmin))
+		return false;
+	
+	const int nvp = params.nvp;
+	const int nold = header->polyCount;
+	const int nnew = params.polyCount;
+	const int noldVerts = header->vertCount;
+	if (!nold || params.vertCount + noldVerts >= 0xffff)
+		return false;
+	
+	SpliceBuffers buf;
+	int nbuckets = 1;
+	while (nbuckets < nold*2)
+		nbuckets <<= 1;
+	buf.oldVerts = (unsigned short*)dtAlloc(sizeof(unsigned short)*noldVerts*3, DT_ALLOC_TEMP);
+	buf.oldHash = (unsigned int*)dtAlloc(sizeof(unsigned int)*nold, DT_ALLOC_TEMP);
+	buf.buckets = (int*)dtAlloc(sizeof(int)*nbuckets, DT_ALLOC_TEMP);
+	buf.next = (int*)dtAlloc(sizeof(int)*nold, DT_ALLOC_TEMP);
+	buf.matched = (unsigned char*)dtAlloc(nold, DT_ALLOC_TEMP);
+	buf.newToFinal = (unsigned short*)dtAlloc(sizeof(unsigned short)*nnew, DT_ALLOC_TEMP);
+	if (!buf.oldVerts || !buf.oldHash || !buf.buckets || !buf.next || !buf.matched || !buf.newToFinal)
+		return false;
+	
+	// The vertices of the tile were created from the quantized vertices of the same layer.
+	const float ics = 1.0f / params.cs;
+	const float ich = 1.0f / params.ch;
+	for (int i = 0; i < noldVerts; ++i)
+	{
+		const float* v = &oldTile->verts[i*3];
+		buf.oldVerts[i*3+0] = (unsigned short)dtMathFloorf((v[0] - params.bmin[0])*ics + 0.5f);
+		buf.oldVerts[i*3+1] = (unsigned short)dtMathFloorf((v[1] - params.bmin[1])*ich + 0.5f);
+		buf.oldVerts[i*3+2] = (unsigned short)dtMathFloorf((v[2] - params.bmin[2])*ics + 0.5f);
+	}
+	
+	unsigned short canon[DT_VERTS_PER_POLYGON*3];
+	unsigned short otherCanon[DT_VERTS_PER_POLYGON*3];
+	memset(buf.buckets, 0xff, sizeof(int)*nbuckets);
+	memset(buf.matched, 0, nold);
+	for (int i = nold-1; i >= 0; --i)
+	{
+		const dtPoly* p = &oldTile->polys[i];
+		if (p->getType() != DT_POLYTYPE_GROUND)
+			return false;
+		getCanonicalPolyVerts(buf.oldVerts, p->verts, p->vertCount, canon);
+		buf.oldHash[i] = hashPoly(canon, p->vertCount, p->getArea(), p->flags);
+		const int bucket = (int)(buf.oldHash[i] & (unsigned int)(nbuckets-1));
+		buf.next[i] = buf.buckets[bucket];
+		buf.buckets[bucket] = i;
+	}
+	
+	// Keep the index of the new polygons which are the same as a current one.
+	int nmatched = 0;
+	int nfinal = nold;
+	for (int i = 0; i < nnew; ++i)
+	{
+		const unsigned short* src = &params.polys[i*nvp*2];
+		const int nv = countPolyVerts(src, nvp);
+		getCanonicalPolyVerts(params.verts, src, nv, canon);
+		const unsigned int h = hashPoly(canon, nv, params.polyAreas[i], params.polyFlags[i]);
+		int match = -1;
+		for (int j = buf.buckets[h & (unsigned int)(nbuckets-1)]; j != -1; j = buf.next[j])
+		{
+			const dtPoly* p = &oldTile->polys[j];
+			if (buf.matched[j] || buf.oldHash[j] != h || p->vertCount != nv ||
+				p->getArea() != params.polyAreas[i] || p->flags != params.polyFlags[i])
+				continue;
+			getCanonicalPolyVerts(buf.oldVerts, p->verts, nv, otherCanon);
+			if (memcmp(canon, otherCanon, sizeof(unsigned short)*nv*3) == 0)
+			{
+				match = j;
+				break;
+			}
+		}
+		if (match != -1)
+		{
+			buf.matched[match] = 1;
+			buf.newToFinal[i] = (unsigned short)match;
+			nmatched++;
+		}
+		else
+		{
+			buf.newToFinal[i] = (unsigned short)nfinal++;
+		}
+	}
+	
+	// Without a polygon to keep, or with more unwalkable polygons than walkable ones, the tile is rebuilt.
+	if (!nmatched || nfinal > maxPolys || nfinal - nnew > nnew)
+		return false;
+	
+	// The new vertices, then the current ones used by the polygons which are not in the new tile.
+	// The vertices of the kept polygons, and of the polygons removed by earlier splices which are
+	// not used anymore, are not carried over, so the tile does not grow with each splice.
+	buf.verts = (unsigned short*)dtAlloc(sizeof(unsigned short)*(params.vertCount + noldVerts)*3, DT_ALLOC_TEMP);
+	buf.oldVertToFinal = (unsigned short*)dtAlloc(sizeof(unsigned short)*noldVerts, DT_ALLOC_TEMP);
+	buf.polys = (unsigned short*)dtAlloc(sizeof(unsigned short)*nfinal*nvp*2, DT_ALLOC_TEMP);
+	buf.areas = (unsigned char*)dtAlloc(nfinal, DT_ALLOC_TEMP);
+	buf.flags = (unsigned short*)dtAlloc(sizeof(unsigned short)*nfinal, DT_ALLOC_TEMP);
+	if (!buf.verts || !buf.oldVertToFinal || !buf.polys || !buf.areas || !buf.flags)
+		return false;
+	memcpy(buf.verts, params.verts, sizeof(unsigned short)*params.vertCount*3);
+	memset(buf.oldVertToFinal, 0xff, sizeof(unsigned short)*noldVerts);
+	memset(buf.polys, 0xff, sizeof(unsigned short)*nfinal*nvp*2);
+	
+	int nverts = params.vertCount;
+	for (int i = 0; i < nold; ++i)
+	{
+		if (buf.matched[i])
+			continue;
+		const dtPoly* p = &oldTile->polys[i];
+		unsigned short* dst = &buf.polys[i*nvp*2];
+		for (int j = 0; j < p->vertCount; ++j)
+		{
+			const unsigned short v = p->verts[j];
+			if (buf.oldVertToFinal[v] == 0xffff)
+			{
+				memcpy(&buf.verts[nverts*3], &buf.oldVerts[v*3], sizeof(unsigned short)*3);
+				buf.oldVertToFinal[v] = (unsigned short)nverts++;
+			}
+			dst[j] = buf.oldVertToFinal[v];
+		}
+		buf.areas[i] = p->getArea();
+		buf.flags[i] = 0;
+	}
+	for (int i = 0; i < nnew; ++i)
+	{
+		const unsigned short* src = &params.polys[i*nvp*2];
+		const int f = buf.newToFinal[i];
+		unsigned short* dst = &buf.polys[f*nvp*2];
+		for (int j = 0; j < nvp; ++j)
+		{
+			dst[j] = src[j];
+			const unsigned short nei = src[nvp+j];
+			// Keep the borders and portals.
+			dst[nvp+j] = (nei & 0x8000) ? nei : buf.newToFinal[nei];
+		}
+		buf.areas[f] = params.polyAreas[i];
+		buf.flags[f] = params.polyFlags[i];
+	}
+	
+	dtNavMeshCreateParams spliced = params;
+	spliced.verts = buf.verts;
+	spliced.vertCount = nverts;
+	spliced.polys = buf.polys;
+	spliced.polyAreas = buf.areas;
+	spliced.polyFlags = buf.flags;
+	spliced.polyCount = nfinal;
+	return dtCreateNavMeshData(&spliced, outData, outDataSize, pool);
+}
+
 dtTileCache::dtTileCache() :
 	m_tileLutSize(0),
 	m_tileLutMask(0),
 	m_posLookup(0),
 	m_nextFreeTile(0),	
 	m_tiles(0),	
+	m_buildStates(0),
 	m_saltBits(0),
 	m_tileBits(0),
 	m_talloc(0),
 	m_tcomp(0),
 	m_tmproc(0),
+	m_dataPool(0),
+	m_polyRefRemap(0),
 	m_obstacles(0),
 	m_nextFreeObstacle(0),
 	m_nreqs(0),
@@ -89,7 +345,11 @@ dtTileCache::~dtTileCache()
 			dtFree(m_tiles[i].data);
 			m_tiles[i].data = 0;
 		}
+		if (m_buildStates)
+			resetTileBuildState(m_buildStates[i]);
 	}
+	dtFree(m_buildStates);
+	m_buildStates = 0;
 	dtFree(m_obstacles);
 	m_obstacles = 0;
 	dtFree(m_posLookup);
@@ -150,7 +410,11 @@ dtStatus dtTileCache::init(const dtTileCacheParams* params,
 	m_posLookup = (dtCompressedTile**)dtAlloc(sizeof(dtCompressedTile*)*m_tileLutSize, DT_ALLOC_PERM);
 	if (!m_posLookup)
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	m_buildStates = (TileBuildState*)dtAlloc(sizeof(TileBuildState)*m_params.maxTiles, DT_ALLOC_PERM);
+	if (!m_buildStates)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(m_tiles, 0, sizeof(dtCompressedTile)*m_params.maxTiles);
+	memset(m_buildStates, 0, sizeof(TileBuildState)*m_params.maxTiles);
 	memset(m_posLookup, 0, sizeof(dtCompressedTile*)*m_tileLutSize);
 	m_nextFreeTile = 0;
 	for (int i = m_params.maxTiles-1; i >= 0; --i)
@@ -342,6 +606,7 @@ dtStatus dtTileCache::removeTile(dtCompressedTileRef ref, unsigned char** data,
 	tile->compressed = 0;
 	tile->compressedSize = 0;
 	tile->flags = 0;
+	resetTileBuildState(m_buildStates[tileIndex]);
 	
 	// Update salt, salt should never be zero.
 	tile->salt = (tile->salt+1) & ((1<<m_saltBits)-1);
@@ -586,7 +851,7 @@ dtStatus dtTileCache::update(const float /*dt*/, dtNavMesh* navmesh,
 	{
 		// Build mesh
 		const dtCompressedTileRef ref = m_update[0];
-		status = buildNavMeshTile(ref, navmesh);
+		status = buildNavMeshTile(ref, navmesh, true);
 		m_nupdate--;
 		if (m_nupdate > 0)
 			memmove(m_update, m_update+1, m_nupdate*sizeof(dtCompressedTileRef));
@@ -655,6 +920,11 @@ dtStatus dtTileCache::buildNavMeshTilesAt(const int tx, const int ty, dtNavMesh*
 }
 
 dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh* navmesh)
+{
+	return buildNavMeshTile(ref, navmesh, false);
+}
+
+dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh* navmesh, const bool skipUnchanged)
 {	
 	dtAssert(m_talloc);
 	dtAssert(m_tcomp);
@@ -666,6 +936,7 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	unsigned int salt = decodeTileIdSalt(ref);
 	if (tile->salt != salt)
 		return DT_FAILURE | DT_INVALID_PARAM;
+	TileBuildState& buildState = m_buildStates[idx];
 	
 	m_talloc->reset();
 	
@@ -704,8 +975,31 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 		}
 	}
 	
+	// When the navmesh tile was built by the previous build of the layer, only the cells changed since
+	// are processed again, and the polygons which did not change keep their refs.
+	const bool incremental = skipUnchanged && isNavMeshTileBuilt(buildState, tile->header, navmesh);
+	int changedMin[2], changedMax[2];
+	if (incremental && !getChangedCells(buildState, *bc.layer, changedMin, changedMax))
+	{
+		// An obstacle change often leaves the walkable cells of a layer as they were, for example
+		// when the obstacle is above the layer or on cells which were not walkable anyway.
+		// The navmesh tile would then be the same, and is not rebuilt.
+		return DT_SUCCESS;
+	}
+	// Invalid until the new tile is in the navmesh.
+	buildState.navmesh = 0;
+	
 	// Build navmesh
-	status = dtBuildTileCacheRegions(m_talloc, *bc.layer, walkableClimbVx);
+	status = DT_FAILURE;
+	if (incremental && buildState.regsSize == (int)bc.layer->header->width*(int)bc.layer->header->height)
+	{
+		// The regions next to the changed cells are partitioned again too, so that the regions
+		// around a removed obstacle merge with the cells it covered.
+		status = dtBuildTileCacheRegionsPartial(m_talloc, *bc.layer, walkableClimbVx, buildState.regs,
+												changedMin[0]-1, changedMin[1]-1, changedMax[0]+1, changedMax[1]+1);
+	}
+	if (dtStatusFailed(status))
+		status = dtBuildTileCacheRegions(m_talloc, *bc.layer, walkableClimbVx);
 	if (dtStatusFailed(status))
 		return status;
 	
@@ -728,7 +1022,11 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 	if (!bc.lmesh->npolys)
 	{
 		// Remove existing tile.
-		navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
+		const dtTileRef oldRef = navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer);
+		beginNavMeshTileRebuild(m_polyRefRemap, navmesh, oldRef);
+		navmesh->removeTile(oldRef,0,0);
+		endNavMeshTileRebuild(m_polyRefRemap, navmesh, 0);
+		setTileBuildState(buildState, *bc.layer, navmesh);
 		return DT_SUCCESS;
 	}
 	
@@ -758,29 +1056,164 @@ dtStatus dtTileCache::buildNavMeshTile(const dtCompressedTileRef ref, dtNavMesh*
 		m_tmproc->process(&params, bc.lmesh->areas, bc.lmesh->flags);
 	}
 	
+	const int flags = DT_TILE_FREE_DATA | (m_dataPool ? DT_TILE_POOLED_DATA : 0);
 	unsigned char* navData = 0;
 	int navDataSize = 0;
-	if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+	
+	// Splice the new polygons into the current tile, and keep its ref.
+	if (incremental)
+	{
+		const dtTileRef oldRef = navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer);
+		const dtMeshTile* oldTile = navmesh->getTileByRef(oldRef);
+		if (oldTile && createSplicedNavMeshData(oldTile, params, navmesh->getParams()->maxPolys,
+												&navData, &navDataSize, m_dataPool))
+		{
+			beginNavMeshTileRebuild(m_polyRefRemap, navmesh, oldRef);
+			navmesh->removeTile(oldRef,0,0);
+			status = navmesh->addTile(navData,navDataSize,flags,oldRef,0);
+			if (dtStatusFailed(status))
+			{
+				endNavMeshTileRebuild(m_polyRefRemap, navmesh, 0);
+				if (m_dataPool)
+					dtTileDataPool::release(navData);
+				else
+					dtFree(navData);
+				return status;
+			}
+			endNavMeshTileRebuild(m_polyRefRemap, navmesh, oldRef);
+			setTileBuildState(buildState, *bc.layer, navmesh);
+			return DT_SUCCESS;
+		}
+	}
+	
+	if (!dtCreateNavMeshData(&params, &navData, &navDataSize, m_dataPool))
 		return DT_FAILURE;
 
 	// Remove existing tile.
-	navmesh->removeTile(navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer),0,0);
+	const dtTileRef oldRef = navmesh->getTileRefAt(tile->header->tx,tile->header->ty,tile->header->tlayer);
+	beginNavMeshTileRebuild(m_polyRefRemap, navmesh, oldRef);
+	navmesh->removeTile(oldRef,0,0);
 
 	// Add new tile, or leave the location empty.
+	dtTileRef newRef = 0;
 	if (navData)
 	{
 		// Let the navmesh own the data.
-		status = navmesh->addTile(navData,navDataSize,DT_TILE_FREE_DATA,0,0);
+		status = navmesh->addTile(navData,navDataSize,flags,0,&newRef);
 		if (dtStatusFailed(status))
 		{
-			dtFree(navData);
+			endNavMeshTileRebuild(m_polyRefRemap, navmesh, 0);
+			if (m_dataPool)
+				dtTileDataPool::release(navData);
+			else
+				dtFree(navData);
 			return status;
 		}
 	}
+	endNavMeshTileRebuild(m_polyRefRemap, navmesh, newRef);
+	setTileBuildState(buildState, *bc.layer, navmesh);
 	
 	return DT_SUCCESS;
 }
 
+bool dtTileCache::isNavMeshTileBuilt(const TileBuildState& state, const dtTileCacheLayerHeader* header,
+									const dtNavMesh* navmesh) const
+{
+	if (state.navmesh != navmesh || !state.nullCells)
+		return false;
+	
+	// The tile must not have been removed or replaced since it was built, even at the same reference.
+	const dtMeshTile* navTile = navmesh->getTileAt(header->tx, header->ty, header->tlayer);
+	return navTile == state.navTile && (!navTile || navTile->changeCount == state.navTileChangeCount);
+}
+
+bool dtTileCache::getChangedCells(const TileBuildState& state, const dtTileCacheLayer& layer,
+								  int* changedMin, int* changedMax) const
+{
+	// The obstacles only clear cells, so the areas are the same if the same cells are not walkable.
+	const int w = (int)layer.header->width;
+	const int h = (int)layer.header->height;
+	if (state.nullCellsSize != (w*h+7)/8)
+	{
+		changedMin[0] = changedMin[1] = 0;
+		changedMax[0] = w-1;
+		changedMax[1] = h-1;
+		return true;
+	}
+	
+	changedMin[0] = w;
+	changedMin[1] = h;
+	changedMax[0] = -1;
+	changedMax[1] = -1;
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const int i = x + y*w;
+			const bool wasNull = (state.nullCells[i/8] & (1 << (i&7))) != 0;
+			if (wasNull == (layer.areas[i] == DT_TILECACHE_NULL_AREA))
+				continue;
+			changedMin[0] = dtMin(changedMin[0], x);
+			changedMin[1] = dtMin(changedMin[1], y);
+			changedMax[0] = dtMax(changedMax[0], x);
+			changedMax[1] = dtMax(changedMax[1], y);
+		}
+	}
+	return changedMax[0] >= 0;
+}
+
+void dtTileCache::setTileBuildState(TileBuildState& state, const dtTileCacheLayer& layer, const dtNavMesh* navmesh)
+{
+	const dtTileCacheLayerHeader* header = layer.header;
+	const int ncells = (int)header->width * (int)header->height;
+	const int size = (ncells+7)/8;
+	if (state.nullCellsSize != size)
+	{
+		dtFree(state.nullCells);
+		state.nullCells = (unsigned char*)dtAlloc(size, DT_ALLOC_PERM);
+		state.nullCellsSize = state.nullCells ? size : 0;
+	}
+	if (!state.nullCells)
+	{
+		// Without the cells, the next build cannot be skipped.
+		state.navmesh = 0;
+		return;
+	}
+	
+	memset(state.nullCells, 0, size);
+	for (int i = 0; i < ncells; ++i)
+	{
+		if (layer.areas[i] == DT_TILECACHE_NULL_AREA)
+			state.nullCells[i/8] |= (unsigned char)(1 << (i&7));
+	}
+	
+	// The regions are optional, the next build partitions the whole layer without them.
+	if (state.regsSize != ncells)
+	{
+		dtFree(state.regs);
+		state.regs = (unsigned char*)dtAlloc(ncells, DT_ALLOC_PERM);
+		state.regsSize = state.regs ? ncells : 0;
+	}
+	if (state.regs)
+		memcpy(state.regs, layer.regs, ncells);
+	state.navmesh = navmesh;
+	state.navTile = navmesh->getTileAt(header->tx, header->ty, header->tlayer);
+	state.navTileChangeCount = state.navTile ? state.navTile->changeCount : 0;
+}
+
+void dtTileCache::resetTileBuildState(TileBuildState& state)
+{
+	dtFree(state.nullCells);
+	state.nullCells = 0;
+	state.nullCellsSize = 0;
+	dtFree(state.regs);
+	state.regs = 0;
+	state.regsSize = 0;
+	state.navmesh = 0;
+	state.navTile = 0;
+	state.navTileChangeCount = 0;
+}
+
 void dtTileCache::calcTightTileBounds(const dtTileCacheLayerHeader* header, float* bmin, float* bmax) const
 {
 	const float cs = m_params.cs;
@@ -33,6 +33,110 @@ dtTileCacheCompressor::~dtTileCacheCompressor()
 	// Defined out of line to fix the weak v-tables warning
 }
 
+static const size_t DT_TILECACHE_ARENA_ALIGN = 16;
+
+inline size_t alignArenaSize(size_t size)
+{
+	return (size + DT_TILECACHE_ARENA_ALIGN-1) & ~(DT_TILECACHE_ARENA_ALIGN-1);
+}
+
+dtTileCacheArena::dtTileCacheArena(size_t blockSize) :
+	m_blocks(0),
+	m_top(0),
+	m_end(0),
+	m_last(0),
+	m_blockSize(alignArenaSize(blockSize)),
+	m_used(0),
+	m_peak(0),
+	m_capacity(0),
+	m_blockCount(0)
+{
+}
+
+dtTileCacheArena::~dtTileCacheArena()
+{
+	freeBlocks();
+}
+
+bool dtTileCacheArena::addBlock(size_t size)
+{
+	const size_t headerSize = alignArenaSize(sizeof(Block));
+	Block* block = (Block*)dtAlloc(headerSize + size + DT_TILECACHE_ARENA_ALIGN, DT_ALLOC_PERM);
+	if (!block)
+		return false;
+	block->next = m_blocks;
+	block->size = size;
+	m_blocks = block;
+	m_blockCount++;
+	m_capacity += size;
+
+	// The allocator may only align to 8 bytes.
+	m_top = (unsigned char*)alignArenaSize((size_t)((unsigned char*)block + headerSize));
+	m_end = m_top + size;
+	return true;
+}
+
+void dtTileCacheArena::freeBlocks()
+{
+	while (m_blocks)
+	{
+		Block* next = m_blocks->next;
+		dtFree(m_blocks);
+		m_blocks = next;
+	}
+	m_top = 0;
+	m_end = 0;
+	m_last = 0;
+	m_capacity = 0;
+	m_blockCount = 0;
+}
+
+void dtTileCacheArena::reset()
+{
+	if (m_blockCount > 1)
+	{
+		// Merge the blocks so that the same allocations fit in one block next time.
+		const size_t size = m_capacity;
+		freeBlocks();
+		addBlock(size);
+	}
+	else if (m_blocks)
+	{
+		const size_t headerSize = alignArenaSize(sizeof(Block));
+		m_top = (unsigned char*)alignArenaSize((size_t)((unsigned char*)m_blocks + headerSize));
+		m_end = m_top + m_blocks->size;
+	}
+	m_last = 0;
+	m_used = 0;
+}
+
+void* dtTileCacheArena::alloc(const size_t size)
+{
+	const size_t alignedSize = alignArenaSize(size);
+	if (!m_top || alignedSize > (size_t)(m_end - m_top))
+	{
+		if (!addBlock(alignedSize > m_blockSize ? alignedSize : m_blockSize))
+			return 0;
+	}
+	void* ptr = m_top;
+	m_top += alignedSize;
+	m_last = ptr;
+	m_used += alignedSize;
+	if (m_used > m_peak)
+		m_peak = m_used;
+	return ptr;
+}
+
+void dtTileCacheArena::free(void* ptr)
+{
+	if (ptr && ptr == m_last)
+	{
+		m_used -= (size_t)(m_top - (unsigned char*)ptr);
+		m_top = (unsigned char*)ptr;
+		m_last = 0;
+	}
+}
+
 template<class T> class dtFixedArray
 {
 	dtTileCacheAlloc* m_alloc;
@@ -200,6 +304,13 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	memset(sweeps,0,sizeof(dtLayerSweepSpan)*nsweeps);
 	
+	// The region ids are bytes, so the regions are allocated up front and their areas and
+	// neighbours are found during the sweep, as soon as the ids of a row are final.
+	dtFixedArray<dtLayerMonotoneRegion> regs(alloc, 255);
+	if (!regs)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	memset(regs, 0, sizeof(dtLayerMonotoneRegion)*255);
+	
 	// Partition walkable area into monotone regions.
 	unsigned char prevCount[256];
 	unsigned char regId = 0;
@@ -281,40 +392,18 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 			}
 		}
 		
-		// Remap local sweep ids to region ids.
+		// Remap local sweep ids to region ids, and update the areas and neighbours of the regions.
 		for (int x = 0; x < w; ++x)
 		{
 			const int idx = x+y*w;
-			if (layer.regs[idx] != 0xff)
-				layer.regs[idx] = sweeps[layer.regs[idx]].id;
-		}
-	}
-	
-	// Allocate and init layer regions.
-	const int nregs = (int)regId;
-	dtFixedArray<dtLayerMonotoneRegion> regs(alloc, nregs);
-	if (!regs)
-		return DT_FAILURE | DT_OUT_OF_MEMORY;
-
-	memset(regs, 0, sizeof(dtLayerMonotoneRegion)*nregs);
-	for (int i = 0; i < nregs; ++i)
-		regs[i].regId = 0xff;
-	
-	// Find region neighbours.
-	for (int y = 0; y < h; ++y)
-	{
-		for (int x = 0; x < w; ++x)
-		{
-			const int idx = x+y*w;
-			const unsigned char ri = layer.regs[idx];
-			if (ri == 0xff)
+			if (layer.regs[idx] == 0xff)
 				continue;
+			const unsigned char ri = sweeps[layer.regs[idx]].id;
+			layer.regs[idx] = ri;
 			
-			// Update area.
 			regs[ri].area++;
 			regs[ri].areaId = layer.areas[idx];
 			
-			// Update neighbours
 			const int ymi = x+(y-1)*w;
 			if (y > 0 && isConnected(layer, idx, ymi, walkableClimb))
 			{
@@ -328,6 +417,7 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		}
 	}
 	
+	const int nregs = (int)regId;
 	for (int i = 0; i < nregs; ++i)
 		regs[i].regId = (unsigned char)i;
 	
@@ -375,11 +465,20 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 		if (remap[i])
 			remap[i] = regId++;
 	// Remap ids.
+	bool merged = false;
 	for (int i = 0; i < nregs; ++i)
+	{
 		regs[i].regId = remap[regs[i].regId];
+		if (regs[i].regId != i)
+			merged = true;
+	}
 	
 	layer.regCount = regId;
 	
+	// The cells already have their final ids if no region was merged.
+	if (!merged)
+		return DT_SUCCESS;
+	
 	for (int i = 0; i < w*h; ++i)
 	{
 		if (layer.regs[i] != 0xff)
@@ -391,6 +490,86 @@ dtStatus dtBuildTileCacheRegions(dtTileCacheAlloc* alloc,
 
 
 
+dtStatus dtBuildTileCacheRegionsPartial(dtTileCacheAlloc* alloc,
+										dtTileCacheLayer& layer,
+										const int walkableClimb,
+										const unsigned char* prevRegs,
+										const int minx, const int miny, const int maxx, const int maxy)
+{
+	dtAssert(alloc);
+	
+	const int w = (int)layer.header->width;
+	const int h = (int)layer.header->height;
+	const int ncells = w*h;
+	
+	// Find the previous regions which overlap the rectangle, or whose cells are not walkable anymore.
+	bool affected[256];
+	memset(affected, 0, sizeof(affected));
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			const int idx = x+y*w;
+			const unsigned char pr = prevRegs[idx];
+			if (pr == 0xff)
+				continue;
+			const bool inside = x >= minx && x <= maxx && y >= miny && y <= maxy;
+			if (inside || layer.areas[idx] == DT_TILECACHE_NULL_AREA)
+				affected[pr] = true;
+		}
+	}
+	
+	// Partition the walkable cells of the affected regions, and the new walkable cells, as a layer of their own.
+	dtFixedArray<unsigned char> areas(alloc, ncells);
+	if (!areas)
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
+	for (int i = 0; i < ncells; ++i)
+	{
+		const unsigned char pr = prevRegs[i];
+		areas[i] = (pr == 0xff || affected[pr]) ? layer.areas[i] : DT_TILECACHE_NULL_AREA;
+	}
+	
+	dtTileCacheLayer partial = layer;
+	partial.areas = areas;
+	dtStatus status = dtBuildTileCacheRegions(alloc, partial, walkableClimb);
+	if (dtStatusFailed(status))
+		return status;
+	
+	// The kept regions are compacted in the same order, the new regions come after them.
+	// The regions of the partition share the regs of the layer.
+	bool used[256];
+	memset(used, 0, sizeof(used));
+	for (int i = 0; i < ncells; ++i)
+	{
+		if (prevRegs[i] != 0xff && !affected[prevRegs[i]])
+			used[prevRegs[i]] = true;
+	}
+	unsigned char remap[256];
+	int nkept = 0;
+	for (int i = 0; i < 255; ++i)
+	{
+		remap[i] = 0xff;
+		if (used[i])
+			remap[i] = (unsigned char)nkept++;
+	}
+	if (nkept + (int)partial.regCount > 255)
+		return DT_FAILURE | DT_BUFFER_TOO_SMALL;
+	
+	for (int i = 0; i < ncells; ++i)
+	{
+		const unsigned char pr = prevRegs[i];
+		if (partial.regs[i] != 0xff)
+			layer.regs[i] = (unsigned char)(nkept + partial.regs[i]);
+		else if (pr != 0xff && !affected[pr])
+			layer.regs[i] = remap[pr];
+		else
+			layer.regs[i] = 0xff;
+	}
+	layer.regCount = (unsigned char)(nkept + partial.regCount);
+	
+	return DT_SUCCESS;
+}
+
 static bool appendVertex(dtTempContour& cont, const int x, const int y, const int z, const int r)
 {
 	// Try to merge with existing segments.
@@ -66,7 +66,7 @@ enum rcTimerLabel
 	RC_TIMER_MERGE_POLYMESH,
 	/// The time to erode the walkable area. (See: #rcErodeWalkableArea)
 	RC_TIMER_ERODE_AREA,
-	/// The time to mark a box area. (See: #rcMarkBoxArea)
+	/// The time to mark a box area. (See: #rcMarkBoxArea, #rcMarkBoxAreas)
 	RC_TIMER_MARK_BOX_AREA,
 	/// The time to mark a cylinder area. (See: #rcMarkCylinderArea)
 	RC_TIMER_MARK_CYLINDER_AREA,
@@ -500,6 +500,124 @@ private:
 	rcPolyMeshDetail& operator=(const rcPolyMeshDetail&);
 };
 
+/// A span rasterized from a triangle of a triangle set of an editable heightfield.
+/// @see rcEditableHeightfield
+struct rcEditSpan
+{
+	unsigned short x, z;		///< The column of the span. (In cell units.)
+	unsigned short smin;		///< The lower limit of the span. [Limit: < #smax]
+	unsigned short smax;		///< The upper limit of the span. [Limit: <= #RC_SPAN_MAX_HEIGHT]
+	unsigned char area;			///< The area id assigned to the span.
+};
+
+/// The spans of a triangle set added to an editable heightfield.
+/// @see rcEditableHeightfield
+struct rcEditMesh
+{
+	unsigned int id;			///< The user id of the triangle set.
+	int bounds[4];				///< The columns covered by the spans. [(minx, minz, maxx, maxz)]
+	rcEditSpan* spans;			///< The unmerged spans of each triangle, in the order of the triangles. [Size: #nspans]
+	int nspans;					///< The number of spans.
+};
+
+/// A heightfield made of static geometry and of triangle sets which can be added and removed
+/// without rasterizing the rest of the geometry again.
+///
+/// The static geometry is rasterized into #base once. The spans of each triangle of a triangle set
+/// are kept, so that after an edit only the columns covered by the added or removed triangles are
+/// composed again into #solid, from #base and the spans of the remaining sets.
+/// #solid is the heightfield built by rasterizing the static geometry, then the triangle sets in
+/// the order they were added. The spans of the triangles are merged again in that order, since the
+/// area of merged spans depends on it: with a flag merge threshold of 1, a walkable span [0,10]
+/// keeps its area when spans [0,11] and then [0,12] are merged over it, but not when they are
+/// merged with each other first.
+///
+/// The filters modify the heightfield they run on: copy #solid with #rcCopyHeightfield before
+/// running the rest of the build.
+/// @ingroup recast
+/// @see rcCreateEditableHeightfield, rcAddEditMesh, rcRemoveEditMesh, rcUpdateEditableHeightfield
+struct rcEditableHeightfield
+{
+	rcEditableHeightfield();
+	~rcEditableHeightfield();
+
+	rcHeightfield base;			///< The static geometry. (See: #rcMarkEditableHeightfieldDirty)
+	rcHeightfield solid;		///< The composed heightfield. Updated by #rcUpdateEditableHeightfield.
+	rcHeightfield scratch;		///< Used to rasterize the triangle sets.
+	rcEditMesh** meshes;		///< The triangle sets, in the order they were added. [Size: #nmeshes]
+	int nmeshes;				///< The number of triangle sets.
+	int maxMeshes;				///< The capacity of #meshes.
+	unsigned char* dirty;		///< Non-zero for the columns to compose again. [Size: width*height]
+	int dirtyBounds[4];			///< The bounds of the dirty columns, empty if min > max. [(minx, minz, maxx, maxz)]
+	int flagMergeThreshold;		///< The flag merge threshold used to rasterize and compose the spans.
+
+private:
+	// Explicitly-disabled copy constructor and copy assignment operator.
+	rcEditableHeightfield(const rcEditableHeightfield&);
+	rcEditableHeightfield& operator=(const rcEditableHeightfield&);
+};
+
+/// A heightfield stored in contiguous arrays, to keep it around with less memory than #rcHeightfield.
+///
+/// The spans are packed in 32 bits, see #rcPackSpan, and stored column by column in the order of
+/// the columns of #rcHeightfield. The spans of column (x, z) are
+/// <tt>spans[columns[x + z*width]]</tt> up to <tt>spans[columns[x + z*width + 1]]</tt>, excluded.
+///
+/// The arrays can be further compressed with #rcCompressPackedHeightfield while the heightfield is
+/// not in use. #columns and #spans are then null, and the data is in #compressed.
+/// @ingroup recast
+/// @see rcPackHeightfield, rcUnpackHeightfield, rcBuildCompactHeightfield
+struct rcPackedHeightfield
+{
+	rcPackedHeightfield();
+	~rcPackedHeightfield();
+
+	int width;					///< The width of the heightfield. (Along the x-axis in cell units.)
+	int height;					///< The height of the heightfield. (Along the z-axis in cell units.)
+	float bmin[3];				///< The minimum bounds in world space. [(x, y, z)]
+	float bmax[3];				///< The maximum bounds in world space. [(x, y, z)]
+	float cs;					///< The size of each cell. (On the xz-plane.)
+	float ch;					///< The height of each cell. (The minimum increment along the y-axis.)
+	int spanCount;				///< The number of spans.
+	unsigned int* columns;		///< The index of the first span of each column in #spans. [Size: width*height + 1]
+	unsigned int* spans;		///< The packed spans. [Size: #spanCount]
+	unsigned char* compressed;	///< The compressed columns and spans, or null. [Size: #compressedSize]
+	int compressedSize;			///< The size of #compressed. [Units: bytes]
+
+private:
+	// Explicitly-disabled copy constructor and copy assignment operator.
+	rcPackedHeightfield(const rcPackedHeightfield&);
+	rcPackedHeightfield& operator=(const rcPackedHeightfield&);
+};
+
+/// Packs a span of a #rcPackedHeightfield.
+///  @param[in]		smin	The lower limit of the span. [Limit: <= #RC_SPAN_MAX_HEIGHT]
+///  @param[in]		smax	The upper limit of the span. [Limit: <= #RC_SPAN_MAX_HEIGHT]
+///  @param[in]		area	The area id of the span. [Limit: <= #RC_WALKABLE_AREA]
+/// @return The packed span.
+inline unsigned int rcPackSpan(const unsigned int smin, const unsigned int smax, const unsigned int area)
+{
+	return smin | (smax << RC_SPAN_HEIGHT_BITS) | (area << (RC_SPAN_HEIGHT_BITS * 2));
+}
+
+/// The lower limit of a packed span.
+inline unsigned int rcGetPackedSpanMin(const unsigned int span)
+{
+	return span & RC_SPAN_MAX_HEIGHT;
+}
+
+/// The upper limit of a packed span.
+inline unsigned int rcGetPackedSpanMax(const unsigned int span)
+{
+	return (span >> RC_SPAN_HEIGHT_BITS) & RC_SPAN_MAX_HEIGHT;
+}
+
+/// The area id of a packed span.
+inline unsigned int rcGetPackedSpanArea(const unsigned int span)
+{
+	return span >> (RC_SPAN_HEIGHT_BITS * 2);
+}
+
 /// @name Allocation Functions
 /// Functions used to allocate and de-allocate Recast objects.
 /// @see rcAllocSetCustom
@@ -577,6 +695,30 @@ rcPolyMeshDetail* rcAllocPolyMeshDetail();
 /// @see rcAllocPolyMeshDetail
 void rcFreePolyMeshDetail(rcPolyMeshDetail* detailMesh);
 
+/// Allocates an editable heightfield object using the Recast allocator.
+/// @return An editable heightfield that is ready for initialization, or null on failure.
+/// @ingroup recast
+/// @see rcCreateEditableHeightfield, rcFreeEditableHeightfield
+rcEditableHeightfield* rcAllocEditableHeightfield();
+
+/// Frees the specified editable heightfield object using the Recast allocator.
+/// @param[in]		editableHeightfield		An editable heightfield allocated using #rcAllocEditableHeightfield
+/// @ingroup recast
+/// @see rcAllocEditableHeightfield
+void rcFreeEditableHeightfield(rcEditableHeightfield* editableHeightfield);
+
+/// Allocates a packed heightfield object using the Recast allocator.
+/// @return A packed heightfield that is ready for initialization, or null on failure.
+/// @ingroup recast
+/// @see rcPackHeightfield, rcFreePackedHeightfield
+rcPackedHeightfield* rcAllocPackedHeightfield();
+
+/// Frees the specified packed heightfield object using the Recast allocator.
+/// @param[in]		packedHeightfield		A packed heightfield allocated using #rcAllocPackedHeightfield
+/// @ingroup recast
+/// @see rcAllocPackedHeightfield
+void rcFreePackedHeightfield(rcPackedHeightfield* packedHeightfield);
+
 /// @}
 
 /// Heightfield border flag.
@@ -1061,6 +1203,135 @@ void rcFilterWalkableLowHeightSpans(rcContext* context, int walkableHeight, rcHe
 ///  @returns The number of spans in the heightfield.
 int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfield);
 
+/// Copies the spans of a heightfield into another one.
+///
+/// The destination is initialized with the size and bounds of the source. Its span pools are kept
+/// and reused if it already has the same size.
+///
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in]		source		The heightfield to copy.
+/// @param[in,out]	dest		The heightfield to copy to. Uninitialized or initialized.
+/// @returns True if the operation completed successfully.
+bool rcCopyHeightfield(rcContext* context, const rcHeightfield& source, rcHeightfield& dest);
+
+/// Initializes an editable heightfield, without static geometry or triangle sets.
+///
+/// Rasterize the static geometry into rcEditableHeightfield::base next. All the columns are
+/// composed on the first call to #rcUpdateEditableHeightfield.
+///
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[out]		heightfield			The editable heightfield to initialize.
+/// @param[in]		sizeX				The width of the field along the x-axis. [Limit: >= 0] [Units: vx]
+/// @param[in]		sizeZ				The height of the field along the z-axis. [Limit: >= 0] [Units: vx]
+/// @param[in]		minBounds			The minimum bounds of the field's AABB. [(x, y, z)] [Units: wu]
+/// @param[in]		maxBounds			The maximum bounds of the field's AABB. [(x, y, z)] [Units: wu]
+/// @param[in]		cellSize			The xz-plane cell size to use for the field. [Limit: > 0] [Units: wu]
+/// @param[in]		cellHeight			The y-axis cell size to use for field. [Limit: > 0] [Units: wu]
+/// @param[in]		flagMergeThreshold	The distance where the walkable flag is favored over the non-walkable flag.
+///										[Limit: >= 0] [Units: vx]
+/// @returns True if the operation completed successfully.
+bool rcCreateEditableHeightfield(rcContext* context, rcEditableHeightfield& heightfield, int sizeX, int sizeZ,
+                                 const float* minBounds, const float* maxBounds,
+                                 float cellSize, float cellHeight, int flagMergeThreshold = 1);
+
+/// Marks columns of an editable heightfield to be composed again, after its static geometry changed.
+///
+/// @ingroup recast
+/// @param[in,out]	heightfield		The editable heightfield.
+/// @param[in]		minX, minZ		The minimum column to mark, clamped to the heightfield. [Units: vx]
+/// @param[in]		maxX, maxZ		The maximum column to mark, clamped to the heightfield. [Units: vx]
+void rcMarkEditableHeightfieldDirty(rcEditableHeightfield& heightfield, int minX, int minZ, int maxX, int maxZ);
+
+/// Rasterizes a triangle set and adds it to an editable heightfield.
+///
+/// The triangles are rasterized one by one and their spans are kept unmerged, which takes more
+/// memory than the merged spans. The columns covered by the triangles are marked to be composed again.
+///
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in,out]	heightfield		An initialized editable heightfield.
+/// @param[in]		id				The user id of the triangle set. Must not be in use.
+/// @param[in]		verts			The vertices. [(x, y, z) * @p numVerts]
+/// @param[in]		numVerts		The number of vertices.
+/// @param[in]		tris			The triangle indices. [(vertA, vertB, vertC) * @p numTris]
+/// @param[in]		triAreaIDs		The area id's of the triangles. [Limit: <= #RC_WALKABLE_AREA] [Size: @p numTris]
+/// @param[in]		numTris			The number of triangles.
+/// @returns True if the operation completed successfully.
+bool rcAddEditMesh(rcContext* context, rcEditableHeightfield& heightfield, unsigned int id,
+                   const float* verts, int numVerts,
+                   const int* tris, const unsigned char* triAreaIDs, int numTris);
+
+/// Removes a triangle set from an editable heightfield.
+///
+/// The columns covered by the triangles are marked to be composed again.
+///
+/// @ingroup recast
+/// @param[in,out]	heightfield		An initialized editable heightfield.
+/// @param[in]		id				The user id of the triangle set.
+/// @returns True if the triangle set was found and removed.
+bool rcRemoveEditMesh(rcEditableHeightfield& heightfield, unsigned int id);
+
+/// Composes the dirty columns of an editable heightfield again into rcEditableHeightfield::solid.
+///
+/// The spans of the static geometry are added first, then the spans of the triangles in the order
+/// the triangle sets were added and the triangles were rasterized.
+///
+/// @ingroup recast
+/// @param[in,out]	context			The build context to use during the operation.
+/// @param[in,out]	heightfield		An initialized editable heightfield.
+/// @param[out]		dirtyBounds		The columns which were composed, empty if min > max. [opt] [(minx, minz, maxx, maxz)]
+/// @returns True if the operation completed successfully.
+bool rcUpdateEditableHeightfield(rcContext* context, rcEditableHeightfield& heightfield, int* dirtyBounds = 0);
+
+/// Stores a heightfield into a packed heightfield.
+///
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in]		heightfield	The heightfield to pack.
+/// @param[out]		packed		The packed heightfield. Uninitialized or initialized, its arrays are replaced.
+/// @returns True if the operation completed successfully.
+bool rcPackHeightfield(rcContext* context, const rcHeightfield& heightfield, rcPackedHeightfield& packed);
+
+/// Builds a heightfield from a packed heightfield.
+///
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in]		packed		The packed heightfield. [Limit: Not compressed]
+/// @param[out]		heightfield	The heightfield. Uninitialized or initialized, its spans are replaced and
+///								its span pools are reused.
+/// @returns True if the operation completed successfully.
+bool rcUnpackHeightfield(rcContext* context, const rcPackedHeightfield& packed, rcHeightfield& heightfield);
+
+/// Compresses the columns and spans of a packed heightfield in place.
+///
+/// Uses a byte oriented LZ77 coder after storing each span relative to the previous one, which is
+/// fast enough to compress the heightfields of a tile cache as the tiles are built. Does nothing
+/// if the heightfield is already compressed.
+///
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in,out]	packed		The packed heightfield.
+/// @returns True if the operation completed successfully.
+bool rcCompressPackedHeightfield(rcContext* context, rcPackedHeightfield& packed);
+
+/// Decompresses the columns and spans of a packed heightfield in place.
+///
+/// Does nothing if the heightfield is not compressed.
+///
+/// @ingroup recast
+/// @param[in,out]	context		The build context to use during the operation.
+/// @param[in,out]	packed		The packed heightfield.
+/// @returns True if the operation completed successfully.
+bool rcDecompressPackedHeightfield(rcContext* context, rcPackedHeightfield& packed);
+
+/// Returns the memory used by a packed heightfield, excluding the struct itself.
+/// @ingroup recast
+/// @param[in]		packed		The packed heightfield.
+/// @returns The size of the arrays, or of the compressed data. [Units: bytes]
+int rcGetPackedHeightfieldMemory(const rcPackedHeightfield& packed);
+
 /// @}
 /// @name Compact Heightfield Functions
 /// @see rcCompactHeightfield
@@ -1088,6 +1359,22 @@ int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfie
 bool rcBuildCompactHeightfield(rcContext* context, int walkableHeight, int walkableClimb,
 							   const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield);
 
+/// Builds a compact heightfield from a packed heightfield.
+///
+/// The result is the same as building the compact heightfield from the heightfield which was packed.
+///
+/// @ingroup recast
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		walkableHeight		Minimum floor to 'ceiling' height that will still allow the floor area 
+/// 									to be considered walkable. [Limit: >= 3] [Units: vx]
+/// @param[in]		walkableClimb		Maximum ledge height that is considered to still be traversable. 
+/// 									[Limit: >=0] [Units: vx]
+/// @param[in]		packed				The packed heightfield. [Limit: Not compressed]
+/// @param[out]		compactHeightfield	The resulting compact heightfield. (Must be pre-allocated.)
+/// @returns True if the operation completed successfully.
+bool rcBuildCompactHeightfield(rcContext* context, int walkableHeight, int walkableClimb,
+							   const rcPackedHeightfield& packed, rcCompactHeightfield& compactHeightfield);
+
 /// Erodes the walkable area within the heightfield by the specified radius.
 /// 
 /// Basically, any spans that are closer to a boundary or obstruction than the specified radius 
@@ -1130,6 +1417,29 @@ bool rcMedianFilterWalkableArea(rcContext* context, rcCompactHeightfield& compac
 void rcMarkBoxArea(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds, unsigned char areaId,
 				   rcCompactHeightfield& compactHeightfield);
 
+/// Applies area ids to all spans within many axis-aligned boxes. (AABB)
+///
+/// A column is within a box when the center of its cell is inside the box on the xz-plane,
+/// with the minimum bounds included and the maximum bounds excluded. This is the same footprint
+/// #rcMarkConvexPolyArea gives to the rectangle of the box, so unit blocks mark exactly the cells they cover.
+/// The spans of the column are then marked as with #rcMarkBoxArea.
+///
+/// The boxes are binned into the columns of the heightfield first, and the columns are marked in
+/// a single pass. Where boxes overlap, the result is the same as marking the boxes one after another.
+///
+/// @see rcCompactHeightfield, rcMedianFilterWalkableArea
+/// @ingroup recast
+///
+/// @param[in,out]	context				The build context to use during the operation.
+/// @param[in]		boxMinBounds		The minimum extents of the boxes. [(x, y, z) * @p boxCount] [Units: wu]
+/// @param[in]		boxMaxBounds		The maximum extents of the boxes. [(x, y, z) * @p boxCount] [Units: wu]
+/// @param[in]		areaIds				The area id to apply for each box. [Size: @p boxCount] [Limit: <= #RC_WALKABLE_AREA]
+/// @param[in]		boxCount			The number of boxes.
+/// @param[in,out]	compactHeightfield	A populated compact heightfield.
+/// @returns True if the operation completed successfully.
+bool rcMarkBoxAreas(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds, const unsigned char* areaIds,
+					int boxCount, rcCompactHeightfield& compactHeightfield);
+
 /// Applies the area id to the all spans within the specified convex polygon. 
 ///
 /// The value of spacial parameters are in world units.
@@ -1305,10 +1615,13 @@ bool rcBuildHeightfieldLayers(rcContext* ctx, const rcCompactHeightfield& chf,
 /// 							[Limit: >=0] [Units: vx]
 /// @param[out]		cset		The resulting contour set. (Must be pre-allocated.)
 /// @param[in]		buildFlags	The build flags. (See: #rcBuildContoursFlags)
+/// @param[in]		threadCount	The number of threads building the contours, including the calling
+/// 							thread. Above 1, @p ctx must be safe to log to from several threads. [Limit: >= 1]
 /// @returns True if the operation completed successfully.
 bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					 float maxError, int maxEdgeLen,
-					 rcContourSet& cset, int buildFlags = RC_CONTOUR_TESS_WALL_EDGES);
+					 rcContourSet& cset, int buildFlags = RC_CONTOUR_TESS_WALL_EDGES,
+					 int threadCount = 1);
 
 /// Builds a polygon mesh from the provided contours.
 /// @ingroup recast
@@ -1338,10 +1651,12 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 /// @param[in]		sampleMaxError	The maximum distance the detail mesh surface should deviate from 
 /// 								heightfield data. [Limit: >=0] [Units: wu]
 /// @param[out]		dmesh			The resulting detail mesh.  (Must be pre-allocated.)
+/// @param[in]		threadCount		The number of threads building the polygons, including the calling
+/// 								thread. Above 1, @p ctx must be safe to log to from several threads. [Limit: >= 1]
 /// @returns True if the operation completed successfully.
 bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
 						   float sampleDist, float sampleMaxError,
-						   rcPolyMeshDetail& dmesh);
+						   rcPolyMeshDetail& dmesh, int threadCount = 1);
 
 /// Copies the poly mesh data from src to dst.
 /// @ingroup recast
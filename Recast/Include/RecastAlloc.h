@@ -52,6 +52,9 @@ typedef void (rcFreeFunc)(void* ptr);
 void rcAllocSetCustom(rcAllocFunc *allocFunc, rcFreeFunc *freeFunc);
 
 /// Allocates a memory block.
+/// Allocates from the arena of the calling thread if there is one. (See: #rcScopedArena)
+/// The block is preceded by a 16 byte header telling where it was allocated, so it must be
+/// freed with #rcFree, and the functions set by #rcAllocSetCustom are asked for 16 more bytes.
 /// 
 /// @param[in]		size	The size, in bytes of memory, to allocate.
 /// @param[in]		hint	A hint to the allocator on how long the memory is expected to be in use.
@@ -70,6 +73,123 @@ void* rcAlloc(size_t size, rcAllocHint hint);
 /// @see rcAlloc, rcAllocSetCustom
 void rcFree(void* ptr);
 
+/// A linear allocator for the data of a build.
+///
+/// Allocations bump a pointer in the current block, and freeing does nothing unless the
+/// pointer is the last allocation. #reset releases everything at once and merges the blocks,
+/// so that the next build of a similar size fits in a single block.
+///
+/// The blocks are allocated with the functions set by #rcAllocSetCustom.
+/// @see rcScopedArena
+class rcArena
+{
+public:
+	///  @param[in]		blockSize	The minimum size of the blocks, in bytes.
+	explicit rcArena(size_t blockSize = 1 << 20);
+	~rcArena();
+
+	/// Allocates a memory block aligned to 16 bytes.
+	///  @param[in]		size	The size, in bytes of memory, to allocate.
+	/// @return A pointer to the beginning of the memory block, or null if a new block could not be allocated.
+	void* allocate(size_t size);
+
+	/// Releases the memory of @p ptr if it is the last allocation, otherwise does nothing.
+	///  @param[in]		ptr		A pointer returned by #allocate.
+	void deallocate(void* ptr);
+
+	/// Returns true if @p ptr points inside one of the blocks of the arena.
+	bool owns(const void* ptr) const;
+
+	/// Releases all the allocations. Pointers returned before the reset become invalid.
+	void reset();
+
+	/// The number of bytes allocated since the last reset.
+	size_t getUsedSize() const { return m_used; }
+
+	/// The largest number of bytes allocated between two resets.
+	size_t getPeakSize() const { return m_peak; }
+
+	/// The total size of the blocks, in bytes.
+	size_t getCapacity() const { return m_capacity; }
+
+	int getBlockCount() const { return m_blockCount; }
+
+private:
+	struct Block
+	{
+		Block* next;
+		size_t size;
+	};
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcArena(const rcArena&);
+	rcArena& operator=(const rcArena&);
+
+	bool addBlock(size_t size);
+	void freeBlocks();
+
+	friend void* rcAlloc(size_t size, rcAllocHint hint);
+	friend void rcFree(void* ptr);
+
+	Block* m_blocks;	///< The current block, followed by the previous ones.
+	char* m_top;
+	char* m_end;
+	void* m_last;
+	size_t m_blockSize;
+	size_t m_used;
+	size_t m_peak;
+	size_t m_capacity;
+	int m_blockCount;
+	unsigned int m_resetCount;	///< Tells the allocations of #rcAlloc made before a reset.
+};
+
+/// Makes #rcAlloc and #rcFree of the calling thread use an arena, until the scope ends.
+///
+/// Recast functions called in the scope then allocate from the arena, which avoids the cost
+/// of the general purpose allocator when building tiles. Memory allocated in the scope must
+/// be freed on the same thread before the scope ends, or not at all; memory allocated before
+/// the scope can be freed in it. The arena is reset when the scope ends, and can be reused for
+/// the next tile.
+///
+/// The scope only applies to the calling thread: other threads, including the worker threads
+/// of the Recast functions, allocate with the functions set by #rcAllocSetCustom, and must not
+/// free memory allocated in the scope. #rcFree detects the memory of an arena freed outside of
+/// its scope, and leaks it instead of giving it to the functions set by #rcAllocSetCustom. It
+/// also asserts unless RC_DISABLE_ASSERTS is defined.
+///
+/// Example:
+/// @code
+/// rcArena arena;	// One per build thread.
+/// for (each tile)
+/// {
+/// 	rcScopedArena scope(&arena);
+/// 	// Build the tile with Recast, copy the results to memory owned by the caller.
+/// }
+/// @endcode
+class rcScopedArena
+{
+public:
+	///  @param[in]		arena	The arena, or null to allocate data outliving an enclosing scope.
+	explicit rcScopedArena(rcArena* arena);
+	~rcScopedArena();
+
+	/// Returns the arena #rcAlloc allocates from on the calling thread, or null if it uses the
+	/// functions set by #rcAllocSetCustom. Recast functions with worker threads use it to keep
+	/// the frees of the memory allocated in the scope on the calling thread.
+	static rcArena* current();
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	rcScopedArena(const rcScopedArena&);
+	rcScopedArena& operator=(const rcScopedArena&);
+
+	friend void* rcAlloc(size_t size, rcAllocHint hint);
+	friend void rcFree(void* ptr);
+
+	rcArena* m_arena;
+	rcScopedArena* m_previous;	///< The enclosing scope of the thread.
+};
+
 /// An implementation of operator new usable for placement new. The default one is part of STL (which we don't use).
 /// rcNewTag is a dummy type used to differentiate our operator from the STL one, in case users import both Recast
 /// and STL.
@@ -19,6 +19,7 @@
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
+#include "RecastSpanPool.h"
 
 #include <math.h>
 #include <string.h>
@@ -284,6 +285,69 @@ rcPolyMeshDetail::rcPolyMeshDetail()
 {
 }
 
+rcEditableHeightfield* rcAllocEditableHeightfield()
+{
+	return rcNew<rcEditableHeightfield>(RC_ALLOC_PERM);
+}
+
+void rcFreeEditableHeightfield(rcEditableHeightfield* editableHeightfield)
+{
+	rcDelete(editableHeightfield);
+}
+
+rcEditableHeightfield::rcEditableHeightfield()
+: meshes()
+, nmeshes()
+, maxMeshes()
+, dirty()
+, dirtyBounds()
+, flagMergeThreshold()
+{
+}
+
+rcEditableHeightfield::~rcEditableHeightfield()
+{
+	for (int i = 0; i < nmeshes; ++i)
+	{
+		rcFree(meshes[i]->spans);
+		rcFree(meshes[i]);
+	}
+	rcFree(meshes);
+	rcFree(dirty);
+}
+
+rcPackedHeightfield* rcAllocPackedHeightfield()
+{
+	return rcNew<rcPackedHeightfield>(RC_ALLOC_PERM);
+}
+
+void rcFreePackedHeightfield(rcPackedHeightfield* packedHeightfield)
+{
+	rcDelete(packedHeightfield);
+}
+
+rcPackedHeightfield::rcPackedHeightfield()
+: width()
+, height()
+, bmin()
+, bmax()
+, cs()
+, ch()
+, spanCount()
+, columns()
+, spans()
+, compressed()
+, compressedSize()
+{
+}
+
+rcPackedHeightfield::~rcPackedHeightfield()
+{
+	rcFree(columns);
+	rcFree(spans);
+	rcFree(compressed);
+}
+
 void rcCalcBounds(const float* verts, int numVerts, float* minBounds, float* maxBounds)
 {
 	// Calculate bounding box.
@@ -324,6 +388,27 @@ bool rcCreateHeightfield(rcContext* context, rcHeightfield& heightfield, int siz
 	return true;
 }
 
+bool rcResetHeightfield(rcContext* context, rcHeightfield& heightfield, int sizeX, int sizeZ,
+                        const float* minBounds, const float* maxBounds,
+                        float cellSize, float cellHeight)
+{
+	if (heightfield.spans)
+	{
+		rcFreeAllSpans(heightfield);
+		if (heightfield.width == sizeX && heightfield.height == sizeZ)
+		{
+			rcVcopy(heightfield.bmin, minBounds);
+			rcVcopy(heightfield.bmax, maxBounds);
+			heightfield.cs = cellSize;
+			heightfield.ch = cellHeight;
+			return true;
+		}
+		rcFree(heightfield.spans);
+		heightfield.spans = NULL;
+	}
+	return rcCreateHeightfield(context, heightfield, sizeX, sizeZ, minBounds, maxBounds, cellSize, cellHeight);
+}
+
 static void calcTriNormal(const float* v0, const float* v1, const float* v2, float* faceNormal)
 {
 	float e0[3], e1[3];
@@ -400,17 +485,12 @@ int rcGetHeightFieldSpanCount(rcContext* context, const rcHeightfield& heightfie
 	return spanCount;
 }
 
-bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
-                               const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+/// Fills in the header and allocates the cells and spans of a compact heightfield.
+static bool allocCompactHeightfield(rcContext* context, const char* name, const int walkableHeight, const int walkableClimb,
+                                    const int xSize, const int zSize, const int spanCount,
+                                    const float* minBounds, const float* maxBounds, const float cellSize, const float cellHeight,
+                                    rcCompactHeightfield& compactHeightfield)
 {
-	rcAssert(context);
-
-	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
-
-	const int xSize = heightfield.width;
-	const int zSize = heightfield.height;
-	const int spanCount = rcGetHeightFieldSpanCount(context, heightfield);
-
 	// Fill in header.
 	compactHeightfield.width = xSize;
 	compactHeightfield.height = zSize;
@@ -418,68 +498,44 @@ bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, con
 	compactHeightfield.walkableHeight = walkableHeight;
 	compactHeightfield.walkableClimb = walkableClimb;
 	compactHeightfield.maxRegions = 0;
-	rcVcopy(compactHeightfield.bmin, heightfield.bmin);
-	rcVcopy(compactHeightfield.bmax, heightfield.bmax);
-	compactHeightfield.bmax[1] += walkableHeight * heightfield.ch;
-	compactHeightfield.cs = heightfield.cs;
-	compactHeightfield.ch = heightfield.ch;
+	rcVcopy(compactHeightfield.bmin, minBounds);
+	rcVcopy(compactHeightfield.bmax, maxBounds);
+	compactHeightfield.bmax[1] += walkableHeight * cellHeight;
+	compactHeightfield.cs = cellSize;
+	compactHeightfield.ch = cellHeight;
 	compactHeightfield.cells = (rcCompactCell*)rcAlloc(sizeof(rcCompactCell) * xSize * zSize, RC_ALLOC_PERM);
 	if (!compactHeightfield.cells)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.cells' (%d)", xSize * zSize);
+		context->log(RC_LOG_ERROR, "%s: Out of memory 'chf.cells' (%d)", name, xSize * zSize);
 		return false;
 	}
 	memset(compactHeightfield.cells, 0, sizeof(rcCompactCell) * xSize * zSize);
 	compactHeightfield.spans = (rcCompactSpan*)rcAlloc(sizeof(rcCompactSpan) * spanCount, RC_ALLOC_PERM);
 	if (!compactHeightfield.spans)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.spans' (%d)", spanCount);
+		context->log(RC_LOG_ERROR, "%s: Out of memory 'chf.spans' (%d)", name, spanCount);
 		return false;
 	}
 	memset(compactHeightfield.spans, 0, sizeof(rcCompactSpan) * spanCount);
 	compactHeightfield.areas = (unsigned char*)rcAlloc(sizeof(unsigned char) * spanCount, RC_ALLOC_PERM);
 	if (!compactHeightfield.areas)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Out of memory 'chf.areas' (%d)", spanCount);
+		context->log(RC_LOG_ERROR, "%s: Out of memory 'chf.areas' (%d)", name, spanCount);
 		return false;
 	}
 	memset(compactHeightfield.areas, RC_NULL_AREA, sizeof(unsigned char) * spanCount);
 
-	const int MAX_HEIGHT = 0xffff;
+	return true;
+}
 
-	// Fill in cells and spans.
-	int currentCellIndex = 0;
-	const int numColumns = xSize * zSize;
-	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
-	{
-		const rcSpan* span = heightfield.spans[columnIndex];
-			
-		// If there are no spans at this cell, just leave the data to index=0, count=0.
-		if (span == NULL)
-		{
-			continue;
-		}
-			
-		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
-		cell.index = currentCellIndex;
-		cell.count = 0;
+/// Finds the neighbour connections of the spans of a compact heightfield.
+static void connectCompactHeightfield(rcContext* context, const char* name, rcCompactHeightfield& compactHeightfield)
+{
+	const int xSize = compactHeightfield.width;
+	const int zSize = compactHeightfield.height;
+	const int walkableHeight = compactHeightfield.walkableHeight;
+	const int walkableClimb = compactHeightfield.walkableClimb;
 
-		for (; span != NULL; span = span->next)
-		{
-			if (span->area != RC_NULL_AREA)
-			{
-				const int bot = (int)span->smax;
-				const int top = span->next ? (int)span->next->smin : MAX_HEIGHT;
-				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
-				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
-				compactHeightfield.areas[currentCellIndex] = span->area;
-				currentCellIndex++;
-				cell.count++;
-			}
-		}
-	}
-	
-	// Find neighbour connections.
 	const int MAX_LAYERS = RC_NOT_CONNECTED - 1;
 	int maxLayerIndex = 0;
 	const int zStride = xSize; // for readability
@@ -534,9 +590,136 @@ bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, con
 
 	if (maxLayerIndex > MAX_LAYERS)
 	{
-		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: Heightfield has too many layers %d (max: %d)",
-		         maxLayerIndex, MAX_LAYERS);
+		context->log(RC_LOG_ERROR, "%s: Heightfield has too many layers %d (max: %d)",
+		         name, maxLayerIndex, MAX_LAYERS);
+	}
+}
+
+bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                               const rcHeightfield& heightfield, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+
+	const int xSize = heightfield.width;
+	const int zSize = heightfield.height;
+	const int spanCount = rcGetHeightFieldSpanCount(context, heightfield);
+
+	if (!allocCompactHeightfield(context, "rcBuildCompactHeightfield", walkableHeight, walkableClimb, xSize, zSize, spanCount,
+	                             heightfield.bmin, heightfield.bmax, heightfield.cs, heightfield.ch, compactHeightfield))
+	{
+		return false;
 	}
 
+	const int MAX_HEIGHT = 0xffff;
+
+	// Fill in cells and spans.
+	int currentCellIndex = 0;
+	const int numColumns = xSize * zSize;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const rcSpan* span = heightfield.spans[columnIndex];
+			
+		// If there are no spans at this cell, just leave the data to index=0, count=0.
+		if (span == NULL)
+		{
+			continue;
+		}
+			
+		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
+		cell.index = currentCellIndex;
+		cell.count = 0;
+
+		for (; span != NULL; span = span->next)
+		{
+			if (span->area != RC_NULL_AREA)
+			{
+				const int bot = (int)span->smax;
+				const int top = span->next ? (int)span->next->smin : MAX_HEIGHT;
+				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
+				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+				compactHeightfield.areas[currentCellIndex] = span->area;
+				currentCellIndex++;
+				cell.count++;
+			}
+		}
+	}
+	
+	// Find neighbour connections.
+	connectCompactHeightfield(context, "rcBuildCompactHeightfield", compactHeightfield);
+
+	return true;
+}
+
+bool rcBuildCompactHeightfield(rcContext* context, const int walkableHeight, const int walkableClimb,
+                               const rcPackedHeightfield& packed, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_BUILD_COMPACTHEIGHTFIELD);
+
+	if (!packed.columns)
+	{
+		context->log(RC_LOG_ERROR, "rcBuildCompactHeightfield: The packed heightfield is compressed.");
+		return false;
+	}
+
+	const int xSize = packed.width;
+	const int zSize = packed.height;
+	int spanCount = 0;
+	for (int i = 0; i < packed.spanCount; ++i)
+	{
+		if (rcGetPackedSpanArea(packed.spans[i]) != RC_NULL_AREA)
+		{
+			spanCount++;
+		}
+	}
+
+	if (!allocCompactHeightfield(context, "rcBuildCompactHeightfield", walkableHeight, walkableClimb, xSize, zSize, spanCount,
+	                             packed.bmin, packed.bmax, packed.cs, packed.ch, compactHeightfield))
+	{
+		return false;
+	}
+
+	const int MAX_HEIGHT = 0xffff;
+
+	// Fill in cells and spans.
+	int currentCellIndex = 0;
+	const int numColumns = xSize * zSize;
+	for (int columnIndex = 0; columnIndex < numColumns; ++columnIndex)
+	{
+		const int first = (int)packed.columns[columnIndex];
+		const int last = (int)packed.columns[columnIndex + 1];
+
+		// If there are no spans at this cell, just leave the data to index=0, count=0.
+		if (first == last)
+		{
+			continue;
+		}
+
+		rcCompactCell& cell = compactHeightfield.cells[columnIndex];
+		cell.index = currentCellIndex;
+		cell.count = 0;
+
+		for (int i = first; i < last; ++i)
+		{
+			const unsigned int span = packed.spans[i];
+			if (rcGetPackedSpanArea(span) != RC_NULL_AREA)
+			{
+				const int bot = (int)rcGetPackedSpanMax(span);
+				const int top = i + 1 < last ? (int)rcGetPackedSpanMin(packed.spans[i + 1]) : MAX_HEIGHT;
+				compactHeightfield.spans[currentCellIndex].y = (unsigned short)rcClamp(bot, 0, 0xffff);
+				compactHeightfield.spans[currentCellIndex].h = (unsigned char)rcClamp(top - bot, 0, 0xff);
+				compactHeightfield.areas[currentCellIndex] = (unsigned char)rcGetPackedSpanArea(span);
+				currentCellIndex++;
+				cell.count++;
+			}
+		}
+	}
+
+	// Find neighbour connections.
+	connectCompactHeightfield(context, "rcBuildCompactHeightfield", compactHeightfield);
+
 	return true;
 }
@@ -17,6 +17,13 @@
 //
 
 #include "RecastAlloc.h"
+#include "RecastAssert.h"
+
+#if defined(_MSC_VER)
+#	define RC_THREAD_LOCAL __declspec(thread)
+#else
+#	define RC_THREAD_LOCAL __thread
+#endif
 
 static void* rcAllocDefault(size_t size, rcAllocHint)
 {
@@ -31,6 +38,21 @@ static void rcFreeDefault(void *ptr)
 static rcAllocFunc* sRecastAllocFunc = rcAllocDefault;
 static rcFreeFunc* sRecastFreeFunc = rcFreeDefault;
 
+// The innermost rcScopedArena of the thread.
+static RC_THREAD_LOCAL rcScopedArena* sThreadScope = 0;
+
+// Precedes each block returned by rcAlloc, so that rcFree knows where it was allocated.
+struct rcAllocHeader
+{
+	rcArena* arena;				// The arena of the block, or null if allocated with sRecastAllocFunc.
+	unsigned int resetCount;	// The reset count of the arena when the block was allocated.
+	unsigned int magic;
+};
+
+// Keeps the blocks aligned to 16 bytes.
+static const size_t RC_ALLOC_HEADER_SIZE = 16;
+static const unsigned int RC_ALLOC_MAGIC = 0x52434148;
+
 void rcAllocSetCustom(rcAllocFunc* allocFunc, rcFreeFunc* freeFunc)
 {
 	sRecastAllocFunc = allocFunc ? allocFunc : rcAllocDefault;
@@ -39,13 +61,189 @@ void rcAllocSetCustom(rcAllocFunc* allocFunc, rcFreeFunc* freeFunc)
 
 void* rcAlloc(size_t size, rcAllocHint hint)
 {
-	return sRecastAllocFunc(size, hint);
+	rcScopedArena* scope = sThreadScope;
+	rcArena* arena = scope ? scope->m_arena : 0;
+	rcAllocHeader* header = (rcAllocHeader*)(arena ? arena->allocate(RC_ALLOC_HEADER_SIZE + size)
+													: sRecastAllocFunc(RC_ALLOC_HEADER_SIZE + size, hint));
+	if (!header)
+		return 0;
+	header->arena = arena;
+	header->resetCount = arena ? arena->m_resetCount : 0;
+	header->magic = RC_ALLOC_MAGIC;
+	return (char*)header + RC_ALLOC_HEADER_SIZE;
 }
 
 void rcFree(void* ptr)
 {
-	if (ptr != NULL)
+	if (ptr == NULL)
+		return;
+
+	// Not allocated by rcAlloc, already freed, or overwritten by a later allocation of an arena.
+	rcAllocHeader* header = (rcAllocHeader*)((char*)ptr - RC_ALLOC_HEADER_SIZE);
+	const bool validHeader = header->magic == RC_ALLOC_MAGIC;
+	rcAssert(validHeader);
+	if (!validHeader)
+		return;
+
+	rcArena* arena = header->arena;
+	if (!arena)
+	{
+		header->magic = 0;
+		sRecastFreeFunc(header);
+		return;
+	}
+
+	// The memory may come from the arena of an enclosing scope, if it was not reset since.
+	for (rcScopedArena* scope = sThreadScope; scope; scope = scope->m_previous)
 	{
-		sRecastFreeFunc(ptr);
+		if (scope->m_arena == arena && header->resetCount == arena->m_resetCount)
+		{
+			header->magic = 0;
+			arena->deallocate(header);
+			return;
+		}
 	}
+
+	// Freed on another thread than the one of its scope, or after the scope ended. The memory
+	// belongs to the arena, leak it.
+	const bool freedInScope = false;
+	rcAssert(freedInScope);
+}
+
+static const size_t RC_ARENA_ALIGN = 16;
+
+static size_t alignArenaSize(size_t size)
+{
+	return (size + (RC_ARENA_ALIGN-1)) & ~(RC_ARENA_ALIGN-1);
+}
+
+rcArena::rcArena(size_t blockSize) :
+	m_blocks(0),
+	m_top(0),
+	m_end(0),
+	m_last(0),
+	m_blockSize(alignArenaSize(blockSize)),
+	m_used(0),
+	m_peak(0),
+	m_capacity(0),
+	m_blockCount(0),
+	m_resetCount(0)
+{
+}
+
+rcArena::~rcArena()
+{
+	freeBlocks();
+}
+
+bool rcArena::addBlock(size_t size)
+{
+	const size_t headerSize = alignArenaSize(sizeof(Block));
+	Block* block = (Block*)sRecastAllocFunc(headerSize + size + RC_ARENA_ALIGN, RC_ALLOC_PERM);
+	if (!block)
+		return false;
+	block->next = m_blocks;
+	block->size = size;
+	m_blocks = block;
+	m_blockCount++;
+	m_capacity += size;
+
+	// The allocator may only align to 8 bytes.
+	const size_t data = alignArenaSize((size_t)((char*)block + headerSize));
+	m_top = (char*)data;
+	m_end = m_top + size;
+	return true;
+}
+
+void rcArena::freeBlocks()
+{
+	while (m_blocks)
+	{
+		Block* next = m_blocks->next;
+		sRecastFreeFunc(m_blocks);
+		m_blocks = next;
+	}
+	m_top = 0;
+	m_end = 0;
+	m_last = 0;
+	m_capacity = 0;
+	m_blockCount = 0;
+}
+
+void* rcArena::allocate(size_t size)
+{
+	size = alignArenaSize(size);
+	if (!m_top || size > (size_t)(m_end - m_top))
+	{
+		if (!addBlock(size > m_blockSize ? size : m_blockSize))
+			return 0;
+	}
+	void* ptr = m_top;
+	m_top += size;
+	m_last = ptr;
+	m_used += size;
+	if (m_used > m_peak)
+		m_peak = m_used;
+	return ptr;
+}
+
+void rcArena::deallocate(void* ptr)
+{
+	if (ptr && ptr == m_last)
+	{
+		m_used -= (size_t)(m_top - (char*)ptr);
+		m_top = (char*)ptr;
+		m_last = 0;
+	}
+}
+
+bool rcArena::owns(const void* ptr) const
+{
+	const size_t headerSize = alignArenaSize(sizeof(Block));
+	for (const Block* block = m_blocks; block; block = block->next)
+	{
+		const char* begin = (const char*)block + headerSize;
+		if ((const char*)ptr >= begin && (const char*)ptr < begin + block->size + RC_ARENA_ALIGN)
+			return true;
+	}
+	return false;
+}
+
+void rcArena::reset()
+{
+	if (m_blockCount > 1)
+	{
+		// Merge the blocks so that the same allocations fit in one block next time.
+		const size_t size = m_capacity;
+		freeBlocks();
+		addBlock(size);
+	}
+	else if (m_blocks)
+	{
+		const size_t headerSize = alignArenaSize(sizeof(Block));
+		m_top = (char*)alignArenaSize((size_t)((char*)m_blocks + headerSize));
+		m_end = m_top + m_blocks->size;
+	}
+	m_last = 0;
+	m_used = 0;
+	m_resetCount++;
+}
+
+rcScopedArena::rcScopedArena(rcArena* arena) :
+	m_arena(arena),
+	m_previous(sThreadScope)
+{
+	sThreadScope = this;
+}
+
+rcScopedArena::~rcScopedArena()
+{
+	sThreadScope = m_previous;
+	if (m_arena)
+		m_arena->reset();
+}
+
+rcArena* rcScopedArena::current()
+{
+	return sThreadScope ? sThreadScope->m_arena : 0;
 }
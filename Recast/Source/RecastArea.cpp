@@ -429,6 +429,144 @@ void rcMarkBoxArea(rcContext* context, const float* boxMinBounds, const float* b
 	}
 }
 
+bool rcMarkBoxAreas(rcContext* context, const float* boxMinBounds, const float* boxMaxBounds, const unsigned char* areaIds,
+                    const int boxCount, rcCompactHeightfield& compactHeightfield)
+{
+	rcAssert(context);
+
+	rcScopedTimer timer(context, RC_TIMER_MARK_BOX_AREA);
+
+	const int xSize = compactHeightfield.width;
+	const int zSize = compactHeightfield.height;
+	const int zStride = xSize; // For readability
+	const float cs = compactHeightfield.cs;
+	const float ch = compactHeightfield.ch;
+
+	if (boxCount <= 0)
+	{
+		return true;
+	}
+
+	// The columns of each box [Form: (minX, maxX, minZ, maxZ, minY, maxY) * boxCount]
+	rcScopedDelete<int> footprints((int*)rcAlloc(sizeof(int) * boxCount * 6, RC_ALLOC_TEMP));
+	rcScopedDelete<int> columnStarts((int*)rcAlloc(sizeof(int) * (xSize * zSize + 1), RC_ALLOC_TEMP));
+	if (!footprints || !columnStarts)
+	{
+		context->log(RC_LOG_ERROR, "rcMarkBoxAreas: Out of memory 'footprints' (%d).", boxCount);
+		return false;
+	}
+	memset(columnStarts, 0, sizeof(int) * (xSize * zSize + 1));
+
+	// Find the columns whose cell center is inside each box, and count the boxes of each column.
+	int entryCount = 0;
+	for (int i = 0; i < boxCount; ++i)
+	{
+		const float* boxMin = &boxMinBounds[i * 3];
+		const float* boxMax = &boxMaxBounds[i * 3];
+		int* footprint = &footprints[i * 6];
+
+		int minX = rcMax((int)((boxMin[0] - compactHeightfield.bmin[0]) / cs), 0);
+		int maxX = rcMin((int)((boxMax[0] - compactHeightfield.bmin[0]) / cs), xSize - 1);
+		int minZ = rcMax((int)((boxMin[2] - compactHeightfield.bmin[2]) / cs), 0);
+		int maxZ = rcMin((int)((boxMax[2] - compactHeightfield.bmin[2]) / cs), zSize - 1);
+
+		// Shrink the footprint to the cells whose center is in [min, max).
+		while (minX <= maxX && compactHeightfield.bmin[0] + ((float)minX + 0.5f) * cs < boxMin[0]) { minX++; }
+		while (minX <= maxX && compactHeightfield.bmin[0] + ((float)maxX + 0.5f) * cs >= boxMax[0]) { maxX--; }
+		while (minZ <= maxZ && compactHeightfield.bmin[2] + ((float)minZ + 0.5f) * cs < boxMin[2]) { minZ++; }
+		while (minZ <= maxZ && compactHeightfield.bmin[2] + ((float)maxZ + 0.5f) * cs >= boxMax[2]) { maxZ--; }
+
+		footprint[0] = minX;
+		footprint[1] = maxX;
+		footprint[2] = minZ;
+		footprint[3] = maxZ;
+		footprint[4] = (int)((boxMin[1] - compactHeightfield.bmin[1]) / ch);
+		footprint[5] = (int)((boxMax[1] - compactHeightfield.bmin[1]) / ch);
+
+		for (int z = minZ; z <= maxZ; ++z)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				columnStarts[x + z * zStride + 1]++;
+			}
+		}
+		if (minX <= maxX && minZ <= maxZ)
+		{
+			entryCount += (maxX - minX + 1) * (maxZ - minZ + 1);
+		}
+	}
+
+	if (entryCount == 0)
+	{
+		return true;
+	}
+
+	rcScopedDelete<int> columnBoxes((int*)rcAlloc(sizeof(int) * entryCount, RC_ALLOC_TEMP));
+	if (!columnBoxes)
+	{
+		context->log(RC_LOG_ERROR, "rcMarkBoxAreas: Out of memory 'columnBoxes' (%d).", entryCount);
+		return false;
+	}
+
+	// Bin the boxes into their columns. The boxes of a column stay in order, so the last box wins where they overlap.
+	for (int i = 0; i < xSize * zSize; ++i)
+	{
+		columnStarts[i + 1] += columnStarts[i];
+	}
+	for (int i = 0; i < boxCount; ++i)
+	{
+		const int* footprint = &footprints[i * 6];
+		for (int z = footprint[2]; z <= footprint[3]; ++z)
+		{
+			for (int x = footprint[0]; x <= footprint[1]; ++x)
+			{
+				columnBoxes[columnStarts[x + z * zStride]++] = i;
+			}
+		}
+	}
+
+	// Mark the spans of each column in a single pass over the grid.
+	// The binning above moved each column start to the start of the next column.
+	int columnBegin = 0;
+	for (int column = 0; column < xSize * zSize; ++column)
+	{
+		const int columnEnd = columnStarts[column];
+		if (columnBegin == columnEnd)
+		{
+			continue;
+		}
+
+		const rcCompactCell& cell = compactHeightfield.cells[column];
+		const int maxSpanIndex = (int)(cell.index + cell.count);
+		for (int entry = columnBegin; entry < columnEnd; ++entry)
+		{
+			const int box = columnBoxes[entry];
+			const int minY = footprints[box * 6 + 4];
+			const int maxY = footprints[box * 6 + 5];
+			for (int spanIndex = (int)cell.index; spanIndex < maxSpanIndex; ++spanIndex)
+			{
+				// Skip if the span is outside the box extents.
+				const int spanY = (int)compactHeightfield.spans[spanIndex].y;
+				if (spanY < minY || spanY > maxY)
+				{
+					continue;
+				}
+
+				// Skip if the span has been removed.
+				if (compactHeightfield.areas[spanIndex] == RC_NULL_AREA)
+				{
+					continue;
+				}
+
+				compactHeightfield.areas[spanIndex] = areaIds[box];
+			}
+		}
+		columnBegin = columnEnd;
+	}
+
+	return true;
+}
+
 void rcMarkConvexPolyArea(rcContext* context, const float* verts, const int numVerts,
 						  const float minY, const float maxY, unsigned char areaId,
 						  rcCompactHeightfield& compactHeightfield)
@@ -20,6 +20,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <atomic>
+#include <thread>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -807,6 +809,191 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 }
 
 
+namespace
+{
+/// The contours of a range of regions, traced by one thread before being sorted into the contour set.
+struct ContourJob
+{
+	int firstReg;
+	int lastReg;
+	rcTempVector<rcContour> conts;
+	rcTempVector<int> starts;	///< The span each contour was traced from.
+};
+
+/// The state shared by the threads building the contours.
+struct ContourBuild
+{
+	rcContext* ctx;
+	const rcCompactHeightfield* chf;
+	float maxError;
+	int maxEdgeLen;
+	int buildFlags;
+	bool timers;					///< Whether the threads update the timers of the context.
+	unsigned char* flags;
+	const int* regionFirst;			///< The first boundary span of each region. [Size: regions + 1]
+	const int* boundarySpans;		///< The boundary spans, by region and in span order.
+	const int* boundaryCells;		///< The cell of each boundary span.
+	ContourJob* jobs;
+	int njobs;
+	rcContourRegion* holeRegions;	///< The regions which have holes to merge.
+	int nholeRegions;
+	std::atomic<int> nextJob;
+	std::atomic<bool> failed;
+};
+
+/// Traces and simplifies the contours of the regions of a job.
+bool buildContourJob(ContourBuild& build, ContourJob& job, rcIntArray& verts, rcIntArray& simplified)
+{
+	rcContext* ctx = build.ctx;
+	const rcCompactHeightfield& chf = *build.chf;
+	const int w = chf.width;
+	const int borderSize = chf.borderSize;
+	unsigned char* flags = build.flags;
+	
+	// The spans of a region are visited in span order, which is the order of the serial scan,
+	// and walking a contour only changes the flags of the spans of its region.
+	for (int r = build.regionFirst[job.firstReg]; r < build.regionFirst[job.lastReg]; ++r)
+	{
+		const int i = build.boundarySpans[r];
+		if (flags[i] == 0 || flags[i] == 0xf)
+		{
+			flags[i] = 0;
+			continue;
+		}
+		const int x = build.boundaryCells[r] % w;
+		const int y = build.boundaryCells[r] / w;
+		
+		verts.clear();
+		simplified.clear();
+		
+		if (build.timers)
+			ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
+		walkContour(x, y, i, chf, flags, verts);
+		if (build.timers)
+			ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
+		
+		if (build.timers)
+			ctx->startTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
+		simplifyContour(verts, simplified, build.maxError, build.maxEdgeLen, build.buildFlags);
+		removeDegenerateSegments(simplified);
+		if (build.timers)
+			ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
+		
+		// Create contour.
+		if (simplified.size()/4 < 3)
+			continue;
+		
+		rcContour cont;
+		memset(&cont, 0, sizeof(cont));
+		cont.nverts = simplified.size()/4;
+		cont.verts = (int*)rcAlloc(sizeof(int)*cont.nverts*4, RC_ALLOC_PERM);
+		if (!cont.verts)
+		{
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont.nverts);
+			return false;
+		}
+		cont.nrverts = verts.size()/4;
+		cont.rverts = (int*)rcAlloc(sizeof(int)*cont.nrverts*4, RC_ALLOC_PERM);
+		if (!cont.rverts)
+		{
+			rcFree(cont.verts);
+			ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont.nrverts);
+			return false;
+		}
+		memcpy(cont.verts, &simplified[0], sizeof(int)*cont.nverts*4);
+		memcpy(cont.rverts, &verts[0], sizeof(int)*cont.nrverts*4);
+		if (borderSize > 0)
+		{
+			// If the heightfield was build with bordersize, remove the offset.
+			for (int j = 0; j < cont.nverts; ++j)
+			{
+				cont.verts[j*4+0] -= borderSize;
+				cont.verts[j*4+2] -= borderSize;
+			}
+			for (int j = 0; j < cont.nrverts; ++j)
+			{
+				cont.rverts[j*4+0] -= borderSize;
+				cont.rverts[j*4+2] -= borderSize;
+			}
+		}
+		cont.reg = chf.spans[i].reg;
+		cont.area = chf.areas[i];
+		
+		job.conts.push_back(cont);
+		job.starts.push_back(i);
+	}
+	
+	return true;
+}
+
+/// Builds the jobs, taken in turn by each thread.
+void buildContourJobs(ContourBuild* build)
+{
+	rcIntArray verts(256);
+	rcIntArray simplified(64);
+	
+	while (!build->failed)
+	{
+		const int jobIndex = build->nextJob.fetch_add(1);
+		if (jobIndex >= build->njobs)
+			break;
+		if (!buildContourJob(*build, build->jobs[jobIndex], verts, simplified))
+			build->failed = true;
+	}
+}
+
+/// Merges the holes of the regions, taken in turn by each thread.
+void mergeHoleJobs(ContourBuild* build)
+{
+	for (;;)
+	{
+		const int regionIndex = build->nextJob.fetch_add(1);
+		if (regionIndex >= build->nholeRegions)
+			break;
+		mergeRegionHoles(build->ctx, build->holeRegions[regionIndex]);
+	}
+}
+
+/// Runs @p fn on @p nthreads threads, including the calling thread.
+void runContourThreads(ContourBuild* build, void (*fn)(ContourBuild*), const int nthreads)
+{
+	build->nextJob = 0;
+	std::thread* threads = 0;
+	if (nthreads > 1)
+	{
+		threads = (std::thread*)rcAlloc(sizeof(std::thread)*(nthreads-1), RC_ALLOC_TEMP);
+		if (threads)
+		{
+			for (int i = 0; i < nthreads-1; ++i)
+				new (rcNewTag(), &threads[i]) std::thread(fn, build);
+		}
+	}
+	fn(build);
+	if (threads)
+	{
+		for (int i = 0; i < nthreads-1; ++i)
+		{
+			threads[i].join();
+			threads[i].~thread();
+		}
+		rcFree(threads);
+	}
+}
+
+struct ContourRef
+{
+	int start;
+	rcContour* cont;
+};
+
+int compareContourRefs(const void* va, const void* vb)
+{
+	const ContourRef* a = (const ContourRef*)va;
+	const ContourRef* b = (const ContourRef*)vb;
+	return a->start - b->start;
+}
+} // anonymous namespace
+
 /// @par
 ///
 /// The raw contours will match the region outlines exactly. The @p maxError and @p maxEdgeLen
@@ -819,10 +1006,17 @@ static void mergeRegionHoles(rcContext* ctx, rcContourRegion& region)
 ///
 /// See the #rcConfig documentation for more information on the configuration parameters.
 ///
+/// The contours of a region only depend on the spans of the region. With @p threadCount above 1, ranges of
+/// regions are traced and simplified on worker threads, and the holes of the regions are merged on them too,
+/// unless the calling thread allocates from an arena. (See: #rcScopedArena)
+/// The contours are then sorted by the span they were traced from, which is the order of a serial scan,
+/// so the result does not depend on the thread count. The worker threads log to @p ctx, but only the
+/// serial build updates the trace and simplify timers.
+///
 /// @see rcAllocContourSet, rcCompactHeightfield, rcContourSet, rcConfig
 bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					 const float maxError, const int maxEdgeLen,
-					 rcContourSet& cset, const int buildFlags)
+					 rcContourSet& cset, const int buildFlags, const int threadCount)
 {
 	rcAssert(ctx);
 	
@@ -850,12 +1044,6 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 	cset.borderSize = chf.borderSize;
 	cset.maxError = maxError;
 	
-	int maxContours = rcMax((int)chf.maxRegions, 8);
-	cset.conts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-	if (!cset.conts)
-		return false;
-	cset.nconts = 0;
-	
 	rcScopedDelete<unsigned char> flags((unsigned char*)rcAlloc(sizeof(unsigned char)*chf.spanCount, RC_ALLOC_TEMP));
 	if (!flags)
 	{
@@ -863,9 +1051,19 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 		return false;
 	}
 	
+	const int nregions = chf.maxRegions+1;
+	rcScopedDelete<int> regionFirst((int*)rcAlloc(sizeof(int)*(nregions+1), RC_ALLOC_TEMP));
+	if (!regionFirst)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'regionFirst' (%d).", nregions+1);
+		return false;
+	}
+	memset(regionFirst, 0, sizeof(int)*(nregions+1));
+	
 	ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
 	
 	// Mark boundaries.
+	int nboundary = 0;
 	for (int y = 0; y < h; ++y)
 	{
 		for (int x = 0; x < w; ++x)
@@ -894,15 +1092,27 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 						res |= (1 << dir);
 				}
 				flags[i] = res ^ 0xf; // Inverse, mark non connected edges.
+				if (flags[i] != 0 && flags[i] != 0xf)
+				{
+					regionFirst[chf.spans[i].reg+1]++;
+					nboundary++;
+				}
 			}
 		}
 	}
 	
-	ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-	
-	rcIntArray verts(256);
-	rcIntArray simplified(64);
-	
+	// Bucket the spans which may start a contour by region.
+	for (int i = 0; i < nregions; ++i)
+		regionFirst[i+1] += regionFirst[i];
+	rcScopedDelete<int> boundarySpans((int*)rcAlloc(sizeof(int)*rcMax(nboundary, 1)*2, RC_ALLOC_TEMP));
+	rcScopedDelete<int> regionNext((int*)rcAlloc(sizeof(int)*nregions, RC_ALLOC_TEMP));
+	if (!boundarySpans || !regionNext)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'boundarySpans' (%d).", nboundary*2);
+		return false;
+	}
+	int* boundaryCells = &boundarySpans[nboundary];
+	memcpy(regionNext, regionFirst, sizeof(int)*nregions);
 	for (int y = 0; y < h; ++y)
 	{
 		for (int x = 0; x < w; ++x)
@@ -911,99 +1121,106 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 			for (int i = (int)c.index, ni = (int)(c.index+c.count); i < ni; ++i)
 			{
 				if (flags[i] == 0 || flags[i] == 0xf)
-				{
-					flags[i] = 0;
-					continue;
-				}
-				const unsigned short reg = chf.spans[i].reg;
-				if (!reg || (reg & RC_BORDER_REG))
 					continue;
-				const unsigned char area = chf.areas[i];
-				
-				verts.clear();
-				simplified.clear();
-				
-				ctx->startTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-				walkContour(x, y, i, chf, flags, verts);
-				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
-				
-				ctx->startTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
-				simplifyContour(verts, simplified, maxError, maxEdgeLen, buildFlags);
-				removeDegenerateSegments(simplified);
-				ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_SIMPLIFY);
-				
-				
-				// Store region->contour remap info.
-				// Create contour.
-				if (simplified.size()/4 >= 3)
-				{
-					if (cset.nconts >= maxContours)
-					{
-						// Allocate more contours.
-						// This happens when a region has holes.
-						const int oldMax = maxContours;
-						maxContours *= 2;
-						rcContour* newConts = (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM);
-						for (int j = 0; j < cset.nconts; ++j)
-						{
-							newConts[j] = cset.conts[j];
-							// Reset source pointers to prevent data deletion.
-							cset.conts[j].verts = 0;
-							cset.conts[j].rverts = 0;
-						}
-						rcFree(cset.conts);
-						cset.conts = newConts;
-						
-						ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", oldMax, maxContours);
-					}
-					
-					rcContour* cont = &cset.conts[cset.nconts++];
-					
-					cont->nverts = simplified.size()/4;
-					cont->verts = (int*)rcAlloc(sizeof(int)*cont->nverts*4, RC_ALLOC_PERM);
-					if (!cont->verts)
-					{
-						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'verts' (%d).", cont->nverts);
-						return false;
-					}
-					memcpy(cont->verts, &simplified[0], sizeof(int)*cont->nverts*4);
-					if (borderSize > 0)
-					{
-						// If the heightfield was build with bordersize, remove the offset.
-						for (int j = 0; j < cont->nverts; ++j)
-						{
-							int* v = &cont->verts[j*4];
-							v[0] -= borderSize;
-							v[2] -= borderSize;
-						}
-					}
-					
-					cont->nrverts = verts.size()/4;
-					cont->rverts = (int*)rcAlloc(sizeof(int)*cont->nrverts*4, RC_ALLOC_PERM);
-					if (!cont->rverts)
-					{
-						ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'rverts' (%d).", cont->nrverts);
-						return false;
-					}
-					memcpy(cont->rverts, &verts[0], sizeof(int)*cont->nrverts*4);
-					if (borderSize > 0)
-					{
-						// If the heightfield was build with bordersize, remove the offset.
-						for (int j = 0; j < cont->nrverts; ++j)
-						{
-							int* v = &cont->rverts[j*4];
-							v[0] -= borderSize;
-							v[2] -= borderSize;
-						}
-					}
-					
-					cont->reg = reg;
-					cont->area = area;
-				}
+				const int j = regionNext[chf.spans[i].reg]++;
+				boundarySpans[j] = i;
+				boundaryCells[j] = x+y*w;
 			}
 		}
 	}
 	
+	ctx->stopTimer(RC_TIMER_BUILD_CONTOURS_TRACE);
+	
+	// Split the regions in more ranges than threads, to balance the work between the threads.
+	const int nthreads = rcMax(1, threadCount);
+	const int njobs = nthreads > 1 ? rcMax(1, rcMin(nregions, nthreads*8)) : 1;
+	ContourJob* jobs = (ContourJob*)rcAlloc(sizeof(ContourJob)*njobs, RC_ALLOC_TEMP);
+	if (!jobs)
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'jobs' (%d).", njobs);
+		return false;
+	}
+	for (int i = 0, reg = 0; i < njobs; ++i)
+	{
+		ContourJob* job = new (rcNewTag(), &jobs[i]) ContourJob;
+		job->firstReg = reg;
+		const int end = (int)((long long)nboundary*(i+1)/njobs);
+		while (reg < nregions && (regionFirst[reg+1] <= end || i == njobs-1))
+			reg++;
+		job->lastReg = reg;
+	}
+	
+	ContourBuild build;
+	build.ctx = ctx;
+	build.chf = &chf;
+	build.maxError = maxError;
+	build.maxEdgeLen = maxEdgeLen;
+	build.buildFlags = buildFlags;
+	build.timers = nthreads == 1;
+	build.flags = flags;
+	build.regionFirst = regionFirst;
+	build.boundarySpans = boundarySpans;
+	build.boundaryCells = boundaryCells;
+	build.jobs = jobs;
+	build.njobs = njobs;
+	build.holeRegions = 0;
+	build.nholeRegions = 0;
+	build.failed = false;
+	
+	runContourThreads(&build, buildContourJobs, rcMin(nthreads, njobs));
+	
+	// Store the contours in the order of the spans they were traced from, as a serial scan would.
+	int ncontours = 0;
+	for (int i = 0; i < njobs; ++i)
+		ncontours += jobs[i].conts.size();
+	
+	bool ok = !build.failed;
+	int maxContours = rcMax((int)chf.maxRegions, 8);
+	if (ncontours > maxContours)
+	{
+		// This happens when a region has holes.
+		ctx->log(RC_LOG_WARNING, "rcBuildContours: Expanding max contours from %d to %d.", maxContours, ncontours);
+		maxContours = ncontours;
+	}
+	cset.conts = ok ? (rcContour*)rcAlloc(sizeof(rcContour)*maxContours, RC_ALLOC_PERM) : 0;
+	cset.nconts = 0;
+	rcScopedDelete<ContourRef> refs(ok ? (ContourRef*)rcAlloc(sizeof(ContourRef)*rcMax(ncontours, 1), RC_ALLOC_TEMP) : 0);
+	if (ok && (!cset.conts || !refs))
+	{
+		ctx->log(RC_LOG_ERROR, "rcBuildContours: Out of memory 'conts' (%d).", maxContours);
+		ok = false;
+	}
+	int nrefs = 0;
+	for (int i = 0; i < njobs; ++i)
+	{
+		ContourJob& job = jobs[i];
+		for (int j = 0; j < job.conts.size(); ++j)
+		{
+			if (ok)
+			{
+				refs[nrefs].start = job.starts[j];
+				refs[nrefs].cont = &job.conts[j];
+				nrefs++;
+			}
+			else
+			{
+				rcFree(job.conts[j].verts);
+				rcFree(job.conts[j].rverts);
+			}
+		}
+	}
+	if (ok)
+	{
+		qsort(refs, nrefs, sizeof(ContourRef), compareContourRefs);
+		for (int i = 0; i < nrefs; ++i)
+			cset.conts[cset.nconts++] = *refs[i].cont;
+	}
+	for (int i = 0; i < njobs; ++i)
+		jobs[i].~ContourJob();
+	rcFree(jobs);
+	if (!ok)
+		return false;
+	
 	// Merge holes if needed.
 	if (cset.nconts > 0)
 	{
@@ -1028,7 +1245,6 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 		{
 			// Collect outline contour and holes contours per region.
 			// We assume that there is one outline and multiple holes.
-			const int nregions = chf.maxRegions+1;
 			rcScopedDelete<rcContourRegion> regions((rcContourRegion*)rcAlloc(sizeof(rcContourRegion)*nregions, RC_ALLOC_TEMP));
 			if (!regions)
 			{
@@ -1079,6 +1295,9 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 			}
 			
 			// Finally merge each regions holes into the outline.
+			// The regions do not share contours, so they are merged on the threads. Merging frees the
+			// contours, which must then happen on the calling thread if it allocated them from an arena.
+			int nmerge = 0;
 			for (int i = 0; i < nregions; i++)
 			{
 				rcContourRegion& reg = regions[i];
@@ -1086,7 +1305,7 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 				
 				if (reg.outline)
 				{
-					mergeRegionHoles(ctx, reg);
+					regions[nmerge++] = reg;
 				}
 				else
 				{
@@ -1096,6 +1315,10 @@ bool rcBuildContours(rcContext* ctx, const rcCompactHeightfield& chf,
 					ctx->log(RC_LOG_ERROR, "rcBuildContours: Bad outline for region %d, contour simplification is likely too aggressive.", i);
 				}
 			}
+			build.holeRegions = regions;
+			build.nholeRegions = nmerge;
+			const int nmergeThreads = rcScopedArena::current() ? 1 : rcMin(nthreads, nmerge);
+			runContourThreads(&build, mergeHoleJobs, nmergeThreads);
 		}
 		
 	}
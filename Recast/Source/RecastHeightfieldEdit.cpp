@@ -0,0 +1,365 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastAssert.h"
+#include "RecastSpanPool.h"
+
+/// Computes the columns covered by a bounding box, with a margin for the rounding of the rasterizer.
+static void calcColumnBounds(const rcHeightfield& heightfield, const float* minBounds, const float* maxBounds, int* bounds)
+{
+	const float inverseCellSize = 1.0f / heightfield.cs;
+	bounds[0] = rcMax((int)((minBounds[0] - heightfield.bmin[0]) * inverseCellSize) - 1, 0);
+	bounds[1] = rcMax((int)((minBounds[2] - heightfield.bmin[2]) * inverseCellSize) - 1, 0);
+	bounds[2] = rcMin((int)((maxBounds[0] - heightfield.bmin[0]) * inverseCellSize) + 1, heightfield.width - 1);
+	bounds[3] = rcMin((int)((maxBounds[2] - heightfield.bmin[2]) * inverseCellSize) + 1, heightfield.height - 1);
+}
+
+bool rcCopyHeightfield(rcContext* context, const rcHeightfield& source, rcHeightfield& dest)
+{
+	rcAssert(context);
+
+	if (!rcResetHeightfield(context, dest, source.width, source.height, source.bmin, source.bmax, source.cs, source.ch))
+	{
+		context->log(RC_LOG_ERROR, "rcCopyHeightfield: Out of memory 'spans' (%d).", source.width * source.height);
+		return false;
+	}
+
+	// The spans of a column neither overlap nor touch, so they are added back unmerged.
+	for (int z = 0; z < source.height; ++z)
+	{
+		for (int x = 0; x < source.width; ++x)
+		{
+			for (const rcSpan* span = source.spans[x + z * source.width]; span; span = span->next)
+			{
+				if (!rcAddSpan(context, dest, x, z, (unsigned short)span->smin, (unsigned short)span->smax, (unsigned char)span->area, 0))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool rcCreateEditableHeightfield(rcContext* context, rcEditableHeightfield& heightfield, int sizeX, int sizeZ,
+                                 const float* minBounds, const float* maxBounds,
+                                 float cellSize, float cellHeight, int flagMergeThreshold)
+{
+	rcAssert(context);
+
+	if (!rcResetHeightfield(context, heightfield.base, sizeX, sizeZ, minBounds, maxBounds, cellSize, cellHeight) ||
+		!rcResetHeightfield(context, heightfield.solid, sizeX, sizeZ, minBounds, maxBounds, cellSize, cellHeight) ||
+		!rcResetHeightfield(context, heightfield.scratch, sizeX, sizeZ, minBounds, maxBounds, cellSize, cellHeight))
+	{
+		context->log(RC_LOG_ERROR, "rcCreateEditableHeightfield: Out of memory 'spans' (%d).", sizeX * sizeZ);
+		return false;
+	}
+
+	for (int i = 0; i < heightfield.nmeshes; ++i)
+	{
+		rcFree(heightfield.meshes[i]->spans);
+		rcFree(heightfield.meshes[i]);
+	}
+	heightfield.nmeshes = 0;
+
+	rcFree(heightfield.dirty);
+	heightfield.dirty = (unsigned char*)rcAlloc(sizeof(unsigned char) * sizeX * sizeZ, RC_ALLOC_PERM);
+	if (!heightfield.dirty)
+	{
+		context->log(RC_LOG_ERROR, "rcCreateEditableHeightfield: Out of memory 'dirty' (%d).", sizeX * sizeZ);
+		return false;
+	}
+	heightfield.flagMergeThreshold = flagMergeThreshold;
+
+	// The static geometry is rasterized into the base heightfield next, compose all the columns on the first update.
+	memset(heightfield.dirty, 1, sizeof(unsigned char) * sizeX * sizeZ);
+	heightfield.dirtyBounds[0] = 0;
+	heightfield.dirtyBounds[1] = 0;
+	heightfield.dirtyBounds[2] = sizeX - 1;
+	heightfield.dirtyBounds[3] = sizeZ - 1;
+
+	return true;
+}
+
+void rcMarkEditableHeightfieldDirty(rcEditableHeightfield& heightfield, int minX, int minZ, int maxX, int maxZ)
+{
+	const int w = heightfield.base.width;
+	const int h = heightfield.base.height;
+	minX = rcMax(minX, 0);
+	minZ = rcMax(minZ, 0);
+	maxX = rcMin(maxX, w - 1);
+	maxZ = rcMin(maxZ, h - 1);
+	if (minX > maxX || minZ > maxZ)
+	{
+		return;
+	}
+
+	for (int z = minZ; z <= maxZ; ++z)
+	{
+		memset(&heightfield.dirty[minX + z * w], 1, maxX - minX + 1);
+	}
+
+	int* bounds = heightfield.dirtyBounds;
+	bounds[0] = rcMin(bounds[0], minX);
+	bounds[1] = rcMin(bounds[1], minZ);
+	bounds[2] = rcMax(bounds[2], maxX);
+	bounds[3] = rcMax(bounds[3], maxZ);
+}
+
+bool rcAddEditMesh(rcContext* context, rcEditableHeightfield& heightfield, unsigned int id,
+                   const float* verts, int numVerts,
+                   const int* tris, const unsigned char* triAreaIDs, int numTris)
+{
+	rcAssert(context);
+
+	for (int i = 0; i < heightfield.nmeshes; ++i)
+	{
+		if (heightfield.meshes[i]->id == id)
+		{
+			context->log(RC_LOG_ERROR, "rcAddEditMesh: Id %u is already in use.", id);
+			return false;
+		}
+	}
+
+	if (heightfield.nmeshes == heightfield.maxMeshes)
+	{
+		const int maxMeshes = rcMax(8, heightfield.maxMeshes * 2);
+		rcEditMesh** meshes = (rcEditMesh**)rcAlloc(sizeof(rcEditMesh*) * maxMeshes, RC_ALLOC_PERM);
+		if (!meshes)
+		{
+			context->log(RC_LOG_ERROR, "rcAddEditMesh: Out of memory 'meshes' (%d).", maxMeshes);
+			return false;
+		}
+		if (heightfield.nmeshes)
+		{
+			memcpy(meshes, heightfield.meshes, sizeof(rcEditMesh*) * heightfield.nmeshes);
+		}
+		rcFree(heightfield.meshes);
+		heightfield.meshes = meshes;
+		heightfield.maxMeshes = maxMeshes;
+	}
+
+	rcEditMesh* mesh = (rcEditMesh*)rcAlloc(sizeof(rcEditMesh), RC_ALLOC_PERM);
+	if (!mesh)
+	{
+		context->log(RC_LOG_ERROR, "rcAddEditMesh: Out of memory 'mesh'.");
+		return false;
+	}
+	mesh->id = id;
+	mesh->spans = NULL;
+	mesh->nspans = 0;
+
+	rcHeightfield& scratch = heightfield.scratch;
+	const int w = scratch.width;
+	const int h = scratch.height;
+
+	int* bounds = mesh->bounds;
+	bounds[0] = w;
+	bounds[1] = h;
+	bounds[2] = -1;
+	bounds[3] = -1;
+	if (numVerts > 0 && numTris > 0)
+	{
+		float meshMin[3], meshMax[3];
+		rcCalcBounds(verts, numVerts, meshMin, meshMax);
+		calcColumnBounds(scratch, meshMin, meshMax, bounds);
+	}
+
+	// The triangles are rasterized one by one and their spans are kept unmerged, in the order of the
+	// triangles. Merging the spans of a set beforehand would not give the same areas as merging each
+	// triangle over the spans below it, since the merge of the areas depends on the order of the spans.
+	bool ok = true;
+	int maxSpans = 0;
+	for (int i = 0; ok && i < numTris && bounds[0] <= bounds[2] && bounds[1] <= bounds[3]; ++i)
+	{
+		const float* v0 = &verts[tris[i * 3 + 0] * 3];
+		const float* v1 = &verts[tris[i * 3 + 1] * 3];
+		const float* v2 = &verts[tris[i * 3 + 2] * 3];
+		float triMin[3], triMax[3];
+		rcVcopy(triMin, v0);
+		rcVmin(triMin, v1);
+		rcVmin(triMin, v2);
+		rcVcopy(triMax, v0);
+		rcVmax(triMax, v1);
+		rcVmax(triMax, v2);
+		int triBounds[4];
+		calcColumnBounds(scratch, triMin, triMax, triBounds);
+		if (triBounds[0] > triBounds[2] || triBounds[1] > triBounds[3])
+		{
+			continue;
+		}
+
+		ok = rcRasterizeTriangle(context, v0, v1, v2, triAreaIDs[i], scratch, heightfield.flagMergeThreshold);
+
+		// Move the spans out of the scratch heightfield, leaving it empty for the next triangle.
+		for (int z = triBounds[1]; z <= triBounds[3]; ++z)
+		{
+			for (int x = triBounds[0]; x <= triBounds[2]; ++x)
+			{
+				const int columnIndex = x + z * w;
+				for (const rcSpan* span = scratch.spans[columnIndex]; ok && span; span = span->next)
+				{
+					if (mesh->nspans == maxSpans)
+					{
+						maxSpans = rcMax(64, maxSpans * 2);
+						rcEditSpan* spans = (rcEditSpan*)rcAlloc(sizeof(rcEditSpan) * maxSpans, RC_ALLOC_PERM);
+						if (!spans)
+						{
+							context->log(RC_LOG_ERROR, "rcAddEditMesh: Out of memory 'spans' (%d).", maxSpans);
+							ok = false;
+							break;
+						}
+						if (mesh->nspans)
+						{
+							memcpy(spans, mesh->spans, sizeof(rcEditSpan) * mesh->nspans);
+						}
+						rcFree(mesh->spans);
+						mesh->spans = spans;
+					}
+					rcEditSpan& s = mesh->spans[mesh->nspans++];
+					s.x = (unsigned short)x;
+					s.z = (unsigned short)z;
+					s.smin = (unsigned short)span->smin;
+					s.smax = (unsigned short)span->smax;
+					s.area = (unsigned char)span->area;
+				}
+				rcFreeColumnSpans(scratch, columnIndex);
+			}
+		}
+	}
+
+	if (!ok)
+	{
+		rcFree(mesh->spans);
+		rcFree(mesh);
+		return false;
+	}
+
+	heightfield.meshes[heightfield.nmeshes++] = mesh;
+	rcMarkEditableHeightfieldDirty(heightfield, bounds[0], bounds[1], bounds[2], bounds[3]);
+
+	return true;
+}
+
+bool rcRemoveEditMesh(rcEditableHeightfield& heightfield, unsigned int id)
+{
+	for (int i = 0; i < heightfield.nmeshes; ++i)
+	{
+		rcEditMesh* mesh = heightfield.meshes[i];
+		if (mesh->id != id)
+		{
+			continue;
+		}
+
+		rcMarkEditableHeightfieldDirty(heightfield, mesh->bounds[0], mesh->bounds[1], mesh->bounds[2], mesh->bounds[3]);
+		rcFree(mesh->spans);
+		rcFree(mesh);
+
+		// Keep the order of the remaining triangle sets, it defines how their spans are merged.
+		heightfield.nmeshes--;
+		for (int j = i; j < heightfield.nmeshes; ++j)
+		{
+			heightfield.meshes[j] = heightfield.meshes[j + 1];
+		}
+		return true;
+	}
+	return false;
+}
+
+bool rcUpdateEditableHeightfield(rcContext* context, rcEditableHeightfield& heightfield, int* dirtyBounds)
+{
+	rcAssert(context);
+
+	int* bounds = heightfield.dirtyBounds;
+	if (dirtyBounds)
+	{
+		memcpy(dirtyBounds, bounds, sizeof(int) * 4);
+	}
+	if (bounds[0] > bounds[2] || bounds[1] > bounds[3])
+	{
+		return true;
+	}
+
+	rcScopedTimer timer(context, RC_TIMER_RASTERIZE_TRIANGLES);
+
+	const rcHeightfield& base = heightfield.base;
+	rcHeightfield& solid = heightfield.solid;
+	const unsigned char* dirty = heightfield.dirty;
+	const int w = solid.width;
+	const int threshold = heightfield.flagMergeThreshold;
+
+	// Start the dirty columns over from the static geometry.
+	for (int z = bounds[1]; z <= bounds[3]; ++z)
+	{
+		for (int x = bounds[0]; x <= bounds[2]; ++x)
+		{
+			const int columnIndex = x + z * w;
+			if (!dirty[columnIndex])
+			{
+				continue;
+			}
+			rcFreeColumnSpans(solid, columnIndex);
+			for (const rcSpan* span = base.spans[columnIndex]; span; span = span->next)
+			{
+				if (!rcAddSpan(context, solid, x, z, (unsigned short)span->smin, (unsigned short)span->smax, (unsigned char)span->area, threshold))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// Then merge the spans of the triangles in the order they were rasterized, as if they were rasterized after the
+	// static geometry.
+	for (int i = 0; i < heightfield.nmeshes; ++i)
+	{
+		const rcEditMesh* mesh = heightfield.meshes[i];
+		if (mesh->bounds[0] > bounds[2] || mesh->bounds[2] < bounds[0] ||
+			mesh->bounds[1] > bounds[3] || mesh->bounds[3] < bounds[1])
+		{
+			continue;
+		}
+		for (int j = 0; j < mesh->nspans; ++j)
+		{
+			const rcEditSpan& span = mesh->spans[j];
+			if (!dirty[span.x + span.z * w])
+			{
+				continue;
+			}
+			if (!rcAddSpan(context, solid, span.x, span.z, span.smin, span.smax, span.area, threshold))
+			{
+				return false;
+			}
+		}
+	}
+
+	for (int z = bounds[1]; z <= bounds[3]; ++z)
+	{
+		memset(&heightfield.dirty[bounds[0] + z * w], 0, bounds[2] - bounds[0] + 1);
+	}
+	bounds[0] = w;
+	bounds[1] = solid.height;
+	bounds[2] = -1;
+	bounds[3] = -1;
+
+	return true;
+}
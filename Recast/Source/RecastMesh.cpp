@@ -123,20 +123,30 @@ static bool buildMeshAdjacency(unsigned short* polys, const int npolys,
 
 
 static const int VERTEX_BUCKET_COUNT = (1<<12);
+static const int MAX_VERTEX_BUCKET_COUNT = (1<<16);
 
-inline int computeVertexHash(int x, int y, int z)
+// Returns the number of hash buckets for the specified number of vertices, a power of two.
+static int calcVertexBucketCount(const int nverts)
+{
+	int count = VERTEX_BUCKET_COUNT;
+	while (count < nverts && count < MAX_VERTEX_BUCKET_COUNT)
+		count *= 2;
+	return count;
+}
+
+inline int computeVertexHash(int x, int y, int z, const int bucketCount)
 {
 	const unsigned int h1 = 0x8da6b343; // Large multiplicative constants;
 	const unsigned int h2 = 0xd8163841; // here arbitrarily chosen primes
 	const unsigned int h3 = 0xcb1ab31f;
 	unsigned int n = h1 * x + h2 * y + h3 * z;
-	return (int)(n & (VERTEX_BUCKET_COUNT-1));
+	return (int)(n & (bucketCount-1));
 }
 
 static unsigned short addVertex(unsigned short x, unsigned short y, unsigned short z,
-								unsigned short* verts, int* firstVert, int* nextVert, int& nv)
+								unsigned short* verts, int* firstVert, const int bucketCount, int* nextVert, int& nv)
 {
-	int bucket = computeVertexHash(x, 0, z);
+	int bucket = computeVertexHash(x, 0, z, bucketCount);
 	int i = firstVert[bucket];
 	
 	while (i != -1)
@@ -267,13 +277,8 @@ static bool diagonalie(int i, int j, int n, const int* verts, int* indices)
 
 // Returns true iff the diagonal (i,j) is strictly internal to the 
 // polygon P in the neighborhood of the i endpoint.
-static bool	inCone(int i, int j, int n, const int* verts, int* indices)
+static bool	inConePts(const int* pi, const int* pj, const int* pi1, const int* pin1)
 {
-	const int* pi = &verts[(indices[i] & 0x0fffffff) * 4];
-	const int* pj = &verts[(indices[j] & 0x0fffffff) * 4];
-	const int* pi1 = &verts[(indices[next(i, n)] & 0x0fffffff) * 4];
-	const int* pin1 = &verts[(indices[prev(i, n)] & 0x0fffffff) * 4];
-
 	// If P[i] is a convex vertex [ i+1 left or on (i-1,i) ].
 	if (leftOn(pin1, pi, pi1))
 		return left(pi, pj, pin1) && left(pj, pi, pi1);
@@ -282,6 +287,15 @@ static bool	inCone(int i, int j, int n, const int* verts, int* indices)
 	return !(leftOn(pi, pj, pi1) && leftOn(pj, pi, pin1));
 }
 
+static bool	inCone(int i, int j, int n, const int* verts, int* indices)
+{
+	const int* pi = &verts[(indices[i] & 0x0fffffff) * 4];
+	const int* pj = &verts[(indices[j] & 0x0fffffff) * 4];
+	const int* pi1 = &verts[(indices[next(i, n)] & 0x0fffffff) * 4];
+	const int* pin1 = &verts[(indices[prev(i, n)] & 0x0fffffff) * 4];
+	return inConePts(pi, pj, pi1, pin1);
+}
+
 // Returns T iff (v_i, v_j) is a proper internal
 // diagonal of P.
 static bool diagonal(int i, int j, int n, const int* verts, int* indices)
@@ -315,13 +329,8 @@ static bool diagonalieLoose(int i, int j, int n, const int* verts, int* indices)
 	return true;
 }
 
-static bool	inConeLoose(int i, int j, int n, const int* verts, int* indices)
+static bool	inConeLoosePts(const int* pi, const int* pj, const int* pi1, const int* pin1)
 {
-	const int* pi = &verts[(indices[i] & 0x0fffffff) * 4];
-	const int* pj = &verts[(indices[j] & 0x0fffffff) * 4];
-	const int* pi1 = &verts[(indices[next(i, n)] & 0x0fffffff) * 4];
-	const int* pin1 = &verts[(indices[prev(i, n)] & 0x0fffffff) * 4];
-	
 	// If P[i] is a convex vertex [ i+1 left or on (i-1,i) ].
 	if (leftOn(pin1, pi, pi1))
 		return leftOn(pi, pj, pin1) && leftOn(pj, pi, pi1);
@@ -330,6 +339,15 @@ static bool	inConeLoose(int i, int j, int n, const int* verts, int* indices)
 	return !(leftOn(pi, pj, pi1) && leftOn(pj, pi, pin1));
 }
 
+static bool	inConeLoose(int i, int j, int n, const int* verts, int* indices)
+{
+	const int* pi = &verts[(indices[i] & 0x0fffffff) * 4];
+	const int* pj = &verts[(indices[j] & 0x0fffffff) * 4];
+	const int* pi1 = &verts[(indices[next(i, n)] & 0x0fffffff) * 4];
+	const int* pin1 = &verts[(indices[prev(i, n)] & 0x0fffffff) * 4];
+	return inConeLoosePts(pi, pj, pi1, pin1);
+}
+
 static bool diagonalLoose(int i, int j, int n, const int* verts, int* indices)
 {
 	return inConeLoose(i, j, n, verts, indices) && diagonalieLoose(i, j, n, verts, indices);
@@ -450,6 +468,301 @@ static int triangulate(int n, const int* verts, int* indices, int* tris)
 	return ntris;
 }
 
+// Contours with more vertices than this are triangulated with triangulateLarge().
+static const int RC_LARGE_CONTOUR_VERTS = 64;
+
+namespace
+{
+/// An edge of the remaining polygon, stored in the grid cells its bounds overlap.
+/// The edge is gone once the next vertex of @p a is not @p b.
+struct EarClipEdge
+{
+	int a, b;
+	int next;
+};
+
+/// An ear of the remaining polygon, ordered like triangulate() picks them:
+/// shortest diagonal first, then lowest index of the vertex before the ear.
+struct EarClipCandidate
+{
+	int len;
+	int prev;
+	int vert;
+	unsigned int version;
+};
+
+/// Scratch data of triangulateLarge().
+struct EarClipper
+{
+	rcTempVector<int> nextVert;		///< The next vertex of the remaining polygon, or -1 when clipped.
+	rcTempVector<int> prevVert;
+	rcTempVector<unsigned char> ears;
+	rcTempVector<unsigned int> versions;
+	rcTempVector<EarClipCandidate> heap;
+	rcTempVector<int> cells;
+	rcTempVector<EarClipEdge> edges;
+	int minx, minz;
+	int cellSize;
+	int gridWidth, gridHeight;
+};
+
+inline bool earBefore(const EarClipCandidate& a, const EarClipCandidate& b)
+{
+	return a.len < b.len || (a.len == b.len && a.prev < b.prev);
+}
+}
+
+static void pushEar(EarClipper& ec, const EarClipCandidate& ear)
+{
+	rcTempVector<EarClipCandidate>& heap = ec.heap;
+	int i = heap.size();
+	heap.push_back(ear);
+	while (i > 0)
+	{
+		const int parent = (i-1)/2;
+		if (!earBefore(ear, heap[parent]))
+			break;
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = ear;
+}
+
+static void popEar(EarClipper& ec)
+{
+	rcTempVector<EarClipCandidate>& heap = ec.heap;
+	const EarClipCandidate last = heap[heap.size()-1];
+	heap.pop_back();
+	const int n = heap.size();
+	int i = 0;
+	for (;;)
+	{
+		int child = i*2+1;
+		if (child >= n)
+			break;
+		if (child+1 < n && earBefore(heap[child+1], heap[child]))
+			child++;
+		if (!earBefore(heap[child], last))
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	if (n > 0)
+		heap[i] = last;
+}
+
+static void getEarClipCellRange(const EarClipper& ec, const int* p0, const int* p1, int& x0, int& z0, int& x1, int& z1)
+{
+	x0 = rcClamp((rcMin(p0[0], p1[0]) - ec.minx) / ec.cellSize, 0, ec.gridWidth-1);
+	x1 = rcClamp((rcMax(p0[0], p1[0]) - ec.minx) / ec.cellSize, 0, ec.gridWidth-1);
+	z0 = rcClamp((rcMin(p0[2], p1[2]) - ec.minz) / ec.cellSize, 0, ec.gridHeight-1);
+	z1 = rcClamp((rcMax(p0[2], p1[2]) - ec.minz) / ec.cellSize, 0, ec.gridHeight-1);
+}
+
+static void addEarClipEdge(EarClipper& ec, const int* verts, const int a, const int b)
+{
+	int x0, z0, x1, z1;
+	getEarClipCellRange(ec, &verts[a*4], &verts[b*4], x0, z0, x1, z1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			int& cell = ec.cells[x + z*ec.gridWidth];
+			EarClipEdge e;
+			e.a = a;
+			e.b = b;
+			e.next = cell;
+			cell = ec.edges.size();
+			ec.edges.push_back(e);
+		}
+	}
+}
+
+// Same as diagonalie(), or diagonalieLoose() when loose, using the grid to find the edges near the diagonal.
+static bool diagonalieLarge(const EarClipper& ec, const int i, const int j, const int* verts, const bool loose)
+{
+	const int* d0 = &verts[i*4];
+	const int* d1 = &verts[j*4];
+	
+	int x0, z0, x1, z1;
+	getEarClipCellRange(ec, d0, d1, x0, z0, x1, z1);
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			for (int k = ec.cells[x + z*ec.gridWidth]; k != -1; k = ec.edges[k].next)
+			{
+				const EarClipEdge& e = ec.edges[k];
+				if (ec.nextVert[e.a] != e.b)
+					continue;
+				// Skip edges incident to i or j
+				if (e.a == i || e.b == i || e.a == j || e.b == j)
+					continue;
+				const int* p0 = &verts[e.a*4];
+				const int* p1 = &verts[e.b*4];
+				
+				if (vequal(d0, p0) || vequal(d1, p0) || vequal(d0, p1) || vequal(d1, p1))
+					continue;
+				
+				if (loose ? intersectProp(d0, d1, p0, p1) : intersect(d0, d1, p0, p1))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Same as diagonal(), for the diagonal from vertex i to vertex j of the remaining polygon.
+static bool diagonalLarge(const EarClipper& ec, const int i, const int j, const int* verts)
+{
+	return inConePts(&verts[i*4], &verts[j*4], &verts[ec.nextVert[i]*4], &verts[ec.prevVert[i]*4]) &&
+		diagonalieLarge(ec, i, j, verts, false);
+}
+
+static int diagonalLength(const int* verts, const int a, const int b)
+{
+	const int dx = verts[b*4+0] - verts[a*4+0];
+	const int dy = verts[b*4+2] - verts[a*4+2];
+	return dx*dx + dy*dy;
+}
+
+// Updates the ear at vertex v, after its neighbours have changed.
+static void updateEar(EarClipper& ec, const int* verts, const int v)
+{
+	const int a = ec.prevVert[v];
+	const int b = ec.nextVert[v];
+	ec.versions[v]++;
+	ec.ears[v] = diagonalLarge(ec, a, b, verts) ? 1 : 0;
+	if (ec.ears[v])
+	{
+		EarClipCandidate ear;
+		ear.len = diagonalLength(verts, a, b);
+		ear.prev = a;
+		ear.vert = v;
+		ear.version = ec.versions[v];
+		pushEar(ec, ear);
+	}
+}
+
+// Triangulates a contour like triangulate(), with the same result. The ears are kept in a heap,
+// and the edges of the remaining polygon in a grid, so that large contours do not take quadratic time.
+// The vertices are clipped from a linked list; as in triangulate(), the vertex at index 0 is the
+// remaining vertex with the lowest index.
+static int triangulateLarge(EarClipper& ec, const int n, const int* verts, int* tris)
+{
+	ec.nextVert.resize(n);
+	ec.prevVert.resize(n);
+	ec.ears.resize(n);
+	ec.versions.resize(n);
+	ec.heap.clear();
+	ec.edges.clear();
+	
+	int minx = verts[0], maxx = verts[0];
+	int minz = verts[2], maxz = verts[2];
+	for (int i = 0; i < n; ++i)
+	{
+		ec.nextVert[i] = next(i, n);
+		ec.prevVert[i] = prev(i, n);
+		ec.versions[i] = 0;
+		minx = rcMin(minx, verts[i*4+0]);
+		maxx = rcMax(maxx, verts[i*4+0]);
+		minz = rcMin(minz, verts[i*4+2]);
+		maxz = rcMax(maxz, verts[i*4+2]);
+	}
+	
+	// About one edge per cell.
+	const int gridSize = rcMax(1, (int)sqrtf((float)n));
+	ec.minx = minx;
+	ec.minz = minz;
+	ec.cellSize = rcMax(1, (rcMax(maxx-minx, maxz-minz) + gridSize) / gridSize);
+	ec.gridWidth = (maxx-minx) / ec.cellSize + 1;
+	ec.gridHeight = (maxz-minz) / ec.cellSize + 1;
+	ec.cells.resize(ec.gridWidth*ec.gridHeight);
+	for (int i = 0; i < ec.gridWidth*ec.gridHeight; ++i)
+		ec.cells[i] = -1;
+	for (int i = 0; i < n; ++i)
+		addEarClipEdge(ec, verts, i, ec.nextVert[i]);
+	
+	for (int i = 0; i < n; i++)
+		updateEar(ec, verts, i);
+	
+	int ntris = 0;
+	int* dst = tris;
+	int first = 0;
+	for (int nleft = n; nleft > 3; --nleft)
+	{
+		// Find the ear with the shortest diagonal.
+		int ear = -1;
+		while (ec.heap.size() > 0)
+		{
+			const EarClipCandidate top = ec.heap[0];
+			popEar(ec);
+			if (ec.nextVert[top.vert] != -1 && ec.ears[top.vert] && ec.versions[top.vert] == top.version)
+			{
+				ear = top.vert;
+				break;
+			}
+		}
+		
+		if (ear == -1)
+		{
+			// We might get here because the contour has overlapping segments, see triangulate().
+			int minLen = -1;
+			int mini = -1;
+			int i = first;
+			for (int k = 0; k < nleft; ++k, i = ec.nextVert[i])
+			{
+				const int i1 = ec.nextVert[i];
+				const int i2 = ec.nextVert[i1];
+				if (inConeLoosePts(&verts[i*4], &verts[i2*4], &verts[i1*4], &verts[ec.prevVert[i]*4]) &&
+					diagonalieLarge(ec, i, i2, verts, true))
+				{
+					const int len = diagonalLength(verts, i, ec.nextVert[i2]);
+					if (minLen < 0 || len < minLen)
+					{
+						minLen = len;
+						mini = i;
+					}
+				}
+			}
+			if (mini == -1)
+			{
+				// The contour is messed up. This sometimes happens
+				// if the contour simplification is too aggressive.
+				return -ntris;
+			}
+			ear = ec.nextVert[mini];
+		}
+		
+		const int a = ec.prevVert[ear];
+		const int b = ec.nextVert[ear];
+		*dst++ = a;
+		*dst++ = ear;
+		*dst++ = b;
+		ntris++;
+		
+		// Clip the ear.
+		ec.nextVert[a] = b;
+		ec.prevVert[b] = a;
+		ec.nextVert[ear] = -1;
+		if (ear == first)
+			first = b;
+		addEarClipEdge(ec, verts, a, b);
+		
+		// Update diagonal flags.
+		updateEar(ec, verts, a);
+		updateEar(ec, verts, b);
+	}
+	
+	// Append the remaining triangle.
+	*dst++ = first;
+	*dst++ = ec.nextVert[first];
+	*dst++ = ec.nextVert[ec.nextVert[first]];
+	ntris++;
+	
+	return ntris;
+}
+
 static int countPolyVerts(const unsigned short* p, const int nvp)
 {
 	for (int i = 0; i < nvp; ++i)
@@ -548,6 +861,226 @@ static void mergePolyVerts(unsigned short* pa, unsigned short* pb, int ea, int e
 }
 
 
+namespace
+{
+/// A polygon using an edge.
+struct PolyEdgeUse
+{
+	int poly;
+	int next;
+};
+
+/// A pair of polygons which can be merged, ordered like the exhaustive search picks them:
+/// highest merge value first, then lowest polygon indices.
+struct PolyMergeCandidate
+{
+	int value;
+	int pa, pb;
+	unsigned int va, vb;
+};
+
+/// Scratch data of mergePolys().
+struct PolyMerger
+{
+	rcTempVector<unsigned int> keys;	///< Hash table of the edges, by vertex pair.
+	rcTempVector<int> firstUse;			///< The first polygon using each edge of the table.
+	rcTempVector<int> usedKeys;			///< The table entries in use.
+	rcTempVector<PolyEdgeUse> uses;
+	rcTempVector<unsigned int> versions;	///< Changed whenever the polygon at an index changes.
+	rcTempVector<PolyMergeCandidate> heap;
+};
+
+inline bool mergeBefore(const PolyMergeCandidate& a, const PolyMergeCandidate& b)
+{
+	if (a.value != b.value)
+		return a.value > b.value;
+	if (a.pa != b.pa)
+		return a.pa < b.pa;
+	return a.pb < b.pb;
+}
+}
+
+static void pushMergeCandidate(PolyMerger& pm, const PolyMergeCandidate& c)
+{
+	rcTempVector<PolyMergeCandidate>& heap = pm.heap;
+	int i = heap.size();
+	heap.push_back(c);
+	while (i > 0)
+	{
+		const int parent = (i-1)/2;
+		if (!mergeBefore(c, heap[parent]))
+			break;
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = c;
+}
+
+static void popMergeCandidate(PolyMerger& pm)
+{
+	rcTempVector<PolyMergeCandidate>& heap = pm.heap;
+	const PolyMergeCandidate last = heap[heap.size()-1];
+	heap.pop_back();
+	const int n = heap.size();
+	int i = 0;
+	for (;;)
+	{
+		int child = i*2+1;
+		if (child >= n)
+			break;
+		if (child+1 < n && mergeBefore(heap[child+1], heap[child]))
+			child++;
+		if (!mergeBefore(heap[child], last))
+			break;
+		heap[i] = heap[child];
+		i = child;
+	}
+	if (n > 0)
+		heap[i] = last;
+}
+
+// Returns the hash table entry of the edge between vertices a and b, adding it if needed.
+static int findPolyEdge(PolyMerger& pm, unsigned short a, unsigned short b)
+{
+	if (a > b)
+		rcSwap(a, b);
+	const unsigned int key = ((unsigned int)a << 16) | b;
+	const int mask = pm.keys.size()-1;
+	int i = (int)((key * 0x9e3779b1u) >> 8) & mask;
+	while (pm.firstUse[i] != -1 && pm.keys[i] != key)
+		i = (i+1) & mask;
+	if (pm.firstUse[i] == -1)
+	{
+		pm.keys[i] = key;
+		pm.usedKeys.push_back(i);
+	}
+	return i;
+}
+
+static void addPolyEdges(PolyMerger& pm, const unsigned short* p, const int poly, const int nvp)
+{
+	const int n = countPolyVerts(p, nvp);
+	for (int i = 0; i < n; ++i)
+	{
+		const int e = findPolyEdge(pm, p[i], p[(i+1) % n]);
+		PolyEdgeUse use;
+		use.poly = poly;
+		use.next = pm.firstUse[e];
+		pm.firstUse[e] = pm.uses.size();
+		pm.uses.push_back(use);
+	}
+}
+
+// Changes the polygon index of the uses of the edges of polygon p.
+static void movePolyEdges(PolyMerger& pm, const unsigned short* p, const int from, const int to, const int nvp)
+{
+	const int n = countPolyVerts(p, nvp);
+	for (int i = 0; i < n; ++i)
+	{
+		const int e = findPolyEdge(pm, p[i], p[(i+1) % n]);
+		for (int u = pm.firstUse[e]; u != -1; u = pm.uses[u].next)
+		{
+			if (pm.uses[u].poly == from)
+				pm.uses[u].poly = to;
+		}
+	}
+}
+
+// Adds the merges of polygon j with its neighbours.
+static void pushPolyMerges(PolyMerger& pm, unsigned short* polys, const int j, const bool higherOnly,
+						   const unsigned short* verts, const int nvp)
+{
+	const unsigned short* p = &polys[j*nvp];
+	const int n = countPolyVerts(p, nvp);
+	for (int i = 0; i < n; ++i)
+	{
+		const int e = findPolyEdge(pm, p[i], p[(i+1) % n]);
+		for (int u = pm.firstUse[e]; u != -1; u = pm.uses[u].next)
+		{
+			const int k = pm.uses[u].poly;
+			if (k == j || (higherOnly && k < j))
+				continue;
+			PolyMergeCandidate c;
+			c.pa = rcMin(j, k);
+			c.pb = rcMax(j, k);
+			int ea, eb;
+			c.value = getPolyMergeValue(&polys[c.pa*nvp], &polys[c.pb*nvp], verts, ea, eb, nvp);
+			if (c.value <= 0)
+				continue;
+			c.va = pm.versions[c.pa];
+			c.vb = pm.versions[c.pb];
+			pushMergeCandidate(pm, c);
+		}
+	}
+}
+
+// Merges the polygons of a contour, with the same result as repeatedly merging the pair
+// with the highest merge value. The pairs are kept in a heap, and the polygons sharing an
+// edge are found with a hash table, so that large contours do not take cubic time.
+static void mergePolys(PolyMerger& pm, unsigned short* polys, int& npolys, const unsigned short* verts,
+					   unsigned short* tmpPoly, const int nvp)
+{
+	// Size the hash table for the edges of the polygons.
+	int tableSize = 64;
+	while (tableSize < npolys*3*2)
+		tableSize *= 2;
+	if (pm.keys.size() < tableSize)
+	{
+		pm.keys.resize(tableSize);
+		pm.firstUse.resize(tableSize);
+		for (int i = 0; i < tableSize; ++i)
+			pm.firstUse[i] = -1;
+	}
+	pm.uses.clear();
+	pm.heap.clear();
+	pm.versions.resize(npolys);
+	for (int i = 0; i < npolys; ++i)
+		pm.versions[i] = 0;
+	
+	for (int i = 0; i < npolys; ++i)
+		addPolyEdges(pm, &polys[i*nvp], i, nvp);
+	for (int i = 0; i < npolys; ++i)
+		pushPolyMerges(pm, polys, i, true, verts, nvp);
+	
+	while (pm.heap.size() > 0)
+	{
+		const PolyMergeCandidate best = pm.heap[0];
+		popMergeCandidate(pm);
+		if (pm.versions[best.pa] != best.va || pm.versions[best.pb] != best.vb)
+			continue;
+		
+		// Found best, merge.
+		unsigned short* pa = &polys[best.pa*nvp];
+		unsigned short* pb = &polys[best.pb*nvp];
+		int ea, eb;
+		getPolyMergeValue(pa, pb, verts, ea, eb, nvp);
+		movePolyEdges(pm, pb, best.pb, best.pa, nvp);
+		mergePolyVerts(pa, pb, ea, eb, tmpPoly, nvp);
+		pm.versions[best.pa]++;
+		
+		const int last = npolys-1;
+		if (best.pb != last)
+		{
+			unsigned short* lastPoly = &polys[last*nvp];
+			movePolyEdges(pm, lastPoly, last, best.pb, nvp);
+			memcpy(pb, lastPoly, sizeof(unsigned short)*nvp);
+			pm.versions[best.pb]++;
+		}
+		pm.versions[last]++;
+		npolys--;
+		
+		pushPolyMerges(pm, polys, best.pa, false, verts, nvp);
+		if (best.pb < npolys)
+			pushPolyMerges(pm, polys, best.pb, false, verts, nvp);
+	}
+	
+	// Clear the hash table for the next contour.
+	for (int i = 0; i < pm.usedKeys.size(); ++i)
+		pm.firstUse[pm.usedKeys[i]] = -1;
+	pm.usedKeys.clear();
+}
+
+
 static void pushFront(int v, int* arr, int& an)
 {
 	an++;
@@ -1069,13 +1602,14 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 	}
 	memset(nextVert, 0, sizeof(int)*maxVertices);
 	
-	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP));
+	const int bucketCount = calcVertexBucketCount(maxVertices);
+	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*bucketCount, RC_ALLOC_TEMP));
 	if (!firstVert)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'firstVert' (%d).", VERTEX_BUCKET_COUNT);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMesh: Out of memory 'firstVert' (%d).", bucketCount);
 		return false;
 	}
-	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
+	for (int i = 0; i < bucketCount; ++i)
 		firstVert[i] = -1;
 	
 	rcScopedDelete<int> indices((int*)rcAlloc(sizeof(int)*maxVertsPerCont, RC_ALLOC_TEMP));
@@ -1097,6 +1631,9 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		return false;
 	}
 	unsigned short* tmpPoly = &polys[maxVertsPerCont*nvp];
+	
+	EarClipper earClipper;
+	PolyMerger polyMerger;
 
 	for (int i = 0; i < cset.nconts; ++i)
 	{
@@ -1110,7 +1647,11 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		for (int j = 0; j < cont.nverts; ++j)
 			indices[j] = j;
 			
-		int ntris = triangulate(cont.nverts, cont.verts, &indices[0], &tris[0]);
+		int ntris;
+		if (cont.nverts > RC_LARGE_CONTOUR_VERTS)
+			ntris = triangulateLarge(earClipper, cont.nverts, cont.verts, &tris[0]);
+		else
+			ntris = triangulate(cont.nverts, cont.verts, &indices[0], &tris[0]);
 		if (ntris <= 0)
 		{
 			// Bad triangulation, should not happen.
@@ -1133,7 +1674,7 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		{
 			const int* v = &cont.verts[j*4];
 			indices[j] = addVertex((unsigned short)v[0], (unsigned short)v[1], (unsigned short)v[2],
-								   mesh.verts, firstVert, nextVert, mesh.nverts);
+								   mesh.verts, firstVert, bucketCount, nextVert, mesh.nverts);
 			if (v[3] & RC_BORDER_VERTEX)
 			{
 				// This vertex should be removed.
@@ -1160,50 +1701,7 @@ bool rcBuildPolyMesh(rcContext* ctx, const rcContourSet& cset, const int nvp, rc
 		
 		// Merge polygons.
 		if (nvp > 3)
-		{
-			for(;;)
-			{
-				// Find best polygons to merge.
-				int bestMergeVal = 0;
-				int bestPa = 0, bestPb = 0, bestEa = 0, bestEb = 0;
-				
-				for (int j = 0; j < npolys-1; ++j)
-				{
-					unsigned short* pj = &polys[j*nvp];
-					for (int k = j+1; k < npolys; ++k)
-					{
-						unsigned short* pk = &polys[k*nvp];
-						int ea, eb;
-						int v = getPolyMergeValue(pj, pk, mesh.verts, ea, eb, nvp);
-						if (v > bestMergeVal)
-						{
-							bestMergeVal = v;
-							bestPa = j;
-							bestPb = k;
-							bestEa = ea;
-							bestEb = eb;
-						}
-					}
-				}
-				
-				if (bestMergeVal > 0)
-				{
-					// Found best, merge.
-					unsigned short* pa = &polys[bestPa*nvp];
-					unsigned short* pb = &polys[bestPb*nvp];
-					mergePolyVerts(pa, pb, bestEa, bestEb, tmpPoly, nvp);
-					unsigned short* lastPoly = &polys[(npolys-1)*nvp];
-					if (pb != lastPoly)
-						memcpy(pb, lastPoly, sizeof(unsigned short)*nvp);
-					npolys--;
-				}
-				else
-				{
-					// Could not merge any polygons, stop.
-					break;
-				}
-			}
-		}
+			mergePolys(polyMerger, polys, npolys, mesh.verts, tmpPoly, nvp);
 		
 		// Store polygons.
 		for (int j = 0; j < npolys; ++j)
@@ -1382,13 +1880,14 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 	}
 	memset(nextVert, 0, sizeof(int)*maxVerts);
 	
-	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*VERTEX_BUCKET_COUNT, RC_ALLOC_TEMP));
+	const int bucketCount = calcVertexBucketCount(maxVerts);
+	rcScopedDelete<int> firstVert((int*)rcAlloc(sizeof(int)*bucketCount, RC_ALLOC_TEMP));
 	if (!firstVert)
 	{
-		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'firstVert' (%d).", VERTEX_BUCKET_COUNT);
+		ctx->log(RC_LOG_ERROR, "rcMergePolyMeshes: Out of memory 'firstVert' (%d).", bucketCount);
 		return false;
 	}
-	for (int i = 0; i < VERTEX_BUCKET_COUNT; ++i)
+	for (int i = 0; i < bucketCount; ++i)
 		firstVert[i] = -1;
 
 	rcScopedDelete<unsigned short> vremap((unsigned short*)rcAlloc(sizeof(unsigned short)*maxVertsPerMesh, RC_ALLOC_PERM));
@@ -1416,7 +1915,7 @@ bool rcMergePolyMeshes(rcContext* ctx, rcPolyMesh** meshes, const int nmeshes, r
 		{
 			unsigned short* v = &pmesh->verts[j*3];
 			vremap[j] = addVertex(v[0]+ox, v[1], v[2]+oz,
-								  mesh.verts, firstVert, nextVert, mesh.nverts);
+								  mesh.verts, firstVert, bucketCount, nextVert, mesh.nverts);
 		}
 		
 		for (int j = 0; j < pmesh->npolys; ++j)
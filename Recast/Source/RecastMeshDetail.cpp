@@ -21,6 +21,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <atomic>
+#include <thread>
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
@@ -531,6 +533,316 @@ static void delaunayHull(rcContext* ctx, const int npts, const float* pts,
 	}
 }
 
+static const int RC_DETAIL_MAX_VERTS = 127;
+static const int RC_DETAIL_MAX_TRIS = RC_DETAIL_MAX_VERTS*2;
+
+/// A Delaunay triangulation of the vertices of a detail mesh, with the adjacency of its triangles,
+/// which is updated as samples are added. The triangles all have the same winding, and the hull
+/// edges, which have no neighbour, are never flipped.
+struct rcDelaunayMesh
+{
+	int ntris;
+	int tris[RC_DETAIL_MAX_TRIS*3];	///< The vertices of the triangles.
+	int neis[RC_DETAIL_MAX_TRIS*3];	///< The neighbour across edge (tris[i], tris[next(i)]), or -1 on the hull.
+	float winding;					///< The sign of vcross2() for the triangles.
+	int changed[RC_DETAIL_MAX_TRIS];	///< The triangles changed by the last insertion.
+	int nchanged;
+	unsigned int stamp;				///< Used to list each changed triangle once.
+	unsigned int stamps[RC_DETAIL_MAX_TRIS];
+};
+
+inline int triEdgeNext(const int i) { return i == 2 ? 0 : i+1; }
+
+static float orientDetail(const rcDelaunayMesh& dm, const float* verts, const int a, const int b, const int c)
+{
+	return vcross2(&verts[a*3], &verts[b*3], &verts[c*3]) * dm.winding;
+}
+
+static void markDetailTriChanged(rcDelaunayMesh& dm, const int t)
+{
+	if (dm.stamps[t] != dm.stamp)
+	{
+		dm.stamps[t] = dm.stamp;
+		dm.changed[dm.nchanged++] = t;
+	}
+}
+
+/// Replaces the neighbour @p from of triangle @p t with @p to.
+static void replaceDetailNei(rcDelaunayMesh& dm, const int t, const int from, const int to)
+{
+	if (t < 0)
+		return;
+	int* n = &dm.neis[t*3];
+	for (int i = 0; i < 3; ++i)
+	{
+		if (n[i] == from)
+		{
+			n[i] = to;
+			return;
+		}
+	}
+}
+
+/// Builds the adjacency of a triangulation made by delaunayHull.
+/// @returns False if the triangulation is not a consistent triangulation of the hull.
+static bool initDelaunayMesh(rcDelaunayMesh& dm, const float* verts, const int nverts, const int nhull, const rcIntArray& tris)
+{
+	const int ntris = tris.size()/4;
+	if (ntris == 0 || ntris > RC_DETAIL_MAX_TRIS)
+		return false;
+	
+	dm.ntris = ntris;
+	dm.nchanged = 0;
+	dm.stamp = 0;
+	for (int i = 0; i < ntris; ++i)
+	{
+		dm.tris[i*3+0] = tris[i*4+0];
+		dm.tris[i*3+1] = tris[i*4+1];
+		dm.tris[i*3+2] = tris[i*4+2];
+		dm.stamps[i] = 0;
+	}
+	dm.winding = vcross2(&verts[dm.tris[0]*3], &verts[dm.tris[1]*3], &verts[dm.tris[2]*3]) > 0 ? 1.0f : -1.0f;
+	
+	// Link the corners of the triangles by vertex.
+	int firstCorner[RC_DETAIL_MAX_VERTS];
+	int nextCorner[RC_DETAIL_MAX_TRIS*3];
+	for (int i = 0; i < nverts; ++i)
+		firstCorner[i] = -1;
+	for (int i = 0; i < ntris*3; ++i)
+	{
+		const int v = dm.tris[i];
+		nextCorner[i] = firstCorner[v];
+		firstCorner[v] = i;
+	}
+	
+	int nhullEdges = 0;
+	for (int i = 0; i < ntris; ++i)
+	{
+		if (orientDetail(dm, verts, dm.tris[i*3+0], dm.tris[i*3+1], dm.tris[i*3+2]) <= 0)
+			return false;
+		for (int j = 0; j < 3; ++j)
+		{
+			// The neighbour has the edge in the opposite direction.
+			const int a = dm.tris[i*3+j];
+			const int b = dm.tris[i*3+triEdgeNext(j)];
+			int nei = -1;
+			for (int c = firstCorner[b]; c != -1; c = nextCorner[c])
+			{
+				const int t = c/3;
+				if (dm.tris[t*3+triEdgeNext(c%3)] == a)
+				{
+					if (nei != -1)
+						return false;
+					nei = t;
+				}
+			}
+			dm.neis[i*3+j] = nei;
+			if (nei == -1)
+				nhullEdges++;
+		}
+	}
+	
+	return nhullEdges == nhull;
+}
+
+/// Flips the edges around vertex @p p which are not locally Delaunay.
+/// @param[in]	stack	Triangles with @p p as third vertex, whose first edge must be checked.
+static void legalizeDelaunayMesh(rcDelaunayMesh& dm, const float* verts, const int p, int* stack, int nstack)
+{
+	static const int MAX_FLIPS = RC_DETAIL_MAX_TRIS*4;
+	int nflips = 0;
+	while (nstack > 0 && nflips < MAX_FLIPS)
+	{
+		const int x = stack[--nstack];
+		int* xt = &dm.tris[x*3];
+		int* xn = &dm.neis[x*3];
+		rcAssert(xt[2] == p);
+		const int q = xn[0];
+		if (q < 0)
+			continue;
+		
+		// Find the edge (v1,v0) in the neighbour, and the vertex d opposite to it.
+		const int v0 = xt[0];
+		const int v1 = xt[1];
+		const int* qt = &dm.tris[q*3];
+		int k = 0;
+		while (k < 3 && !(qt[k] == v1 && qt[triEdgeNext(k)] == v0))
+			k++;
+		if (k == 3)
+			continue;
+		const int kd = triEdgeNext(triEdgeNext(k));
+		const int d = qt[kd];
+		
+		// Flip if d is inside the circumcircle of x, and the new triangles are valid.
+		float c[3], r;
+		const bool valid = circumCircle(&verts[v0*3], &verts[v1*3], &verts[p*3], c, r);
+		if (valid && vdist2(c, &verts[d*3]) >= r*(1-0.001f))
+			continue;
+		if (orientDetail(dm, verts, v0, d, p) <= 0 || orientDetail(dm, verts, d, v1, p) <= 0)
+			continue;
+		
+		const int nqa = dm.neis[q*3+triEdgeNext(k)];	// Across (v0,d).
+		const int nqb = dm.neis[q*3+kd];				// Across (d,v1).
+		const int nx1 = xn[1];							// Across (v1,p).
+		const int nx2 = xn[2];							// Across (p,v0).
+		
+		// x = (v0,d,p), q = (d,v1,p).
+		xt[0] = v0; xt[1] = d; xt[2] = p;
+		xn[0] = nqa; xn[1] = q; xn[2] = nx2;
+		int* qtw = &dm.tris[q*3];
+		int* qn = &dm.neis[q*3];
+		qtw[0] = d; qtw[1] = v1; qtw[2] = p;
+		qn[0] = nqb; qn[1] = nx1; qn[2] = x;
+		replaceDetailNei(dm, nqa, q, x);
+		replaceDetailNei(dm, nx1, x, q);
+		
+		markDetailTriChanged(dm, x);
+		markDetailTriChanged(dm, q);
+		stack[nstack++] = x;
+		stack[nstack++] = q;
+		nflips++;
+	}
+}
+
+/// Adds vertex @p p, inside triangle @p t, to the triangulation.
+/// @returns False if there is no room for the new triangles, or the vertex would create degenerate ones.
+static bool insertDelaunayVertex(rcDelaunayMesh& dm, const float* verts, const int p, const int t)
+{
+	if (dm.ntris+3 > RC_DETAIL_MAX_TRIS)
+		return false;
+	
+	dm.stamp++;
+	dm.nchanged = 0;
+	
+	int stack[RC_DETAIL_MAX_TRIS*4+8];
+	int nstack = 0;
+	
+	// Find whether the vertex lies on an edge of the triangle.
+	const int* tt = &dm.tris[t*3];
+	const float area = orientDetail(dm, verts, tt[0], tt[1], tt[2]);
+	int onEdge = -1;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (dm.neis[t*3+i] >= 0 && orientDetail(dm, verts, tt[i], tt[triEdgeNext(i)], p) <= area*1e-4f)
+		{
+			onEdge = i;
+			break;
+		}
+	}
+	
+	if (onEdge == -1)
+	{
+		// Split the triangle in three.
+		const int a = tt[0], b = tt[1], c = tt[2];
+		if (orientDetail(dm, verts, a, b, p) <= 0 || orientDetail(dm, verts, b, c, p) <= 0 || orientDetail(dm, verts, c, a, p) <= 0)
+			return false;
+		const int nab = dm.neis[t*3+0], nbc = dm.neis[t*3+1], nca = dm.neis[t*3+2];
+		const int t1 = dm.ntris++;
+		const int t2 = dm.ntris++;
+		dm.stamps[t1] = dm.stamps[t2] = 0;
+		
+		int* v = &dm.tris[t*3];
+		int* n = &dm.neis[t*3];
+		v[0] = a; v[1] = b; v[2] = p;
+		n[0] = nab; n[1] = t1; n[2] = t2;
+		v = &dm.tris[t1*3];
+		n = &dm.neis[t1*3];
+		v[0] = b; v[1] = c; v[2] = p;
+		n[0] = nbc; n[1] = t2; n[2] = t;
+		v = &dm.tris[t2*3];
+		n = &dm.neis[t2*3];
+		v[0] = c; v[1] = a; v[2] = p;
+		n[0] = nca; n[1] = t; n[2] = t1;
+		replaceDetailNei(dm, nbc, t, t1);
+		replaceDetailNei(dm, nca, t, t2);
+		
+		markDetailTriChanged(dm, t);
+		markDetailTriChanged(dm, t1);
+		markDetailTriChanged(dm, t2);
+		stack[nstack++] = t;
+		stack[nstack++] = t1;
+		stack[nstack++] = t2;
+	}
+	else
+	{
+		// Split the triangle and its neighbour across the edge in two.
+		const int a = tt[onEdge];
+		const int b = tt[triEdgeNext(onEdge)];
+		const int c = tt[triEdgeNext(triEdgeNext(onEdge))];
+		const int nbc = dm.neis[t*3+triEdgeNext(onEdge)];
+		const int nca = dm.neis[t*3+triEdgeNext(triEdgeNext(onEdge))];
+		const int u = dm.neis[t*3+onEdge];
+		const int* ut = &dm.tris[u*3];
+		int k = 0;
+		while (k < 3 && !(ut[k] == b && ut[triEdgeNext(k)] == a))
+			k++;
+		if (k == 3)
+			return false;
+		const int d = ut[triEdgeNext(triEdgeNext(k))];
+		if (orientDetail(dm, verts, c, a, p) <= 0 || orientDetail(dm, verts, b, c, p) <= 0 ||
+			orientDetail(dm, verts, a, d, p) <= 0 || orientDetail(dm, verts, d, b, p) <= 0)
+			return false;
+		const int nad = dm.neis[u*3+triEdgeNext(k)];
+		const int ndb = dm.neis[u*3+triEdgeNext(triEdgeNext(k))];
+		const int t1 = dm.ntris++;
+		const int u1 = dm.ntris++;
+		dm.stamps[t1] = dm.stamps[u1] = 0;
+		
+		int* v = &dm.tris[t*3];
+		int* n = &dm.neis[t*3];
+		v[0] = c; v[1] = a; v[2] = p;
+		n[0] = nca; n[1] = u; n[2] = t1;
+		v = &dm.tris[t1*3];
+		n = &dm.neis[t1*3];
+		v[0] = b; v[1] = c; v[2] = p;
+		n[0] = nbc; n[1] = t; n[2] = u1;
+		v = &dm.tris[u*3];
+		n = &dm.neis[u*3];
+		v[0] = a; v[1] = d; v[2] = p;
+		n[0] = nad; n[1] = u1; n[2] = t;
+		v = &dm.tris[u1*3];
+		n = &dm.neis[u1*3];
+		v[0] = d; v[1] = b; v[2] = p;
+		n[0] = ndb; n[1] = t1; n[2] = u;
+		replaceDetailNei(dm, nbc, t, t1);
+		replaceDetailNei(dm, ndb, u, u1);
+		
+		markDetailTriChanged(dm, t);
+		markDetailTriChanged(dm, t1);
+		markDetailTriChanged(dm, u);
+		markDetailTriChanged(dm, u1);
+		stack[nstack++] = t;
+		stack[nstack++] = t1;
+		stack[nstack++] = u;
+		stack[nstack++] = u1;
+	}
+	
+	legalizeDelaunayMesh(dm, verts, p, stack, nstack);
+	return true;
+}
+
+/// Finds the triangle under a sample point.
+/// @returns The distance to the triangle along the y-axis, or -1 if no triangle was found.
+static float distToDelaunayMesh(const rcDelaunayMesh& dm, const float* verts, const float* p,
+								const int* candidates, const int ncandidates, int& tri)
+{
+	float dmin = FLT_MAX;
+	tri = -1;
+	for (int i = 0; i < ncandidates; ++i)
+	{
+		const int t = candidates ? candidates[i] : i;
+		const int* v = &dm.tris[t*3];
+		const float d = distPtTri(p, &verts[v[0]*3], &verts[v[1]*3], &verts[v[2]*3]);
+		if (d < dmin)
+		{
+			dmin = d;
+			tri = t;
+		}
+	}
+	if (dmin == FLT_MAX) return -1;
+	return dmin;
+}
+
 // Calculate minimum extend of the polygon.
 static float polyMinExtent(const float* verts, const int nverts)
 {
@@ -674,7 +986,7 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 							const rcHeightPatch& hp, float* verts, int& nverts,
 							rcIntArray& tris, rcIntArray& edges, rcIntArray& samples)
 {
-	static const int MAX_VERTS = 127;
+	static const int MAX_VERTS = RC_DETAIL_MAX_VERTS;
 	static const int MAX_TRIS = 255;	// Max tris for delaunay is 2n-2-k (n=num verts, k=num hull verts).
 	static const int MAX_VERTS_PER_EDGE = 32;
 	float edge[(MAX_VERTS_PER_EDGE+1)*3];
@@ -858,7 +1170,17 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 		// Add the samples starting from the one that has the most
 		// error. The procedure stops when all samples are added
 		// or when the max error is within treshold.
+		// After the first sample, the triangulation is updated incrementally,
+		// and the error of a sample is only recalculated when the triangle
+		// under it has changed.
 		const int nsamples = samples.size()/4;
+		rcTempVector<float> sampleErrors;
+		rcTempVector<int> sampleTris;
+		sampleErrors.resize(nsamples);
+		sampleTris.resize(nsamples);
+		rcDelaunayMesh dmesh;
+		bool incremental = false;
+		bool recalcAll = true;
 		for (int iter = 0; iter < nsamples; ++iter)
 		{
 			if (nverts >= MAX_VERTS)
@@ -878,7 +1200,24 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 				pt[0] = s[0]*sampleDist + getJitterX(i)*cs*0.1f;
 				pt[1] = s[1]*chf.ch;
 				pt[2] = s[2]*sampleDist + getJitterY(i)*cs*0.1f;
-				float d = distToTriMesh(pt, verts, nverts, &tris[0], tris.size()/4);
+				float d;
+				if (!incremental)
+				{
+					d = distToTriMesh(pt, verts, nverts, &tris[0], tris.size()/4);
+				}
+				else if (!recalcAll && sampleTris[i] >= 0 && dmesh.stamps[sampleTris[i]] != dmesh.stamp)
+				{
+					d = sampleErrors[i];
+				}
+				else
+				{
+					d = -1;
+					if (!recalcAll && sampleTris[i] >= 0)
+						d = distToDelaunayMesh(dmesh, verts, pt, dmesh.changed, dmesh.nchanged, sampleTris[i]);
+					if (d < 0)
+						d = distToDelaunayMesh(dmesh, verts, pt, 0, dmesh.ntris, sampleTris[i]);
+					sampleErrors[i] = d;
+				}
 				if (d < 0) continue; // did not hit the mesh.
 				if (d > bestd)
 				{
@@ -887,6 +1226,7 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 					rcVcopy(bestpt,pt);
 				}
 			}
+			recalcAll = false;
 			// If the max error is within accepted threshold, stop tesselating.
 			if (bestd <= sampleMaxError || besti == -1)
 				break;
@@ -896,11 +1236,28 @@ static bool buildPolyDetail(rcContext* ctx, const float* in, const int nin,
 			rcVcopy(&verts[nverts*3],bestpt);
 			nverts++;
 			
-			// Create new triangulation.
-			// TODO: Incremental add instead of full rebuild.
+			// Update the triangulation.
+			if (incremental && insertDelaunayVertex(dmesh, verts, nverts-1, sampleTris[besti]))
+				continue;
+			
+			// Create new triangulation, and continue incrementally from it.
 			edges.clear();
 			tris.clear();
 			delaunayHull(ctx, nverts, verts, nhull, hull, tris, edges);
+			incremental = initDelaunayMesh(dmesh, verts, nverts, nhull, tris);
+			recalcAll = true;
+		}
+		
+		if (incremental)
+		{
+			tris.resize(dmesh.ntris*4);
+			for (int i = 0; i < dmesh.ntris; ++i)
+			{
+				tris[i*4+0] = dmesh.tris[i*3+0];
+				tris[i*4+1] = dmesh.tris[i*3+1];
+				tris[i*4+2] = dmesh.tris[i*3+2];
+				tris[i*4+3] = 0;
+			}
 		}
 	}
 	
@@ -1174,14 +1531,151 @@ static void getHeightData(rcContext* ctx, const rcCompactHeightfield& chf,
 	}
 }
 
+namespace
+{
+/// The detail meshes of a range of polygons, built by one thread before being concatenated.
+struct DetailMeshJob
+{
+	int firstPoly;
+	int lastPoly;
+	rcTempVector<float> verts;
+	rcTempVector<unsigned char> tris;
+};
+
+/// The state shared by the threads building the detail meshes.
+struct DetailMeshBuild
+{
+	rcContext* ctx;
+	const rcPolyMesh* mesh;
+	const rcCompactHeightfield* chf;
+	float sampleDist;
+	float sampleMaxError;
+	int heightSearchRadius;
+	const int* bounds;
+	int maxhw, maxhh;
+	unsigned int* meshes;
+	DetailMeshJob* jobs;
+	int njobs;
+	std::atomic<int> nextJob;
+	std::atomic<bool> failed;
+};
+
+/// Builds the detail meshes of the polygons of a job, storing their vertex and triangle offsets
+/// relative to the job.
+bool buildDetailMeshJob(DetailMeshBuild& build, DetailMeshJob& job,
+						rcHeightPatch& hp, float* poly, float* verts,
+						rcIntArray& edges, rcIntArray& tris, rcIntArray& arr, rcIntArray& samples)
+{
+	rcContext* ctx = build.ctx;
+	const rcPolyMesh& mesh = *build.mesh;
+	const rcCompactHeightfield& chf = *build.chf;
+	const int* bounds = build.bounds;
+	const int nvp = mesh.nvp;
+	const float cs = mesh.cs;
+	const float ch = mesh.ch;
+	const float* orig = mesh.bmin;
+
+	for (int i = job.firstPoly; i < job.lastPoly; ++i)
+	{
+		const unsigned short* p = &mesh.polys[i*nvp*2];
+		
+		// Store polygon vertices for processing.
+		int npoly = 0;
+		for (int j = 0; j < nvp; ++j)
+		{
+			if(p[j] == RC_MESH_NULL_IDX) break;
+			const unsigned short* v = &mesh.verts[p[j]*3];
+			poly[j*3+0] = v[0]*cs;
+			poly[j*3+1] = v[1]*ch;
+			poly[j*3+2] = v[2]*cs;
+			npoly++;
+		}
+		
+		// Get the height data from the area of the polygon.
+		hp.xmin = bounds[i*4+0];
+		hp.ymin = bounds[i*4+2];
+		hp.width = bounds[i*4+1]-bounds[i*4+0];
+		hp.height = bounds[i*4+3]-bounds[i*4+2];
+		getHeightData(ctx, chf, p, npoly, mesh.verts, mesh.borderSize, hp, arr, mesh.regs[i]);
+		
+		// Build detail mesh.
+		int nverts = 0;
+		if (!buildPolyDetail(ctx, poly, npoly,
+							 build.sampleDist, build.sampleMaxError,
+							 build.heightSearchRadius, chf, hp,
+							 verts, nverts, tris,
+							 edges, samples))
+		{
+			return false;
+		}
+		
+		// Move detail verts to world space.
+		for (int j = 0; j < nverts; ++j)
+		{
+			verts[j*3+0] += orig[0];
+			verts[j*3+1] += orig[1] + chf.ch; // Is this offset necessary?
+			verts[j*3+2] += orig[2];
+		}
+		
+		// Store detail submesh.
+		const int ntris = tris.size()/4;
+		
+		build.meshes[i*4+0] = (unsigned int)(job.verts.size()/3);
+		build.meshes[i*4+1] = (unsigned int)nverts;
+		build.meshes[i*4+2] = (unsigned int)(job.tris.size()/4);
+		build.meshes[i*4+3] = (unsigned int)ntris;
+		
+		for (int j = 0; j < nverts*3; ++j)
+			job.verts.push_back(verts[j]);
+		for (int j = 0; j < ntris*4; ++j)
+			job.tris.push_back((unsigned char)tris[j]);
+	}
+	
+	return true;
+}
+
+/// Builds the jobs, taken in turn by each thread.
+void buildDetailMeshJobs(DetailMeshBuild* build)
+{
+	rcIntArray edges(64);
+	rcIntArray tris(512);
+	rcIntArray arr(512);
+	rcIntArray samples(512);
+	float verts[256*3];
+	rcHeightPatch hp;
+	
+	hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*build->maxhw*build->maxhh, RC_ALLOC_TEMP);
+	rcScopedDelete<float> poly((float*)rcAlloc(sizeof(float)*build->mesh->nvp*3, RC_ALLOC_TEMP));
+	if (!hp.data || !poly)
+	{
+		build->ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'hp.data' (%d).", build->maxhw*build->maxhh);
+		build->failed = true;
+		return;
+	}
+	
+	while (!build->failed)
+	{
+		const int jobIndex = build->nextJob.fetch_add(1);
+		if (jobIndex >= build->njobs)
+			break;
+		if (!buildDetailMeshJob(*build, build->jobs[jobIndex], hp, poly, verts, edges, tris, arr, samples))
+			build->failed = true;
+	}
+}
+} // anonymous namespace
+
 /// @par
 ///
 /// See the #rcConfig documentation for more information on the configuration parameters.
 ///
+/// The detail meshes of the polygons do not depend on each other. With @p threadCount above 1, ranges of
+/// polygons are built on worker threads into separate buffers which are concatenated in polygon order,
+/// so the result does not depend on the thread count. The worker threads log to @p ctx.
+///
 /// @see rcAllocPolyMeshDetail, rcPolyMesh, rcCompactHeightfield, rcPolyMeshDetail, rcConfig
 bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompactHeightfield& chf,
 						   const float sampleDist, const float sampleMaxError,
-						   rcPolyMeshDetail& dmesh)
+						   rcPolyMeshDetail& dmesh, const int threadCount)
 {
 	rcAssert(ctx);
 	
@@ -1191,19 +1685,6 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		return true;
 	
 	const int nvp = mesh.nvp;
-	const float cs = mesh.cs;
-	const float ch = mesh.ch;
-	const float* orig = mesh.bmin;
-	const int borderSize = mesh.borderSize;
-	const int heightSearchRadius = rcMax(1, (int)ceilf(mesh.maxEdgeError));
-	
-	rcIntArray edges(64);
-	rcIntArray tris(512);
-	rcIntArray arr(512);
-	rcIntArray samples(512);
-	float verts[256*3];
-	rcHeightPatch hp;
-	int nPolyVerts = 0;
 	int maxhw = 0, maxhh = 0;
 	
 	rcScopedDelete<int> bounds((int*)rcAlloc(sizeof(int)*mesh.npolys*4, RC_ALLOC_TEMP));
@@ -1212,12 +1693,6 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'bounds' (%d).", mesh.npolys*4);
 		return false;
 	}
-	rcScopedDelete<float> poly((float*)rcAlloc(sizeof(float)*nvp*3, RC_ALLOC_TEMP));
-	if (!poly)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'poly' (%d).", nvp*3);
-		return false;
-	}
 	
 	// Find max size for a polygon area.
 	for (int i = 0; i < mesh.npolys; ++i)
@@ -1239,7 +1714,6 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 			xmax = rcMax(xmax, (int)v[0]);
 			ymin = rcMin(ymin, (int)v[2]);
 			ymax = rcMax(ymax, (int)v[2]);
-			nPolyVerts++;
 		}
 		xmin = rcMax(0,xmin-1);
 		xmax = rcMin(chf.width,xmax+1);
@@ -1250,13 +1724,6 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		maxhh = rcMax(maxhh, ymax-ymin);
 	}
 	
-	hp.data = (unsigned short*)rcAlloc(sizeof(unsigned short)*maxhw*maxhh, RC_ALLOC_TEMP);
-	if (!hp.data)
-	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'hp.data' (%d).", maxhw*maxhh);
-		return false;
-	}
-	
 	dmesh.nmeshes = mesh.npolys;
 	dmesh.nverts = 0;
 	dmesh.ntris = 0;
@@ -1267,134 +1734,103 @@ bool rcBuildPolyMeshDetail(rcContext* ctx, const rcPolyMesh& mesh, const rcCompa
 		return false;
 	}
 	
-	int vcap = nPolyVerts+nPolyVerts/2;
-	int tcap = vcap*2;
-	
-	dmesh.nverts = 0;
-	dmesh.verts = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
-	if (!dmesh.verts)
+	// Split the polygons in more ranges than threads, to balance the work between the threads.
+	const int nthreads = rcClamp(threadCount, 1, mesh.npolys);
+	const int njobs = nthreads > 1 ? rcMin(mesh.npolys, nthreads*8) : 1;
+	DetailMeshJob* jobs = (DetailMeshJob*)rcAlloc(sizeof(DetailMeshJob)*njobs, RC_ALLOC_TEMP);
+	if (!jobs)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d).", vcap*3);
+		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'jobs' (%d).", njobs);
 		return false;
 	}
-	dmesh.ntris = 0;
-	dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
-	if (!dmesh.tris)
+	for (int i = 0; i < njobs; ++i)
 	{
-		ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.tris' (%d).", tcap*4);
-		return false;
+		DetailMeshJob* job = new (rcNewTag(), &jobs[i]) DetailMeshJob;
+		job->firstPoly = (int)((long long)mesh.npolys*i/njobs);
+		job->lastPoly = (int)((long long)mesh.npolys*(i+1)/njobs);
 	}
 	
-	for (int i = 0; i < mesh.npolys; ++i)
+	DetailMeshBuild build;
+	build.ctx = ctx;
+	build.mesh = &mesh;
+	build.chf = &chf;
+	build.sampleDist = sampleDist;
+	build.sampleMaxError = sampleMaxError;
+	build.heightSearchRadius = rcMax(1, (int)ceilf(mesh.maxEdgeError));
+	build.bounds = bounds;
+	build.maxhw = maxhw;
+	build.maxhh = maxhh;
+	build.meshes = dmesh.meshes;
+	build.jobs = jobs;
+	build.njobs = njobs;
+	build.nextJob = 0;
+	build.failed = false;
+	
+	if (nthreads > 1)
 	{
-		const unsigned short* p = &mesh.polys[i*nvp*2];
-		
-		// Store polygon vertices for processing.
-		int npoly = 0;
-		for (int j = 0; j < nvp; ++j)
+		std::thread* threads = (std::thread*)rcAlloc(sizeof(std::thread)*(nthreads-1), RC_ALLOC_TEMP);
+		if (threads)
 		{
-			if(p[j] == RC_MESH_NULL_IDX) break;
-			const unsigned short* v = &mesh.verts[p[j]*3];
-			poly[j*3+0] = v[0]*cs;
-			poly[j*3+1] = v[1]*ch;
-			poly[j*3+2] = v[2]*cs;
-			npoly++;
+			for (int i = 0; i < nthreads-1; ++i)
+				new (rcNewTag(), &threads[i]) std::thread(buildDetailMeshJobs, &build);
 		}
-		
-		// Get the height data from the area of the polygon.
-		hp.xmin = bounds[i*4+0];
-		hp.ymin = bounds[i*4+2];
-		hp.width = bounds[i*4+1]-bounds[i*4+0];
-		hp.height = bounds[i*4+3]-bounds[i*4+2];
-		getHeightData(ctx, chf, p, npoly, mesh.verts, borderSize, hp, arr, mesh.regs[i]);
-		
-		// Build detail mesh.
-		int nverts = 0;
-		if (!buildPolyDetail(ctx, poly, npoly,
-							 sampleDist, sampleMaxError,
-							 heightSearchRadius, chf, hp,
-							 verts, nverts, tris,
-							 edges, samples))
+		buildDetailMeshJobs(&build);
+		if (threads)
 		{
-			return false;
-		}
-		
-		// Move detail verts to world space.
-		for (int j = 0; j < nverts; ++j)
-		{
-			verts[j*3+0] += orig[0];
-			verts[j*3+1] += orig[1] + chf.ch; // Is this offset necessary?
-			verts[j*3+2] += orig[2];
-		}
-		// Offset poly too, will be used to flag checking.
-		for (int j = 0; j < npoly; ++j)
-		{
-			poly[j*3+0] += orig[0];
-			poly[j*3+1] += orig[1];
-			poly[j*3+2] += orig[2];
-		}
-		
-		// Store detail submesh.
-		const int ntris = tris.size()/4;
-		
-		dmesh.meshes[i*4+0] = (unsigned int)dmesh.nverts;
-		dmesh.meshes[i*4+1] = (unsigned int)nverts;
-		dmesh.meshes[i*4+2] = (unsigned int)dmesh.ntris;
-		dmesh.meshes[i*4+3] = (unsigned int)ntris;
-		
-		// Store vertices, allocate more memory if necessary.
-		if (dmesh.nverts+nverts > vcap)
-		{
-			while (dmesh.nverts+nverts > vcap)
-				vcap += 256;
-			
-			float* newv = (float*)rcAlloc(sizeof(float)*vcap*3, RC_ALLOC_PERM);
-			if (!newv)
+			for (int i = 0; i < nthreads-1; ++i)
 			{
-				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'newv' (%d).", vcap*3);
-				return false;
+				threads[i].join();
+				threads[i].~thread();
 			}
-			if (dmesh.nverts)
-				memcpy(newv, dmesh.verts, sizeof(float)*3*dmesh.nverts);
-			rcFree(dmesh.verts);
-			dmesh.verts = newv;
+			rcFree(threads);
 		}
-		for (int j = 0; j < nverts; ++j)
+	}
+	else
+	{
+		buildDetailMeshJobs(&build);
+	}
+	
+	// Concatenate the jobs.
+	bool ok = !build.failed;
+	if (ok)
+	{
+		int nverts = 0;
+		int ntris = 0;
+		for (int i = 0; i < njobs; ++i)
 		{
-			dmesh.verts[dmesh.nverts*3+0] = verts[j*3+0];
-			dmesh.verts[dmesh.nverts*3+1] = verts[j*3+1];
-			dmesh.verts[dmesh.nverts*3+2] = verts[j*3+2];
-			dmesh.nverts++;
+			nverts += jobs[i].verts.size()/3;
+			ntris += jobs[i].tris.size()/4;
 		}
-		
-		// Store triangles, allocate more memory if necessary.
-		if (dmesh.ntris+ntris > tcap)
+		dmesh.verts = (float*)rcAlloc(sizeof(float)*rcMax(nverts, 1)*3, RC_ALLOC_PERM);
+		dmesh.tris = (unsigned char*)rcAlloc(sizeof(unsigned char)*rcMax(ntris, 1)*4, RC_ALLOC_PERM);
+		if (!dmesh.verts || !dmesh.tris)
 		{
-			while (dmesh.ntris+ntris > tcap)
-				tcap += 256;
-			unsigned char* newt = (unsigned char*)rcAlloc(sizeof(unsigned char)*tcap*4, RC_ALLOC_PERM);
-			if (!newt)
-			{
-				ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'newt' (%d).", tcap*4);
-				return false;
-			}
-			if (dmesh.ntris)
-				memcpy(newt, dmesh.tris, sizeof(unsigned char)*4*dmesh.ntris);
-			rcFree(dmesh.tris);
-			dmesh.tris = newt;
+			ctx->log(RC_LOG_ERROR, "rcBuildPolyMeshDetail: Out of memory 'dmesh.verts' (%d), 'dmesh.tris' (%d).", nverts*3, ntris*4);
+			ok = false;
 		}
-		for (int j = 0; j < ntris; ++j)
+	}
+	for (int i = 0; i < njobs; ++i)
+	{
+		DetailMeshJob& job = jobs[i];
+		if (ok)
 		{
-			const int* t = &tris[j*4];
-			dmesh.tris[dmesh.ntris*4+0] = (unsigned char)t[0];
-			dmesh.tris[dmesh.ntris*4+1] = (unsigned char)t[1];
-			dmesh.tris[dmesh.ntris*4+2] = (unsigned char)t[2];
-			dmesh.tris[dmesh.ntris*4+3] = (unsigned char)t[3];
-			dmesh.ntris++;
+			for (int j = job.firstPoly; j < job.lastPoly; ++j)
+			{
+				dmesh.meshes[j*4+0] += (unsigned int)dmesh.nverts;
+				dmesh.meshes[j*4+2] += (unsigned int)dmesh.ntris;
+			}
+			if (!job.verts.empty())
+				memcpy(&dmesh.verts[dmesh.nverts*3], job.verts.data(), sizeof(float)*job.verts.size());
+			if (!job.tris.empty())
+				memcpy(&dmesh.tris[dmesh.ntris*4], job.tris.data(), sizeof(unsigned char)*job.tris.size());
+			dmesh.nverts += job.verts.size()/3;
+			dmesh.ntris += job.tris.size()/4;
 		}
+		job.~DetailMeshJob();
 	}
+	rcFree(jobs);
 	
-	return true;
+	return ok;
 }
 
 /// @see rcAllocPolyMeshDetail, rcPolyMeshDetail
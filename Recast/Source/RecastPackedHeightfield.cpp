@@ -0,0 +1,465 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <string.h>
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastAssert.h"
+#include "RecastSpanPool.h"
+
+namespace
+{
+// The compressed stream stores each column as its span count followed by its spans, each as the
+// gap to the span below, the span height and the area. Neighbouring columns are often identical
+// in this form, which the LZ77 pass below turns into short back references.
+
+void writeVarint(unsigned char*& out, unsigned int value)
+{
+	while (value >= 0x80)
+	{
+		*out++ = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	*out++ = (unsigned char)value;
+}
+
+bool readVarint(const unsigned char*& in, const unsigned char* end, unsigned int& value)
+{
+	value = 0;
+	for (int shift = 0; shift < 32 && in < end; shift += 7)
+	{
+		const unsigned char byte = *in++;
+		value |= (unsigned int)(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// A byte oriented LZ77 coder. Each sequence is a token with the literal count in the high
+// nibble and the match length minus 4 in the low nibble, both extended by 255-runs when they
+// are 15, followed by the literals, then by the 16 bit match offset. The last sequence has
+// only literals.
+
+const int LZ_MIN_MATCH = 4;
+const int LZ_MAX_OFFSET = 0xffff;
+const int LZ_HASH_BITS = 12;
+
+int lzMaxCompressedSize(const int size)
+{
+	return size + size / 255 + 16;
+}
+
+unsigned int lzRead32(const unsigned char* p)
+{
+	unsigned int v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+void lzWriteLength(unsigned char*& out, int length)
+{
+	while (length >= 255)
+	{
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = (unsigned char)length;
+}
+
+void lzWriteSequence(unsigned char*& out, const unsigned char* literals, const int literalCount,
+                     const int offset, const int matchLength)
+{
+	const int matchCode = matchLength ? matchLength - LZ_MIN_MATCH : 0;
+	*out++ = (unsigned char)((rcMin(literalCount, 15) << 4) | rcMin(matchCode, 15));
+	if (literalCount >= 15)
+	{
+		lzWriteLength(out, literalCount - 15);
+	}
+	memcpy(out, literals, literalCount);
+	out += literalCount;
+	if (matchLength)
+	{
+		*out++ = (unsigned char)(offset & 0xff);
+		*out++ = (unsigned char)(offset >> 8);
+		if (matchCode >= 15)
+		{
+			lzWriteLength(out, matchCode - 15);
+		}
+	}
+}
+
+int lzCompress(const unsigned char* in, const int size, unsigned char* out)
+{
+	int table[1 << LZ_HASH_BITS];
+	memset(table, 0xff, sizeof(table));
+
+	unsigned char* op = out;
+	int ip = 0;
+	int anchor = 0;
+	while (ip + LZ_MIN_MATCH <= size)
+	{
+		const unsigned int sequence = lzRead32(in + ip);
+		const unsigned int hash = (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+		const int ref = table[hash];
+		table[hash] = ip;
+		if (ref < 0 || ip - ref > LZ_MAX_OFFSET || lzRead32(in + ref) != sequence)
+		{
+			ip++;
+			continue;
+		}
+
+		int length = LZ_MIN_MATCH;
+		while (ip + length < size && in[ref + length] == in[ip + length])
+		{
+			length++;
+		}
+		lzWriteSequence(op, in + anchor, ip - anchor, ip - ref, length);
+		ip += length;
+		anchor = ip;
+	}
+	lzWriteSequence(op, in + anchor, size - anchor, 0, 0);
+	return (int)(op - out);
+}
+
+bool lzReadLength(const unsigned char*& in, const unsigned char* end, int& length)
+{
+	unsigned char byte;
+	do
+	{
+		if (in >= end)
+		{
+			return false;
+		}
+		byte = *in++;
+		length += byte;
+	}
+	while (byte == 255);
+	return true;
+}
+
+/// @returns The decompressed size, or -1 if the data is invalid.
+int lzDecompress(const unsigned char* in, const int size, unsigned char* out, const int maxSize)
+{
+	const unsigned char* end = in + size;
+	int op = 0;
+	while (in < end)
+	{
+		const unsigned char token = *in++;
+		int literalCount = token >> 4;
+		if (literalCount == 15 && !lzReadLength(in, end, literalCount))
+		{
+			return -1;
+		}
+		if (literalCount > end - in || literalCount > maxSize - op)
+		{
+			return -1;
+		}
+		memcpy(out + op, in, literalCount);
+		in += literalCount;
+		op += literalCount;
+		if (in == end)
+		{
+			break;
+		}
+
+		if (end - in < 2)
+		{
+			return -1;
+		}
+		const int offset = in[0] | (in[1] << 8);
+		in += 2;
+		int matchLength = token & 15;
+		if (matchLength == 15 && !lzReadLength(in, end, matchLength))
+		{
+			return -1;
+		}
+		matchLength += LZ_MIN_MATCH;
+		if (offset == 0 || offset > op || matchLength > maxSize - op)
+		{
+			return -1;
+		}
+		// The match can overlap the bytes it produces.
+		for (int i = 0; i < matchLength; ++i, ++op)
+		{
+			out[op] = out[op - offset];
+		}
+	}
+	return op;
+}
+} // anonymous namespace
+
+bool rcPackHeightfield(rcContext* context, const rcHeightfield& heightfield, rcPackedHeightfield& packed)
+{
+	rcAssert(context);
+
+	const int numColumns = heightfield.width * heightfield.height;
+	int totalSpanCount = 0;
+	for (int i = 0; i < numColumns; ++i)
+	{
+		for (const rcSpan* span = heightfield.spans[i]; span; span = span->next)
+		{
+			totalSpanCount++;
+		}
+	}
+
+	rcFree(packed.columns);
+	rcFree(packed.spans);
+	rcFree(packed.compressed);
+	packed.compressed = NULL;
+	packed.compressedSize = 0;
+	packed.spanCount = 0;
+	packed.columns = (unsigned int*)rcAlloc(sizeof(unsigned int) * (numColumns + 1), RC_ALLOC_PERM);
+	packed.spans = (unsigned int*)rcAlloc(sizeof(unsigned int) * rcMax(totalSpanCount, 1), RC_ALLOC_PERM);
+	if (!packed.columns || !packed.spans)
+	{
+		context->log(RC_LOG_ERROR, "rcPackHeightfield: Out of memory (%d columns, %d spans).", numColumns, totalSpanCount);
+		return false;
+	}
+
+	packed.width = heightfield.width;
+	packed.height = heightfield.height;
+	rcVcopy(packed.bmin, heightfield.bmin);
+	rcVcopy(packed.bmax, heightfield.bmax);
+	packed.cs = heightfield.cs;
+	packed.ch = heightfield.ch;
+	packed.spanCount = totalSpanCount;
+
+	unsigned int spanIndex = 0;
+	for (int i = 0; i < numColumns; ++i)
+	{
+		packed.columns[i] = spanIndex;
+		for (const rcSpan* span = heightfield.spans[i]; span; span = span->next)
+		{
+			packed.spans[spanIndex++] = rcPackSpan(span->smin, span->smax, span->area);
+		}
+	}
+	packed.columns[numColumns] = spanIndex;
+
+	return true;
+}
+
+bool rcUnpackHeightfield(rcContext* context, const rcPackedHeightfield& packed, rcHeightfield& heightfield)
+{
+	rcAssert(context);
+
+	if (!packed.columns)
+	{
+		context->log(RC_LOG_ERROR, "rcUnpackHeightfield: The packed heightfield is compressed.");
+		return false;
+	}
+
+	if (!rcResetHeightfield(context, heightfield, packed.width, packed.height, packed.bmin, packed.bmax, packed.cs, packed.ch))
+	{
+		context->log(RC_LOG_ERROR, "rcUnpackHeightfield: Out of memory 'spans' (%d).", packed.width * packed.height);
+		return false;
+	}
+
+	const int numColumns = packed.width * packed.height;
+	for (int i = 0; i < numColumns; ++i)
+	{
+		rcSpan* prev = NULL;
+		for (unsigned int j = packed.columns[i]; j < packed.columns[i + 1]; ++j)
+		{
+			if (heightfield.freelist == NULL && !rcAddSpanPool(heightfield))
+			{
+				context->log(RC_LOG_ERROR, "rcUnpackHeightfield: Out of memory.");
+				return false;
+			}
+			rcSpan* span = heightfield.freelist;
+			heightfield.freelist = span->next;
+
+			const unsigned int packedSpan = packed.spans[j];
+			span->smin = rcGetPackedSpanMin(packedSpan);
+			span->smax = rcGetPackedSpanMax(packedSpan);
+			span->area = rcGetPackedSpanArea(packedSpan);
+			span->next = NULL;
+			if (prev)
+			{
+				prev->next = span;
+			}
+			else
+			{
+				heightfield.spans[i] = span;
+			}
+			prev = span;
+		}
+	}
+
+	return true;
+}
+
+bool rcCompressPackedHeightfield(rcContext* context, rcPackedHeightfield& packed)
+{
+	rcAssert(context);
+
+	if (!packed.columns)
+	{
+		return true;
+	}
+
+	// Each span takes at most 3 bytes per limit and one for the area.
+	const int numColumns = packed.width * packed.height;
+	const int maxRawSize = numColumns * 5 + packed.spanCount * 7;
+	unsigned char* raw = (unsigned char*)rcAlloc(maxRawSize, RC_ALLOC_TEMP);
+	if (!raw)
+	{
+		context->log(RC_LOG_ERROR, "rcCompressPackedHeightfield: Out of memory 'raw' (%d).", maxRawSize);
+		return false;
+	}
+
+	unsigned char* out = raw;
+	for (int i = 0; i < numColumns; ++i)
+	{
+		const unsigned int first = packed.columns[i];
+		const unsigned int last = packed.columns[i + 1];
+		writeVarint(out, last - first);
+		unsigned int prevTop = 0;
+		for (unsigned int j = first; j < last; ++j)
+		{
+			const unsigned int span = packed.spans[j];
+			const unsigned int smin = rcGetPackedSpanMin(span);
+			const unsigned int smax = rcGetPackedSpanMax(span);
+			writeVarint(out, smin - prevTop);
+			writeVarint(out, smax - smin);
+			*out++ = (unsigned char)rcGetPackedSpanArea(span);
+			prevTop = smax;
+		}
+	}
+	const int rawSize = (int)(out - raw);
+
+	// The compressed data starts with the size of the raw stream.
+	const int maxCompressedSize = 4 + lzMaxCompressedSize(rawSize);
+	unsigned char* buffer = (unsigned char*)rcAlloc(maxCompressedSize, RC_ALLOC_TEMP);
+	if (!buffer)
+	{
+		rcFree(raw);
+		context->log(RC_LOG_ERROR, "rcCompressPackedHeightfield: Out of memory 'buffer' (%d).", maxCompressedSize);
+		return false;
+	}
+	memcpy(buffer, &rawSize, 4);
+	const int compressedSize = 4 + lzCompress(raw, rawSize, buffer + 4);
+	rcFree(raw);
+
+	// Keep the exact size only.
+	unsigned char* compressed = (unsigned char*)rcAlloc(compressedSize, RC_ALLOC_PERM);
+	if (!compressed)
+	{
+		rcFree(buffer);
+		context->log(RC_LOG_ERROR, "rcCompressPackedHeightfield: Out of memory 'compressed' (%d).", compressedSize);
+		return false;
+	}
+	memcpy(compressed, buffer, compressedSize);
+	rcFree(buffer);
+
+	rcFree(packed.columns);
+	rcFree(packed.spans);
+	packed.columns = NULL;
+	packed.spans = NULL;
+	packed.compressed = compressed;
+	packed.compressedSize = compressedSize;
+
+	return true;
+}
+
+bool rcDecompressPackedHeightfield(rcContext* context, rcPackedHeightfield& packed)
+{
+	rcAssert(context);
+
+	if (!packed.compressed)
+	{
+		return true;
+	}
+
+	int rawSize = 0;
+	if (packed.compressedSize >= 4)
+	{
+		memcpy(&rawSize, packed.compressed, 4);
+	}
+	const int numColumns = packed.width * packed.height;
+	unsigned char* raw = (unsigned char*)rcAlloc(rcMax(rawSize, 1), RC_ALLOC_TEMP);
+	unsigned int* columns = (unsigned int*)rcAlloc(sizeof(unsigned int) * (numColumns + 1), RC_ALLOC_PERM);
+	unsigned int* spans = (unsigned int*)rcAlloc(sizeof(unsigned int) * rcMax(packed.spanCount, 1), RC_ALLOC_PERM);
+	if (!raw || !columns || !spans)
+	{
+		rcFree(raw);
+		rcFree(columns);
+		rcFree(spans);
+		context->log(RC_LOG_ERROR, "rcDecompressPackedHeightfield: Out of memory (%d bytes, %d spans).", rawSize, packed.spanCount);
+		return false;
+	}
+
+	bool valid = packed.compressedSize >= 4 &&
+		lzDecompress(packed.compressed + 4, packed.compressedSize - 4, raw, rawSize) == rawSize;
+
+	const unsigned char* in = raw;
+	const unsigned char* end = raw + rawSize;
+	unsigned int spanIndex = 0;
+	for (int i = 0; i < numColumns && valid; ++i)
+	{
+		columns[i] = spanIndex;
+		unsigned int count;
+		valid = readVarint(in, end, count) && count <= (unsigned int)packed.spanCount - spanIndex;
+		unsigned int prevTop = 0;
+		for (unsigned int j = 0; j < count && valid; ++j)
+		{
+			unsigned int gap, height;
+			valid = readVarint(in, end, gap) && readVarint(in, end, height) && in < end;
+			if (valid)
+			{
+				const unsigned int smin = prevTop + gap;
+				const unsigned int smax = smin + height;
+				spans[spanIndex++] = rcPackSpan(smin, smax, *in++);
+				prevTop = smax;
+			}
+		}
+	}
+	columns[numColumns] = spanIndex;
+	rcFree(raw);
+
+	if (!valid || spanIndex != (unsigned int)packed.spanCount)
+	{
+		rcFree(columns);
+		rcFree(spans);
+		context->log(RC_LOG_ERROR, "rcDecompressPackedHeightfield: Invalid compressed data.");
+		return false;
+	}
+
+	rcFree(packed.compressed);
+	packed.compressed = NULL;
+	packed.compressedSize = 0;
+	packed.columns = columns;
+	packed.spans = spans;
+
+	return true;
+}
+
+int rcGetPackedHeightfieldMemory(const rcPackedHeightfield& packed)
+{
+	if (packed.compressed)
+	{
+		return packed.compressedSize;
+	}
+	if (!packed.columns)
+	{
+		return 0;
+	}
+	return (int)sizeof(unsigned int) * (packed.width * packed.height + 1 + packed.spanCount);
+}
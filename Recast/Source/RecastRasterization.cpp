@@ -20,6 +20,7 @@
 #include "Recast.h"
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
+#include "RecastSpanPool.h"
 
 /// Check whether two bounding boxes overlap
 ///
@@ -36,6 +37,55 @@ static bool overlapBounds(const float* aMin, const float* aMax, const float* bMi
 		aMin[2] <= bMax[2] && aMax[2] >= bMin[2];
 }
 
+bool rcAddSpanPool(rcHeightfield& heightfield)
+{
+	rcSpanPool* spanPool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool), RC_ALLOC_PERM);
+	if (spanPool == NULL)
+	{
+		return false;
+	}
+
+	// Add the pool into the list of pools.
+	spanPool->next = heightfield.pools;
+	heightfield.pools = spanPool;
+
+	// Add new spans to the free list.
+	rcSpan* freeList = heightfield.freelist;
+	rcSpan* head = &spanPool->items[0];
+	rcSpan* it = &spanPool->items[RC_SPANS_PER_POOL];
+	do
+	{
+		--it;
+		it->next = freeList;
+		freeList = it;
+	}
+	while (it != head);
+	heightfield.freelist = it;
+	return true;
+}
+
+void rcFreeColumnSpans(rcHeightfield& heightfield, const int columnIndex)
+{
+	rcSpan* span = heightfield.spans[columnIndex];
+	while (span)
+	{
+		rcSpan* next = span->next;
+		span->next = heightfield.freelist;
+		heightfield.freelist = span;
+		span = next;
+	}
+	heightfield.spans[columnIndex] = NULL;
+}
+
+void rcFreeAllSpans(rcHeightfield& heightfield)
+{
+	const int numColumns = heightfield.width * heightfield.height;
+	for (int i = 0; i < numColumns; ++i)
+	{
+		rcFreeColumnSpans(heightfield, i);
+	}
+}
+
 /// Allocates a new span in the heightfield.
 /// Use a memory pool and free list to minimize actual allocations.
 /// 
@@ -44,32 +94,9 @@ static bool overlapBounds(const float* aMin, const float* aMax, const float* bMi
 static rcSpan* allocSpan(rcHeightfield& heightfield)
 {
 	// If necessary, allocate new page and update the freelist.
-	if (heightfield.freelist == NULL || heightfield.freelist->next == NULL)
+	if ((heightfield.freelist == NULL || heightfield.freelist->next == NULL) && !rcAddSpanPool(heightfield))
 	{
-		// Create new page.
-		// Allocate memory for the new pool.
-		rcSpanPool* spanPool = (rcSpanPool*)rcAlloc(sizeof(rcSpanPool), RC_ALLOC_PERM);
-		if (spanPool == NULL)
-		{
-			return NULL;
-		}
-
-		// Add the pool into the list of pools.
-		spanPool->next = heightfield.pools;
-		heightfield.pools = spanPool;
-		
-		// Add new spans to the free list.
-		rcSpan* freeList = heightfield.freelist;
-		rcSpan* head = &spanPool->items[0];
-		rcSpan* it = &spanPool->items[RC_SPANS_PER_POOL];
-		do
-		{
-			--it;
-			it->next = freeList;
-			freeList = it;
-		}
-		while (it != head);
-		heightfield.freelist = it;
+		return NULL;
 	}
 
 	// Pop item from the front of the free list.
@@ -0,0 +1,44 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTSPANPOOL_H
+#define RECASTSPANPOOL_H
+
+// The span pool of rcHeightfield, shared by the sources which manage its spans directly.
+// Not part of the public API.
+
+struct rcHeightfield;
+class rcContext;
+
+/// Adds a new span pool to the free list of a heightfield.
+/// @returns False if out of memory.
+bool rcAddSpanPool(rcHeightfield& heightfield);
+
+/// Moves the spans of a column to the free list of a heightfield.
+void rcFreeColumnSpans(rcHeightfield& heightfield, const int columnIndex);
+
+/// Moves all the spans of a heightfield to its free list.
+void rcFreeAllSpans(rcHeightfield& heightfield);
+
+/// Initializes a heightfield like #rcCreateHeightfield, keeping its span pools. The spans are freed,
+/// and the column array is reused if the size is the same.
+bool rcResetHeightfield(rcContext* context, rcHeightfield& heightfield, int sizeX, int sizeZ,
+                        const float* minBounds, const float* maxBounds,
+                        float cellSize, float cellHeight);
+
+#endif // RECASTSPANPOOL_H
@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTBAKECONTEXT_H
+#define RECASTBAKECONTEXT_H
+
+#include "Recast.h"
+#include "PerfTimer.h"
+
+class duProfiler;
+
+/// Build context of a bake worker thread.
+/// Logs go to stdout, prefixed with the tile being built, timers accumulate over all the
+/// tiles built by the thread. The timers are also recorded as spans into the profiler, if any.
+class BakeContext : public rcContext
+{
+	TimeVal m_startTime[RC_MAX_TIMERS];
+	TimeVal m_accTime[RC_MAX_TIMERS];
+	int m_tileX, m_tileY;
+	bool m_verbose;
+	duProfiler* m_profiler;
+
+public:
+	BakeContext(bool verbose, duProfiler* profiler = 0);
+
+	/// Sets the tile prefixed to the log messages and attributed to the spans, -1 for none.
+	void setTile(int tx, int ty);
+
+	/// Adds the timers of another context to the timers of this one.
+	void accumulate(const BakeContext& other);
+
+protected:
+	virtual void doLog(const rcLogCategory category, const char* msg, const int len);
+	virtual void doResetTimers();
+	virtual void doStartTimer(const rcTimerLabel label);
+	virtual void doStopTimer(const rcTimerLabel label);
+	virtual int doGetAccumulatedTime(const rcTimerLabel label) const;
+
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	BakeContext(const BakeContext&);
+	BakeContext& operator=(const BakeContext&);
+};
+
+#endif // RECASTBAKECONTEXT_H
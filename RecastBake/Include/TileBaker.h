@@ -0,0 +1,111 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTBAKETILEBAKER_H
+#define RECASTBAKETILEBAKER_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "InputGeom.h"
+
+class BakeContext;
+
+/// Partition types, same values as the ones of RecastDemo.
+enum BakePartitionType
+{
+	BAKE_PARTITION_WATERSHED,
+	BAKE_PARTITION_MONOTONE,
+	BAKE_PARTITION_LAYERS
+};
+
+/// Initializes the settings with the defaults of RecastDemo.
+void resetBuildSettings(BuildSettings& settings);
+
+/// Tile grid of a bake.
+struct TileGrid
+{
+	int width;			///< Number of tiles along the x-axis.
+	int height;			///< Number of tiles along the z-axis.
+	float tileSize;		///< Size of a tile in world units.
+	float bmin[3];		///< Bounds of the navmesh.
+	float bmax[3];
+};
+
+/// Computes the tile grid covering the navmesh bounds of the geometry.
+void calcTileGrid(const InputGeom* geom, const BuildSettings& settings, TileGrid& grid);
+
+/// Builds the navmesh data of a tile, the way Sample_TileMesh does.
+/// Only reads the geometry, so several tiles can be built at the same time with
+/// different contexts.
+///  @param[in]		ctx			The build context of the calling thread.
+///  @param[in]		geom		The input geometry.
+///  @param[in]		settings	The build settings.
+///  @param[in]		grid		The tile grid.
+///  @param[in]		tx, ty		The tile to build.
+///  @param[out]	dataSize	The size of the returned data.
+///  @param[in]		detailThreadCount	The number of threads building the detail mesh of the tile,
+///  									including the calling thread.
+/// @returns The navmesh data allocated with dtAlloc, or null if the tile is empty or the build failed.
+unsigned char* bakeTile(BakeContext* ctx, const InputGeom* geom, const BuildSettings& settings,
+						const TileGrid& grid, const int tx, const int ty, int& dataSize,
+						const int detailThreadCount = 1);
+
+/// Runs jobs over a range of items on worker threads with work stealing.
+///
+/// The items are split in contiguous ranges, one per worker, so that neighbour tiles are built
+/// by the same thread. A worker takes items from the front of its own queue, and steals from the
+/// back of the queues of the other workers once it runs out.
+class WorkStealingScheduler
+{
+public:
+	/// Called on a worker thread for each item.
+	typedef void (*JobFunc)(int worker, int item, void* userData);
+
+	WorkStealingScheduler();
+
+	/// Processes the items [0, itemCount) on @p threadCount threads, and returns when all are done.
+	void run(int itemCount, int threadCount, JobFunc func, void* userData);
+
+	/// The number of items stolen during the last run.
+	int getStealCount() const { return m_stealCount; }
+
+private:
+	struct WorkerQueue
+	{
+		std::mutex lock;
+		std::deque<int> items;
+	};
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	WorkStealingScheduler(const WorkStealingScheduler&);
+	WorkStealingScheduler& operator=(const WorkStealingScheduler&);
+
+	static void workerMain(WorkStealingScheduler* scheduler, int worker);
+	bool popItem(int worker, int& item);
+	bool stealItem(int worker, int& item);
+
+	std::vector<WorkerQueue*> m_queues;
+	JobFunc m_func;
+	void* m_userData;
+	std::atomic<int> m_stealCount;
+};
+
+#endif // RECASTBAKETILEBAKER_H
@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#ifndef RECASTBAKETILECACHEBAKER_H
+#define RECASTBAKETILECACHEBAKER_H
+
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+#include "TileBaker.h"
+
+/// The maximum number of layers of a tile, same as RecastDemo.
+static const int BAKE_MAX_LAYERS = 32;
+
+/// The expected number of layers of a tile, used to size the tile cache. (Same as RecastDemo)
+static const int BAKE_EXPECTED_LAYERS_PER_TILE = 4;
+
+/// A compressed tile cache layer.
+struct BakedLayer
+{
+	unsigned char* data;	///< The compressed layer, allocated with dtAlloc.
+	int dataSize;			///< The size of the compressed layer.
+};
+
+/// FastLZ compressor, compatible with the one of RecastDemo.
+/// Does not have any state, so a single instance can be used by all the worker threads.
+class BakeCompressor : public dtTileCacheCompressor
+{
+public:
+	virtual ~BakeCompressor();
+	virtual int maxCompressedSize(const int bufferSize);
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+							  unsigned char* compressed, const int maxCompressedSize, int* compressedSize);
+	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+								unsigned char* buffer, const int maxBufferSize, int* bufferSize);
+};
+
+/// Initializes the tile cache parameters of a bake, the way Sample_TempObstacles does.
+void calcTileCacheParams(const BuildSettings& settings, const TileGrid& grid, dtTileCacheParams& params);
+
+/// Rasterizes a tile, builds its heightfield layers and compresses them, the way
+/// Sample_TempObstacles does.
+/// Only reads the geometry, so several tiles can be built at the same time with
+/// different contexts.
+///  @param[in]		ctx			The build context of the calling thread.
+///  @param[in]		geom		The input geometry.
+///  @param[in]		settings	The build settings.
+///  @param[in]		grid		The tile grid.
+///  @param[in]		tx, ty		The tile to build.
+///  @param[in]		comp		The compressor of the layers.
+///  @param[out]	layers		The compressed layers of the tile. [Size: @p maxLayers]
+///  @param[in]		maxLayers	The maximum number of layers to return.
+/// @returns The number of layers, 0 if the tile is empty or the build failed.
+int bakeTileLayers(BakeContext* ctx, const InputGeom* geom, const BuildSettings& settings,
+				   const TileGrid& grid, const int tx, const int ty, dtTileCacheCompressor* comp,
+				   BakedLayer* layers, const int maxLayers);
+
+#endif // RECASTBAKETILECACHEBAKER_H
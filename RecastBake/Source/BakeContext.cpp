@@ -0,0 +1,101 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <stdio.h>
+#include <mutex>
+#include "BakeContext.h"
+#include "RecastProfiler.h"
+
+// Keeps the lines of the worker threads from interleaving.
+static std::mutex s_logMutex;
+
+BakeContext::BakeContext(bool verbose, duProfiler* profiler) :
+	m_tileX(-1),
+	m_tileY(-1),
+	m_verbose(verbose),
+	m_profiler(profiler)
+{
+	resetTimers();
+}
+
+void BakeContext::setTile(int tx, int ty)
+{
+	m_tileX = tx;
+	m_tileY = ty;
+	if (m_profiler)
+		m_profiler->setTile(tx, ty);
+}
+
+void BakeContext::accumulate(const BakeContext& other)
+{
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+	{
+		if (other.m_accTime[i] == -1)
+			continue;
+		if (m_accTime[i] == -1)
+			m_accTime[i] = other.m_accTime[i];
+		else
+			m_accTime[i] += other.m_accTime[i];
+	}
+}
+
+void BakeContext::doLog(const rcLogCategory category, const char* msg, const int /*len*/)
+{
+	if (category == RC_LOG_PROGRESS && !m_verbose)
+		return;
+
+	std::lock_guard<std::mutex> lock(s_logMutex);
+	FILE* fp = category == RC_LOG_PROGRESS ? stdout : stderr;
+	const char* prefix = category == RC_LOG_ERROR ? "Error: " : category == RC_LOG_WARNING ? "Warning: " : "";
+	if (m_tileX != -1)
+		fprintf(fp, "(%d,%d) %s%s\n", m_tileX, m_tileY, prefix, msg);
+	else
+		fprintf(fp, "%s%s\n", prefix, msg);
+}
+
+void BakeContext::doResetTimers()
+{
+	for (int i = 0; i < RC_MAX_TIMERS; ++i)
+		m_accTime[i] = -1;
+}
+
+void BakeContext::doStartTimer(const rcTimerLabel label)
+{
+	m_startTime[label] = getPerfTime();
+	if (m_profiler)
+		m_profiler->beginSpan(duGetTimerLabelName(label), label);
+}
+
+void BakeContext::doStopTimer(const rcTimerLabel label)
+{
+	const TimeVal endTime = getPerfTime();
+	if (m_profiler)
+		m_profiler->endSpan();
+	const TimeVal deltaTime = endTime - m_startTime[label];
+	if (m_accTime[label] == -1)
+		m_accTime[label] = deltaTime;
+	else
+		m_accTime[label] += deltaTime;
+}
+
+int BakeContext::doGetAccumulatedTime(const rcTimerLabel label) const
+{
+	if (m_accTime[label] == -1)
+		return -1;
+	return getPerfTimeUsec(m_accTime[label]);
+}
@@ -0,0 +1,425 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <math.h>
+#include <string.h>
+#include <thread>
+#include "TileBaker.h"
+#include "BakeContext.h"
+#include "Recast.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+
+// Area and flags of the polygons, same as RecastDemo.
+enum BakePolyAreas
+{
+	BAKE_POLYAREA_GROUND,
+	BAKE_POLYAREA_WATER,
+	BAKE_POLYAREA_ROAD,
+	BAKE_POLYAREA_DOOR,
+	BAKE_POLYAREA_GRASS,
+	BAKE_POLYAREA_JUMP
+};
+enum BakePolyFlags
+{
+	BAKE_POLYFLAGS_WALK		= 0x01,
+	BAKE_POLYFLAGS_SWIM		= 0x02,
+	BAKE_POLYFLAGS_DOOR		= 0x04,
+	BAKE_POLYFLAGS_JUMP		= 0x08
+};
+
+void resetBuildSettings(BuildSettings& settings)
+{
+	memset(&settings, 0, sizeof(settings));
+	settings.cellSize = 0.3f;
+	settings.cellHeight = 0.2f;
+	settings.agentHeight = 2.0f;
+	settings.agentRadius = 0.6f;
+	settings.agentMaxClimb = 0.9f;
+	settings.agentMaxSlope = 45.0f;
+	settings.regionMinSize = 8;
+	settings.regionMergeSize = 20;
+	settings.edgeMaxLen = 12.0f;
+	settings.edgeMaxError = 1.3f;
+	settings.vertsPerPoly = 6.0f;
+	settings.detailSampleDist = 6.0f;
+	settings.detailSampleMaxError = 1.0f;
+	settings.partitionType = BAKE_PARTITION_WATERSHED;
+	settings.tileSize = 32;
+}
+
+void calcTileGrid(const InputGeom* geom, const BuildSettings& settings, TileGrid& grid)
+{
+	rcVcopy(grid.bmin, geom->getNavMeshBoundsMin());
+	rcVcopy(grid.bmax, geom->getNavMeshBoundsMax());
+	int gw = 0, gh = 0;
+	rcCalcGridSize(grid.bmin, grid.bmax, settings.cellSize, &gw, &gh);
+	const int ts = (int)settings.tileSize;
+	grid.width = (gw + ts-1) / ts;
+	grid.height = (gh + ts-1) / ts;
+	grid.tileSize = settings.tileSize*settings.cellSize;
+}
+
+// Intermediate results of a tile build.
+struct TileBuildData
+{
+	TileBuildData() : triareas(0), solid(0), chf(0), cset(0), pmesh(0), dmesh(0) {}
+	~TileBuildData()
+	{
+		delete [] triareas;
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeContourSet(cset);
+		rcFreePolyMesh(pmesh);
+		rcFreePolyMeshDetail(dmesh);
+	}
+
+	unsigned char* triareas;
+	rcHeightfield* solid;
+	rcCompactHeightfield* chf;
+	rcContourSet* cset;
+	rcPolyMesh* pmesh;
+	rcPolyMeshDetail* dmesh;
+};
+
+unsigned char* bakeTile(BakeContext* ctx, const InputGeom* geom, const BuildSettings& settings,
+						const TileGrid& grid, const int tx, const int ty, int& dataSize,
+						const int detailThreadCount)
+{
+	dataSize = 0;
+	ctx->setTile(tx, ty);
+
+	const float* verts = geom->getMesh()->getVerts();
+	const int nverts = geom->getMesh()->getVertCount();
+	const rcChunkyTriMesh* chunkyMesh = geom->getChunkyMesh();
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = settings.cellSize;
+	cfg.ch = settings.cellHeight;
+	cfg.walkableSlopeAngle = settings.agentMaxSlope;
+	cfg.walkableHeight = (int)ceilf(settings.agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(settings.agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(settings.agentRadius / cfg.cs);
+	cfg.maxEdgeLen = (int)(settings.edgeMaxLen / settings.cellSize);
+	cfg.maxSimplificationError = settings.edgeMaxError;
+	cfg.minRegionArea = (int)rcSqr(settings.regionMinSize);		// Note: area = size*size
+	cfg.mergeRegionArea = (int)rcSqr(settings.regionMergeSize);	// Note: area = size*size
+	cfg.maxVertsPerPoly = (int)settings.vertsPerPoly;
+	cfg.tileSize = (int)settings.tileSize;
+	cfg.borderSize = cfg.walkableRadius + 3; // Reserve enough padding.
+	cfg.width = cfg.tileSize + cfg.borderSize*2;
+	cfg.height = cfg.tileSize + cfg.borderSize*2;
+	cfg.detailSampleDist = settings.detailSampleDist < 0.9f ? 0 : settings.cellSize * settings.detailSampleDist;
+	cfg.detailSampleMaxError = settings.cellHeight * settings.detailSampleMaxError;
+
+	// Expand the tile bounds by the border size to find the geometry needed to build the tile.
+	cfg.bmin[0] = grid.bmin[0] + tx*grid.tileSize - cfg.borderSize*cfg.cs;
+	cfg.bmin[1] = grid.bmin[1];
+	cfg.bmin[2] = grid.bmin[2] + ty*grid.tileSize - cfg.borderSize*cfg.cs;
+	cfg.bmax[0] = grid.bmin[0] + (tx+1)*grid.tileSize + cfg.borderSize*cfg.cs;
+	cfg.bmax[1] = grid.bmax[1];
+	cfg.bmax[2] = grid.bmin[2] + (ty+1)*grid.tileSize + cfg.borderSize*cfg.cs;
+
+	rcScopedTimer totalTimer(ctx, RC_TIMER_TOTAL);
+
+	float tbmin[2], tbmax[2];
+	tbmin[0] = cfg.bmin[0];
+	tbmin[1] = cfg.bmin[2];
+	tbmax[0] = cfg.bmax[0];
+	tbmax[1] = cfg.bmax[2];
+	std::vector<int> cid(chunkyMesh->nnodes);
+	const int ncid = cid.empty() ? 0 : rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, &cid[0], (int)cid.size());
+	if (!ncid)
+		return 0;
+
+	TileBuildData data;
+
+	data.solid = rcAllocHeightfield();
+	if (!data.solid)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Out of memory 'solid'.");
+		return 0;
+	}
+	if (!rcCreateHeightfield(ctx, *data.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Could not create solid heightfield.");
+		return 0;
+	}
+
+	data.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+	for (int i = 0; i < ncid; ++i)
+	{
+		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+		const int* ctris = &chunkyMesh->tris[node.i*3];
+		const int nctris = node.n;
+
+		memset(data.triareas, 0, nctris*sizeof(unsigned char));
+		rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle, verts, nverts, ctris, nctris, data.triareas);
+		if (!rcRasterizeTriangles(ctx, verts, nverts, ctris, data.triareas, nctris, *data.solid, cfg.walkableClimb))
+			return 0;
+	}
+
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *data.solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *data.solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, *data.solid);
+
+	data.chf = rcAllocCompactHeightfield();
+	if (!data.chf)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Out of memory 'chf'.");
+		return 0;
+	}
+	if (!rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *data.solid, *data.chf))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Could not build compact data.");
+		return 0;
+	}
+	rcFreeHeightField(data.solid);
+	data.solid = 0;
+
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *data.chf))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Could not erode.");
+		return 0;
+	}
+
+	const ConvexVolume* vols = geom->getConvexVolumes();
+	for (int i = 0; i < geom->getConvexVolumeCount(); ++i)
+		rcMarkConvexPolyArea(ctx, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *data.chf);
+
+	if (settings.partitionType == BAKE_PARTITION_WATERSHED)
+	{
+		if (!rcBuildDistanceField(ctx, *data.chf))
+		{
+			ctx->log(RC_LOG_ERROR, "bakeTile: Could not build distance field.");
+			return 0;
+		}
+		if (!rcBuildRegions(ctx, *data.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+		{
+			ctx->log(RC_LOG_ERROR, "bakeTile: Could not build watershed regions.");
+			return 0;
+		}
+	}
+	else if (settings.partitionType == BAKE_PARTITION_MONOTONE)
+	{
+		if (!rcBuildRegionsMonotone(ctx, *data.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+		{
+			ctx->log(RC_LOG_ERROR, "bakeTile: Could not build monotone regions.");
+			return 0;
+		}
+	}
+	else
+	{
+		if (!rcBuildLayerRegions(ctx, *data.chf, cfg.borderSize, cfg.minRegionArea))
+		{
+			ctx->log(RC_LOG_ERROR, "bakeTile: Could not build layer regions.");
+			return 0;
+		}
+	}
+
+	data.cset = rcAllocContourSet();
+	if (!data.cset)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Out of memory 'cset'.");
+		return 0;
+	}
+	if (!rcBuildContours(ctx, *data.chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *data.cset))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Could not create contours.");
+		return 0;
+	}
+	if (data.cset->nconts == 0)
+		return 0;
+
+	data.pmesh = rcAllocPolyMesh();
+	if (!data.pmesh)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Out of memory 'pmesh'.");
+		return 0;
+	}
+	if (!rcBuildPolyMesh(ctx, *data.cset, cfg.maxVertsPerPoly, *data.pmesh))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Could not triangulate contours.");
+		return 0;
+	}
+
+	data.dmesh = rcAllocPolyMeshDetail();
+	if (!data.dmesh)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Out of memory 'dmesh'.");
+		return 0;
+	}
+	if (!rcBuildPolyMeshDetail(ctx, *data.pmesh, *data.chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *data.dmesh, detailThreadCount))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Could not build polymesh detail.");
+		return 0;
+	}
+
+	if (cfg.maxVertsPerPoly > DT_VERTS_PER_POLYGON)
+		return 0;
+	rcPolyMesh& pmesh = *data.pmesh;
+	if (pmesh.nverts >= 0xffff)
+	{
+		// The vertex indices are ushorts, and cannot point to more than 0xffff vertices.
+		ctx->log(RC_LOG_ERROR, "bakeTile: Too many vertices per tile %d (max: %d).", pmesh.nverts, 0xffff);
+		return 0;
+	}
+
+	// Update poly flags from areas.
+	for (int i = 0; i < pmesh.npolys; ++i)
+	{
+		if (pmesh.areas[i] == RC_WALKABLE_AREA)
+			pmesh.areas[i] = BAKE_POLYAREA_GROUND;
+
+		if (pmesh.areas[i] == BAKE_POLYAREA_GROUND ||
+			pmesh.areas[i] == BAKE_POLYAREA_GRASS ||
+			pmesh.areas[i] == BAKE_POLYAREA_ROAD)
+		{
+			pmesh.flags[i] = BAKE_POLYFLAGS_WALK;
+		}
+		else if (pmesh.areas[i] == BAKE_POLYAREA_WATER)
+		{
+			pmesh.flags[i] = BAKE_POLYFLAGS_SWIM;
+		}
+		else if (pmesh.areas[i] == BAKE_POLYAREA_DOOR)
+		{
+			pmesh.flags[i] = BAKE_POLYFLAGS_WALK | BAKE_POLYFLAGS_DOOR;
+		}
+	}
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = pmesh.verts;
+	params.vertCount = pmesh.nverts;
+	params.polys = pmesh.polys;
+	params.polyAreas = pmesh.areas;
+	params.polyFlags = pmesh.flags;
+	params.polyCount = pmesh.npolys;
+	params.nvp = pmesh.nvp;
+	params.detailMeshes = data.dmesh->meshes;
+	params.detailVerts = data.dmesh->verts;
+	params.detailVertsCount = data.dmesh->nverts;
+	params.detailTris = data.dmesh->tris;
+	params.detailTriCount = data.dmesh->ntris;
+	params.offMeshConVerts = geom->getOffMeshConnectionVerts();
+	params.offMeshConRad = geom->getOffMeshConnectionRads();
+	params.offMeshConDir = geom->getOffMeshConnectionDirs();
+	params.offMeshConAreas = geom->getOffMeshConnectionAreas();
+	params.offMeshConFlags = geom->getOffMeshConnectionFlags();
+	params.offMeshConUserID = geom->getOffMeshConnectionId();
+	params.offMeshConCount = geom->getOffMeshConnectionCount();
+	params.walkableHeight = settings.agentHeight;
+	params.walkableRadius = settings.agentRadius;
+	params.walkableClimb = settings.agentMaxClimb;
+	params.tileX = tx;
+	params.tileY = ty;
+	params.tileLayer = 0;
+	rcVcopy(params.bmin, pmesh.bmin);
+	rcVcopy(params.bmax, pmesh.bmax);
+	params.cs = cfg.cs;
+	params.ch = cfg.ch;
+	params.buildBvTree = true;
+
+	unsigned char* navData = 0;
+	if (!dtCreateNavMeshData(&params, &navData, &dataSize))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTile: Could not build Detour navmesh.");
+		return 0;
+	}
+
+	ctx->log(RC_LOG_PROGRESS, "%d vertices, %d polygons, %.1fkB", pmesh.nverts, pmesh.npolys, dataSize/1024.0f);
+
+	return navData;
+}
+
+WorkStealingScheduler::WorkStealingScheduler() :
+	m_func(0),
+	m_userData(0),
+	m_stealCount(0)
+{
+}
+
+void WorkStealingScheduler::run(int itemCount, int threadCount, JobFunc func, void* userData)
+{
+	if (threadCount < 1)
+		threadCount = 1;
+
+	m_func = func;
+	m_userData = userData;
+	m_stealCount = 0;
+
+	m_queues.resize(threadCount);
+	for (int i = 0; i < threadCount; ++i)
+	{
+		m_queues[i] = new WorkerQueue;
+		const int begin = (int)((long long)itemCount * i / threadCount);
+		const int end = (int)((long long)itemCount * (i+1) / threadCount);
+		for (int j = begin; j < end; ++j)
+			m_queues[i]->items.push_back(j);
+	}
+
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; ++i)
+		threads.push_back(std::thread(workerMain, this, i));
+	workerMain(this, 0);
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+
+	for (int i = 0; i < threadCount; ++i)
+		delete m_queues[i];
+	m_queues.clear();
+}
+
+void WorkStealingScheduler::workerMain(WorkStealingScheduler* scheduler, int worker)
+{
+	int item = 0;
+	// No item is ever added once the run started, so a worker which finds all the queues
+	// empty is done.
+	while (scheduler->popItem(worker, item) || scheduler->stealItem(worker, item))
+		scheduler->m_func(worker, item, scheduler->m_userData);
+}
+
+bool WorkStealingScheduler::popItem(int worker, int& item)
+{
+	WorkerQueue* queue = m_queues[worker];
+	std::lock_guard<std::mutex> lock(queue->lock);
+	if (queue->items.empty())
+		return false;
+	item = queue->items.front();
+	queue->items.pop_front();
+	return true;
+}
+
+bool WorkStealingScheduler::stealItem(int worker, int& item)
+{
+	const int count = (int)m_queues.size();
+	for (int i = 1; i < count; ++i)
+	{
+		WorkerQueue* queue = m_queues[(worker + i) % count];
+		std::lock_guard<std::mutex> lock(queue->lock);
+		if (queue->items.empty())
+			continue;
+		// Steal from the far end, away from the tiles the owner is working on.
+		item = queue->items.back();
+		queue->items.pop_back();
+		m_stealCount++;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,239 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+#include <math.h>
+#include <string.h>
+#include "TileCacheBaker.h"
+#include "BakeContext.h"
+#include "Recast.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "fastlz.h"
+
+BakeCompressor::~BakeCompressor()
+{
+	// Defined out of line to fix the weak v-tables warning
+}
+
+int BakeCompressor::maxCompressedSize(const int bufferSize)
+{
+	return (int)(bufferSize* 1.05f);
+}
+
+dtStatus BakeCompressor::compress(const unsigned char* buffer, const int bufferSize,
+								  unsigned char* compressed, const int /*maxCompressedSize*/, int* compressedSize)
+{
+	*compressedSize = fastlz_compress((const void*)buffer, bufferSize, compressed);
+	return DT_SUCCESS;
+}
+
+dtStatus BakeCompressor::decompress(const unsigned char* compressed, const int compressedSize,
+									unsigned char* buffer, const int maxBufferSize, int* bufferSize)
+{
+	*bufferSize = fastlz_decompress(compressed, compressedSize, buffer, maxBufferSize);
+	return *bufferSize < 0 ? DT_FAILURE : DT_SUCCESS;
+}
+
+void calcTileCacheParams(const BuildSettings& settings, const TileGrid& grid, dtTileCacheParams& params)
+{
+	memset(&params, 0, sizeof(params));
+	rcVcopy(params.orig, grid.bmin);
+	params.cs = settings.cellSize;
+	params.ch = settings.cellHeight;
+	params.width = (int)settings.tileSize;
+	params.height = (int)settings.tileSize;
+	params.walkableHeight = settings.agentHeight;
+	params.walkableRadius = settings.agentRadius;
+	params.walkableClimb = settings.agentMaxClimb;
+	params.maxSimplificationError = settings.edgeMaxError;
+	params.maxTiles = grid.width*grid.height*BAKE_EXPECTED_LAYERS_PER_TILE;
+	params.maxObstacles = 128;
+}
+
+// Intermediate results of a tile layers build.
+struct TileLayersBuildData
+{
+	TileLayersBuildData() : triareas(0), solid(0), chf(0), lset(0) {}
+	~TileLayersBuildData()
+	{
+		delete [] triareas;
+		rcFreeHeightField(solid);
+		rcFreeCompactHeightfield(chf);
+		rcFreeHeightfieldLayerSet(lset);
+	}
+
+	unsigned char* triareas;
+	rcHeightfield* solid;
+	rcCompactHeightfield* chf;
+	rcHeightfieldLayerSet* lset;
+};
+
+int bakeTileLayers(BakeContext* ctx, const InputGeom* geom, const BuildSettings& settings,
+				   const TileGrid& grid, const int tx, const int ty, dtTileCacheCompressor* comp,
+				   BakedLayer* layers, const int maxLayers)
+{
+	ctx->setTile(tx, ty);
+
+	const float* verts = geom->getMesh()->getVerts();
+	const int nverts = geom->getMesh()->getVertCount();
+	const rcChunkyTriMesh* chunkyMesh = geom->getChunkyMesh();
+
+	rcConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.cs = settings.cellSize;
+	cfg.ch = settings.cellHeight;
+	cfg.walkableSlopeAngle = settings.agentMaxSlope;
+	cfg.walkableHeight = (int)ceilf(settings.agentHeight / cfg.ch);
+	cfg.walkableClimb = (int)floorf(settings.agentMaxClimb / cfg.ch);
+	cfg.walkableRadius = (int)ceilf(settings.agentRadius / cfg.cs);
+	cfg.tileSize = (int)settings.tileSize;
+	cfg.borderSize = cfg.walkableRadius + 3; // Reserve enough padding.
+	cfg.width = cfg.tileSize + cfg.borderSize*2;
+	cfg.height = cfg.tileSize + cfg.borderSize*2;
+
+	// Expand the tile bounds by the border size to find the geometry needed to build the tile.
+	cfg.bmin[0] = grid.bmin[0] + tx*grid.tileSize - cfg.borderSize*cfg.cs;
+	cfg.bmin[1] = grid.bmin[1];
+	cfg.bmin[2] = grid.bmin[2] + ty*grid.tileSize - cfg.borderSize*cfg.cs;
+	cfg.bmax[0] = grid.bmin[0] + (tx+1)*grid.tileSize + cfg.borderSize*cfg.cs;
+	cfg.bmax[1] = grid.bmax[1];
+	cfg.bmax[2] = grid.bmin[2] + (ty+1)*grid.tileSize + cfg.borderSize*cfg.cs;
+
+	rcScopedTimer totalTimer(ctx, RC_TIMER_TOTAL);
+
+	float tbmin[2], tbmax[2];
+	tbmin[0] = cfg.bmin[0];
+	tbmin[1] = cfg.bmin[2];
+	tbmax[0] = cfg.bmax[0];
+	tbmax[1] = cfg.bmax[2];
+	std::vector<int> cid(chunkyMesh->nnodes);
+	const int ncid = cid.empty() ? 0 : rcGetChunksOverlappingRect(chunkyMesh, tbmin, tbmax, &cid[0], (int)cid.size());
+	if (!ncid)
+		return 0;
+
+	TileLayersBuildData data;
+
+	data.solid = rcAllocHeightfield();
+	if (!data.solid)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTileLayers: Out of memory 'solid'.");
+		return 0;
+	}
+	if (!rcCreateHeightfield(ctx, *data.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTileLayers: Could not create solid heightfield.");
+		return 0;
+	}
+
+	data.triareas = new unsigned char[chunkyMesh->maxTrisPerChunk];
+	for (int i = 0; i < ncid; ++i)
+	{
+		const rcChunkyTriMeshNode& node = chunkyMesh->nodes[cid[i]];
+		const int* ctris = &chunkyMesh->tris[node.i*3];
+		const int nctris = node.n;
+
+		memset(data.triareas, 0, nctris*sizeof(unsigned char));
+		rcMarkWalkableTriangles(ctx, cfg.walkableSlopeAngle, verts, nverts, ctris, nctris, data.triareas);
+		if (!rcRasterizeTriangles(ctx, verts, nverts, ctris, data.triareas, nctris, *data.solid, cfg.walkableClimb))
+			return 0;
+	}
+
+	rcFilterLowHangingWalkableObstacles(ctx, cfg.walkableClimb, *data.solid);
+	rcFilterLedgeSpans(ctx, cfg.walkableHeight, cfg.walkableClimb, *data.solid);
+	rcFilterWalkableLowHeightSpans(ctx, cfg.walkableHeight, *data.solid);
+
+	data.chf = rcAllocCompactHeightfield();
+	if (!data.chf)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTileLayers: Out of memory 'chf'.");
+		return 0;
+	}
+	if (!rcBuildCompactHeightfield(ctx, cfg.walkableHeight, cfg.walkableClimb, *data.solid, *data.chf))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTileLayers: Could not build compact data.");
+		return 0;
+	}
+	rcFreeHeightField(data.solid);
+	data.solid = 0;
+
+	if (!rcErodeWalkableArea(ctx, cfg.walkableRadius, *data.chf))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTileLayers: Could not erode.");
+		return 0;
+	}
+
+	const ConvexVolume* vols = geom->getConvexVolumes();
+	for (int i = 0; i < geom->getConvexVolumeCount(); ++i)
+		rcMarkConvexPolyArea(ctx, vols[i].verts, vols[i].nverts, vols[i].hmin, vols[i].hmax, (unsigned char)vols[i].area, *data.chf);
+
+	data.lset = rcAllocHeightfieldLayerSet();
+	if (!data.lset)
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTileLayers: Out of memory 'lset'.");
+		return 0;
+	}
+	if (!rcBuildHeightfieldLayers(ctx, *data.chf, cfg.borderSize, cfg.walkableHeight, *data.lset))
+	{
+		ctx->log(RC_LOG_ERROR, "bakeTileLayers: Could not build heightfield layers.");
+		return 0;
+	}
+
+	// Compress the layers on the calling thread, the compressed data outlives the arena of the tile.
+	const int nlayers = rcMin(data.lset->nlayers, maxLayers);
+	size_t dataSize = 0;
+	for (int i = 0; i < nlayers; ++i)
+	{
+		const rcHeightfieldLayer* layer = &data.lset->layers[i];
+
+		dtTileCacheLayerHeader header;
+		header.magic = DT_TILECACHE_MAGIC;
+		header.version = DT_TILECACHE_VERSION;
+		header.tx = tx;
+		header.ty = ty;
+		header.tlayer = i;
+		dtVcopy(header.bmin, layer->bmin);
+		dtVcopy(header.bmax, layer->bmax);
+		header.width = (unsigned char)layer->width;
+		header.height = (unsigned char)layer->height;
+		header.minx = (unsigned char)layer->minx;
+		header.maxx = (unsigned char)layer->maxx;
+		header.miny = (unsigned char)layer->miny;
+		header.maxy = (unsigned char)layer->maxy;
+		header.hmin = (unsigned short)layer->hmin;
+		header.hmax = (unsigned short)layer->hmax;
+
+		layers[i].data = 0;
+		layers[i].dataSize = 0;
+		if (dtStatusFailed(dtBuildTileCacheLayer(comp, &header, layer->heights, layer->areas, layer->cons,
+												 &layers[i].data, &layers[i].dataSize)))
+		{
+			ctx->log(RC_LOG_ERROR, "bakeTileLayers: Could not compress layer %d.", i);
+			for (int j = 0; j < i; ++j)
+			{
+				dtFree(layers[j].data);
+				layers[j].data = 0;
+			}
+			return 0;
+		}
+		dataSize += layers[i].dataSize;
+	}
+
+	ctx->log(RC_LOG_PROGRESS, "%d layers, %.1fkB", nlayers, dataSize/1024.0f);
+
+	return nlayers;
+}
@@ -0,0 +1,507 @@
+//
+// Copyright (c) 2009-2010 Mikko Mononen memon@inside.org
+//
+// This software is provided 'as-is', without any express or implied
+// warranty.  In no event will the authors be held liable for any damages
+// arising from the use of this software.
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+// 1. The origin of this software must not be misrepresented; you must not
+//    claim that you wrote the original software. If you use this software
+//    in a product, an acknowledgment in the product documentation would be
+//    appreciated but is not required.
+// 2. Altered source versions must be plainly marked as such, and must not be
+//    misrepresented as being the original software.
+// 3. This notice may not be removed or altered from any source distribution.
+//
+
+// Headless tiled navmesh baker.
+//
+// Builds all the tiles of an .obj or .gset file on worker threads and writes the navmesh
+// in the format loaded by RecastDemo. (See: Sample::loadAll)
+// Can also bake the compressed layers of a tile cache, in the format loaded by the
+// temp obstacles sample. (See: Sample_TempObstacles::loadAll)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+#include "RecastDump.h"
+#include "RecastProfiler.h"
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourTileCache.h"
+#include "InputGeom.h"
+#include "BakeContext.h"
+#include "TileBaker.h"
+#include "TileCacheBaker.h"
+
+static const int NAVMESHSET_MAGIC = 'M'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'MSET';
+static const int NAVMESHSET_VERSION = 1;
+
+struct NavMeshSetHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	dtNavMeshParams params;
+};
+
+struct NavMeshTileHeader
+{
+	dtTileRef tileRef;
+	int dataSize;
+};
+
+static const int TILECACHESET_MAGIC = 'T'<<24 | 'S'<<16 | 'E'<<8 | 'T'; //'TSET';
+static const int TILECACHESET_VERSION = 1;
+
+struct TileCacheSetHeader
+{
+	int magic;
+	int version;
+	int numTiles;
+	dtNavMeshParams meshParams;
+	dtTileCacheParams cacheParams;
+};
+
+struct TileCacheTileHeader
+{
+	dtCompressedTileRef tileRef;
+	int dataSize;
+};
+
+struct BakedTile
+{
+	unsigned char* data;
+	int dataSize;
+};
+
+struct BakedTileLayers
+{
+	BakedLayer layers[BAKE_MAX_LAYERS];
+	int nlayers;
+};
+
+struct BakeJob
+{
+	const InputGeom* geom;
+	const BuildSettings* settings;
+	const TileGrid* grid;
+	int detailThreadCount;
+	dtTileCacheCompressor* comp;
+	std::vector<BakeContext*> contexts;
+	std::vector<rcArena*> arenas;
+	std::vector<BakedTile> tiles;
+	std::vector<BakedTileLayers> tileLayers;
+};
+
+/// Write only stdio file.
+class TraceFile : public duFileIO
+{
+	FILE* m_fp;
+public:
+	TraceFile(const char* path) : m_fp(fopen(path, "wb")) {}
+	virtual ~TraceFile() { if (m_fp) fclose(m_fp); }
+	virtual bool isWriting() const { return m_fp != 0; }
+	virtual bool isReading() const { return false; }
+	virtual bool write(const void* ptr, const size_t size) { return m_fp && fwrite(ptr, size, 1, m_fp) == 1; }
+	virtual bool read(void* /*ptr*/, const size_t /*size*/) { return false; }
+private:
+	// Explicitly disabled copy constructor and copy assignment operator.
+	TraceFile(const TraceFile&);
+	TraceFile& operator=(const TraceFile&);
+};
+
+static void bakeTileJob(int worker, int item, void* userData)
+{
+	BakeJob* job = (BakeJob*)userData;
+	const int tx = item % job->grid->width;
+	const int ty = item / job->grid->width;
+	BakedTile& tile = job->tiles[item];
+	// The intermediate data of the tile is allocated from the arena of the worker, and
+	// released at once when the tile is done. The tile data is allocated with dtAlloc.
+	rcScopedArena arenaScope(job->arenas[worker]);
+	tile.data = bakeTile(job->contexts[worker], job->geom, *job->settings, *job->grid, tx, ty, tile.dataSize,
+						 job->detailThreadCount);
+}
+
+static void bakeTileLayersJob(int worker, int item, void* userData)
+{
+	BakeJob* job = (BakeJob*)userData;
+	const int tx = item % job->grid->width;
+	const int ty = item / job->grid->width;
+	BakedTileLayers& tile = job->tileLayers[item];
+	// Rasterization, layers and compression all run on the worker, only the compressed
+	// layers are allocated with dtAlloc.
+	rcScopedArena arenaScope(job->arenas[worker]);
+	tile.nlayers = bakeTileLayers(job->contexts[worker], job->geom, *job->settings, *job->grid, tx, ty,
+								  job->comp, tile.layers, BAKE_MAX_LAYERS);
+}
+
+static void printUsage()
+{
+	printf("Usage: RecastBake [options] <input.obj|input.gset>\n");
+	printf("Options:\n");
+	printf("  -o <file>         Output navmesh file. (default: input file with .bin extension)\n");
+	printf("  -j <threads>      Number of worker threads. (default: hardware threads)\n");
+	printf("  -d <threads>      Number of threads building the detail mesh of each tile, per worker. (default: 1)\n");
+	printf("  -s <size>         Tile size in voxels, overrides the .gset settings.\n");
+	printf("  -c <size>         Cell size in world units, overrides the .gset settings.\n");
+	printf("  -p <partition>    watershed, monotone or layers, overrides the .gset settings.\n");
+	printf("  -l                Bake the compressed layers of a tile cache instead of a navmesh.\n");
+	printf("  -t <file>         Write a Chrome trace of the build stages and log their statistics.\n");
+	printf("  -v                Log the build of each tile.\n");
+}
+
+// Same format as Sample::saveAll.
+static bool writeNavMeshSet(const char* path, const dtNavMesh* mesh)
+{
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+		return false;
+
+	NavMeshSetHeader header;
+	header.magic = NAVMESHSET_MAGIC;
+	header.version = NAVMESHSET_VERSION;
+	header.numTiles = 0;
+	for (int i = 0; i < mesh->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+		header.numTiles++;
+	}
+	memcpy(&header.params, mesh->getParams(), sizeof(dtNavMeshParams));
+	bool ok = fwrite(&header, sizeof(NavMeshSetHeader), 1, fp) == 1;
+
+	for (int i = 0; i < mesh->getMaxTiles() && ok; ++i)
+	{
+		const dtMeshTile* tile = mesh->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+
+		NavMeshTileHeader tileHeader;
+		tileHeader.tileRef = mesh->getTileRef(tile);
+		tileHeader.dataSize = tile->dataSize;
+		ok = fwrite(&tileHeader, sizeof(tileHeader), 1, fp) == 1 &&
+			 fwrite(tile->data, tile->dataSize, 1, fp) == 1;
+	}
+
+	if (fclose(fp) != 0)
+		ok = false;
+	return ok;
+}
+
+// Same format as Sample_TempObstacles::saveAll.
+static bool writeTileCacheSet(const char* path, const dtTileCache* tileCache, const dtNavMeshParams* meshParams)
+{
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+		return false;
+
+	TileCacheSetHeader header;
+	header.magic = TILECACHESET_MAGIC;
+	header.version = TILECACHESET_VERSION;
+	header.numTiles = 0;
+	for (int i = 0; i < tileCache->getTileCount(); ++i)
+	{
+		const dtCompressedTile* tile = tileCache->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+		header.numTiles++;
+	}
+	memcpy(&header.cacheParams, tileCache->getParams(), sizeof(dtTileCacheParams));
+	memcpy(&header.meshParams, meshParams, sizeof(dtNavMeshParams));
+	bool ok = fwrite(&header, sizeof(TileCacheSetHeader), 1, fp) == 1;
+
+	for (int i = 0; i < tileCache->getTileCount() && ok; ++i)
+	{
+		const dtCompressedTile* tile = tileCache->getTile(i);
+		if (!tile || !tile->header || !tile->dataSize) continue;
+
+		TileCacheTileHeader tileHeader;
+		tileHeader.tileRef = tileCache->getTileRef(tile);
+		tileHeader.dataSize = tile->dataSize;
+		ok = fwrite(&tileHeader, sizeof(tileHeader), 1, fp) == 1 &&
+			 fwrite(tile->data, tile->dataSize, 1, fp) == 1;
+	}
+
+	if (fclose(fp) != 0)
+		ok = false;
+	return ok;
+}
+
+// Tiles are added in a fixed order, so that the archive does not depend on the scheduling.
+static bool writeNavMesh(const char* path, BakeJob& job, const dtNavMeshParams& params)
+{
+	dtNavMesh* mesh = dtAllocNavMesh();
+	if (!mesh || dtStatusFailed(mesh->init(&params)))
+	{
+		fprintf(stderr, "Could not init navmesh.\n");
+		dtFreeNavMesh(mesh);
+		return false;
+	}
+	for (size_t i = 0; i < job.tiles.size(); ++i)
+	{
+		if (!job.tiles[i].data)
+			continue;
+		if (dtStatusFailed(mesh->addTile(job.tiles[i].data, job.tiles[i].dataSize, DT_TILE_FREE_DATA, 0, 0)))
+		{
+			fprintf(stderr, "Could not add tile (%d,%d).\n", (int)i % job.grid->width, (int)i / job.grid->width);
+			dtFree(job.tiles[i].data);
+		}
+	}
+
+	const bool written = writeNavMeshSet(path, mesh);
+	dtFreeNavMesh(mesh);
+	return written;
+}
+
+// The layers are added to the tile cache in bulk once all the tiles are built, in a fixed
+// order, so that the tile refs do not depend on the scheduling.
+static bool writeTileCache(const char* path, BakeJob& job, const dtNavMeshParams& meshParams)
+{
+	dtTileCacheParams params;
+	calcTileCacheParams(*job.settings, *job.grid, params);
+
+	// Adding tiles does not allocate, decompress nor process meshes, only the compressor is needed.
+	dtTileCache* tileCache = dtAllocTileCache();
+	if (!tileCache || dtStatusFailed(tileCache->init(&params, 0, job.comp, 0)))
+	{
+		fprintf(stderr, "Could not init tile cache.\n");
+		dtFreeTileCache(tileCache);
+		return false;
+	}
+	for (size_t i = 0; i < job.tileLayers.size(); ++i)
+	{
+		BakedTileLayers& tile = job.tileLayers[i];
+		for (int j = 0; j < tile.nlayers; ++j)
+		{
+			if (dtStatusFailed(tileCache->addTile(tile.layers[j].data, tile.layers[j].dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)))
+			{
+				fprintf(stderr, "Could not add layer %d of tile (%d,%d).\n", j, (int)i % job.grid->width, (int)i / job.grid->width);
+				dtFree(tile.layers[j].data);
+			}
+		}
+	}
+
+	const bool written = writeTileCacheSet(path, tileCache, &meshParams);
+	dtFreeTileCache(tileCache);
+	return written;
+}
+
+int main(int argc, char** argv)
+{
+	const char* inputPath = 0;
+	std::string outputPath;
+	int threadCount = (int)std::thread::hardware_concurrency();
+	int detailThreadCount = 1;
+	float tileSize = 0;
+	float cellSize = 0;
+	int partitionType = -1;
+	bool verbose = false;
+	bool bakeLayers = false;
+	const char* tracePath = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		const bool hasValue = i+1 < argc;
+		if (strcmp(arg, "-o") == 0 && hasValue)
+			outputPath = argv[++i];
+		else if (strcmp(arg, "-j") == 0 && hasValue)
+			threadCount = atoi(argv[++i]);
+		else if (strcmp(arg, "-d") == 0 && hasValue)
+			detailThreadCount = atoi(argv[++i]);
+		else if (strcmp(arg, "-s") == 0 && hasValue)
+			tileSize = (float)atof(argv[++i]);
+		else if (strcmp(arg, "-c") == 0 && hasValue)
+			cellSize = (float)atof(argv[++i]);
+		else if (strcmp(arg, "-p") == 0 && hasValue)
+		{
+			const char* name = argv[++i];
+			if (strcmp(name, "watershed") == 0)
+				partitionType = BAKE_PARTITION_WATERSHED;
+			else if (strcmp(name, "monotone") == 0)
+				partitionType = BAKE_PARTITION_MONOTONE;
+			else if (strcmp(name, "layers") == 0)
+				partitionType = BAKE_PARTITION_LAYERS;
+			else
+			{
+				fprintf(stderr, "Unknown partition type '%s'.\n", name);
+				return 1;
+			}
+		}
+		else if (strcmp(arg, "-t") == 0 && hasValue)
+			tracePath = argv[++i];
+		else if (strcmp(arg, "-v") == 0)
+			verbose = true;
+		else if (strcmp(arg, "-l") == 0)
+			bakeLayers = true;
+		else if (arg[0] != '-' && !inputPath)
+			inputPath = arg;
+		else
+		{
+			printUsage();
+			return strcmp(arg, "-h") == 0 ? 0 : 1;
+		}
+	}
+	if (!inputPath)
+	{
+		printUsage();
+		return 1;
+	}
+	if (threadCount < 1)
+		threadCount = 1;
+	if (detailThreadCount < 1)
+		detailThreadCount = 1;
+	if (outputPath.empty())
+	{
+		outputPath = inputPath;
+		const size_t extPos = outputPath.find_last_of('.');
+		if (extPos != std::string::npos)
+			outputPath = outputPath.substr(0, extPos);
+		outputPath += ".bin";
+	}
+
+	BakeContext ctx(true);
+
+	InputGeom geom;
+	if (!geom.load(&ctx, inputPath) || !geom.getMesh())
+	{
+		fprintf(stderr, "Could not load '%s'.\n", inputPath);
+		return 1;
+	}
+
+	BuildSettings settings;
+	if (geom.getBuildSettings())
+		settings = *geom.getBuildSettings();
+	else
+		resetBuildSettings(settings);
+	if (settings.tileSize <= 0)
+		settings.tileSize = 32;
+	if (tileSize > 0)
+		settings.tileSize = tileSize;
+	if (cellSize > 0)
+		settings.cellSize = cellSize;
+	if (partitionType != -1)
+		settings.partitionType = partitionType;
+
+	TileGrid grid;
+	calcTileGrid(&geom, settings, grid);
+	const int tileCount = grid.width * grid.height;
+
+	// Max tiles and max polys affect how the tile IDs are calculated.
+	// There are 22 bits available for identifying a tile and a polygon.
+	// A tile cache builds a navmesh tile per layer.
+	const int maxNavMeshTiles = bakeLayers ? tileCount*BAKE_EXPECTED_LAYERS_PER_TILE : tileCount;
+	int tileBits = rcMin((int)dtIlog2(dtNextPow2((unsigned int)maxNavMeshTiles)), 14);
+	int polyBits = 22 - tileBits;
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	rcVcopy(params.orig, grid.bmin);
+	params.tileWidth = grid.tileSize;
+	params.tileHeight = grid.tileSize;
+	params.maxTiles = 1 << tileBits;
+	params.maxPolys = 1 << polyBits;
+
+	printf("Baking %s of '%s': %d x %d tiles, %.1fK verts, %.1fK tris, %d threads\n",
+		   bakeLayers ? "tile cache" : "navmesh", inputPath, grid.width, grid.height, geom.getMesh()->getVertCount()/1000.0f,
+		   geom.getMesh()->getTriCount()/1000.0f, threadCount);
+
+	duProfiler* profiler = tracePath ? new duProfiler() : 0;
+
+	BakeCompressor comp;
+	BakeJob job;
+	job.geom = &geom;
+	job.settings = &settings;
+	job.grid = &grid;
+	job.detailThreadCount = detailThreadCount;
+	job.comp = &comp;
+	if (bakeLayers)
+		job.tileLayers.resize(tileCount);
+	else
+		job.tiles.resize(tileCount);
+	for (int i = 0; i < threadCount; ++i)
+	{
+		job.contexts.push_back(new BakeContext(verbose, profiler));
+		job.arenas.push_back(new rcArena());
+	}
+
+	WorkStealingScheduler scheduler;
+	const TimeVal startTime = getPerfTime();
+	scheduler.run(tileCount, threadCount, bakeLayers ? bakeTileLayersJob : bakeTileJob, &job);
+	const TimeVal endTime = getPerfTime();
+
+	// Per stage times, summed over all the threads.
+	BakeContext times(true);
+	for (int i = 0; i < threadCount; ++i)
+	{
+		times.accumulate(*job.contexts[i]);
+		delete job.contexts[i];
+	}
+	size_t arenaPeak = 0;
+	for (int i = 0; i < threadCount; ++i)
+	{
+		arenaPeak = rcMax(arenaPeak, job.arenas[i]->getPeakSize());
+		delete job.arenas[i];
+	}
+	const int totalTime = times.getAccumulatedTime(RC_TIMER_TOTAL);
+	if (totalTime > 0)
+		duLogBuildTimes(times, totalTime);
+
+	if (profiler)
+	{
+		duLogProfileStats(times, *profiler);
+		TraceFile traceFile(tracePath);
+		if (!duDumpChromeTrace(*profiler, &traceFile))
+			fprintf(stderr, "Could not write '%s'.\n", tracePath);
+		delete profiler;
+	}
+
+	int builtTiles = 0;
+	int builtLayers = 0;
+	size_t dataSize = 0;
+	for (int i = 0; i < tileCount; ++i)
+	{
+		if (bakeLayers)
+		{
+			const BakedTileLayers& tile = job.tileLayers[i];
+			if (!tile.nlayers)
+				continue;
+			builtTiles++;
+			builtLayers += tile.nlayers;
+			for (int j = 0; j < tile.nlayers; ++j)
+				dataSize += tile.layers[j].dataSize;
+		}
+		else
+		{
+			if (!job.tiles[i].data)
+				continue;
+			builtTiles++;
+			dataSize += job.tiles[i].dataSize;
+		}
+	}
+	if (bakeLayers)
+		printf("Built %d layers in %d tiles (%.1fkB)", builtLayers, builtTiles, dataSize/1024.0f);
+	else
+		printf("Built %d tiles (%.1fkB)", builtTiles, dataSize/1024.0f);
+	printf(" in %.2fms, %d tiles stolen, %.1fkB peak arena\n", getPerfTimeUsec(endTime - startTime)/1000.0f,
+		   scheduler.getStealCount(), arenaPeak/1024.0f);
+
+	const bool written = bakeLayers ? writeTileCache(outputPath.c_str(), job, params) :
+									  writeNavMesh(outputPath.c_str(), job, params);
+	if (!written)
+	{
+		fprintf(stderr, "Could not write '%s'.\n", outputPath.c_str());
+		return 1;
+	}
+	printf("Wrote '%s'\n", outputPath.c_str());
+
+	return 0;
+}
@@ -23,6 +23,7 @@
 #include "Recast.h"
 #include "RecastDump.h"
 #include "PerfTimer.h"
+#include <mutex>
 
 // These are example implementations of various interfaces used in Recast and Detour.
 
@@ -38,6 +39,8 @@ class BuildContext : public rcContext
 	static const int TEXT_POOL_SIZE = 8000;
 	char m_textPool[TEXT_POOL_SIZE];
 	int m_textPoolSize;
+	/// The detail meshes are built on several threads, which log to the same context.
+	std::mutex m_logMutex;
 	
 public:
 	BuildContext();
@@ -27,6 +27,7 @@ BuildContext::BuildContext() :
 // Virtual functions for custom implementations.
 void BuildContext::doResetLog()
 {
+	std::lock_guard<std::mutex> lock(m_logMutex);
 	m_messageCount = 0;
 	m_textPoolSize = 0;
 }
@@ -34,6 +35,7 @@ void BuildContext::doResetLog()
 void BuildContext::doLog(const rcLogCategory category, const char* msg, const int len)
 {
 	if (!len) return;
+	std::lock_guard<std::mutex> lock(m_logMutex);
 	if (m_messageCount >= MAX_MESSAGES)
 		return;
 	char* dst = &m_textPool[m_textPoolSize];
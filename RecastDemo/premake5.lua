@@ -195,6 +195,62 @@ project "RecastDemo"
 			"Cocoa.framework",
 		}
 
+project "RecastBakeLib"
+	language "C++"
+	kind "StaticLib"
+	cppdialect "C++11" -- std::thread
+	includedirs {
+		"../RecastBake/Include",
+		"../RecastDemo/Include",
+		"../RecastDemo/Contrib/fastlz",
+		"../DebugUtils/Include",
+		"../Detour/Include",
+		"../DetourTileCache/Include",
+		"../Recast/Include"
+	}
+	files {
+		"../RecastBake/Include/*.h",
+		"../RecastBake/Source/BakeContext.cpp",
+		"../RecastBake/Source/TileBaker.cpp",
+		"../RecastBake/Source/TileCacheBaker.cpp",
+		"../RecastDemo/Source/ChunkyTriMesh.cpp",
+		"../RecastDemo/Source/InputGeom.cpp",
+		"../RecastDemo/Source/MeshLoaderObj.cpp",
+		"../RecastDemo/Source/PerfTimer.cpp",
+		"../RecastDemo/Contrib/fastlz/fastlz.c"
+	}
+
+project "RecastBake"
+	language "C++"
+	kind "ConsoleApp"
+	cppdialect "C++11" -- std::thread
+	includedirs {
+		"../RecastBake/Include",
+		"../RecastDemo/Include",
+		"../DebugUtils/Include",
+		"../Detour/Include",
+		"../DetourTileCache/Include",
+		"../Recast/Include"
+	}
+	files {
+		"../RecastBake/Source/main.cpp"
+	}
+
+	-- project dependencies
+	links {
+		"RecastBakeLib",
+		"DebugUtils",
+		"Detour",
+		"DetourTileCache",
+		"Recast"
+	}
+
+	-- distribute executable in RecastDemo/Bin directory
+	targetdir "Bin"
+
+	filter "system:linux"
+		links { "pthread" }
+
 project "Tests"
 	language "C++"
 	kind "ConsoleApp"
@@ -224,6 +280,7 @@ project "Tests"
 		"../Tests/Detour/*.h",
 		"../Tests/Detour/*.cpp",
 		"../Tests/DetourCrowd/*.cpp",
+		"../Tests/DetourTileCache/*.cpp",
 		"../Tests/Contrib/catch2/*.cpp"
 	}
 
@@ -0,0 +1,30 @@
+#pragma once
+
+/// Accounts the Detour memory (NavMeshes, tiles and NavMesh queries) of each environment (client X or server).
+/// The allocations of a thread are accounted to the environment of the current EnvironmentMemoryScope of the thread,
+/// and the frees are accounted to the environment of the allocation, whatever thread frees it.
+class EnvironmentMemory
+{
+public:
+	/// Installs the Detour allocator that does the accounting. Must be called before any Detour allocation.
+	/// Can be called from several threads, the allocator is only installed once.
+	static void install();
+
+	/// Returns the number of bytes currently allocated for an environment.
+	static long long getAllocatedBytes(int environmentId);
+};
+
+/// Accounts the Detour allocations of the calling thread to an environment, until the scope ends.
+class EnvironmentMemoryScope
+{
+public:
+	explicit EnvironmentMemoryScope(int environmentId);
+	~EnvironmentMemoryScope();
+
+private:
+	void* m_previousCounter;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	EnvironmentMemoryScope(const EnvironmentMemoryScope&);
+	EnvironmentMemoryScope& operator=(const EnvironmentMemoryScope&);
+};
@@ -60,4 +60,8 @@ struct NavMeshBuildConfig
 
 	/// The type of NavMesh partitioning (see PartitionType enum)
 	int partitionType;
+
+	/// The number of threads building the detail mesh of a NavMesh or of a tile, including the calling thread.
+	/// Values below 2 build it on the calling thread only.
+	int detailThreadCount;
 };
@@ -1,10 +1,17 @@
 ﻿#pragma once
 #include "DetourStatus.h"
+#include "NavMeshBuildConfig.h"
 #include "NavMeshBuildData.h"
 
 class NavMeshBuildUtility
 {
 public:
+	/// Initializes the build config of a tile. The bounds of the config are the bounds of the tile plus its border.
+	/// @param[in]	tileBmin	The min bounds of the tile, without its border.
+	/// @param[in]	tileBmax	The max bounds of the tile, without its border.
+	static void initTileConfig(const NavMeshBuildConfig& config, float tileSize,
+	                           const float* tileBmin, const float* tileBmax, rcConfig& rcConfig);
+
 	static dtStatus prepareTriangleRasterization(const rcConfig& rcConfig, int triAreasCount,
 	                                             NavMeshBuildData& buildData, rcContext& context);
 
@@ -21,5 +28,5 @@ public:
 
 	static dtStatus buildMesh(const rcConfig& rcConfig, NavMeshBuildData& buildData, rcContext& context);
 
-	static dtStatus buildDetailMesh(const rcConfig& rcConfig, NavMeshBuildData& buildData, rcContext& context);
+	static dtStatus buildDetailMesh(const rcConfig& rcConfig, int threadCount, NavMeshBuildData& buildData, rcContext& context);
 };
@@ -0,0 +1,107 @@
+#pragma once
+#include <vector>
+
+#include "DetourNavMesh.h"
+#include "PluginHandleTable.h"
+
+/// The cached debug draw data of one tile of a NavMesh.
+/// Should be in sync with the C# side. The pointers stay valid until the next update of the cache.
+struct NavMeshDebugDrawTileData
+{
+	/// The positions of all the vertices from the polygon triangles (3 items per vertex).
+	const float* polyTrianglesPositions;
+	/// The area of all the polygon triangles.
+	const unsigned char* polyTrianglesArea;
+	/// The number of polygon triangles.
+	int polyTrianglesCount;
+
+	/// The boundaries positions (3 items per position). The positions are organised line by line (2 positions per line)
+	const float* boundariesPositions;
+	/// The type of boundary for each line.
+	const unsigned char* boundariesType;
+	/// The number of boundary lines.
+	int boundariesLinesCount;
+
+	/// The generation of the cache at which the tile last changed.
+	int generation;
+};
+
+/// Keeps the debug draw data of each tile of a NavMesh, and only fetches the tiles that changed since the last update.
+/// A tile changed when it was added, removed or replaced at the same reference, which changes its change count,
+/// or when one of its neighbours did, which can change the type of its boundaries.
+/// Changes that keep the tiles, like new polygon areas, are only seen after #invalidate.
+///
+/// The cache references its NavMesh by handle, and is given the NavMesh on each update, so it never keeps a pointer
+/// to a disposed NavMesh. A cache must be used from one thread at a time.
+class NavMeshDebugDrawCache
+{
+public:
+	/// @param[in]	navMesh		The handle of the NavMesh.
+	/// @param[in]	maxTiles	The max number of tiles of the NavMesh.
+	NavMeshDebugDrawCache(PluginHandle navMesh, int maxTiles);
+
+	/// Fetches the data of the tiles that changed since the last update.
+	/// The tiles of the NavMesh must not be added or removed during the update.
+	/// @param[in]	navMesh		The NavMesh of the handle of the cache.
+	/// @return The generation of the cache, which is increased when a tile changed.
+	int update(const dtNavMesh& navMesh);
+
+	/// Marks all the tiles as changed, so that the next update fetches them again.
+	void invalidate();
+
+	/// Gets the tiles that changed after a generation.
+	/// @param[in]	generation		The generation of the last data the caller copied. 0 to get all the tiles.
+	/// @param[out]	tileIndices		The indices of the changed tiles.
+	/// @param[in]	maxTileIndices	The max number of indices that tileIndices can hold.
+	/// @return The number of changed tiles, which can be more than maxTileIndices.
+	int getChangedTiles(int generation, int* tileIndices, int maxTileIndices) const;
+
+	/// Gets the cached data of a tile. A removed tile has no triangles and no boundaries.
+	/// @return False if the tile index is out of range.
+	bool getTileData(int tileIndex, NavMeshDebugDrawTileData* tileData) const;
+
+	/// The total number of triangles of all the tiles, to size the buffers of the caller.
+	int getPolyTrianglesCount() const { return m_polyTrianglesCount; }
+	/// The total number of boundary lines of all the tiles.
+	int getBoundariesLinesCount() const { return m_boundariesLinesCount; }
+
+	int getGeneration() const { return m_generation; }
+
+	PluginHandle getNavMesh() const { return m_navMesh; }
+
+private:
+	struct TileCache
+	{
+		TileCache() : changeCount(0), hasTile(false), x(0), y(0), dirty(false), generation(0), polyTrianglesCount(0), boundariesLinesCount(0) {}
+
+		/// The change count of the tile when it was last fetched.
+		unsigned int changeCount;
+		/// True if the slot had a tile when it was last fetched.
+		bool hasTile;
+		/// The location of the tile when it was last fetched.
+		int x;
+		int y;
+		bool dirty;
+		int generation;
+
+		std::vector<float> polyTrianglesPositions;
+		std::vector<unsigned char> polyTrianglesArea;
+		int polyTrianglesCount;
+		std::vector<float> boundariesPositions;
+		std::vector<unsigned char> boundariesType;
+		int boundariesLinesCount;
+	};
+
+	void markNeighboursDirty(const dtNavMesh& navMesh, int x, int y);
+	void fetchTile(const dtNavMesh& navMesh, int tileIndex);
+
+	PluginHandle m_navMesh;
+	std::vector<TileCache> m_tiles;
+	int m_generation;
+	int m_polyTrianglesCount;
+	int m_boundariesLinesCount;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	NavMeshDebugDrawCache(const NavMeshDebugDrawCache&);
+	NavMeshDebugDrawCache& operator=(const NavMeshDebugDrawCache&);
+};
@@ -85,9 +85,12 @@ class NavMeshDebugDrawUtility
 public:
 	static bool fetchTileNavMeshDebugDrawData(const dtNavMesh& mesh, NavMeshDebugDrawData* debugDrawData);
 
-private:
+	/// Fetches the triangles and the boundaries of a single tile.
+	/// Returns false if the buffers of the data could not contain all of them.
 	static bool fetchMeshTileData(const dtNavMesh& mesh, const dtMeshTile* tile, NavMeshDebugDrawData* debugDrawData);
 
+private:
+
 	static bool fetchMeshBoundariesData(const dtMeshTile* tile, NavMeshDebugDrawData* debugDrawData);
 
 	static float distancePtLine2d(const float* pt, const float* p, const float* q);
@@ -0,0 +1,152 @@
+#pragma once
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+/// A handle to an object allocated for the C# side.
+/// The low 32 bits are the slot of the object in the table plus one, and the high 32 bits the generation of the slot.
+/// The generation changes when the object is freed, so a handle to a disposed object stays invalid even if
+/// its slot is reused. 0 is never a valid handle.
+typedef uint64_t PluginHandle;
+
+/// The types of the objects of the handle table.
+enum PluginObjectType
+{
+	PLUGIN_OBJECT_NAVMESH = 1,
+	PLUGIN_OBJECT_NAVMESH_QUERY = 2,
+	PLUGIN_OBJECT_TILE_HEIGHTFIELD_CACHE = 3,
+	PLUGIN_OBJECT_NAVMESH_DEBUG_DRAW_CACHE = 4
+};
+
+/// Owns the objects allocated for the C# side, grouped by environment (client X or server).
+/// Adding, acquiring and disposing a handle are O(1), plus disposing the objects which depend on it, and all the
+/// methods can be called from several threads.
+///
+/// An object is used through a lease (see #acquire and PluginHandleLease). Disposing an object invalidates its
+/// handle at once, but the object is only freed when its last lease is released, so a thread using it is never
+/// left with a dangling pointer.
+///
+/// An object can depend on another one of the same environment, like a NavMesh query on its NavMesh. The dependent
+/// object holds a lease on its owner, and is disposed with it.
+class PluginHandleTable
+{
+public:
+	PluginHandleTable();
+	/// Frees all the remaining objects.
+	~PluginHandleTable();
+
+	/// Takes ownership of an object.
+	/// @param[in]	owner	The handle of the object this one depends on, or 0. Must be valid.
+	/// @return The handle of the object, or 0 if the object is null or the owner was disposed. The object is not
+	/// owned by the table then.
+	PluginHandle add(void* object, PluginObjectType type, int environmentId, PluginHandle owner = 0);
+
+	/// Returns the object of a handle and keeps it alive until #release, or null if the handle was disposed
+	/// or is of another type.
+	/// @param[out]	environmentId	The environment of the object. Can be null.
+	void* acquire(PluginHandle handle, PluginObjectType type, int* environmentId = nullptr);
+
+	/// Releases a lease taken by #acquire. Frees the object if it was disposed and this was its last lease.
+	void release(PluginHandle handle);
+
+	/// Disposes the object of a handle and the objects which depend on it.
+	/// @return False if the handle was already disposed or is of another type.
+	bool dispose(PluginHandle handle, PluginObjectType type);
+
+	/// Disposes all the objects of an environment.
+	void disposeEnvironment(int environmentId);
+
+	/// Returns the number of objects of an environment that were not disposed.
+	int getObjectsCount(int environmentId) const;
+
+	/// Returns true if all the objects were disposed.
+	bool empty() const;
+
+private:
+	struct Slot
+	{
+		void* object;
+		PluginObjectType type;
+		int environmentId;
+		uint32_t generation;
+		/// The next free slot when the slot is free, otherwise the position of the slot in the slots of its environment.
+		int next;
+		/// The number of leases on the object, including the ones of the objects which depend on it.
+		int leases;
+		/// True once the object is disposed. It is freed when its leases are released.
+		bool disposed;
+		/// The handle of the object this one depends on, or 0.
+		PluginHandle owner;
+		/// The first slot of the objects which depend on this one and were not disposed, or -1.
+		int firstDependent;
+		/// The previous and next slots in the dependents of the owner, or -1.
+		int prevDependent;
+		int nextDependent;
+	};
+
+	/// An object to free outside of the lock.
+	struct FreedObject
+	{
+		void* object;
+		PluginObjectType type;
+		PluginHandle owner;
+	};
+
+	int findSlot(PluginHandle handle) const;
+	/// Disposes a used slot, and adds its object to the objects to free if it has no lease.
+	void disposeSlot(int slotIndex, std::vector<FreedObject>& freedObjects);
+	/// Frees a disposed slot without lease, and adds its object to the objects to free.
+	void freeSlot(int slotIndex, std::vector<FreedObject>& freedObjects);
+	/// Frees the objects, and releases their leases on their owners.
+	void freeObjects(std::vector<FreedObject>& freedObjects);
+	static void freeObject(void* object, PluginObjectType type);
+
+	std::vector<Slot> m_slots;
+	int m_firstFreeSlot;
+	int m_objectsCount;
+	/// The slots of each environment which were not disposed.
+	std::unordered_map<int, std::vector<int> > m_environmentSlots;
+	mutable std::mutex m_mutex;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	PluginHandleTable(const PluginHandleTable&);
+	PluginHandleTable& operator=(const PluginHandleTable&);
+};
+
+/// A lease on the object of a handle, released when the lease is destroyed.
+template <class T, PluginObjectType Type>
+class PluginHandleLease
+{
+public:
+	PluginHandleLease(PluginHandleTable& table, PluginHandle handle) :
+		m_table(table),
+		m_handle(handle),
+		m_environmentId(0)
+	{
+		m_object = (T*)table.acquire(handle, Type, &m_environmentId);
+	}
+
+	~PluginHandleLease()
+	{
+		if (m_object != nullptr)
+			m_table.release(m_handle);
+	}
+
+	/// The object, or null if the handle was disposed or is of another type.
+	T* get() const { return m_object; }
+	T* operator->() const { return m_object; }
+
+	/// The environment of the object.
+	int getEnvironmentId() const { return m_environmentId; }
+
+private:
+	PluginHandleTable& m_table;
+	PluginHandle m_handle;
+	T* m_object;
+	int m_environmentId;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	PluginHandleLease(const PluginHandleLease&);
+	PluginHandleLease& operator=(const PluginHandleLease&);
+};
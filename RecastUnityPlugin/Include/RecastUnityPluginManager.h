@@ -1,15 +1,20 @@
 #ifndef RECAST_UNITY_PLUGIN_MANAGER_H
 #define RECAST_UNITY_PLUGIN_MANAGER_H
 
-#include <map>
+#include <atomic>
+
 #include "BlockArea.h"
 #include "BuildContext.h"
 #include "DetourNavMesh.h"
 #include "DetourNavMeshQuery.h"
 #include "NavMeshBuildConfig.h"
+#include "NavMeshDebugDrawCache.h"
 #include "NavMeshInputGeometry.h"
+#include "PluginHandleTable.h"
 #include "Recast.h"
 #include "ChunkyTriMesh.h"
+#include "NavMeshBuildData.h"
+#include "TileHeightfieldCache.h"
 
 // Copy of SamplePartitionType 
 enum PartitionType
@@ -38,13 +43,21 @@ enum PolyFlags
 
 /// A singleton that contains all the allocated data for the C# side.
 /// Before using it, you should call RecastUnityPluginManager::Initialize()
+/// The NavMeshes and NavMesh queries are given to the C# side as handles, which can be used from several threads.
+/// The objects of the handles are used through leases: an object disposed while another thread uses it is freed
+/// when that thread releases it. The NavMesh queries and the caches keep their NavMesh alive, and are disposed with it.
 class RecastUnityPluginManager
 {
 public:
-	/// Creates the singleton instance.
+	typedef PluginHandleLease<dtNavMesh, PLUGIN_OBJECT_NAVMESH> NavMeshLease;
+	typedef PluginHandleLease<dtNavMeshQuery, PLUGIN_OBJECT_NAVMESH_QUERY> NavMeshQueryLease;
+	typedef PluginHandleLease<TileHeightfieldCache, PLUGIN_OBJECT_TILE_HEIGHTFIELD_CACHE> TileHeightfieldCacheLease;
+	typedef PluginHandleLease<NavMeshDebugDrawCache, PLUGIN_OBJECT_NAVMESH_DEBUG_DRAW_CACHE> NavMeshDebugDrawCacheLease;
+
+	/// Initializes the plugin. Returns false if it was already initialized.
 	static bool initialize();
 
-	/// Disposes the singleton and free its data.
+	/// Disposes the objects of an environment. The plugin is no longer initialized once all the objects are disposed.
 	static void dispose(int environmentId);
 
 	/// Returns true if the plugin is initialized.
@@ -52,11 +65,18 @@ public:
 
 	/// Creates a non-tile NavMesh.
 	static dtStatus createNavMesh(const NavMeshBuildConfig& config, const float* bmin, const float* bmax,
-	                              const NavMeshInputGeometry& inputGeometry, void*& allocatedNavMesh,
+	                              const NavMeshInputGeometry& inputGeometry, PluginHandle& allocatedNavMesh,
 	                              int environmentId);
 
-	/// Disposes the NavMesh passed in parameter.
-	static void disposeNavMesh(void* allocatedNavMesh, int environmentId);
+	/// Disposes the NavMesh passed in parameter, with its NavMesh queries and caches. Does nothing if it was already disposed.
+	static void disposeNavMesh(PluginHandle allocatedNavMesh);
+
+	/// Returns the table of the handles, to lease their objects (see NavMeshLease).
+	/// The table is never destroyed before the end of the program, so a lease can be released from any thread.
+	static PluginHandleTable& getHandles();
+
+	/// Returns the number of NavMeshes, NavMesh queries, tile heightfield caches and debug draw caches of an environment.
+	static int getObjectsCount(int environmentId);
 
 	/**
 	 * \brief Creates an empty TileNavMesh. Tiles should be built later.
@@ -64,14 +84,14 @@ public:
 	 * \param tileSize The size of the tile (m)
 	 * \param bmin The min bounds (world coordinates) of the whole navMesh
 	 * \param bmax The max bounds (world coordinates) of the whole navMesh
-	 * \param allocatedNavMesh The returned allocated NavMesh.
+	 * \param allocatedNavMesh The returned handle of the allocated NavMesh.
 	 * \param tilesNumber The returned tiles number
 	 * \param environmentId The environment id the NavMesh is linked to.
 	 * \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
 	 */
 	static dtStatus createTileNavMesh(const NavMeshBuildConfig& config, float tileSize,
 	                                  const float* bmin, const float* bmax,
-	                                  void*& allocatedNavMesh, int* tilesNumber, int environmentId);
+	                                  PluginHandle& allocatedNavMesh, int* tilesNumber, int environmentId);
 
 	/**
 	 * \brief Builds a tile for a tile NavMesh.
@@ -96,7 +116,7 @@ public:
 	static dtStatus createTileNavMeshWithChunkyMesh(const NavMeshBuildConfig& config, float tileSize,
 	                                                bool buildAllTiles,
 	                                                const float* bmin, const float* bmax,
-	                                                const NavMeshInputGeometry& inputGeometry, void*& allocatedNavMesh,
+	                                                const NavMeshInputGeometry& inputGeometry, PluginHandle& allocatedNavMesh,
 	                                                void*& computedChunkyTriMesh, int* tilesNumber, int environmentId);
 
 	/// Adds a tile to a TileNavMesh by building a ChunkyMesh. Not used anymore for now.
@@ -107,17 +127,61 @@ public:
 
 	/**
 	 * \brief Creates a NavMeshQuery
-	 * \param navMesh The NavMesh the query should use.
+	 * \param navMesh The NavMesh the query should use. The query is linked to the environment of the NavMesh.
 	 * \param maxNodes The maximum nodes that should be used for the path.
-	 * \param allocatedNavMeshQuery The created NavMeshQuery
-	 * \param environmentId The environment id the NavMesh is linked to.
+	 * \param allocatedNavMeshQuery The returned handle of the created NavMeshQuery
+	 * \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
+	 */
+	static dtStatus createNavMeshQuery(PluginHandle navMesh, int maxNodes, PluginHandle& allocatedNavMeshQuery);
+
+	/// Dispose the NavMeshQuery passed in parameter. Does nothing if it was already disposed.
+	static void disposeNavMeshQuery(PluginHandle allocatedNavMeshQuery);
+
+	/**
+	 * \brief Creates a cache of the heightfields of the tiles of a TileNavMesh, to rebuild the tiles after edits
+	 * without rasterizing their whole geometry again.
+	 * \param navMesh The TileNavMesh the tiles are rebuilt into. The cache is linked to the environment of the NavMesh.
+	 * \param config Contains all the parameters that should be used to build the NavMesh.
+	 * \param tileSize The size of the tile (m)
+	 * \param bmin The min bounds (world coordinates) of the whole navMesh
+	 * \param bmax The max bounds (world coordinates) of the whole navMesh
+	 * \param allocatedCache The returned handle of the created cache.
+	 * \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
+	 */
+	static dtStatus createTileHeightfieldCache(PluginHandle navMesh, const NavMeshBuildConfig& config, float tileSize,
+	                                           const float* bmin, const float* bmax, PluginHandle& allocatedCache);
+
+	/// Dispose the tile heightfield cache passed in parameter. Does nothing if it was already disposed.
+	static void disposeTileHeightfieldCache(PluginHandle cache);
+
+	/**
+	 * \brief Rebuilds a tile from its cached heightfield, after structures were added to or removed from it.
+	 * Only the edited columns are rasterized again, then the tile is built from the filtering step, like AddTile.
+	 * \param tileCoordinates The coordinate of the tile.
+	 * \param cache The cache with the heightfield of the tile.
+	 * \param blockAreas The block areas of the tile, to potentially flag some areas of the tile.
+	 * \param blocksCount The number of block areas.
+	 * \param context The context to use. Used to return the timings to the C# side.
+	 * \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
+	 */
+	static dtStatus rebuildEditedTile(const int* tileCoordinates, TileHeightfieldCache& cache,
+	                                  const BlockArea* blockAreas, int blocksCount, BuildContext* context);
+
+	/**
+	 * \brief Creates a cache of the debug draw data of a NavMesh, which only fetches the tiles that changed.
+	 * \param navMesh The NavMesh to draw. The cache is linked to the environment of the NavMesh.
+	 * \param allocatedCache The returned handle of the created cache.
 	 * \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
 	 */
-	static dtStatus createNavMeshQuery(const void* navMesh, int maxNodes, void*& allocatedNavMeshQuery,
-	                                   int environmentId);
+	static dtStatus createNavMeshDebugDrawCache(PluginHandle navMesh, PluginHandle& allocatedCache);
+
+	/// Dispose the debug draw cache passed in parameter. Does nothing if it was already disposed.
+	static void disposeNavMeshDebugDrawCache(PluginHandle cache);
 
-	/// Dispose the NavMeshQuery passed in parameter.
-	static void disposeNavMeshQuery(void*& allocatedNavMeshQuery, int environmentId);
+	/// Fetches the tiles of the NavMesh of the cache that changed since the last update.
+	/// The tiles are not added or removed during the update.
+	/// @return The generation of the cache, or -1 if the NavMesh was disposed.
+	static int updateNavMeshDebugDrawCache(NavMeshDebugDrawCache& cache);
 
 private:
 	/// Made it private so that nobody can call the constructor outside of this class.
@@ -125,9 +189,6 @@ private:
 	{
 	}
 
-	/// Free the navMeshes and the navmesh queries for the specified environment.
-	void disposeData(int environmentId);
-
 	static dtStatus BuildAllTiles(dtNavMesh* navMesh, const NavMeshBuildConfig& config, float tileSize,
 	                              const float* bmin, const float* bmax,
 	                              const NavMeshInputGeometry& inputGeometry, const rcChunkyTriMesh* chunkyMesh,
@@ -138,6 +199,11 @@ private:
 	                                    const NavMeshInputGeometry& inputGeometry, int& dataSize,
 	                                    const BlockArea* blockAreas, int blocksCount, rcContext& context);
 
+	/// Builds the tile from the rasterized heightfield of buildData.
+	static unsigned char* buildTileMeshFromHeightfield(const int tx, const int ty, const NavMeshBuildConfig& config,
+	                                                   const rcConfig& rcConfig, NavMeshBuildData& buildData, int& dataSize,
+	                                                   const BlockArea* blockAreas, int blocksCount, rcContext& context);
+
 	static unsigned char* buildTileMeshWithChunkyMesh(const int tx, const int ty, const NavMeshBuildConfig& config,
 	                                                  float tileSize,
 	                                                  const float* bmin, const float* bmax,
@@ -145,13 +211,7 @@ private:
 	                                                  const rcChunkyTriMesh* chunkyMesh, int& dataSize,
 	                                                  rcContext& context);
 
-	/// The instance of the singleton.
-	static RecastUnityPluginManager* s_instance;
-
-	/// All the navMeshes that were allocated for the C# side. The NavMesh are sorted by environment id (client X or server)
-	std::multimap<int, dtNavMesh*> m_navMeshes;
-
-	/// All the navMesh queries that were allocated for the C# side. The NavMesh queries are sorted by environment id (client X or server)
-	std::multimap<int, dtNavMeshQuery*> m_navMeshQueries;
+	/// True between initialize and the dispose of the last environment.
+	static std::atomic<bool> s_initialized;
 };
 #endif
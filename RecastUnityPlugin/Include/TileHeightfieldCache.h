@@ -0,0 +1,72 @@
+#pragma once
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+
+#include "NavMeshBuildConfig.h"
+#include "NavMeshInputGeometry.h"
+#include "PluginHandleTable.h"
+#include "Recast.h"
+
+/// Keeps the heightfield of each tile of a tile NavMesh, so that the structures built by the players can be added
+/// to and removed from a tile without rasterizing the rest of its geometry again.
+/// The static geometry of a tile is rasterized once, and each structure is rasterized on its own when it is added.
+/// A rebuild then only composes the columns covered by the edited structures, and runs the stages after the
+/// rasterization. See rcEditableHeightfield.
+///
+/// The cache references its NavMesh by handle: once the NavMesh is disposed, the rebuilds fail.
+/// Different tiles can be edited from several threads, but a tile must be edited and rebuilt from one thread at a time.
+class TileHeightfieldCache
+{
+public:
+	/// @param[in]	navMesh		The handle of the tile NavMesh the tiles are rebuilt into.
+	/// @param[in]	config		The build settings of the NavMesh.
+	/// @param[in]	tileSize	The size of the tiles. [Units: vx]
+	/// @param[in]	bmin		The min bounds of the whole NavMesh.
+	/// @param[in]	bmax		The max bounds of the whole NavMesh.
+	TileHeightfieldCache(PluginHandle navMesh, const NavMeshBuildConfig& config, float tileSize, const float* bmin, const float* bmax);
+	~TileHeightfieldCache();
+
+	/// Rasterizes the static geometry of a tile, and removes the structures of the tile.
+	/// @param[in]	inputGeometry	The geometry of the tile and of the border around it, like for AddTile.
+	bool setStaticGeometry(int tx, int ty, const NavMeshInputGeometry& inputGeometry, rcContext& context);
+
+	/// Rasterizes a structure and adds it to a tile. The static geometry of the tile must have been set.
+	/// @param[in]	id	The id of the structure, unique in the tile.
+	bool addMesh(int tx, int ty, unsigned int id, const NavMeshInputGeometry& inputGeometry, rcContext& context);
+
+	/// Removes a structure from a tile.
+	/// @return False if the tile has no structure with this id.
+	bool removeMesh(int tx, int ty, unsigned int id);
+
+	/// Composes the edited columns of a tile again, and returns its heightfield.
+	/// @return The heightfield of the tile, or null if its static geometry was not set or on failure.
+	const rcHeightfield* updateHeightfield(int tx, int ty, rcContext& context);
+
+	/// Frees the heightfield of a tile.
+	void removeTile(int tx, int ty);
+
+	PluginHandle getNavMesh() const { return m_navMesh; }
+	const NavMeshBuildConfig& getConfig() const { return m_config; }
+	float getTileSize() const { return m_tileSize; }
+
+	/// Computes the build config of a tile.
+	void getTileConfig(int tx, int ty, rcConfig& rcConfig) const;
+
+private:
+	static uint64_t getTileKey(int tx, int ty);
+	rcEditableHeightfield* findTile(int tx, int ty);
+
+	PluginHandle m_navMesh;
+	NavMeshBuildConfig m_config;
+	float m_tileSize;
+	float m_bmin[3];
+	float m_bmax[3];
+	/// The heightfield of each tile, by tile coordinates. Only the map is guarded by the mutex.
+	std::unordered_map<uint64_t, rcEditableHeightfield*> m_tiles;
+	std::mutex m_mutex;
+
+	// Explicitly disabled copy constructor and copy assignment operator.
+	TileHeightfieldCache(const TileHeightfieldCache&);
+	TileHeightfieldCache& operator=(const TileHeightfieldCache&);
+};
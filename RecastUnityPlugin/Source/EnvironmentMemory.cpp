@@ -0,0 +1,98 @@
+#include "EnvironmentMemory.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdlib.h>
+#include "DetourAlloc.h"
+
+namespace
+{
+typedef std::atomic<long long> MemoryCounter;
+
+/// Stored in front of each allocation, so that the free is accounted to the environment of the allocation.
+struct AllocationHeader
+{
+	MemoryCounter* counter;
+	size_t size;
+};
+
+// Keeps the allocations aligned to 16 bytes.
+const size_t ALLOCATION_HEADER_SIZE = 16;
+static_assert(sizeof(AllocationHeader) <= ALLOCATION_HEADER_SIZE, "The allocation header does not fit.");
+
+/// The counter of the environment of the current scope of the thread, or null if there is no scope.
+thread_local MemoryCounter* t_currentCounter = nullptr;
+
+std::mutex& getCountersMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+/// The counters are never freed, because allocations can outlive their environment.
+std::map<int, MemoryCounter*>& getCounters()
+{
+	static std::map<int, MemoryCounter*> counters;
+	return counters;
+}
+
+MemoryCounter* getCounter(int environmentId)
+{
+	std::lock_guard<std::mutex> lock(getCountersMutex());
+	MemoryCounter*& counter = getCounters()[environmentId];
+	if (counter == nullptr)
+		counter = new MemoryCounter(0);
+	return counter;
+}
+
+void* allocAccounted(size_t size, dtAllocHint /*hint*/)
+{
+	unsigned char* memory = (unsigned char*)malloc(size + ALLOCATION_HEADER_SIZE);
+	if (memory == nullptr)
+		return nullptr;
+
+	AllocationHeader* header = (AllocationHeader*)memory;
+	header->counter = t_currentCounter;
+	header->size = size;
+	if (header->counter != nullptr)
+		header->counter->fetch_add((long long)size, std::memory_order_relaxed);
+	return memory + ALLOCATION_HEADER_SIZE;
+}
+
+void freeAccounted(void* ptr)
+{
+	if (ptr == nullptr)
+		return;
+
+	unsigned char* memory = (unsigned char*)ptr - ALLOCATION_HEADER_SIZE;
+	const AllocationHeader* header = (const AllocationHeader*)memory;
+	if (header->counter != nullptr)
+		header->counter->fetch_sub((long long)header->size, std::memory_order_relaxed);
+	free(memory);
+}
+}
+
+void EnvironmentMemory::install()
+{
+	static std::once_flag installed;
+	std::call_once(installed, []() { dtAllocSetCustom(allocAccounted, freeAccounted); });
+}
+
+long long EnvironmentMemory::getAllocatedBytes(int environmentId)
+{
+	std::lock_guard<std::mutex> lock(getCountersMutex());
+	std::map<int, MemoryCounter*>::const_iterator it = getCounters().find(environmentId);
+	return it != getCounters().end() ? it->second->load(std::memory_order_relaxed) : 0;
+}
+
+EnvironmentMemoryScope::EnvironmentMemoryScope(int environmentId) :
+	m_previousCounter(t_currentCounter)
+{
+	t_currentCounter = getCounter(environmentId);
+}
+
+EnvironmentMemoryScope::~EnvironmentMemoryScope()
+{
+	t_currentCounter = (MemoryCounter*)m_previousCounter;
+}
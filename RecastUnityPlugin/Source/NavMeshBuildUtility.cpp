@@ -3,6 +3,60 @@
 #include "DetourNavMeshBuilder.h"
 #include "RecastUnityPluginManager.h"
 
+#include <math.h>
+#include <string.h>
+
+void NavMeshBuildUtility::initTileConfig(const NavMeshBuildConfig& config, float tileSize,
+	const float* tileBmin, const float* tileBmax, rcConfig& rcConfig)
+{
+	memset(&rcConfig, 0, sizeof(rcConfig));
+	rcConfig.cs = config.cs;
+	rcConfig.ch = config.ch;
+	rcConfig.walkableSlopeAngle = config.walkableSlopeAngle;
+	rcConfig.walkableHeight = (int)ceilf(config.agentHeight / config.ch);
+	rcConfig.walkableClimb = (int)floorf(config.agentMaxClimb / config.ch);
+	rcConfig.walkableRadius = (int)ceilf(config.agentRadius / config.cs);
+	rcConfig.maxEdgeLen = (int)((float)config.maxEdgeLen / config.cs);
+	rcConfig.maxSimplificationError = config.maxSimplificationError;
+	rcConfig.minRegionArea = (int)config.minRegionArea ;		// Note: area = size*size
+	rcConfig.mergeRegionArea = (int)config.mergeRegionArea;	// Note: area = size*size
+	rcConfig.maxVertsPerPoly = (int)config.maxVertsPerPoly;
+	rcConfig.tileSize = (int)tileSize;
+	rcConfig.borderSize = rcConfig.walkableRadius + 3;// Reserve enough padding.
+	rcConfig.width = rcConfig.tileSize + rcConfig.borderSize*2;
+	rcConfig.height = rcConfig.tileSize + rcConfig.borderSize*2;
+	rcConfig.detailSampleDist = config.detailSampleDist < 0.9f ? 0 : config.cs * config.detailSampleDist;
+	rcConfig.detailSampleMaxError = config.ch * config.detailSampleMaxError;
+	
+	// Expand the heighfield bounding box by border size to find the extents of geometry we need to build this tile.
+	//
+	// This is done in order to make sure that the navmesh tiles connect correctly at the borders,
+	// and the obstacles close to the border work correctly with the dilation process.
+	// No polygons (or contours) will be created on the border area.
+	//
+	// IMPORTANT!
+	//
+	//   :''''''''':
+	//   : +-----+ :
+	//   : |     | :
+	//   : |     |<--- tile to build
+	//   : |     | :  
+	//   : +-----+ :<-- geometry needed
+	//   :.........:
+	//
+	// You should use this bounding box to query your input geometry.
+	//
+	// For example if you build a navmesh for terrain, and want the navmesh tiles to match the terrain tile size
+	// you will need to pass in data from neighbour terrain tiles too! In a simple case, just pass in all the 8 neighbours,
+	// or use the bounding box below to only pass in a sliver of each of the 8 neighbours.
+	rcVcopy(rcConfig.bmin, tileBmin);
+	rcVcopy(rcConfig.bmax, tileBmax);
+	rcConfig.bmin[0] -= rcConfig.borderSize*rcConfig.cs;
+	rcConfig.bmin[2] -= rcConfig.borderSize*rcConfig.cs;
+	rcConfig.bmax[0] += rcConfig.borderSize*rcConfig.cs;
+	rcConfig.bmax[2] += rcConfig.borderSize*rcConfig.cs;
+}
+
 dtStatus NavMeshBuildUtility::prepareTriangleRasterization(const rcConfig& rcConfig, int triAreasCount, NavMeshBuildData& buildData, rcContext& context)
 {
 	// Allocate voxel heightfield where we rasterize our input data to.
@@ -175,7 +229,7 @@ dtStatus NavMeshBuildUtility::buildMesh(const rcConfig& rcConfig, NavMeshBuildDa
 	return DT_SUCCESS;
 }
 
-dtStatus NavMeshBuildUtility::buildDetailMesh(const rcConfig& rcConfig, NavMeshBuildData& buildData, rcContext& context)
+dtStatus NavMeshBuildUtility::buildDetailMesh(const rcConfig& rcConfig, int threadCount, NavMeshBuildData& buildData, rcContext& context)
 {
 	buildData.dmesh = rcAllocPolyMeshDetail();
 	if (!buildData.dmesh)
@@ -184,7 +238,7 @@ dtStatus NavMeshBuildUtility::buildDetailMesh(const rcConfig& rcConfig, NavMeshB
 		return DT_FAILURE;
 	}
 
-	if (!rcBuildPolyMeshDetail(&context, *buildData.pmesh, *buildData.chf, rcConfig.detailSampleDist, rcConfig.detailSampleMaxError, *buildData.dmesh))
+	if (!rcBuildPolyMeshDetail(&context, *buildData.pmesh, *buildData.chf, rcConfig.detailSampleDist, rcConfig.detailSampleMaxError, *buildData.dmesh, threadCount))
 	{
 		context.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
 		return DT_FAILURE;
@@ -0,0 +1,156 @@
+#include "NavMeshDebugDrawCache.h"
+#include "NavMeshDebugDrawUtility.h"
+
+NavMeshDebugDrawCache::NavMeshDebugDrawCache(PluginHandle navMesh, int maxTiles) :
+	m_navMesh(navMesh),
+	m_tiles(maxTiles),
+	m_generation(0),
+	m_polyTrianglesCount(0),
+	m_boundariesLinesCount(0)
+{
+}
+
+int NavMeshDebugDrawCache::update(const dtNavMesh& navMesh)
+{
+	// Find the tiles that were added, removed or replaced. Their neighbours must be fetched again too,
+	// because the links at their borders changed.
+	for (int i = 0; i < (int)m_tiles.size(); ++i)
+	{
+		const dtMeshTile* tile = navMesh.getTile(i);
+		TileCache& cache = m_tiles[i];
+		const bool hasTile = tile->header != nullptr;
+		if (hasTile == cache.hasTile && (!hasTile || tile->changeCount == cache.changeCount))
+			continue;
+
+		cache.dirty = true;
+		if (cache.hasTile)
+			markNeighboursDirty(navMesh, cache.x, cache.y);
+		if (hasTile)
+			markNeighboursDirty(navMesh, tile->header->x, tile->header->y);
+	}
+
+	bool changed = false;
+	for (int i = 0; i < (int)m_tiles.size(); ++i)
+	{
+		if (!m_tiles[i].dirty)
+			continue;
+		fetchTile(navMesh, i);
+		m_tiles[i].generation = m_generation + 1;
+		changed = true;
+	}
+	if (changed)
+		m_generation++;
+
+	return m_generation;
+}
+
+void NavMeshDebugDrawCache::invalidate()
+{
+	for (size_t i = 0; i < m_tiles.size(); ++i)
+		m_tiles[i].dirty = m_tiles[i].hasTile;
+}
+
+int NavMeshDebugDrawCache::getChangedTiles(int generation, int* tileIndices, int maxTileIndices) const
+{
+	int changedTilesCount = 0;
+	for (int i = 0; i < (int)m_tiles.size(); ++i)
+	{
+		if (m_tiles[i].generation <= generation)
+			continue;
+		if (changedTilesCount < maxTileIndices)
+			tileIndices[changedTilesCount] = i;
+		changedTilesCount++;
+	}
+	return changedTilesCount;
+}
+
+bool NavMeshDebugDrawCache::getTileData(int tileIndex, NavMeshDebugDrawTileData* tileData) const
+{
+	if (tileIndex < 0 || tileIndex >= (int)m_tiles.size())
+		return false;
+
+	const TileCache& cache = m_tiles[tileIndex];
+	tileData->polyTrianglesPositions = cache.polyTrianglesPositions.empty() ? nullptr : &cache.polyTrianglesPositions[0];
+	tileData->polyTrianglesArea = cache.polyTrianglesArea.empty() ? nullptr : &cache.polyTrianglesArea[0];
+	tileData->polyTrianglesCount = cache.polyTrianglesCount;
+	tileData->boundariesPositions = cache.boundariesPositions.empty() ? nullptr : &cache.boundariesPositions[0];
+	tileData->boundariesType = cache.boundariesType.empty() ? nullptr : &cache.boundariesType[0];
+	tileData->boundariesLinesCount = cache.boundariesLinesCount;
+	tileData->generation = cache.generation;
+	return true;
+}
+
+void NavMeshDebugDrawCache::markNeighboursDirty(const dtNavMesh& navMesh, int x, int y)
+{
+	static const int MAX_LAYERS = 32;
+	const dtMeshTile* tiles[MAX_LAYERS];
+	for (int ny = y - 1; ny <= y + 1; ++ny)
+	{
+		for (int nx = x - 1; nx <= x + 1; ++nx)
+		{
+			const int tilesCount = navMesh.getTilesAt(nx, ny, tiles, MAX_LAYERS);
+			for (int i = 0; i < tilesCount; ++i)
+				m_tiles[navMesh.decodePolyIdTile(navMesh.getTileRef(tiles[i]))].dirty = true;
+		}
+	}
+}
+
+void NavMeshDebugDrawCache::fetchTile(const dtNavMesh& navMesh, int tileIndex)
+{
+	const dtMeshTile* tile = navMesh.getTile(tileIndex);
+	TileCache& cache = m_tiles[tileIndex];
+	m_polyTrianglesCount -= cache.polyTrianglesCount;
+	m_boundariesLinesCount -= cache.boundariesLinesCount;
+	cache.polyTrianglesCount = 0;
+	cache.boundariesLinesCount = 0;
+	cache.dirty = false;
+	cache.hasTile = tile->header != nullptr;
+	cache.changeCount = tile->changeCount;
+	if (!cache.hasTile)
+		return;
+	cache.x = tile->header->x;
+	cache.y = tile->header->y;
+
+	// The number of triangles is known, but the boundaries are found while fetching them.
+	int trianglesCount = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		if (tile->polys[i].getType() != DT_POLYTYPE_OFFMESH_CONNECTION)
+			trianglesCount += tile->detailMeshes[i].triCount;
+	}
+
+	// The debug draw data can hold one item less than its capacity.
+	const int trianglesCapacity = trianglesCount + 1;
+	cache.polyTrianglesPositions.resize(trianglesCapacity * 9);
+	cache.polyTrianglesArea.resize(trianglesCapacity);
+	int boundariesCapacity = (int)cache.boundariesType.size();
+	if (boundariesCapacity < trianglesCapacity)
+		boundariesCapacity = trianglesCapacity;
+
+	for (;;)
+	{
+		cache.boundariesPositions.resize(boundariesCapacity * 6);
+		cache.boundariesType.resize(boundariesCapacity);
+
+		NavMeshDebugDrawData data;
+		data.polyTrianglesPositions = &cache.polyTrianglesPositions[0];
+		data.polyTrianglesArea = &cache.polyTrianglesArea[0];
+		data.polyTrianglesCount = &cache.polyTrianglesCount;
+		data.polyTrianglesMaxCapacity = trianglesCapacity;
+		data.boundariesPositions = &cache.boundariesPositions[0];
+		data.boundariesType = &cache.boundariesType[0];
+		data.boundariesLinesCount = &cache.boundariesLinesCount;
+		data.boundariesMaxCapacity = boundariesCapacity;
+
+		cache.polyTrianglesCount = 0;
+		cache.boundariesLinesCount = 0;
+		if (NavMeshDebugDrawUtility::fetchMeshTileData(navMesh, tile, &data))
+			break;
+
+		// Only the boundaries can be full.
+		boundariesCapacity *= 2;
+	}
+
+	m_polyTrianglesCount += cache.polyTrianglesCount;
+	m_boundariesLinesCount += cache.boundariesLinesCount;
+}
@@ -0,0 +1,252 @@
+#include "PluginHandleTable.h"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "NavMeshDebugDrawCache.h"
+#include "TileHeightfieldCache.h"
+
+PluginHandleTable::PluginHandleTable() :
+	m_firstFreeSlot(-1),
+	m_objectsCount(0)
+{
+}
+
+PluginHandleTable::~PluginHandleTable()
+{
+	for (size_t i = 0; i < m_slots.size(); ++i)
+	{
+		if (m_slots[i].object != nullptr)
+			freeObject(m_slots[i].object, m_slots[i].type);
+	}
+}
+
+PluginHandle PluginHandleTable::add(void* object, PluginObjectType type, int environmentId, PluginHandle owner)
+{
+	if (object == nullptr)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	int ownerIndex = -1;
+	if (owner != 0)
+	{
+		// The owner is kept alive by the lease of the object, until the object is freed.
+		ownerIndex = findSlot(owner);
+		if (ownerIndex < 0 || m_slots[ownerIndex].disposed)
+			return 0;
+		m_slots[ownerIndex].leases++;
+	}
+
+	int slotIndex = m_firstFreeSlot;
+	if (slotIndex >= 0)
+	{
+		m_firstFreeSlot = m_slots[slotIndex].next;
+	}
+	else
+	{
+		Slot slot;
+		slot.object = nullptr;
+		slot.generation = 1;
+		m_slots.push_back(slot);
+		slotIndex = (int)m_slots.size() - 1;
+	}
+
+	std::vector<int>& environmentSlots = m_environmentSlots[environmentId];
+	Slot& slot = m_slots[slotIndex];
+	slot.object = object;
+	slot.type = type;
+	slot.environmentId = environmentId;
+	slot.next = (int)environmentSlots.size();
+	slot.leases = 0;
+	slot.disposed = false;
+	slot.owner = owner;
+	slot.firstDependent = -1;
+	slot.prevDependent = -1;
+	slot.nextDependent = -1;
+	if (ownerIndex >= 0)
+	{
+		Slot& ownerSlot = m_slots[ownerIndex];
+		slot.nextDependent = ownerSlot.firstDependent;
+		if (ownerSlot.firstDependent >= 0)
+			m_slots[ownerSlot.firstDependent].prevDependent = slotIndex;
+		ownerSlot.firstDependent = slotIndex;
+	}
+	environmentSlots.push_back(slotIndex);
+	m_objectsCount++;
+
+	return ((PluginHandle)slot.generation << 32) | (PluginHandle)(slotIndex + 1);
+}
+
+void* PluginHandleTable::acquire(PluginHandle handle, PluginObjectType type, int* environmentId)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const int slotIndex = findSlot(handle);
+	if (slotIndex < 0)
+		return nullptr;
+	Slot& slot = m_slots[slotIndex];
+	if (slot.disposed || slot.type != type)
+		return nullptr;
+	slot.leases++;
+	if (environmentId != nullptr)
+		*environmentId = slot.environmentId;
+	return slot.object;
+}
+
+void PluginHandleTable::release(PluginHandle handle)
+{
+	std::vector<FreedObject> freedObjects;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// The slot cannot be reused while it has leases, so the handle is still valid.
+		const int slotIndex = findSlot(handle);
+		if (slotIndex < 0)
+			return;
+		Slot& slot = m_slots[slotIndex];
+		slot.leases--;
+		if (slot.leases == 0 && slot.disposed)
+			freeSlot(slotIndex, freedObjects);
+	}
+
+	freeObjects(freedObjects);
+}
+
+bool PluginHandleTable::dispose(PluginHandle handle, PluginObjectType type)
+{
+	std::vector<FreedObject> freedObjects;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const int slotIndex = findSlot(handle);
+		if (slotIndex < 0)
+			return false;
+		const Slot& slot = m_slots[slotIndex];
+		if (slot.disposed || slot.type != type)
+			return false;
+		disposeSlot(slotIndex, freedObjects);
+	}
+
+	// Free outside of the lock, so that the other threads are not blocked.
+	freeObjects(freedObjects);
+	return true;
+}
+
+void PluginHandleTable::disposeEnvironment(int environmentId)
+{
+	std::vector<FreedObject> freedObjects;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unordered_map<int, std::vector<int> >::iterator it = m_environmentSlots.find(environmentId);
+		if (it == m_environmentSlots.end())
+			return;
+		const std::vector<int>& environmentSlots = it->second;
+		while (!environmentSlots.empty())
+			disposeSlot(environmentSlots.back(), freedObjects);
+	}
+
+	freeObjects(freedObjects);
+}
+
+int PluginHandleTable::getObjectsCount(int environmentId) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::unordered_map<int, std::vector<int> >::const_iterator it = m_environmentSlots.find(environmentId);
+	return it != m_environmentSlots.end() ? (int)it->second.size() : 0;
+}
+
+bool PluginHandleTable::empty() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_objectsCount == 0;
+}
+
+int PluginHandleTable::findSlot(PluginHandle handle) const
+{
+	const int slotIndex = (int)(handle & 0xffffffff) - 1;
+	const uint32_t generation = (uint32_t)(handle >> 32);
+	if (slotIndex < 0 || slotIndex >= (int)m_slots.size())
+		return -1;
+	const Slot& slot = m_slots[slotIndex];
+	if (slot.object == nullptr || slot.generation != generation)
+		return -1;
+	return slotIndex;
+}
+
+void PluginHandleTable::disposeSlot(int slotIndex, std::vector<FreedObject>& freedObjects)
+{
+	Slot& slot = m_slots[slotIndex];
+
+	// Swap-remove the slot from the slots of its environment.
+	std::vector<int>& environmentSlots = m_environmentSlots[slot.environmentId];
+	const int lastSlotIndex = environmentSlots.back();
+	environmentSlots[slot.next] = lastSlotIndex;
+	m_slots[lastSlotIndex].next = slot.next;
+	environmentSlots.pop_back();
+	slot.disposed = true;
+	m_objectsCount--;
+
+	// Unlink the slot from the dependents of its owner. The owner is not freed before its dependents.
+	if (slot.owner != 0)
+	{
+		Slot& ownerSlot = m_slots[findSlot(slot.owner)];
+		if (slot.prevDependent >= 0)
+			m_slots[slot.prevDependent].nextDependent = slot.nextDependent;
+		else
+			ownerSlot.firstDependent = slot.nextDependent;
+		if (slot.nextDependent >= 0)
+			m_slots[slot.nextDependent].prevDependent = slot.prevDependent;
+		slot.prevDependent = -1;
+		slot.nextDependent = -1;
+	}
+
+	// Disposing a dependent unlinks it from the dependents of this one.
+	while (slot.firstDependent >= 0)
+		disposeSlot(slot.firstDependent, freedObjects);
+
+	if (slot.leases == 0)
+		freeSlot(slotIndex, freedObjects);
+}
+
+void PluginHandleTable::freeSlot(int slotIndex, std::vector<FreedObject>& freedObjects)
+{
+	Slot& slot = m_slots[slotIndex];
+	FreedObject freedObject;
+	freedObject.object = slot.object;
+	freedObject.type = slot.type;
+	freedObject.owner = slot.owner;
+	freedObjects.push_back(freedObject);
+
+	slot.object = nullptr;
+	slot.owner = 0;
+	slot.generation++;
+	if (slot.generation == 0)
+		slot.generation = 1;
+	slot.next = m_firstFreeSlot;
+	m_firstFreeSlot = slotIndex;
+}
+
+void PluginHandleTable::freeObjects(std::vector<FreedObject>& freedObjects)
+{
+	for (size_t i = 0; i < freedObjects.size(); ++i)
+	{
+		freeObject(freedObjects[i].object, freedObjects[i].type);
+		if (freedObjects[i].owner != 0)
+			release(freedObjects[i].owner);
+	}
+}
+
+void PluginHandleTable::freeObject(void* object, PluginObjectType type)
+{
+	switch (type)
+	{
+	case PLUGIN_OBJECT_NAVMESH:
+		dtFreeNavMesh((dtNavMesh*)object);
+		break;
+	case PLUGIN_OBJECT_NAVMESH_QUERY:
+		dtFreeNavMeshQuery((dtNavMeshQuery*)object);
+		break;
+	case PLUGIN_OBJECT_TILE_HEIGHTFIELD_CACHE:
+		delete (TileHeightfieldCache*)object;
+		break;
+	case PLUGIN_OBJECT_NAVMESH_DEBUG_DRAW_CACHE:
+		delete (NavMeshDebugDrawCache*)object;
+		break;
+	}
+}
@@ -3,14 +3,26 @@
 #include "ChunkyTriMesh.h"
 #include "DetourNavMeshBuilder.h"
 #include "DetourNavMeshQuery.h"
+#include "EnvironmentMemory.h"
 #include "NavMeshBuildData.h"
 #include "NavMeshBuildUtility.h"
 #include "Recast.h"
+#include "RecastAlloc.h"
+#include "TileHeightfieldCache.h"
 #include <math.h>
 #include <cstring>
-#include <algorithm>
 
-RecastUnityPluginManager* RecastUnityPluginManager::s_instance= nullptr;
+std::atomic<bool> RecastUnityPluginManager::s_initialized(false);
+
+/// The arena of the intermediate data of the tiles built on the calling thread, reused across tiles.
+static rcArena& getTileBuildArena()
+{
+	static thread_local rcArena arena;
+	return arena;
+}
+
+/// The bounding volume tree builder of the tiles. The SAH builder produces tighter trees than the median split.
+static const int TILE_BVTREE_BUILD_METHOD = DT_BVTREE_SAH;
 
 inline unsigned int nextPow2(unsigned int v)
 {
@@ -39,65 +51,56 @@ inline unsigned int ilog2(unsigned int v)
 
 bool RecastUnityPluginManager::initialize()
 {
-	// TODO add a locking mechanism? Even though these methods should be called only on the main thread.
-	if (!isInitialized())
-	{
-		s_instance = new RecastUnityPluginManager();
-		return true;
-	}
-
-	return false;
+	// The allocator is installed before any NavMesh is allocated, whichever thread initializes the plugin.
+	EnvironmentMemory::install();
+	bool initialized = false;
+	return s_initialized.compare_exchange_strong(initialized, true);
 }
 
 bool RecastUnityPluginManager::isInitialized()
 {
-	return s_instance != nullptr;
+	return s_initialized.load();
 }
 
 void RecastUnityPluginManager::dispose(int environmentId)
 {
-	// TODO add a locking mechanism? Even though these methods should be called only on the main thread.
 	if (isInitialized())
 	{
-		s_instance->disposeData(environmentId);
-		if (s_instance->m_navMeshes.empty())
+		// The objects still leased by other threads are freed when their last lease is released.
+		getHandles().disposeEnvironment(environmentId);
+		if (getHandles().empty())
 		{
-			delete s_instance;
-			s_instance = nullptr;
+			s_initialized = false;
 		}
 	}
 }
 
-void RecastUnityPluginManager::disposeData(int environmentId)
+PluginHandleTable& RecastUnityPluginManager::getHandles()
 {
-	for (auto entry : m_navMeshes)
-	{
-		if (entry.first == environmentId)
-		{
-			dtFreeNavMesh(entry.second);
-		}
-	}
-	m_navMeshes.erase(environmentId);
+	static PluginHandleTable handles;
+	return handles;
+}
 
-	for (auto entry : m_navMeshQueries)
+int RecastUnityPluginManager::getObjectsCount(int environmentId)
+{
+	if (!isInitialized())
 	{
-		if (entry.first == environmentId)
-		{
-			dtFreeNavMeshQuery(entry.second);
-		}
+		return 0;
 	}
-	m_navMeshQueries.erase(environmentId);	
+	return getHandles().getObjectsCount(environmentId);
 }
 
 // More or less copied from Sample_SoloMesh.cpp
 dtStatus RecastUnityPluginManager::createNavMesh(const NavMeshBuildConfig& config, const float* bmin, const float* bmax,
-                                                 const NavMeshInputGeometry& inputGeometry, void*& allocatedNavMesh, int environmentId)
+                                                 const NavMeshInputGeometry& inputGeometry, PluginHandle& allocatedNavMesh, int environmentId)
 {
 	if (!isInitialized())
 	{
 		return DT_FAILURE;
 	}
 
+	EnvironmentMemoryScope memoryScope(environmentId);
+
 	NavMeshBuildData buildData;
 	const float* verts = inputGeometry.vertices;
 	int nverts = inputGeometry.verticesCount;
@@ -201,7 +204,7 @@ dtStatus RecastUnityPluginManager::createNavMesh(const NavMeshBuildConfig& confi
 	// Step 7. Create detail mesh which allows to access approximate height on each polygon.
 	//
 	
-	if (NavMeshBuildUtility::buildDetailMesh(rcConfig, buildData, context) == DT_FAILURE)
+	if (NavMeshBuildUtility::buildDetailMesh(rcConfig, config.detailThreadCount, buildData, context) == DT_FAILURE)
 	{
 		return DT_FAILURE;
 	}
@@ -300,9 +303,7 @@ dtStatus RecastUnityPluginManager::createNavMesh(const NavMeshBuildConfig& confi
 	buildData.ownsNavData = false;
 	
 	// Store the allocated navmesh.
-	s_instance->m_navMeshes.insert({environmentId, navMesh});
-
-	allocatedNavMesh = navMesh;
+	allocatedNavMesh = getHandles().add(navMesh, PLUGIN_OBJECT_NAVMESH, environmentId);
 	
 	return DT_SUCCESS;
 }
@@ -310,13 +311,15 @@ dtStatus RecastUnityPluginManager::createNavMesh(const NavMeshBuildConfig& confi
 // More or less copied from Sample_TileMesh.cpp
 dtStatus RecastUnityPluginManager::createTileNavMesh(const NavMeshBuildConfig& config, float tileSize,
 	const float* bmin, const float* bmax,
-	void*& allocatedNavMesh, int* tilesNumber, int environmentId)
+	PluginHandle& allocatedNavMesh, int* tilesNumber, int environmentId)
 {
 		if (!isInitialized())
 	{
 		return DT_FAILURE;
 	}
 
+	EnvironmentMemoryScope memoryScope(environmentId);
+
 	rcContext context;
 	
 	dtNavMesh* navMesh = dtAllocNavMesh();
@@ -359,9 +362,7 @@ dtStatus RecastUnityPluginManager::createTileNavMesh(const NavMeshBuildConfig& c
 	}
 	
 	// Store the allocated navmesh.
-	s_instance->m_navMeshes.insert({environmentId, navMesh});
-
-	allocatedNavMesh = navMesh;
+	allocatedNavMesh = getHandles().add(navMesh, PLUGIN_OBJECT_NAVMESH, environmentId);
 		
 	return DT_SUCCESS;
 }
@@ -369,13 +370,15 @@ dtStatus RecastUnityPluginManager::createTileNavMesh(const NavMeshBuildConfig& c
 
 dtStatus RecastUnityPluginManager:: createTileNavMeshWithChunkyMesh(const NavMeshBuildConfig& config, float tileSize, bool buildAllTiles,
 	const float* bmin, const float* bmax,
-	const NavMeshInputGeometry& inputGeometry, void*& allocatedNavMesh, void*& computedChunkyTriMesh, int* tilesNumber, int environmentId)
+	const NavMeshInputGeometry& inputGeometry, PluginHandle& allocatedNavMesh, void*& computedChunkyTriMesh, int* tilesNumber, int environmentId)
 {
 	if (!isInitialized())
 	{
 		return DT_FAILURE;
 	}
 
+	EnvironmentMemoryScope memoryScope(environmentId);
+
 	rcContext context;
 	
 	dtNavMesh* navMesh = dtAllocNavMesh();
@@ -452,9 +455,7 @@ dtStatus RecastUnityPluginManager:: createTileNavMeshWithChunkyMesh(const NavMes
 	}
 
 	// Store the allocated navmesh.
-	s_instance->m_navMeshes.insert({environmentId, navMesh});
-
-	allocatedNavMesh = navMesh;
+	allocatedNavMesh = getHandles().add(navMesh, PLUGIN_OBJECT_NAVMESH, environmentId);
 		
 	return DT_SUCCESS;
 }
@@ -607,6 +608,8 @@ unsigned char* RecastUnityPluginManager::buildTileMesh(const int tx, const int t
 	const float* bmin, const float* bmax,
 	const NavMeshInputGeometry& inputGeometry, int& dataSize, const BlockArea* blockAreas, int blocksCount, rcContext& context)
 {
+	// Must outlive buildData, which frees the intermediate data into the arena.
+	rcScopedArena arenaScope(&getTileBuildArena());
 	NavMeshBuildData buildData;
 	const float* verts = inputGeometry.vertices;
 	int nverts = inputGeometry.verticesCount;
@@ -618,51 +621,7 @@ unsigned char* RecastUnityPluginManager::buildTileMesh(const int tx, const int t
 	//
 	
 	rcConfig rcConfig;
-	rcConfig.cs = config.cs;
-	rcConfig.ch = config.ch;
-	rcConfig.walkableSlopeAngle = config.walkableSlopeAngle;
-	rcConfig.walkableHeight = (int)ceilf(config.agentHeight / config.ch);
-	rcConfig.walkableClimb = (int)floorf(config.agentMaxClimb / config.ch);
-	rcConfig.walkableRadius = (int)ceilf(config.agentRadius / config.cs);
-	rcConfig.maxEdgeLen = (int)((float)config.maxEdgeLen / config.cs);
-	rcConfig.maxSimplificationError = config.maxSimplificationError;
-	rcConfig.minRegionArea = (int)config.minRegionArea ;		// Note: area = size*size
-	rcConfig.mergeRegionArea = (int)config.mergeRegionArea;	// Note: area = size*size
-	rcConfig.maxVertsPerPoly = (int)config.maxVertsPerPoly;
-	rcConfig.tileSize = (int)tileSize;
-	rcConfig.borderSize = rcConfig.walkableRadius + 3;// Reserve enough padding.
-	rcConfig.width = rcConfig.tileSize + rcConfig.borderSize*2;
-	rcConfig.height = rcConfig.tileSize + rcConfig.borderSize*2;
-	rcConfig.detailSampleDist = config.detailSampleDist < 0.9f ? 0 : config.cs * config.detailSampleDist;
-	rcConfig.detailSampleMaxError = config.ch * config.detailSampleMaxError;
-	
-	// Expand the heighfield bounding box by border size to find the extents of geometry we need to build this tile.
-	//
-	// This is done in order to make sure that the navmesh tiles connect correctly at the borders,
-	// and the obstacles close to the border work correctly with the dilation process.
-	// No polygons (or contours) will be created on the border area.
-	//
-	// IMPORTANT!
-	//
-	//   :''''''''':
-	//   : +-----+ :
-	//   : |     | :
-	//   : |     |<--- tile to build
-	//   : |     | :  
-	//   : +-----+ :<-- geometry needed
-	//   :.........:
-	//
-	// You should use this bounding box to query your input geometry.
-	//
-	// For example if you build a navmesh for terrain, and want the navmesh tiles to match the terrain tile size
-	// you will need to pass in data from neighbour terrain tiles too! In a simple case, just pass in all the 8 neighbours,
-	// or use the bounding box below to only pass in a sliver of each of the 8 neighbours.
-	rcVcopy(rcConfig.bmin, bmin);
-	rcVcopy(rcConfig.bmax, bmax);
-	rcConfig.bmin[0] -= rcConfig.borderSize*rcConfig.cs;
-	rcConfig.bmin[2] -= rcConfig.borderSize*rcConfig.cs;
-	rcConfig.bmax[0] += rcConfig.borderSize*rcConfig.cs;
-	rcConfig.bmax[2] += rcConfig.borderSize*rcConfig.cs;
+	NavMeshBuildUtility::initTileConfig(config, tileSize, bmin, bmax, rcConfig);
 		
 	//
 	// Step 2. Rasterize input polygon soup.
@@ -684,6 +643,12 @@ unsigned char* RecastUnityPluginManager::buildTileMesh(const int tx, const int t
 		return nullptr;
 	}
 
+	return buildTileMeshFromHeightfield(tx, ty, config, rcConfig, buildData, dataSize, blockAreas, blocksCount, context);
+}
+
+unsigned char* RecastUnityPluginManager::buildTileMeshFromHeightfield(const int tx, const int ty, const NavMeshBuildConfig& config,
+	const rcConfig& rcConfig, NavMeshBuildData& buildData, int& dataSize, const BlockArea* blockAreas, int blocksCount, rcContext& context)
+{
 	//
 	// Step 3. Filter walkable surfaces.
 	//
@@ -701,62 +666,30 @@ unsigned char* RecastUnityPluginManager::buildTileMesh(const int tx, const int t
 	}
 	
 	// (Optional) Mark areas.
-	for (int i  = 0; i < blocksCount; ++i)
+	if (blocksCount > 0)
 	{
-		// In theory, 4 points would have been enough, but we subdivise the square because the poly marking checks
-		// the vertices, not the bounds. Subdividing increase the accuracy of the marking.
-		const int blockVerticesCount = 8;
+		// The blocks are unit cubes. The top is raised by half a block to make sure the volume is really taken into account.
+		rcTempVector<float> blockMins(blocksCount * 3);
+		rcTempVector<float> blockMaxs(blocksCount * 3);
+		rcTempVector<unsigned char> blockAreaIds(blocksCount);
 		const float halfSize = 0.5f;
-		float vertices[blockVerticesCount * 3];
-		const float* center = blockAreas[i].center;
-		float minY = center[1] - halfSize;
-		// We add an offset to make sure the volume is really taken into account.
-		float maxY = center[1] + halfSize * 2;
-
-		// Create the vertices for the bottom plane of the block.
-		float* currentVertex = vertices;
-		currentVertex[0] = center[0] - halfSize;
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2] - halfSize;
-
-		currentVertex += 3;
-		currentVertex[0] = center[0];
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2] - halfSize;
-		
-		currentVertex += 3;
-		currentVertex[0] = center[0] + halfSize;
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2] - halfSize;
-
-		currentVertex += 3;
-		currentVertex[0] = center[0] + halfSize;
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2];
-		
-		currentVertex += 3;
-		currentVertex[0] = center[0] + halfSize;
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2] + halfSize;
-
-		currentVertex += 3;
-		currentVertex[0] = center[0];
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2] + halfSize;
-
-		currentVertex += 3;
-		currentVertex[0] = center[0] - halfSize;
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2] + halfSize;
-		
-		currentVertex += 3;
-		currentVertex[0] = center[0] - halfSize;
-		currentVertex[1] = center[1] - halfSize;
-		currentVertex[2] = center[2];
-
-		const float* verts = vertices;
-		// TODO: maybe do a better methods that checks the bounds or something? Checking the vertices is not very effecient to have an accurate marking.
-		rcMarkConvexPolyArea(&context, verts, blockVerticesCount, minY, maxY, (unsigned char)blockAreas[i].area, *buildData.chf);
+		for (int i = 0; i < blocksCount; ++i)
+		{
+			const float* center = blockAreas[i].center;
+			float* blockMin = &blockMins[i * 3];
+			float* blockMax = &blockMaxs[i * 3];
+			blockMin[0] = center[0] - halfSize;
+			blockMin[1] = center[1] - halfSize;
+			blockMin[2] = center[2] - halfSize;
+			blockMax[0] = center[0] + halfSize;
+			blockMax[1] = center[1] + halfSize * 2;
+			blockMax[2] = center[2] + halfSize;
+			blockAreaIds[i] = (unsigned char)blockAreas[i].area;
+		}
+		if (!rcMarkBoxAreas(&context, &blockMins[0], &blockMaxs[0], &blockAreaIds[0], blocksCount, *buildData.chf))
+		{
+			return nullptr;
+		}
 	}
 	
 	if (NavMeshBuildUtility::buildRegions(config.partitionType, rcConfig.borderSize, rcConfig, buildData, context) == DT_FAILURE)
@@ -791,7 +724,7 @@ unsigned char* RecastUnityPluginManager::buildTileMesh(const int tx, const int t
 	// Step 7. Create detail mesh which allows to access approximate height on each polygon.
 	//
 	
-	if (NavMeshBuildUtility::buildDetailMesh(rcConfig, buildData, context) == DT_FAILURE)
+	if (NavMeshBuildUtility::buildDetailMesh(rcConfig, config.detailThreadCount, buildData, context) == DT_FAILURE)
 	{
 		return nullptr;
 	}
@@ -859,6 +792,7 @@ unsigned char* RecastUnityPluginManager::buildTileMesh(const int tx, const int t
 		params.cs = rcConfig.cs;
 		params.ch = rcConfig.ch;
 		params.buildBvTree = true;
+		params.bvTreeBuildMethod = TILE_BVTREE_BUILD_METHOD;
 		
 		if (!dtCreateNavMeshData(&params, &buildData.navData, &navDataSize))
 		{
@@ -879,6 +813,8 @@ unsigned char* RecastUnityPluginManager::buildTileMeshWithChunkyMesh(const int t
 	const float* bmin, const float* bmax,
 	const NavMeshInputGeometry& inputGeometry, const rcChunkyTriMesh* chunkyMesh, int& dataSize, rcContext& context)
 {
+	// Must outlive buildData, which frees the intermediate data into the arena.
+	rcScopedArena arenaScope(&getTileBuildArena());
 	NavMeshBuildData buildData;
 	const float* verts = inputGeometry.vertices;
 	int nverts = inputGeometry.verticesCount;
@@ -888,51 +824,7 @@ unsigned char* RecastUnityPluginManager::buildTileMeshWithChunkyMesh(const int t
 	//
 	
 	rcConfig rcConfig;
-	rcConfig.cs = config.cs;
-	rcConfig.ch = config.ch;
-	rcConfig.walkableSlopeAngle = config.walkableSlopeAngle;
-	rcConfig.walkableHeight = (int)ceilf(config.agentHeight / config.ch);
-	rcConfig.walkableClimb = (int)floorf(config.agentMaxClimb / config.ch);
-	rcConfig.walkableRadius = (int)ceilf(config.agentRadius / config.cs);
-	rcConfig.maxEdgeLen = (int)((float)config.maxEdgeLen / config.cs);
-	rcConfig.maxSimplificationError = config.maxSimplificationError;
-	rcConfig.minRegionArea = (int)config.minRegionArea ;		// Note: area = size*size
-	rcConfig.mergeRegionArea = (int)config.mergeRegionArea;	// Note: area = size*size
-	rcConfig.maxVertsPerPoly = (int)config.maxVertsPerPoly;
-	rcConfig.tileSize = (int)tileSize;
-	rcConfig.borderSize = rcConfig.walkableRadius + 3;// Reserve enough padding.
-	rcConfig.width = rcConfig.tileSize + rcConfig.borderSize*2;
-	rcConfig.height = rcConfig.tileSize + rcConfig.borderSize*2;
-	rcConfig.detailSampleDist = config.detailSampleDist < 0.9f ? 0 : config.cs * config.detailSampleDist;
-	rcConfig.detailSampleMaxError = config.ch * config.detailSampleMaxError;
-	
-	// Expand the heighfield bounding box by border size to find the extents of geometry we need to build this tile.
-	//
-	// This is done in order to make sure that the navmesh tiles connect correctly at the borders,
-	// and the obstacles close to the border work correctly with the dilation process.
-	// No polygons (or contours) will be created on the border area.
-	//
-	// IMPORTANT!
-	//
-	//   :''''''''':
-	//   : +-----+ :
-	//   : |     | :
-	//   : |     |<--- tile to build
-	//   : |     | :  
-	//   : +-----+ :<-- geometry needed
-	//   :.........:
-	//
-	// You should use this bounding box to query your input geometry.
-	//
-	// For example if you build a navmesh for terrain, and want the navmesh tiles to match the terrain tile size
-	// you will need to pass in data from neighbour terrain tiles too! In a simple case, just pass in all the 8 neighbours,
-	// or use the bounding box below to only pass in a sliver of each of the 8 neighbours.
-	rcVcopy(rcConfig.bmin, bmin);
-	rcVcopy(rcConfig.bmax, bmax);
-	rcConfig.bmin[0] -= rcConfig.borderSize*rcConfig.cs;
-	rcConfig.bmin[2] -= rcConfig.borderSize*rcConfig.cs;
-	rcConfig.bmax[0] += rcConfig.borderSize*rcConfig.cs;
-	rcConfig.bmax[2] += rcConfig.borderSize*rcConfig.cs;
+	NavMeshBuildUtility::initTileConfig(config, tileSize, bmin, bmax, rcConfig);
 
 	float tbmin[2], tbmax[2];
 	tbmin[0] = rcConfig.bmin[0];
@@ -1029,7 +921,7 @@ unsigned char* RecastUnityPluginManager::buildTileMeshWithChunkyMesh(const int t
 	// Step 7. Create detail mesh which allows to access approximate height on each polygon.
 	//
 	
-	if (NavMeshBuildUtility::buildDetailMesh(rcConfig, buildData, context) == DT_FAILURE)
+	if (NavMeshBuildUtility::buildDetailMesh(rcConfig, config.detailThreadCount, buildData, context) == DT_FAILURE)
 	{
 		return nullptr;
 	}
@@ -1105,6 +997,7 @@ unsigned char* RecastUnityPluginManager::buildTileMeshWithChunkyMesh(const int t
 		params.cs = rcConfig.cs;
 		params.ch = rcConfig.ch;
 		params.buildBvTree = true;
+		params.bvTreeBuildMethod = TILE_BVTREE_BUILD_METHOD;
 		
 		if (!dtCreateNavMeshData(&params, &buildData.navData, &navDataSize))
 		{
@@ -1121,65 +1014,177 @@ unsigned char* RecastUnityPluginManager::buildTileMeshWithChunkyMesh(const int t
 	return navData;
 }
 
-void RecastUnityPluginManager::disposeNavMesh(void* allocatedNavMesh, int environmentId)
+void RecastUnityPluginManager::disposeNavMesh(PluginHandle allocatedNavMesh)
 {
-	if (allocatedNavMesh == nullptr)
+	if (isInitialized())
 	{
-		return;
+		getHandles().dispose(allocatedNavMesh, PLUGIN_OBJECT_NAVMESH);
 	}
-	
-	auto navMesh = (dtNavMesh*)allocatedNavMesh;
-	// Find the element 
-	auto it = std::find_if( 
-		s_instance->m_navMeshes.begin(), s_instance->m_navMeshes.end(), [&](const auto& pair) { 
-			return pair.first == environmentId 
-				   && pair.second == navMesh; 
-		}); 
-  
-	// If found, erase it 
-	if (it != s_instance->m_navMeshes.end()) { 
-		s_instance->m_navMeshes.erase(it); 
-	} 
-
-	dtFreeNavMesh(navMesh);
 }
 
 
-dtStatus RecastUnityPluginManager::createNavMeshQuery(const void* navMesh, int maxNodes, void*& allocatedNavMeshQuery, int environmentId)
+dtStatus RecastUnityPluginManager::createNavMeshQuery(PluginHandle navMesh, int maxNodes, PluginHandle& allocatedNavMeshQuery)
 {
+	NavMeshLease mesh(getHandles(), navMesh);
+	if (mesh.get() == nullptr)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	EnvironmentMemoryScope memoryScope(mesh.getEnvironmentId());
 	auto navMeshQuery = dtAllocNavMeshQuery();
-	if (navMeshQuery != nullptr)
+	if (navMeshQuery == nullptr)
 	{
-		// Store the allocated navmesh query.
-		s_instance->m_navMeshQueries.insert({environmentId, navMeshQuery});
-		navMeshQuery->init((const dtNavMesh*)navMesh, maxNodes);
-		allocatedNavMeshQuery = navMeshQuery;
-		return DT_SUCCESS;
+		return DT_FAILURE | DT_OUT_OF_MEMORY;
 	}
 
-	return DT_FAILURE;
+	const dtStatus status = navMeshQuery->init(mesh.get(), maxNodes);
+	if (dtStatusFailed(status))
+	{
+		dtFreeNavMeshQuery(navMeshQuery);
+		return status;
+	}
+
+	// Store the allocated navmesh query. It keeps its NavMesh alive, and is disposed with it.
+	allocatedNavMeshQuery = getHandles().add(navMeshQuery, PLUGIN_OBJECT_NAVMESH_QUERY, mesh.getEnvironmentId(), navMesh);
+	if (allocatedNavMeshQuery == 0)
+	{
+		// The NavMesh was disposed in the meantime.
+		dtFreeNavMeshQuery(navMeshQuery);
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	return DT_SUCCESS;
 }
 
-void RecastUnityPluginManager::disposeNavMeshQuery(void*& allocatedNavMeshQuery, int environmentId)
+void RecastUnityPluginManager::disposeNavMeshQuery(PluginHandle allocatedNavMeshQuery)
 {
-	if (allocatedNavMeshQuery == nullptr)
+	if (isInitialized())
 	{
-		return;
+		getHandles().dispose(allocatedNavMeshQuery, PLUGIN_OBJECT_NAVMESH_QUERY);
 	}
-	
-	auto navMeshQuery = (dtNavMeshQuery*)allocatedNavMeshQuery;
-	// Find the element 
-	auto it = std::find_if( 
-		s_instance->m_navMeshQueries.begin(), s_instance->m_navMeshQueries.end(), [&](const auto& pair) { 
-			return pair.first == environmentId 
-				   && pair.second == navMeshQuery; 
-		}); 
-  
-	// If found, erase it 
-	if (it != s_instance->m_navMeshQueries.end()) { 
-		s_instance->m_navMeshQueries.erase(it); 
-	} 
-	
-	dtFreeNavMeshQuery(navMeshQuery);
-	allocatedNavMeshQuery = nullptr;
+}
+
+dtStatus RecastUnityPluginManager::createTileHeightfieldCache(PluginHandle navMesh, const NavMeshBuildConfig& config, float tileSize,
+	const float* bmin, const float* bmax, PluginHandle& allocatedCache)
+{
+	NavMeshLease mesh(getHandles(), navMesh);
+	if (mesh.get() == nullptr)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// The cache keeps its NavMesh alive, and is disposed with it.
+	TileHeightfieldCache* cache = new TileHeightfieldCache(navMesh, config, tileSize, bmin, bmax);
+	allocatedCache = getHandles().add(cache, PLUGIN_OBJECT_TILE_HEIGHTFIELD_CACHE, mesh.getEnvironmentId(), navMesh);
+	if (allocatedCache == 0)
+	{
+		delete cache;
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	return DT_SUCCESS;
+}
+
+void RecastUnityPluginManager::disposeTileHeightfieldCache(PluginHandle cache)
+{
+	if (isInitialized())
+	{
+		getHandles().dispose(cache, PLUGIN_OBJECT_TILE_HEIGHTFIELD_CACHE);
+	}
+}
+
+dtStatus RecastUnityPluginManager::rebuildEditedTile(const int* tileCoordinates, TileHeightfieldCache& cache,
+	const BlockArea* blockAreas, int blocksCount, BuildContext* context)
+{
+	NavMeshLease navMesh(getHandles(), cache.getNavMesh());
+	if (navMesh.get() == nullptr)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	const int x = tileCoordinates[0];
+	const int y = tileCoordinates[1];
+
+	// The heightfield of the tile is kept across rebuilds, it must not be allocated in the arena.
+	const rcHeightfield* solid = cache.updateHeightfield(x, y, *context);
+	if (solid == nullptr)
+	{
+		context->computeAllTimings();
+		return DT_FAILURE;
+	}
+
+	EnvironmentMemoryScope memoryScope(navMesh.getEnvironmentId());
+	unsigned char* data;
+	int dataSize = 0;
+	{
+		// Must outlive buildData, which frees the intermediate data into the arena.
+		rcScopedArena arenaScope(&getTileBuildArena());
+		NavMeshBuildData buildData;
+		rcConfig rcConfig;
+		cache.getTileConfig(x, y, rcConfig);
+
+		// The filters modify the heightfield, only the copy is built from.
+		buildData.solid = rcAllocHeightfield();
+		if (buildData.solid == nullptr || !rcCopyHeightfield(context, *solid, *buildData.solid))
+		{
+			context->log(RC_LOG_ERROR, "rebuildEditedTile: Could not copy the heightfield.");
+			context->computeAllTimings();
+			return DT_FAILURE;
+		}
+		data = buildTileMeshFromHeightfield(x, y, cache.getConfig(), rcConfig, buildData, dataSize, blockAreas, blocksCount, *context);
+	}
+
+	// The previous tile no longer matches the geometry: it is removed even if the new tile is empty or could not be built.
+	dtStatus status = DT_SUCCESS;
+	navMesh->mutex.lock();
+	navMesh->removeTile(navMesh->getTileRefAt(x, y, 0), 0, 0);
+	if (data)
+	{
+		status = navMesh->addTile(data, dataSize, DT_TILE_FREE_DATA, 0, 0);
+		if (dtStatusFailed(status))
+			dtFree(data);
+	}
+	navMesh->mutex.unlock();
+
+	context->computeAllTimings();
+	return status;
+}
+
+dtStatus RecastUnityPluginManager::createNavMeshDebugDrawCache(PluginHandle navMesh, PluginHandle& allocatedCache)
+{
+	NavMeshLease mesh(getHandles(), navMesh);
+	if (mesh.get() == nullptr)
+	{
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+
+	// The cache keeps its NavMesh alive, and is disposed with it.
+	NavMeshDebugDrawCache* cache = new NavMeshDebugDrawCache(navMesh, mesh->getMaxTiles());
+	allocatedCache = getHandles().add(cache, PLUGIN_OBJECT_NAVMESH_DEBUG_DRAW_CACHE, mesh.getEnvironmentId(), navMesh);
+	if (allocatedCache == 0)
+	{
+		delete cache;
+		return DT_FAILURE | DT_INVALID_PARAM;
+	}
+	return DT_SUCCESS;
+}
+
+void RecastUnityPluginManager::disposeNavMeshDebugDrawCache(PluginHandle cache)
+{
+	if (isInitialized())
+	{
+		getHandles().dispose(cache, PLUGIN_OBJECT_NAVMESH_DEBUG_DRAW_CACHE);
+	}
+}
+
+int RecastUnityPluginManager::updateNavMeshDebugDrawCache(NavMeshDebugDrawCache& cache)
+{
+	NavMeshLease navMesh(getHandles(), cache.getNavMesh());
+	if (navMesh.get() == nullptr)
+	{
+		return -1;
+	}
+
+	// AddTile and RebuildEditedTile change the tiles under the same lock.
+	std::lock_guard<std::mutex> lock(navMesh->mutex);
+	return cache.update(*navMesh.get());
 }
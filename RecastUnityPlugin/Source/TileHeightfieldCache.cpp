@@ -0,0 +1,137 @@
+#include "TileHeightfieldCache.h"
+
+#include <vector>
+
+#include "NavMeshBuildUtility.h"
+
+TileHeightfieldCache::TileHeightfieldCache(PluginHandle navMesh, const NavMeshBuildConfig& config, float tileSize,
+                                           const float* bmin, const float* bmax) :
+	m_navMesh(navMesh),
+	m_config(config),
+	m_tileSize(tileSize)
+{
+	rcVcopy(m_bmin, bmin);
+	rcVcopy(m_bmax, bmax);
+}
+
+TileHeightfieldCache::~TileHeightfieldCache()
+{
+	for (std::unordered_map<uint64_t, rcEditableHeightfield*>::iterator it = m_tiles.begin(); it != m_tiles.end(); ++it)
+		rcFreeEditableHeightfield(it->second);
+}
+
+bool TileHeightfieldCache::setStaticGeometry(int tx, int ty, const NavMeshInputGeometry& inputGeometry, rcContext& context)
+{
+	rcConfig rcConfig;
+	getTileConfig(tx, ty, rcConfig);
+
+	rcEditableHeightfield* heightfield = findTile(tx, ty);
+	if (heightfield == nullptr)
+	{
+		heightfield = rcAllocEditableHeightfield();
+		if (heightfield == nullptr)
+		{
+			context.log(RC_LOG_ERROR, "setStaticGeometry: Out of memory 'heightfield'.");
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tiles[getTileKey(tx, ty)] = heightfield;
+	}
+
+	// Also removes the structures, which were rasterized for the previous static geometry.
+	if (!rcCreateEditableHeightfield(&context, *heightfield, rcConfig.width, rcConfig.height, rcConfig.bmin, rcConfig.bmax,
+	                                 rcConfig.cs, rcConfig.ch, rcConfig.walkableClimb))
+	{
+		removeTile(tx, ty);
+		return false;
+	}
+
+	std::vector<unsigned char> triareas(inputGeometry.trianglesCount, 0);
+	if (inputGeometry.trianglesCount > 0)
+	{
+		rcMarkWalkableTriangles(&context, rcConfig.walkableSlopeAngle, inputGeometry.vertices, inputGeometry.verticesCount,
+		                        inputGeometry.triangles, inputGeometry.trianglesCount, &triareas[0]);
+		if (!rcRasterizeTriangles(&context, inputGeometry.vertices, inputGeometry.verticesCount, inputGeometry.triangles,
+		                          &triareas[0], inputGeometry.trianglesCount, heightfield->base, rcConfig.walkableClimb))
+		{
+			context.log(RC_LOG_ERROR, "setStaticGeometry: Could not rasterize triangles.");
+			removeTile(tx, ty);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool TileHeightfieldCache::addMesh(int tx, int ty, unsigned int id, const NavMeshInputGeometry& inputGeometry, rcContext& context)
+{
+	rcEditableHeightfield* heightfield = findTile(tx, ty);
+	if (heightfield == nullptr)
+	{
+		context.log(RC_LOG_ERROR, "addMesh: The static geometry of the tile (%d, %d) was not set.", tx, ty);
+		return false;
+	}
+
+	std::vector<unsigned char> triareas(inputGeometry.trianglesCount, 0);
+	if (inputGeometry.trianglesCount > 0)
+	{
+		rcMarkWalkableTriangles(&context, m_config.walkableSlopeAngle, inputGeometry.vertices, inputGeometry.verticesCount,
+		                        inputGeometry.triangles, inputGeometry.trianglesCount, &triareas[0]);
+	}
+	return rcAddEditMesh(&context, *heightfield, id, inputGeometry.vertices, inputGeometry.verticesCount,
+	                     inputGeometry.triangles, triareas.empty() ? nullptr : &triareas[0], inputGeometry.trianglesCount);
+}
+
+bool TileHeightfieldCache::removeMesh(int tx, int ty, unsigned int id)
+{
+	rcEditableHeightfield* heightfield = findTile(tx, ty);
+	return heightfield != nullptr && rcRemoveEditMesh(*heightfield, id);
+}
+
+const rcHeightfield* TileHeightfieldCache::updateHeightfield(int tx, int ty, rcContext& context)
+{
+	rcEditableHeightfield* heightfield = findTile(tx, ty);
+	if (heightfield == nullptr || !rcUpdateEditableHeightfield(&context, *heightfield))
+		return nullptr;
+	return &heightfield->solid;
+}
+
+void TileHeightfieldCache::removeTile(int tx, int ty)
+{
+	rcEditableHeightfield* heightfield;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unordered_map<uint64_t, rcEditableHeightfield*>::iterator it = m_tiles.find(getTileKey(tx, ty));
+		if (it == m_tiles.end())
+			return;
+		heightfield = it->second;
+		m_tiles.erase(it);
+	}
+	rcFreeEditableHeightfield(heightfield);
+}
+
+void TileHeightfieldCache::getTileConfig(int tx, int ty, rcConfig& rcConfig) const
+{
+	const float tcs = m_tileSize * m_config.cs;
+	float tileBmin[3];
+	float tileBmax[3];
+	tileBmin[0] = m_bmin[0] + tx * tcs;
+	tileBmin[1] = m_bmin[1];
+	tileBmin[2] = m_bmin[2] + ty * tcs;
+	tileBmax[0] = m_bmin[0] + (tx + 1) * tcs;
+	tileBmax[1] = m_bmax[1];
+	tileBmax[2] = m_bmin[2] + (ty + 1) * tcs;
+	NavMeshBuildUtility::initTileConfig(m_config, m_tileSize, tileBmin, tileBmax, rcConfig);
+}
+
+uint64_t TileHeightfieldCache::getTileKey(int tx, int ty)
+{
+	return ((uint64_t)(uint32_t)tx << 32) | (uint64_t)(uint32_t)ty;
+}
+
+rcEditableHeightfield* TileHeightfieldCache::findTile(int tx, int ty)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::unordered_map<uint64_t, rcEditableHeightfield*>::iterator it = m_tiles.find(getTileKey(tx, ty));
+	return it != m_tiles.end() ? it->second : nullptr;
+}
@@ -7,6 +7,8 @@
 #include "BuildContext.h"
 #include "DetourNavMeshQuery.h"
 #include "DetourCommon.h"
+#include "EnvironmentMemory.h"
+#include "NavMeshDebugDrawCache.h"
 #include "NavMeshDebugDrawUtility.h"
 #include "RecastUnityPluginManager.h"
 
@@ -51,11 +53,27 @@ extern "C"
 		RecastUnityPluginManager::dispose(environmentId);
 	}
 
+	/// Returns the number of bytes allocated for the NavMeshes, their tiles and the NavMesh queries of an environment.
+	DllExport long long GetEnvironmentMemoryUsage(int environmentId)
+	{
+		return EnvironmentMemory::getAllocatedBytes(environmentId);
+	}
+
+	/// Returns the number of NavMeshes, NavMesh queries, tile heightfield caches and debug draw caches of an environment
+	/// that were not disposed yet.
+	DllExport int GetEnvironmentObjectsCount(int environmentId)
+	{
+		return RecastUnityPluginManager::getObjectsCount(environmentId);
+	}
+
 	// Allocate Navmesh
+	// The NavMeshes and the NavMesh queries are given as handles, which can be used from several threads.
+	// A handle that was disposed is rejected, even if its slot was reused since. An object disposed while another
+	// thread uses it is freed once that call returns.
 
 	/// Creates a non-tile NavMesh.
 	DllExport dtStatus CreateNavMesh(const void* config, const float* bmin, const float* bmax, const void* inputGeometry,
-	                                 void*& allocatedNavMesh, int environmentId)
+	                                 PluginHandle& allocatedNavMesh, int environmentId)
 	{
 		return RecastUnityPluginManager::createNavMesh(*((const NavMeshBuildConfig*)config), bmin, bmax,
 		                                               *((const NavMeshInputGeometry*)inputGeometry), allocatedNavMesh,
@@ -68,13 +86,13 @@ extern "C"
 	* \param tileSize The size of the tile (m)
 	* \param bmin The min bounds (world coordinates) of the whole navMesh
 	* \param bmax The max bounds (world coordinates) of the whole navMesh
-	* \param allocatedNavMesh The returned allocated NavMesh.
+	* \param allocatedNavMesh The returned handle of the allocated NavMesh.
 	* \param tilesCount The returned tiles number
 	* \param environmentId The environment id the NavMesh is linked to.
 	* \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
 	*/
 	DllExport dtStatus CreateTileNavMesh(const void* config, float tileSize,
-	                                     const float* bmin, const float* bmax, void*& allocatedNavMesh, int* tilesCount,
+	                                     const float* bmin, const float* bmax, PluginHandle& allocatedNavMesh, int* tilesCount,
 	                                     int environmentId)
 	{
 		return RecastUnityPluginManager::createTileNavMesh(*((const NavMeshBuildConfig*)config), tileSize,
@@ -90,27 +108,34 @@ extern "C"
 	 * \param bmax The max bounds (world coordinates) of the whole navMesh
 	 * \param inputGeometry The geometry (vertices + triangles) that should be used to generate the tile. Should contain
 	 * the geometry located in the bounds + a little offset around the bounds to make sure the connection between the tiles is correct.
-	 * \param navMesh The NavMesh we should add a tile on.
+	 * \param navMesh The handle of the NavMesh we should add a tile on.
 	 * \param blockAreas The block areas of the tile, to potentially flag some areas of the tile.
 	 * \param blocksCount The number of block areas.
 	 * \param contextData The data that the context must use. Used to return the timings to the C# side.
 	 */
 	DllExport void AddTile(int* tileCoordinates, const void* config, float tileSize,
 	                       const float* bmin, const float* bmax,
-	                       const void* inputGeometry, void*& navMesh, const BlockArea* blockAreas, int blocksCount,
+	                       const void* inputGeometry, PluginHandle navMesh, const BlockArea* blockAreas, int blocksCount,
 	                       void* contextData)
 	{
+		RecastUnityPluginManager::NavMeshLease mesh(RecastUnityPluginManager::getHandles(), navMesh);
+		if (mesh.get() == nullptr)
+		{
+			return;
+		}
+
+		EnvironmentMemoryScope memoryScope(mesh.getEnvironmentId());
 		TimeVal* timings = (TimeVal*)contextData;
 		BuildContext buildContext(timings);
 		return RecastUnityPluginManager::addTile(tileCoordinates, *((const NavMeshBuildConfig*)config), tileSize,
 		                                         bmin, bmax, *((const NavMeshInputGeometry*)inputGeometry),
-		                                         (dtNavMesh*)navMesh, blockAreas, blocksCount, &buildContext);
+		                                         mesh.get(), blockAreas, blocksCount, &buildContext);
 	}
 
 	/// Creates a TileNavMesh by building a ChunkyMesh. Not used anymore for now.
 	DllExport dtStatus CreateTileNavMeshWithChunkyMesh(const void* config, float tileSize, bool buildAllTiles,
 	                                                   const float* bmin, const float* bmax,
-	                                                   const void* inputGeometry, void*& allocatedNavMesh,
+	                                                   const void* inputGeometry, PluginHandle& allocatedNavMesh,
 	                                                   void*& computedChunkyTriMesh, int* tilesCount, int environmentId)
 	{
 		return RecastUnityPluginManager::createTileNavMeshWithChunkyMesh(*((const NavMeshBuildConfig*)config), tileSize,
@@ -124,23 +149,28 @@ extern "C"
 	/// Adds a tile to a TileNavMesh by building a ChunkyMesh. Not used anymore for now.
 	DllExport void AddTileWithChunkyMesh(int* tilesCoordinates, const void* config, float tileSize,
 	                                     const float* bmin, const float* bmax,
-	                                     const void* inputGeometry, void*& allocatedNavMesh, const void* chunkTriMesh,
+	                                     const void* inputGeometry, PluginHandle allocatedNavMesh, const void* chunkTriMesh,
 	                                     bool dontRecomputeBounds = false)
 	{
+		RecastUnityPluginManager::NavMeshLease mesh(RecastUnityPluginManager::getHandles(), allocatedNavMesh);
+		if (mesh.get() == nullptr)
+		{
+			return;
+		}
+
+		EnvironmentMemoryScope memoryScope(mesh.getEnvironmentId());
 		return RecastUnityPluginManager::addTileWithChunkyMesh(tilesCoordinates, *((const NavMeshBuildConfig*)config),
 		                                                       tileSize,
 		                                                       bmin, bmax, *((const NavMeshInputGeometry*)inputGeometry),
-		                                                       (dtNavMesh*)allocatedNavMesh,
+		                                                       mesh.get(),
 		                                                       (const rcChunkyTriMesh*)chunkTriMesh, dontRecomputeBounds);
 	}
 
-	/// Dispose the NavMesh passed in parameter.
-	DllExport void DisposeNavMesh(void* allocatedNavMesh, int environmentId)
+	/// Dispose the NavMesh passed in parameter, with its NavMesh queries, tile heightfield caches and debug draw caches.
+	/// Does nothing if it was already disposed.
+	DllExport void DisposeNavMesh(PluginHandle allocatedNavMesh)
 	{
-		if (allocatedNavMesh != nullptr)
-		{
-			RecastUnityPluginManager::disposeNavMesh(allocatedNavMesh, environmentId);
-		}
+		RecastUnityPluginManager::disposeNavMesh(allocatedNavMesh);
 	}
 
 	/// Dispose the NavMeshQuery passed in parameter.
@@ -153,20 +183,97 @@ extern "C"
 		}
 	}
 
-	/// Create a NavMesh query (from a specific navmesh)
-	DllExport dtStatus CreateNavMeshQuery(const void* navMesh, int maxNodes, void*& allocatedNavMeshQuery,
-	                                      int environmentId)
+	/// Create a NavMesh query (from a specific navmesh). The query is linked to the environment of the NavMesh.
+	DllExport dtStatus CreateNavMeshQuery(PluginHandle navMesh, int maxNodes, PluginHandle& allocatedNavMeshQuery)
+	{
+		return RecastUnityPluginManager::createNavMeshQuery(navMesh, maxNodes, allocatedNavMeshQuery);
+	}
+
+	// Dispose the NavMesh query passed in parameter. Does nothing if it was already disposed.
+	DllExport void DisposeNavMeshQuery(PluginHandle allocatedNavMeshQuery)
 	{
-		return RecastUnityPluginManager::createNavMeshQuery(navMesh, maxNodes, allocatedNavMeshQuery, environmentId);
+		RecastUnityPluginManager::disposeNavMeshQuery(allocatedNavMeshQuery);
 	}
 
-	// Dispose the NavMesh query passed in parameter.
-	DllExport void DisposeNavMeshQuery(void* allocatedNavMeshQuery, int environmentId)
+	// Edit tiles
+	// A TileHeightfieldCache keeps the heightfield of each tile, so that the structures built by the players are added
+	// and removed without rasterizing the rest of the tile again. Set the static geometry of a tile once, then add and
+	// remove structures and rebuild the tile.
+
+	/// Creates a cache of the tile heightfields of a TileNavMesh. The cache is linked to the environment of the NavMesh.
+	DllExport dtStatus CreateTileHeightfieldCache(PluginHandle navMesh, const void* config, float tileSize,
+	                                              const float* bmin, const float* bmax, PluginHandle& allocatedCache)
 	{
-		if (allocatedNavMeshQuery != nullptr)
+		return RecastUnityPluginManager::createTileHeightfieldCache(navMesh, *((const NavMeshBuildConfig*)config), tileSize,
+		                                                            bmin, bmax, allocatedCache);
+	}
+
+	/// Dispose the tile heightfield cache passed in parameter. Does nothing if it was already disposed.
+	DllExport void DisposeTileHeightfieldCache(PluginHandle cache)
+	{
+		RecastUnityPluginManager::disposeTileHeightfieldCache(cache);
+	}
+
+	/// Rasterizes the static geometry of a tile into the cache, and removes the structures of the tile.
+	/// The geometry is the one AddTile would use, without the structures.
+	DllExport bool SetTileStaticGeometry(PluginHandle cache, const int* tileCoordinates, const void* inputGeometry)
+	{
+		RecastUnityPluginManager::TileHeightfieldCacheLease heightfields(RecastUnityPluginManager::getHandles(), cache);
+		if (heightfields.get() == nullptr)
+		{
+			return false;
+		}
+		rcContext context;
+		return heightfields->setStaticGeometry(tileCoordinates[0], tileCoordinates[1],
+		                                       *((const NavMeshInputGeometry*)inputGeometry), context);
+	}
+
+	/// Rasterizes a structure and adds it to a tile of the cache. The tile is rebuilt by RebuildEditedTile.
+	/// A structure that overlaps several tiles must be added to each of them, with the border of the tiles.
+	DllExport bool AddTileEditMesh(PluginHandle cache, const int* tileCoordinates, unsigned int meshId, const void* inputGeometry)
+	{
+		RecastUnityPluginManager::TileHeightfieldCacheLease heightfields(RecastUnityPluginManager::getHandles(), cache);
+		if (heightfields.get() == nullptr)
+		{
+			return false;
+		}
+		rcContext context;
+		return heightfields->addMesh(tileCoordinates[0], tileCoordinates[1], meshId,
+		                             *((const NavMeshInputGeometry*)inputGeometry), context);
+	}
+
+	/// Removes a structure from a tile of the cache. The tile is rebuilt by RebuildEditedTile.
+	DllExport bool RemoveTileEditMesh(PluginHandle cache, const int* tileCoordinates, unsigned int meshId)
+	{
+		RecastUnityPluginManager::TileHeightfieldCacheLease heightfields(RecastUnityPluginManager::getHandles(), cache);
+		if (heightfields.get() == nullptr)
 		{
-			RecastUnityPluginManager::disposeNavMeshQuery(allocatedNavMeshQuery, environmentId);
+			return false;
 		}
+		return heightfields->removeMesh(tileCoordinates[0], tileCoordinates[1], meshId);
+	}
+
+	/**
+	 * \brief Rebuilds a tile of the NavMesh of the cache, after structures were added to or removed from it.
+	 * \param cache The tile heightfield cache.
+	 * \param tileCoordinates The coordinate of the tile.
+	 * \param blockAreas The block areas of the tile, to potentially flag some areas of the tile.
+	 * \param blocksCount The number of block areas.
+	 * \param contextData The data that the context must use. Used to return the timings to the C# side.
+	 * \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
+	 */
+	DllExport dtStatus RebuildEditedTile(PluginHandle cache, const int* tileCoordinates, const BlockArea* blockAreas,
+	                                     int blocksCount, void* contextData)
+	{
+		RecastUnityPluginManager::TileHeightfieldCacheLease heightfields(RecastUnityPluginManager::getHandles(), cache);
+		if (heightfields.get() == nullptr)
+		{
+			return DT_FAILURE | DT_INVALID_PARAM;
+		}
+		TimeVal* timings = (TimeVal*)contextData;
+		BuildContext buildContext(timings);
+		return RecastUnityPluginManager::rebuildEditedTile(tileCoordinates, *heightfields.get(), blockAreas, blocksCount,
+		                                                   &buildContext);
 	}
 
 	/**
@@ -181,13 +288,17 @@ extern "C"
 	 * \param pathMaxSize The max size of the path.
 	 *\return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
 	 */
-	DllExport dtStatus FindStraightPath(void* navMeshQuery, const float* startPosition, const float* endPosition,
+	DllExport dtStatus FindStraightPath(PluginHandle navMeshQuery, const float* startPosition, const float* endPosition,
 	                                    const float* polygonSearchExtents,
 	                                    const dtQueryFilter* filter, float* pathPositions,
 	                                    int* pathPositionsCount, int pathMaxSize = PATH_MAX_CAPACITY)
 	{
 		// Copied from NavMeshTesterTool.cpp
-		auto query = (dtNavMeshQuery*)navMeshQuery;
+		RecastUnityPluginManager::NavMeshQueryLease query(RecastUnityPluginManager::getHandles(), navMeshQuery);
+		if (query.get() == nullptr)
+		{
+			return DT_FAILURE | DT_INVALID_PARAM;
+		}
 		dtPolyRef startPolyRef, endPolyRef;
 		query->findNearestPoly(startPosition, polygonSearchExtents, filter, &startPolyRef, 0);
 		query->findNearestPoly(endPosition, polygonSearchExtents, filter, &endPolyRef, 0);
@@ -230,10 +341,39 @@ extern "C"
 		return DT_FAILURE;
 	}
 
+	/**
+	 * \brief Finds the nearest polygon of many positions at once (spawn positions, player positions validation, etc.)
+	 * \param navMeshQuery The navmesh query to use (references the navmesh).
+	 * \param positions The positions to resolve (3 items per position).
+	 * \param positionsCount The number of positions.
+	 * \param polygonSearchExtents The search extents to use when trying to find a suitable polygon for each position.
+	 * \param filter A filter for the polygons (for instance to exclude liquids)
+	 * \param polyRefs The found polygon of each position, 0 if none was found.
+	 * \param nearestPositions The nearest position on the found polygon of each position (3 items per position). Can be null.
+	 * \return DT_SUCCESS if success, DT_FAILURE and some other flags if it failed.
+	 */
+	DllExport dtStatus FindNearestPolys(PluginHandle navMeshQuery, const float* positions, int positionsCount,
+	                                    const float* polygonSearchExtents, const dtQueryFilter* filter,
+	                                    dtPolyRef* polyRefs, float* nearestPositions)
+	{
+		RecastUnityPluginManager::NavMeshQueryLease query(RecastUnityPluginManager::getHandles(), navMeshQuery);
+		if (query.get() == nullptr)
+		{
+			return DT_FAILURE | DT_INVALID_PARAM;
+		}
+		return query->findNearestPolyBatch(positions, positionsCount, polygonSearchExtents, filter, polyRefs,
+		                                   nearestPositions, nullptr);
+	}
+
 	// Debug
-	DllExport int GetPolyTrianglesCount(const void* navMeshHandle)
+	DllExport int GetPolyTrianglesCount(PluginHandle navMeshHandle)
 	{
-		const dtNavMesh* navMesh = (const dtNavMesh*)navMeshHandle;
+		RecastUnityPluginManager::NavMeshLease navMeshLease(RecastUnityPluginManager::getHandles(), navMeshHandle);
+		const dtNavMesh* navMesh = navMeshLease.get();
+		if (navMesh == nullptr)
+		{
+			return 0;
+		}
 		int polyTrianglesCount = 0;
 		for (int i = 0; i < navMesh->getMaxTiles(); ++i)
 		{
@@ -253,10 +393,81 @@ extern "C"
 	}
 
 	/// Fetches all the data that is necessary to draw the NavMesh.
-	DllExport bool FetchNavMeshDebugDrawData(const void* navMeshHandle, void* data)
+	DllExport bool FetchNavMeshDebugDrawData(PluginHandle navMeshHandle, void* data)
 	{
-		const dtNavMesh* navMesh = (const dtNavMesh*)navMeshHandle;
+		RecastUnityPluginManager::NavMeshLease navMeshLease(RecastUnityPluginManager::getHandles(), navMeshHandle);
+		const dtNavMesh* navMesh = navMeshLease.get();
+		if (navMesh == nullptr)
+		{
+			return false;
+		}
 		NavMeshDebugDrawData* debugDrawData = (NavMeshDebugDrawData*)data;
 		return NavMeshDebugDrawUtility::fetchTileNavMeshDebugDrawData(*navMesh, debugDrawData);
 	}
+
+	/// Creates a cache of the debug draw data of a NavMesh, which only fetches the tiles that changed.
+	/// The cache is disposed with the NavMesh. A cache must be used from one thread at a time.
+	DllExport dtStatus CreateNavMeshDebugDrawCache(PluginHandle navMeshHandle, PluginHandle& allocatedDebugDrawCache)
+	{
+		return RecastUnityPluginManager::createNavMeshDebugDrawCache(navMeshHandle, allocatedDebugDrawCache);
+	}
+
+	/// Dispose the debug draw cache passed in parameter. Does nothing if it was already disposed.
+	DllExport void DisposeNavMeshDebugDrawCache(PluginHandle debugDrawCache)
+	{
+		RecastUnityPluginManager::disposeNavMeshDebugDrawCache(debugDrawCache);
+	}
+
+	/// Fetches the tiles that changed since the last update, and returns the generation of the cache.
+	/// The generation increases each time some tiles changed. Returns -1 if the cache or its NavMesh was disposed.
+	DllExport int UpdateNavMeshDebugDrawCache(PluginHandle debugDrawCache)
+	{
+		RecastUnityPluginManager::NavMeshDebugDrawCacheLease cache(RecastUnityPluginManager::getHandles(), debugDrawCache);
+		if (cache.get() == nullptr)
+		{
+			return -1;
+		}
+		return RecastUnityPluginManager::updateNavMeshDebugDrawCache(*cache.get());
+	}
+
+	/**
+	 * \brief Gets the tiles that changed after a generation of the cache.
+	 * \param debugDrawCache The debug draw cache.
+	 * \param generation The generation of the last data that was copied. 0 to get all the tiles.
+	 * \param tileIndices The returned indices of the changed tiles.
+	 * \param maxTileIndices The max number of indices that tileIndices can hold.
+	 * \return The number of changed tiles, which can be more than maxTileIndices.
+	 */
+	DllExport int GetChangedDebugDrawTiles(PluginHandle debugDrawCache, int generation, int* tileIndices, int maxTileIndices)
+	{
+		RecastUnityPluginManager::NavMeshDebugDrawCacheLease cache(RecastUnityPluginManager::getHandles(), debugDrawCache);
+		if (cache.get() == nullptr)
+		{
+			return 0;
+		}
+		return cache->getChangedTiles(generation, tileIndices, maxTileIndices);
+	}
+
+	/// Gets the cached debug draw data of a tile. The data points to the buffers of the cache, which can be copied
+	/// directly and stay valid until the next update or the dispose of the cache.
+	DllExport bool GetDebugDrawTileData(PluginHandle debugDrawCache, int tileIndex, void* tileData)
+	{
+		RecastUnityPluginManager::NavMeshDebugDrawCacheLease cache(RecastUnityPluginManager::getHandles(), debugDrawCache);
+		if (cache.get() == nullptr)
+		{
+			return false;
+		}
+		return cache->getTileData(tileIndex, (NavMeshDebugDrawTileData*)tileData);
+	}
+
+	/// Gets the number of polygon triangles of all the tiles of the cache, without walking the NavMesh.
+	DllExport int GetCachedPolyTrianglesCount(PluginHandle debugDrawCache)
+	{
+		RecastUnityPluginManager::NavMeshDebugDrawCacheLease cache(RecastUnityPluginManager::getHandles(), debugDrawCache);
+		if (cache.get() == nullptr)
+		{
+			return 0;
+		}
+		return cache->getPolyTrianglesCount();
+	}
 }
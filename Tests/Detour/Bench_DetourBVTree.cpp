@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <set>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourAlloc.h"
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+
+namespace
+{
+// Small deterministic generator so that both trees are built from the same input.
+struct Lcg
+{
+	unsigned int state;
+	explicit Lcg(unsigned int seed) : state(seed) {}
+	unsigned int next() { state = state * 1664525u + 1013904223u; return state >> 8; }
+	int range(int lo, int hi) { return lo + (int)(next() % (unsigned int)(hi - lo + 1)); }
+	float unit() { return (float)(next() & 0xffff) / 65535.0f; }
+};
+
+// Polygon soup made of rectangles of various sizes and heights packed in a grid, which
+// is closer to a real tile than a regular grid of equally sized polygons.
+struct RectTile
+{
+	std::vector<unsigned short> verts;
+	std::vector<unsigned short> polys;
+	std::vector<unsigned short> flags;
+	std::vector<unsigned char> areas;
+	int gridSize;
+	float cs;
+	float ch;
+	int nvp;
+};
+
+void buildRectTile(RectTile& tile, int gridSize, unsigned int seed)
+{
+	tile.gridSize = gridSize;
+	tile.cs = 0.3f;
+	tile.ch = 0.2f;
+	tile.nvp = 6;
+	Lcg rng(seed);
+	std::vector<char> used(gridSize * gridSize, 0);
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			if (used[x + z * gridSize])
+				continue;
+			int w = 1;
+			const int maxW = rng.range(1, 8);
+			while (w < maxW && x + w < gridSize && !used[x + w + z * gridSize])
+				w++;
+			const int h = dtMin(rng.range(1, 8), gridSize - z);
+			for (int j = z; j < z + h; ++j)
+				for (int i = x; i < x + w; ++i)
+					used[i + j * gridSize] = 1;
+
+			const unsigned short y = (unsigned short)rng.range(0, 60);
+			const unsigned short vbase = (unsigned short)(tile.verts.size() / 3);
+			const unsigned short corners[4][2] = {
+				{ (unsigned short)x, (unsigned short)z },
+				{ (unsigned short)x, (unsigned short)(z + h) },
+				{ (unsigned short)(x + w), (unsigned short)(z + h) },
+				{ (unsigned short)(x + w), (unsigned short)z },
+			};
+			for (int i = 0; i < 4; ++i)
+			{
+				tile.verts.push_back(corners[i][0]);
+				tile.verts.push_back(y);
+				tile.verts.push_back(corners[i][1]);
+			}
+			for (int i = 0; i < tile.nvp * 2; ++i)
+				tile.polys.push_back(i < 4 ? (unsigned short)(vbase + i) : 0xffff);
+			tile.flags.push_back(1);
+			tile.areas.push_back(0);
+		}
+	}
+}
+
+unsigned char* createTileData(const RectTile& tile, int bvTreeBuildMethod, int* dataSize)
+{
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	params.verts = &tile.verts[0];
+	params.vertCount = (int)tile.verts.size() / 3;
+	params.polys = &tile.polys[0];
+	params.polyFlags = &tile.flags[0];
+	params.polyAreas = &tile.areas[0];
+	params.polyCount = (int)tile.flags.size();
+	params.nvp = tile.nvp;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.6f;
+	params.walkableClimb = 0.9f;
+	params.bmax[0] = tile.gridSize * tile.cs;
+	params.bmax[1] = 64 * tile.ch;
+	params.bmax[2] = tile.gridSize * tile.cs;
+	params.cs = tile.cs;
+	params.ch = tile.ch;
+	params.buildBvTree = true;
+	params.bvTreeBuildMethod = bvTreeBuildMethod;
+
+	unsigned char* data = 0;
+	if (!dtCreateNavMeshData(&params, &data, dataSize))
+		return 0;
+	return data;
+}
+
+dtNavMesh* createNavMesh(const RectTile& tile, int bvTreeBuildMethod)
+{
+	int dataSize = 0;
+	unsigned char* data = createTileData(tile, bvTreeBuildMethod, &dataSize);
+	if (!data)
+		return 0;
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (dtStatusFailed(nav->init(data, dataSize, DT_TILE_FREE_DATA)))
+	{
+		dtFree(data);
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	return nav;
+}
+
+const dtMeshTile* firstTile(const dtNavMesh* nav)
+{
+	return nav->getTile(0);
+}
+
+// Sum of the surface areas of the internal nodes relative to the root, the usual SAH tree quality metric.
+float treeCost(const dtMeshTile* tile)
+{
+	float cost = 0;
+	const dtBVNode& root = tile->bvTree[0];
+	const float rootArea = (float)(root.bmax[0] - root.bmin[0] + 1) * (root.bmax[2] - root.bmin[2] + 1);
+	for (int i = 0; i < tile->header->polyCount * 2 - 1; ++i)
+	{
+		const dtBVNode& n = tile->bvTree[i];
+		if (n.i >= 0)
+			continue;
+		const float dx = (float)(n.bmax[0] - n.bmin[0] + 1);
+		const float dy = (float)(n.bmax[1] - n.bmin[1] + 1);
+		const float dz = (float)(n.bmax[2] - n.bmin[2] + 1);
+		cost += (dx * dy + dy * dz + dz * dx) / rootArea;
+	}
+	return cost;
+}
+
+void randomBox(Lcg& rng, const RectTile& tile, float* center, float* halfExtents)
+{
+	const float size = tile.gridSize * tile.cs;
+	center[0] = rng.unit() * size;
+	center[1] = rng.unit() * 64 * tile.ch;
+	center[2] = rng.unit() * size;
+	halfExtents[0] = 0.2f + rng.unit() * 2.0f;
+	halfExtents[1] = 0.5f + rng.unit() * 2.0f;
+	halfExtents[2] = 0.2f + rng.unit() * 2.0f;
+}
+
+int64_t nowNanos()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+TEST_CASE("dtCreateNavMeshData BV tree build methods", "[detour, bvtree]")
+{
+	RectTile tile;
+	buildRectTile(tile, 256, 1234);
+
+	dtNavMesh* median = createNavMesh(tile, DT_BVTREE_MEDIAN);
+	dtNavMesh* sah = createNavMesh(tile, DT_BVTREE_SAH);
+	REQUIRE(median);
+	REQUIRE(sah);
+
+	dtNavMeshQuery* medianQuery = dtAllocNavMeshQuery();
+	dtNavMeshQuery* sahQuery = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(medianQuery->init(median, 256)));
+	REQUIRE(dtStatusSucceed(sahQuery->init(sah, 256)));
+
+	SECTION("The SAH tree is a complete tree with valid escape indices")
+	{
+		const dtMeshTile* t = firstTile(sah);
+		const int nodeCount = t->header->polyCount * 2 - 1;
+		std::set<int> leaves;
+		for (int i = 0; i < nodeCount; ++i)
+		{
+			const dtBVNode& n = t->bvTree[i];
+			if (n.i >= 0)
+				leaves.insert(n.i);
+			else
+				REQUIRE(i - n.i <= nodeCount);
+		}
+		CHECK((int)leaves.size() == t->header->polyCount);
+	}
+
+	SECTION("Both trees return the same polygons")
+	{
+		dtQueryFilter filter;
+		Lcg rng(42);
+		for (int i = 0; i < 500; ++i)
+		{
+			float center[3], halfExtents[3];
+			randomBox(rng, tile, center, halfExtents);
+
+			dtPolyRef medianPolys[512], sahPolys[512];
+			int medianCount = 0, sahCount = 0;
+			medianQuery->queryPolygons(center, halfExtents, &filter, medianPolys, &medianCount, 512);
+			sahQuery->queryPolygons(center, halfExtents, &filter, sahPolys, &sahCount, 512);
+
+			const std::set<dtPolyRef> medianSet(medianPolys, medianPolys + medianCount);
+			const std::set<dtPolyRef> sahSet(sahPolys, sahPolys + sahCount);
+			REQUIRE(medianSet == sahSet);
+		}
+	}
+
+	SECTION("The SAH tree is not looser than the median tree")
+	{
+		CHECK(treeCost(firstTile(sah)) <= treeCost(firstTile(median)));
+	}
+
+	dtFreeNavMeshQuery(medianQuery);
+	dtFreeNavMeshQuery(sahQuery);
+	dtFreeNavMesh(median);
+	dtFreeNavMesh(sah);
+}
+
+TEST_CASE("Bench BV tree build and query", "[detour, bvtree, bench]")
+{
+	RectTile tile;
+	buildRectTile(tile, 384, 1234);
+	const int buildIterations = 20;
+	const int queryIterations = 100000;
+	const char* names[] = { "median", "sah" };
+	const int methods[] = { DT_BVTREE_MEDIAN, DT_BVTREE_SAH };
+
+	for (int m = 0; m < 2; ++m)
+	{
+		int64_t begin = nowNanos();
+		for (int i = 0; i < buildIterations; ++i)
+		{
+			int dataSize = 0;
+			unsigned char* data = createTileData(tile, methods[m], &dataSize);
+			REQUIRE(data);
+			dtFree(data);
+		}
+		const int64_t buildNanos = nowNanos() - begin;
+
+		dtNavMesh* nav = createNavMesh(tile, methods[m]);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+		dtQueryFilter filter;
+		Lcg rng(42);
+		int found = 0;
+		begin = nowNanos();
+		for (int i = 0; i < queryIterations; ++i)
+		{
+			float center[3], halfExtents[3];
+			randomBox(rng, tile, center, halfExtents);
+			dtPolyRef polys[512];
+			int count = 0;
+			query->queryPolygons(center, halfExtents, &filter, polys, &count, 512);
+			found += count;
+		}
+		const int64_t queryNanos = nowNanos() - begin;
+
+		printf("BM_BVTree_%-8s %d polys, build %10.2f micros/tile, query %8.2f nanos/it, tree cost %8.2f (%d hits)\n",
+			   names[m], firstTile(nav)->header->polyCount, double(buildNanos) / buildIterations / 1000.0,
+			   double(queryNanos) / queryIterations, treeCost(firstTile(nav)), found);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+	}
+}
@@ -0,0 +1,256 @@
+#ifndef GRIDNAVMESH_H
+#define GRIDNAVMESH_H
+
+#include <string.h>
+#include <vector>
+
+#include "DetourAlloc.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourTileDataPool.h"
+
+/// Off-mesh connection of a grid navmesh.
+struct GridOffMeshConnection
+{
+	float start[3];
+	float end[3];
+	float radius;
+	bool bidir;
+};
+
+/// Describes a flat tiled navmesh made of one square polygon per grid cell, lying on the y = 0 plane.
+/// Used by the tests that need real polygon connectivity without running the whole Recast pipeline.
+struct GridNavMeshDesc
+{
+	int tilesX;				///< Number of tiles along the x-axis.
+	int tilesZ;				///< Number of tiles along the z-axis.
+	int tileCells;			///< Number of cells along each side of a tile.
+	float cellSize;			///< Size of a cell in world units.
+	/// Cells without polygon, row major over the whole grid, (tilesX * tileCells) * (tilesZ * tileCells)
+	/// entries. Non zero means blocked. [opt]
+	const std::vector<char>* blocked;
+	/// Off-mesh connections, stored in the tile containing their start point. [opt]
+	const std::vector<GridOffMeshConnection>* offMeshCons;
+
+	GridNavMeshDesc() : tilesX(1), tilesZ(1), tileCells(8), cellSize(1.0f), blocked(0), offMeshCons(0) {}
+
+	int gridWidth() const { return tilesX * tileCells; }
+	int gridHeight() const { return tilesZ * tileCells; }
+
+	bool isBlocked(int x, int z) const
+	{
+		if (x < 0 || z < 0 || x >= gridWidth() || z >= gridHeight())
+			return true;
+		return blocked && (*blocked)[x + z * gridWidth()] != 0;
+	}
+
+	/// World position of the center of a cell.
+	void cellCenter(int x, int z, float* pos) const
+	{
+		pos[0] = (x + 0.5f) * cellSize;
+		pos[1] = 0.0f;
+		pos[2] = (z + 0.5f) * cellSize;
+	}
+};
+
+/// Builds the tile data of a grid navmesh tile. The polygons are ordered row major.
+inline unsigned char* createGridNavMeshTileData(const GridNavMeshDesc& desc, int tx, int tz, int* dataSize,
+												dtTileDataPool* pool = 0)
+{
+	const int n = desc.tileCells;
+	const int nvp = 6;
+	const unsigned short nullIdx = 0xffff;
+
+	std::vector<unsigned short> verts;
+	for (int z = 0; z <= n; ++z)
+	{
+		for (int x = 0; x <= n; ++x)
+		{
+			verts.push_back((unsigned short)x);
+			verts.push_back(10);
+			verts.push_back((unsigned short)z);
+		}
+	}
+
+	std::vector<unsigned short> polys;
+	std::vector<unsigned short> flags;
+	std::vector<unsigned char> areas;
+	std::vector<int> polyIndex(n * n, -1);
+	for (int z = 0; z < n; ++z)
+	{
+		for (int x = 0; x < n; ++x)
+		{
+			if (!desc.isBlocked(tx * n + x, tz * n + z))
+				polyIndex[x + z * n] = (int)flags.size();
+			if (polyIndex[x + z * n] != -1)
+			{
+				flags.push_back(1);
+				areas.push_back(0);
+			}
+		}
+	}
+	if (flags.empty())
+		return 0;
+
+	for (int z = 0; z < n; ++z)
+	{
+		for (int x = 0; x < n; ++x)
+		{
+			if (polyIndex[x + z * n] == -1)
+				continue;
+			// Same winding as the polygons built by Recast.
+			const unsigned short v0 = (unsigned short)(x + z * (n + 1));
+			const unsigned short v1 = (unsigned short)(x + (z + 1) * (n + 1));
+			const unsigned short v2 = (unsigned short)(x + 1 + (z + 1) * (n + 1));
+			const unsigned short v3 = (unsigned short)(x + 1 + z * (n + 1));
+			const unsigned short pv[4] = { v0, v1, v2, v3 };
+			// Edges face x-, z+, x+, z-. Portals to the neighbour tiles use the Recast direction encoding.
+			const int dx[4] = { -1, 0, 1, 0 };
+			const int dz[4] = { 0, 1, 0, -1 };
+			unsigned short nei[4];
+			for (int e = 0; e < 4; ++e)
+			{
+				const int nx = x + dx[e];
+				const int nz = z + dz[e];
+				if (nx >= 0 && nz >= 0 && nx < n && nz < n)
+				{
+					const int ni = polyIndex[nx + nz * n];
+					nei[e] = ni == -1 ? nullIdx : (unsigned short)ni;
+				}
+				else
+				{
+					nei[e] = (unsigned short)(0x8000 | e);
+				}
+			}
+			for (int i = 0; i < nvp; ++i)
+				polys.push_back(i < 4 ? pv[i] : nullIdx);
+			for (int i = 0; i < nvp; ++i)
+				polys.push_back(i < 4 ? nei[i] : nullIdx);
+		}
+	}
+
+	std::vector<float> conVerts;
+	std::vector<float> conRads;
+	std::vector<unsigned char> conDirs;
+	std::vector<unsigned char> conAreas;
+	std::vector<unsigned short> conFlags;
+	std::vector<unsigned int> conIds;
+	if (desc.offMeshCons)
+	{
+		for (size_t i = 0; i < desc.offMeshCons->size(); ++i)
+		{
+			const GridOffMeshConnection& con = (*desc.offMeshCons)[i];
+			conVerts.insert(conVerts.end(), con.start, con.start + 3);
+			conVerts.insert(conVerts.end(), con.end, con.end + 3);
+			conRads.push_back(con.radius);
+			conDirs.push_back(con.bidir ? DT_OFFMESH_CON_BIDIR : 0);
+			conAreas.push_back(0);
+			conFlags.push_back(1);
+			conIds.push_back((unsigned int)i);
+		}
+	}
+
+	dtNavMeshCreateParams params;
+	memset(&params, 0, sizeof(params));
+	if (!conRads.empty())
+	{
+		params.offMeshConVerts = &conVerts[0];
+		params.offMeshConRad = &conRads[0];
+		params.offMeshConDir = &conDirs[0];
+		params.offMeshConAreas = &conAreas[0];
+		params.offMeshConFlags = &conFlags[0];
+		params.offMeshConUserID = &conIds[0];
+		params.offMeshConCount = (int)conRads.size();
+	}
+	params.verts = &verts[0];
+	params.vertCount = (int)verts.size() / 3;
+	params.polys = &polys[0];
+	params.polyFlags = &flags[0];
+	params.polyAreas = &areas[0];
+	params.polyCount = (int)flags.size();
+	params.nvp = nvp;
+	params.walkableHeight = 2.0f;
+	params.walkableRadius = 0.5f;
+	params.walkableClimb = 0.5f;
+	params.tileX = tx;
+	params.tileY = tz;
+	params.bmin[0] = tx * n * desc.cellSize;
+	params.bmin[1] = -1.0f;
+	params.bmin[2] = tz * n * desc.cellSize;
+	params.bmax[0] = (tx + 1) * n * desc.cellSize;
+	params.bmax[1] = 1.0f;
+	params.bmax[2] = (tz + 1) * n * desc.cellSize;
+	params.cs = desc.cellSize;
+	params.ch = 0.1f;
+	params.buildBvTree = true;
+
+	unsigned char* data = 0;
+	if (!dtCreateNavMeshData(&params, &data, dataSize, pool))
+		return 0;
+	return data;
+}
+
+/// Initializes a tiled navmesh for the grid, without adding any tile.
+inline dtNavMesh* allocGridNavMesh(const GridNavMeshDesc& desc)
+{
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = desc.tileCells * desc.cellSize;
+	params.tileHeight = desc.tileCells * desc.cellSize;
+	params.maxTiles = desc.tilesX * desc.tilesZ;
+	params.maxPolys = desc.tileCells * desc.tileCells + (desc.offMeshCons ? (int)desc.offMeshCons->size() : 0);
+
+	dtNavMesh* nav = dtAllocNavMesh();
+	if (!nav || dtStatusFailed(nav->init(&params)))
+	{
+		dtFreeNavMesh(nav);
+		return 0;
+	}
+	return nav;
+}
+
+/// Adds (or replaces) the tile of the grid at the given location.
+inline dtStatus addGridNavMeshTile(dtNavMesh* nav, const GridNavMeshDesc& desc, int tx, int tz,
+								   dtTileDataPool* pool = 0)
+{
+	const dtTileRef oldRef = nav->getTileRefAt(tx, tz, 0);
+	if (oldRef)
+		nav->removeTile(oldRef, 0, 0);
+
+	int dataSize = 0;
+	unsigned char* data = createGridNavMeshTileData(desc, tx, tz, &dataSize, pool);
+	if (!data)
+		return DT_SUCCESS;
+	const int flags = DT_TILE_FREE_DATA | (pool ? DT_TILE_POOLED_DATA : 0);
+	const dtStatus status = nav->addTile(data, dataSize, flags, 0, 0);
+	if (dtStatusFailed(status))
+	{
+		if (pool)
+			dtTileDataPool::release(data);
+		else
+			dtFree(data);
+	}
+	return status;
+}
+
+/// Builds a tiled navmesh with all the tiles of the grid.
+inline dtNavMesh* createGridNavMesh(const GridNavMeshDesc& desc)
+{
+	dtNavMesh* nav = allocGridNavMesh(desc);
+	if (!nav)
+		return 0;
+	for (int z = 0; z < desc.tilesZ; ++z)
+	{
+		for (int x = 0; x < desc.tilesX; ++x)
+		{
+			if (dtStatusFailed(addGridNavMeshTile(nav, desc, x, z)))
+			{
+				dtFreeNavMesh(nav);
+				return 0;
+			}
+		}
+	}
+	return nav;
+}
+
+#endif // GRIDNAVMESH_H
@@ -0,0 +1,205 @@
+#include <float.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourFlowField.h"
+
+#include "GridNavMesh.h"
+
+namespace
+{
+dtPolyRef findCellPoly(const dtNavMeshQuery* query, const GridNavMeshDesc& desc, int x, int z)
+{
+	float pos[3];
+	desc.cellCenter(x, z, pos);
+	const float halfExtents[3] = { 0.1f, 2.0f, 0.1f };
+	dtQueryFilter filter;
+	dtPolyRef ref = 0;
+	query->findNearestPoly(pos, halfExtents, &filter, &ref, 0);
+	return ref;
+}
+
+// Checks that the updated field has the costs of a field built from scratch.
+void requireSameCosts(const dtNavMeshQuery* query, const GridNavMeshDesc& desc, const dtFlowField& field)
+{
+	dtQueryFilter filter;
+	dtFlowField built;
+	REQUIRE(dtStatusSucceed(built.init(field.getNavMesh())));
+	REQUIRE(dtStatusSucceed(built.build(query, field.getGoalRef(), field.getGoalPos(), &filter)));
+	for (int z = 0; z < desc.gridHeight(); ++z)
+	{
+		for (int x = 0; x < desc.gridWidth(); ++x)
+		{
+			const dtPolyRef ref = findCellPoly(query, desc, x, z);
+			if (!ref)
+				continue;
+			REQUIRE(field.isReachable(ref) == built.isReachable(ref));
+			if (built.isReachable(ref))
+				REQUIRE(field.getCost(ref) == Catch::Approx(built.getCost(ref)).margin(1e-3));
+		}
+	}
+}
+}
+
+TEST_CASE("dtFlowField", "[detour, flowfield]")
+{
+	std::vector<char> blocked(16 * 8, 0);
+	GridNavMeshDesc desc;
+	desc.tilesX = 2;
+	desc.blocked = &blocked;
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav != 0);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(query != 0);
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	dtQueryFilter filter;
+
+	const dtPolyRef goalRef = findCellPoly(query, desc, 1, 1);
+	float goalPos[3];
+	desc.cellCenter(1, 1, goalPos);
+
+	dtFlowField field;
+	REQUIRE(dtStatusSucceed(field.init(nav)));
+	REQUIRE(dtStatusSucceed(field.build(query, goalRef, goalPos, &filter)));
+
+	SECTION("Every polygon leads to the goal")
+	{
+		REQUIRE(field.getCost(goalRef) == 0.0f);
+		REQUIRE(field.getNextPoly(goalRef) == 0);
+		for (int z = 0; z < desc.gridHeight(); ++z)
+		{
+			for (int x = 0; x < desc.gridWidth(); ++x)
+			{
+				const dtPolyRef ref = findCellPoly(query, desc, x, z);
+				REQUIRE(field.isReachable(ref));
+				const dtPolyRef next = field.getNextPoly(ref);
+				if (ref != goalRef)
+					REQUIRE(field.getCost(next) < field.getCost(ref));
+			}
+		}
+	}
+
+	SECTION("The corridor follows the next polygons to the goal")
+	{
+		const dtPolyRef startRef = findCellPoly(query, desc, 14, 6);
+		dtPolyRef path[64];
+		int pathCount = 0;
+		REQUIRE(field.getCorridor(startRef, path, &pathCount, 64) == DT_SUCCESS);
+		// The shortest path on the grid crosses 13 + 5 cells, plus the start cell.
+		REQUIRE(pathCount == 19);
+		REQUIRE(path[0] == startRef);
+		REQUIRE(path[pathCount - 1] == goalRef);
+		for (int i = 0; i + 1 < pathCount; ++i)
+			REQUIRE(field.getNextPoly(path[i]) == path[i + 1]);
+
+		REQUIRE(field.getCorridor(startRef, path, &pathCount, 4) == (DT_SUCCESS | DT_BUFFER_TOO_SMALL));
+		REQUIRE(pathCount == 4);
+	}
+
+	SECTION("The polygons walled off from the goal are not reachable")
+	{
+		for (int z = 0; z < 8; ++z)
+			blocked[12 + z * 16] = 1;
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+		REQUIRE(dtStatusSucceed(field.build(query, goalRef, goalPos, &filter)));
+		const dtPolyRef ref = findCellPoly(query, desc, 14, 6);
+		REQUIRE(!field.isReachable(ref));
+		REQUIRE(field.getCost(ref) == FLT_MAX);
+		dtPolyRef path[64];
+		int pathCount = 0;
+		REQUIRE(dtStatusFailed(field.getCorridor(ref, path, &pathCount, 64)));
+		REQUIRE(pathCount == 0);
+	}
+
+	SECTION("The field is updated when a tile changes")
+	{
+		const dtPolyRef oldRef = findCellPoly(query, desc, 14, 6);
+		const float oldCost = field.getCost(oldRef);
+
+		// A wall with a gap: the costs behind it increase.
+		for (int z = 1; z < 8; ++z)
+			blocked[10 + z * 16] = 1;
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+		REQUIRE(!field.isReachable(oldRef));
+		REQUIRE(dtStatusSucceed(field.update(query)));
+		requireSameCosts(query, desc, field);
+		const dtPolyRef ref = findCellPoly(query, desc, 14, 6);
+		REQUIRE(field.getCost(ref) > oldCost);
+		dtPolyRef path[64];
+		int pathCount = 0;
+		REQUIRE(field.getCorridor(ref, path, &pathCount, 64) == DT_SUCCESS);
+		REQUIRE(path[pathCount - 1] == goalRef);
+
+		// The wall is removed: the costs decrease.
+		for (int z = 1; z < 8; ++z)
+			blocked[10 + z * 16] = 0;
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+		REQUIRE(dtStatusSucceed(field.update(query)));
+		requireSameCosts(query, desc, field);
+		REQUIRE(field.getCost(findCellPoly(query, desc, 14, 6)) == Catch::Approx(oldCost).margin(1e-3));
+
+		// Nothing changed.
+		REQUIRE(dtStatusSucceed(field.update(query)));
+		requireSameCosts(query, desc, field);
+	}
+
+	SECTION("The field is updated when a tile is removed and added")
+	{
+		// The second tile reaches the goal only through a gap in a wall of the first tile.
+		for (int z = 0; z < 7; ++z)
+			blocked[7 + z * 16] = 1;
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 0, 0)));
+		const dtPolyRef goal = findCellPoly(query, desc, 1, 1);
+		REQUIRE(dtStatusSucceed(field.build(query, goal, goalPos, &filter)));
+
+		// Removing the second tile disconnects nothing in the first one.
+		const dtPolyRef left = findCellPoly(query, desc, 6, 6);
+		const float leftCost = field.getCost(left);
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 0, 0), 0, 0)));
+		REQUIRE(dtStatusSucceed(field.update(query)));
+		REQUIRE(field.getCost(left) == Catch::Approx(leftCost).margin(1e-3));
+		requireSameCosts(query, desc, field);
+
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+		REQUIRE(dtStatusSucceed(field.update(query)));
+		requireSameCosts(query, desc, field);
+		REQUIRE(field.isReachable(findCellPoly(query, desc, 14, 6)));
+	}
+
+	SECTION("The field is updated when a tile is replaced at the same reference")
+	{
+		// The same number of polygons, at the same reference: only the change count of the tile differs.
+		for (int z = 0; z < 7; ++z)
+			blocked[10 + z * 16] = 1;
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+		REQUIRE(dtStatusSucceed(field.build(query, goalRef, goalPos, &filter)));
+		const float oldCost = field.getCost(findCellPoly(query, desc, 14, 0));
+
+		const dtTileRef ref = nav->getTileRefAt(1, 0, 0);
+		REQUIRE(dtStatusSucceed(nav->removeTile(ref, 0, 0)));
+		blocked[10 + 0 * 16] = 0;
+		blocked[10 + 7 * 16] = 1;
+		int dataSize = 0;
+		unsigned char* data = createGridNavMeshTileData(desc, 1, 0, &dataSize, 0);
+		REQUIRE(data != 0);
+		REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, ref, 0)));
+		REQUIRE(nav->getTileRefAt(1, 0, 0) == ref);
+
+		REQUIRE(dtStatusSucceed(field.update(query)));
+		requireSameCosts(query, desc, field);
+		REQUIRE(field.getCost(findCellPoly(query, desc, 14, 0)) < oldCost);
+	}
+
+	SECTION("The update fails when the goal tile changes")
+	{
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 0, 0)));
+		REQUIRE(dtStatusFailed(field.update(query)));
+		REQUIRE(field.getGoalRef() == 0);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,353 @@
+#include <map>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshConnectivity.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+
+#include "GridNavMesh.h"
+
+namespace
+{
+int findComponent(std::vector<int>& parent, int i)
+{
+	while (parent[i] != i)
+		i = parent[i] = parent[parent[i]];
+	return i;
+}
+
+// Labels the islands of the mesh from scratch and checks that the index agrees.
+void checkIslands(const dtNavMesh* nav, const dtNavMeshConnectivity* connectivity)
+{
+	std::map<dtPolyRef, int> index;
+	std::vector<dtPolyRef> refs;
+	for (int i = 0; i < nav->getMaxTiles(); ++i)
+	{
+		const dtMeshTile* tile = nav->getTile(i);
+		if (!tile || !tile->header)
+			continue;
+		const dtPolyRef base = nav->getPolyRefBase(tile);
+		for (int j = 0; j < tile->header->polyCount; ++j)
+		{
+			index[base | (dtPolyRef)j] = (int)refs.size();
+			refs.push_back(base | (dtPolyRef)j);
+		}
+	}
+
+	for (int m = 0; m < connectivity->getMaskCount(); ++m)
+	{
+		const unsigned short mask = connectivity->getMaskFlags(m);
+		std::vector<int> parent(refs.size());
+		for (size_t i = 0; i < refs.size(); ++i)
+			parent[i] = (int)i;
+
+		for (size_t i = 0; i < refs.size(); ++i)
+		{
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			nav->getTileAndPolyByRefUnsafe(refs[i], &tile, &poly);
+			if (!(poly->flags & mask))
+				continue;
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+			{
+				const dtMeshTile* neiTile = 0;
+				const dtPoly* neiPoly = 0;
+				nav->getTileAndPolyByRefUnsafe(tile->links[k].ref, &neiTile, &neiPoly);
+				if (neiPoly->flags & mask)
+					parent[findComponent(parent, (int)i)] = findComponent(parent, index[tile->links[k].ref]);
+			}
+		}
+
+		std::map<int, unsigned int> componentIslands;
+		std::map<unsigned int, int> islandComponents;
+		for (size_t i = 0; i < refs.size(); ++i)
+		{
+			const dtMeshTile* tile = 0;
+			const dtPoly* poly = 0;
+			nav->getTileAndPolyByRefUnsafe(refs[i], &tile, &poly);
+			const unsigned int island = connectivity->getPolyIsland(refs[i], m);
+			if (!(poly->flags & mask))
+			{
+				REQUIRE(island == DT_NULL_ISLAND);
+				continue;
+			}
+			REQUIRE(island != DT_NULL_ISLAND);
+			const int component = findComponent(parent, (int)i);
+			if (componentIslands.count(component))
+				REQUIRE(componentIslands[component] == island);
+			else
+				componentIslands[component] = island;
+			if (islandComponents.count(island))
+				REQUIRE(islandComponents[island] == component);
+			else
+				islandComponents[island] = component;
+		}
+	}
+}
+
+dtPolyRef findCellPoly(const dtNavMeshQuery* query, const GridNavMeshDesc& desc, int x, int z)
+{
+	float pos[3];
+	desc.cellCenter(x, z, pos);
+	const float halfExtents[3] = { 0.1f, 2.0f, 0.1f };
+	dtQueryFilter filter;
+	filter.setIncludeFlags(0xffff);
+	dtPolyRef ref = 0;
+	query->findNearestPoly(pos, halfExtents, &filter, &ref, 0);
+	return ref;
+}
+}
+
+TEST_CASE("dtNavMeshConnectivity", "[detour, connectivity]")
+{
+	GridNavMeshDesc desc;
+	desc.tilesX = 4;
+	desc.tilesZ = 4;
+	desc.tileCells = 8;
+	// A wall along x = 12 with a single door at z = 20 splits the mesh in two.
+	std::vector<char> blocked(desc.gridWidth() * desc.gridHeight(), 0);
+	for (int z = 0; z < desc.gridHeight(); ++z)
+		blocked[12 + z * desc.gridWidth()] = z == 20 ? 0 : 1;
+	desc.blocked = &blocked;
+
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	const unsigned short masks[2] = { 1, 1 | 2 };
+	REQUIRE(dtStatusSucceed(nav->initConnectivity(masks, 2)));
+	const dtNavMeshConnectivity* connectivity = nav->getConnectivity();
+	REQUIRE(connectivity);
+	checkIslands(nav, connectivity);
+
+	const dtPolyRef door = findCellPoly(query, desc, 12, 20);
+	const dtPolyRef left = findCellPoly(query, desc, 2, 3);
+	const dtPolyRef right = findCellPoly(query, desc, 29, 30);
+	REQUIRE(door);
+	REQUIRE(left);
+	REQUIRE(right);
+
+	dtQueryFilter filter;
+	filter.setIncludeFlags(1);
+
+	SECTION("Polygon flags split and merge islands")
+	{
+		CHECK(query->arePolysConnected(left, right, &filter));
+
+		// Flag 2 only passes the second mask.
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, 2)));
+		checkIslands(nav, connectivity);
+		CHECK(!query->arePolysConnected(left, right, &filter));
+		filter.setIncludeFlags(2);
+		CHECK(query->arePolysConnected(left, right, &filter));
+		filter.setIncludeFlags(1 | 2);
+		CHECK(query->arePolysConnected(left, right, &filter));
+		// No mask contains flag 4, the answer is unknown.
+		filter.setIncludeFlags(1 | 4);
+		CHECK(query->arePolysConnected(left, right, &filter));
+
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, 1)));
+		checkIslands(nav, connectivity);
+		filter.setIncludeFlags(1);
+		CHECK(query->arePolysConnected(left, right, &filter));
+	}
+
+	SECTION("Bidirectional findPath rejects disconnected polygons")
+	{
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, 0)));
+		float startPos[3], endPos[3];
+		desc.cellCenter(2, 3, startPos);
+		desc.cellCenter(29, 30, endPos);
+		dtPolyRef path[256];
+		int pathCount = 0;
+		const dtStatus status = query->findPath(left, right, startPos, endPos, &filter, path, &pathCount, 256, DT_FINDPATH_BIDIRECTIONAL);
+		CHECK(dtStatusSucceed(status));
+		CHECK(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		REQUIRE(pathCount == 1);
+		CHECK(path[0] == left);
+		CHECK(query->getNodePool()->getNodeCount() == 0);
+	}
+
+	SECTION("Removing and adding tiles")
+	{
+		// Removing the tile of the door splits the mesh.
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 2, 0), 0, 0)));
+		checkIslands(nav, connectivity);
+		CHECK(!query->arePolysConnected(left, right, &filter));
+
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 2)));
+		checkIslands(nav, connectivity);
+		CHECK(query->arePolysConnected(left, right, &filter));
+
+		// Rebuilding tiles with other obstacles.
+		for (int i = 0; i < 40; ++i)
+		{
+			const int tx = (i * 7) % desc.tilesX;
+			const int tz = (i * 3 + i / 4) % desc.tilesZ;
+			for (int z = tz * desc.tileCells; z < (tz + 1) * desc.tileCells; ++z)
+			{
+				for (int x = tx * desc.tileCells; x < (tx + 1) * desc.tileCells; ++x)
+				{
+					if (x != 12)
+						blocked[x + z * desc.gridWidth()] = ((x * 13 + z * 7 + i) % 5) == 0 ? 1 : 0;
+				}
+			}
+			REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, tx, tz)));
+			checkIslands(nav, connectivity);
+		}
+	}
+
+	SECTION("Island ids are reclaimed")
+	{
+		for (int i = 0; i < 500; ++i)
+		{
+			REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, (unsigned short)(i & 3))));
+			CHECK(connectivity->getIslandIdCount() < 2000);
+		}
+		checkIslands(nav, connectivity);
+	}
+
+	SECTION("Tracking can be stopped")
+	{
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, 0)));
+		CHECK(!query->arePolysConnected(left, right, &filter));
+		REQUIRE(dtStatusSucceed(nav->initConnectivity(0, 0)));
+		CHECK(nav->getConnectivity() == 0);
+		CHECK(query->arePolysConnected(left, right, &filter));
+		CHECK(dtStatusFailed(nav->initConnectivity(0, 1)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshConnectivity off-mesh connections", "[detour, connectivity]")
+{
+	GridNavMeshDesc desc;
+	desc.tilesX = 4;
+	desc.tilesZ = 4;
+	desc.tileCells = 8;
+	std::vector<char> blocked(desc.gridWidth() * desc.gridHeight(), 0);
+	for (int i = 0; i < desc.gridWidth(); ++i)
+	{
+		blocked[15 + i * desc.gridWidth()] = 1;
+		blocked[i + 15 * desc.gridWidth()] = 1;
+	}
+	desc.blocked = &blocked;
+
+	// One-way jump over the walls from the tile (1, 1) into the tile (2, 2).
+	std::vector<GridOffMeshConnection> cons(1);
+	desc.cellCenter(14, 14, cons[0].start);
+	desc.cellCenter(16, 16, cons[0].end);
+	cons[0].radius = 0.4f;
+	cons[0].bidir = false;
+	desc.offMeshCons = &cons;
+
+	// Add the tiles in an order where the landing tile comes after the tile of the connection.
+	dtNavMesh* nav = allocGridNavMesh(desc);
+	REQUIRE(nav);
+	const unsigned short mask = 1;
+	REQUIRE(dtStatusSucceed(nav->initConnectivity(&mask, 1)));
+	const dtNavMeshConnectivity* connectivity = nav->getConnectivity();
+	for (int z = desc.tilesZ - 1; z >= 0; --z)
+	{
+		for (int x = 0; x < desc.tilesX; ++x)
+		{
+			if (x == 1 && z == 1)
+				continue;
+			GridNavMeshDesc tileDesc = desc;
+			tileDesc.offMeshCons = 0;
+			REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, tileDesc, x, z)));
+		}
+	}
+	REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 1)));
+	checkIslands(nav, connectivity);
+
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+	filter.setIncludeFlags(1);
+	const dtPolyRef start = findCellPoly(query, desc, 2, 2);
+	const dtPolyRef corner = findCellPoly(query, desc, 20, 20);
+	REQUIRE(start);
+	REQUIRE(corner);
+	CHECK(query->arePolysConnected(start, corner, &filter));
+
+	// Removing and adding back the landing tile.
+	REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(2, 2, 0), 0, 0)));
+	checkIslands(nav, connectivity);
+	GridNavMeshDesc tileDesc = desc;
+	tileDesc.offMeshCons = 0;
+	REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, tileDesc, 2, 2)));
+	checkIslands(nav, connectivity);
+	const dtPolyRef newCorner = findCellPoly(query, desc, 20, 20);
+	CHECK(query->arePolysConnected(start, newCorner, &filter));
+
+	// Removing the tile of the connection isolates the corner.
+	REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 1, 0), 0, 0)));
+	checkIslands(nav, connectivity);
+	CHECK(!query->arePolysConnected(start, newCorner, &filter));
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtNavMeshConnectivity relabels only the split islands", "[detour, connectivity]")
+{
+	GridNavMeshDesc desc;
+	desc.tilesX = 4;
+	desc.tilesZ = 4;
+	desc.tileCells = 8;
+	// Walls along the tile borders make an island of each tile, except the two first tiles
+	// which are joined by a door.
+	std::vector<char> blocked(desc.gridWidth() * desc.gridHeight(), 0);
+	for (int z = 0; z < desc.gridHeight(); ++z)
+	{
+		for (int x = 0; x < desc.gridWidth(); ++x)
+		{
+			if (x % 8 == 7 || z % 8 == 7)
+				blocked[x + z * desc.gridWidth()] = 1;
+		}
+	}
+	blocked[7 + 3 * desc.gridWidth()] = 0;
+	desc.blocked = &blocked;
+
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav);
+	const unsigned short masks[2] = { 1, 1 | 2 };
+	REQUIRE(dtStatusSucceed(nav->initConnectivity(masks, 2)));
+	const dtNavMeshConnectivity* connectivity = nav->getConnectivity();
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+	// Closing the door splits the island of the two first tiles, the other tiles are not scanned.
+	const dtPolyRef door = findCellPoly(query, desc, 7, 3);
+	REQUIRE(door);
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, 0)));
+	checkIslands(nav, connectivity);
+	CHECK(connectivity->getRelabelledTileCount() == 2);
+
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, 1)));
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(findCellPoly(query, desc, 2, 2), 0)));
+	checkIslands(nav, connectivity);
+	CHECK(connectivity->getRelabelledTileCount() == 2);
+
+	// Removing a tile relabels its neighbours on the same island only.
+	REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(1, 0, 0), 0, 0)));
+	checkIslands(nav, connectivity);
+	CHECK(connectivity->getRelabelledTileCount() == 1);
+
+	// Islands created by the relabelling keep their tiles.
+	REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+	REQUIRE(dtStatusSucceed(nav->setPolyFlags(door, 0)));
+	checkIslands(nav, connectivity);
+	CHECK(connectivity->getRelabelledTileCount() == 2);
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,317 @@
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNode.h"
+
+#include "GridNavMesh.h"
+
+TEST_CASE("dtNavMeshQuery::findNearestPolyBatch", "[detour, query]")
+{
+	GridNavMeshDesc desc;
+	desc.tilesX = 3;
+	desc.tilesZ = 3;
+	desc.tileCells = 8;
+	std::vector<char> blocked(desc.gridWidth() * desc.gridHeight(), 0);
+	for (int i = 0; i < (int)blocked.size(); i += 7)
+		blocked[i] = 1;
+	desc.blocked = &blocked;
+
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 1.2f, 2.0f, 1.2f };
+
+	SECTION("Gives the same results as findNearestPoly")
+	{
+		// Points spread over the whole mesh, including tile borders and points outside of the mesh.
+		std::vector<float> centers;
+		for (int i = 0; i < 1000; ++i)
+		{
+			centers.push_back(-2.0f + (float)((i * 37) % 293) * 0.1f);
+			centers.push_back(-0.5f + (float)(i % 5) * 0.25f);
+			centers.push_back(-2.0f + (float)((i * 91) % 281) * 0.1f);
+		}
+		const int count = (int)centers.size() / 3;
+
+		std::vector<dtPolyRef> refs(count);
+		std::vector<float> points(count * 3, 0.0f);
+		bool overPoly[1000];
+		REQUIRE(dtStatusSucceed(query->findNearestPolyBatch(&centers[0], count, halfExtents, &filter,
+															&refs[0], &points[0], overPoly)));
+
+		int found = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			dtPolyRef ref = 0;
+			float pt[3] = { 0, 0, 0 };
+			bool over = false;
+			REQUIRE(dtStatusSucceed(query->findNearestPoly(&centers[i * 3], halfExtents, &filter, &ref, pt, &over)));
+			REQUIRE(refs[i] == ref);
+			if (ref)
+			{
+				found++;
+				CHECK(points[i * 3 + 0] == Catch::Approx(pt[0]));
+				CHECK(points[i * 3 + 1] == Catch::Approx(pt[1]));
+				CHECK(points[i * 3 + 2] == Catch::Approx(pt[2]));
+				CHECK(overPoly[i] == over);
+			}
+		}
+		CHECK(found > 0);
+		CHECK(found < count);
+	}
+
+	SECTION("Optional outputs can be omitted")
+	{
+		float centers[6];
+		desc.cellCenter(1, 1, &centers[0]);
+		desc.cellCenter(20, 20, &centers[3]);
+		dtPolyRef refs[2];
+		REQUIRE(dtStatusSucceed(query->findNearestPolyBatch(centers, 2, halfExtents, &filter, refs, 0, 0)));
+		CHECK(refs[0] != 0);
+		CHECK(refs[1] != 0);
+		CHECK(refs[0] != refs[1]);
+	}
+
+	SECTION("Points without polygon around get a null reference")
+	{
+		const float centers[3] = { 100.0f, 0.0f, 100.0f };
+		dtPolyRef ref = 1;
+		REQUIRE(dtStatusSucceed(query->findNearestPolyBatch(centers, 1, halfExtents, &filter, &ref, 0, 0)));
+		CHECK(ref == 0);
+	}
+
+	SECTION("Rejects invalid parameters")
+	{
+		const float centers[3] = { 1.0f, 0.0f, 1.0f };
+		dtPolyRef ref = 0;
+		CHECK(dtStatusFailed(query->findNearestPolyBatch(centers, -1, halfExtents, &filter, &ref, 0, 0)));
+		CHECK(dtStatusFailed(query->findNearestPolyBatch(0, 1, halfExtents, &filter, &ref, 0, 0)));
+		CHECK(dtStatusFailed(query->findNearestPolyBatch(centers, 1, 0, &filter, &ref, 0, 0)));
+		CHECK(dtStatusFailed(query->findNearestPolyBatch(centers, 1, halfExtents, 0, &ref, 0, 0)));
+		CHECK(dtStatusSucceed(query->findNearestPolyBatch(0, 0, halfExtents, &filter, 0, 0, 0)));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+namespace
+{
+bool arePolysLinked(const dtNavMesh* nav, dtPolyRef from, dtPolyRef to)
+{
+	const dtMeshTile* tile = 0;
+	const dtPoly* poly = 0;
+	if (dtStatusFailed(nav->getTileAndPolyByRef(from, &tile, &poly)))
+		return false;
+	for (unsigned int i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+	{
+		if (tile->links[i].ref == to)
+			return true;
+	}
+	return false;
+}
+
+float straightPathLength(const dtNavMeshQuery* query, const float* startPos, const float* endPos,
+						 const dtPolyRef* path, int pathCount)
+{
+	float points[256 * 3];
+	int count = 0;
+	query->findStraightPath(startPos, endPos, path, pathCount, points, 0, 0, &count, 256);
+	float length = 0;
+	for (int i = 1; i < count; ++i)
+		length += dtVdist(&points[(i - 1) * 3], &points[i * 3]);
+	return length;
+}
+}
+
+TEST_CASE("dtNavMeshQuery::findPath bidirectional", "[detour, query]")
+{
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.4f, 2.0f, 0.4f };
+	dtPolyRef path[256];
+	int pathCount = 0;
+
+	SECTION("Finds paths as good as the regular search")
+	{
+		GridNavMeshDesc desc;
+		desc.tilesX = 4;
+		desc.tilesZ = 4;
+		std::vector<char> blocked(desc.gridWidth() * desc.gridHeight(), 0);
+		for (int i = 0; i < (int)blocked.size(); i += 7)
+			blocked[i] = 1;
+		desc.blocked = &blocked;
+		dtNavMesh* nav = createGridNavMesh(desc);
+		REQUIRE(nav);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+
+		for (int i = 0; i < 200; ++i)
+		{
+			float startPos[3], endPos[3];
+			desc.cellCenter((i * 13) % desc.gridWidth(), (i * 7 + 3) % desc.gridHeight(), startPos);
+			desc.cellCenter((i * 29 + 11) % desc.gridWidth(), (i * 17 + 5) % desc.gridHeight(), endPos);
+			dtPolyRef startRef = 0, endRef = 0;
+			query->findNearestPoly(startPos, halfExtents, &filter, &startRef, 0);
+			query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0);
+			if (!startRef || !endRef)
+				continue;
+
+			dtPolyRef regular[256];
+			int regularCount = 0;
+			REQUIRE(dtStatusSucceed(query->findPath(startRef, endRef, startPos, endPos, &filter, regular, &regularCount, 256)));
+			const dtStatus status = query->findPath(startRef, endRef, startPos, endPos, &filter, path, &pathCount, 256,
+													DT_FINDPATH_BIDIRECTIONAL);
+			REQUIRE(status == DT_SUCCESS);
+			REQUIRE(path[0] == startRef);
+			REQUIRE(path[pathCount - 1] == endRef);
+			for (int j = 1; j < pathCount; ++j)
+				REQUIRE(arePolysLinked(nav, path[j - 1], path[j]));
+
+			const float regularLength = straightPathLength(query, startPos, endPos, regular, regularCount);
+			const float length = straightPathLength(query, startPos, endPos, path, pathCount);
+			CHECK(length <= regularLength * 1.05f + 0.01f);
+		}
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+	}
+
+	// Walls separate a small island in a corner from the rest of the mesh.
+	GridNavMeshDesc desc;
+	desc.tilesX = 4;
+	desc.tilesZ = 4;
+	std::vector<char> blocked(desc.gridWidth() * desc.gridHeight(), 0);
+	for (int i = 28; i < 32; ++i)
+	{
+		blocked[28 + i * desc.gridWidth()] = 1;
+		blocked[i + 28 * desc.gridWidth()] = 1;
+	}
+	desc.blocked = &blocked;
+
+	float mainPos[3], islandPos[3];
+	desc.cellCenter(2, 2, mainPos);
+	desc.cellCenter(30, 30, islandPos);
+
+	SECTION("Stops early when the polygons are not connected")
+	{
+		dtNavMesh* nav = createGridNavMesh(desc);
+		REQUIRE(nav);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+		dtPolyRef mainRef = 0, islandRef = 0;
+		query->findNearestPoly(mainPos, halfExtents, &filter, &mainRef, 0);
+		query->findNearestPoly(islandPos, halfExtents, &filter, &islandRef, 0);
+		REQUIRE(mainRef);
+		REQUIRE(islandRef);
+
+		dtStatus status = query->findPath(mainRef, islandRef, mainPos, islandPos, &filter, path, &pathCount, 256);
+		CHECK(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		const int regularNodes = query->getNodePool()->getNodeCount();
+
+		status = query->findPath(mainRef, islandRef, mainPos, islandPos, &filter, path, &pathCount, 256, DT_FINDPATH_BIDIRECTIONAL);
+		CHECK(dtStatusSucceed(status));
+		CHECK(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		CHECK(pathCount > 0);
+		CHECK(path[0] == mainRef);
+		CHECK(query->getNodePool()->getNodeCount() * 10 < regularNodes);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+	}
+
+	SECTION("Follows one-way off-mesh connections")
+	{
+		std::vector<GridOffMeshConnection> cons(1);
+		desc.cellCenter(22, 30, cons[0].start);
+		desc.cellCenter(29, 30, cons[0].end);
+		cons[0].radius = 0.4f;
+		cons[0].bidir = false;
+		desc.offMeshCons = &cons;
+		dtNavMesh* nav = createGridNavMesh(desc);
+		REQUIRE(nav);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+		dtPolyRef mainRef = 0, islandRef = 0;
+		query->findNearestPoly(mainPos, halfExtents, &filter, &mainRef, 0);
+		query->findNearestPoly(islandPos, halfExtents, &filter, &islandRef, 0);
+
+		dtStatus status = query->findPath(mainRef, islandRef, mainPos, islandPos, &filter, path, &pathCount, 256, DT_FINDPATH_BIDIRECTIONAL);
+		CHECK(status == DT_SUCCESS);
+		CHECK(path[0] == mainRef);
+		CHECK(path[pathCount - 1] == islandRef);
+		bool usesConnection = false;
+		for (int i = 0; i < pathCount; ++i)
+			usesConnection |= nav->getOffMeshConnectionByRef(path[i]) != 0;
+		CHECK(usesConnection);
+
+		// The connection cannot be used the other way around.
+		status = query->findPath(islandRef, mainRef, islandPos, mainPos, &filter, path, &pathCount, 256, DT_FINDPATH_BIDIRECTIONAL);
+		CHECK(dtStatusDetail(status, DT_PARTIAL_RESULT));
+		CHECK(path[0] == islandRef);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+	}
+
+	SECTION("Gives the partial path of the regular search when the end polygon is filtered out")
+	{
+		dtNavMesh* nav = createGridNavMesh(desc);
+		REQUIRE(nav);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+		float endPos[3];
+		desc.cellCenter(20, 12, endPos);
+		dtPolyRef mainRef = 0, endRef = 0;
+		query->findNearestPoly(mainPos, halfExtents, &filter, &mainRef, 0);
+		query->findNearestPoly(endPos, halfExtents, &filter, &endRef, 0);
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(endRef, 2)));
+		dtQueryFilter excluding;
+		excluding.setExcludeFlags(2);
+
+		dtPolyRef regular[256];
+		int regularCount = 0;
+		const dtStatus regularStatus = query->findPath(mainRef, endRef, mainPos, endPos, &excluding, regular, &regularCount, 256);
+		REQUIRE(dtStatusDetail(regularStatus, DT_PARTIAL_RESULT));
+		const dtStatus status = query->findPath(mainRef, endRef, mainPos, endPos, &excluding, path, &pathCount, 256, DT_FINDPATH_BIDIRECTIONAL);
+		CHECK(status == regularStatus);
+		REQUIRE(pathCount == regularCount);
+		for (int i = 0; i < pathCount; ++i)
+			CHECK(path[i] == regular[i]);
+		CHECK(path[pathCount - 1] != endRef);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+	}
+
+	SECTION("Fills the path from the start when the buffer is too small")
+	{
+		std::vector<char> open(desc.gridWidth() * desc.gridHeight(), 0);
+		desc.blocked = &open;
+		dtNavMesh* nav = createGridNavMesh(desc);
+		REQUIRE(nav);
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+		dtPolyRef mainRef = 0, islandRef = 0;
+		query->findNearestPoly(mainPos, halfExtents, &filter, &mainRef, 0);
+		query->findNearestPoly(islandPos, halfExtents, &filter, &islandRef, 0);
+
+		dtPolyRef full[256];
+		int fullCount = 0;
+		REQUIRE(query->findPath(mainRef, islandRef, mainPos, islandPos, &filter, full, &fullCount, 256, DT_FINDPATH_BIDIRECTIONAL) == DT_SUCCESS);
+		REQUIRE(fullCount > 8);
+		const dtStatus status = query->findPath(mainRef, islandRef, mainPos, islandPos, &filter, path, &pathCount, 8, DT_FINDPATH_BIDIRECTIONAL);
+		CHECK(dtStatusDetail(status, DT_BUFFER_TOO_SMALL));
+		CHECK(pathCount == 8);
+		for (int i = 0; i < pathCount; ++i)
+			CHECK(path[i] == full[i]);
+
+		dtFreeNavMeshQuery(query);
+		dtFreeNavMesh(nav);
+	}
+}
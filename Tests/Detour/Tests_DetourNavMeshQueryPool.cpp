@@ -0,0 +1,229 @@
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourCommon.h"
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourNavMeshQueryPool.h"
+
+#include "GridNavMesh.h"
+
+namespace
+{
+const int MAX_POLYS = 256;
+
+struct PoolTestCase
+{
+	dtPolyRef startRef;
+	dtPolyRef endRef;
+	float startPos[3];
+	float endPos[3];
+	dtPolyRef path[MAX_POLYS];
+	dtPolyRef parents[MAX_POLYS];
+	float costs[MAX_POLYS];
+	dtQueryJob job;
+};
+
+void countCompleted(dtQueryJob* /*job*/, void* userData)
+{
+	((std::atomic<int>*)userData)->fetch_add(1);
+}
+
+// Describes job i, cycling through all the query types.
+void setupJob(PoolTestCase& c, int i, const dtQueryFilter* filter)
+{
+	switch (i % 4)
+	{
+	case 0:
+		c.job.setFindPath(c.startRef, c.endRef, c.startPos, c.endPos, filter, c.path, MAX_POLYS);
+		break;
+	case 1:
+		c.job.setRaycast(c.startRef, c.startPos, c.endPos, filter, 0, c.path, MAX_POLYS);
+		break;
+	case 2:
+		c.job.setDistanceToWall(c.startRef, c.startPos, 3.0f, filter);
+		break;
+	default:
+		c.job.setPolysAroundCircle(c.startRef, c.startPos, 2.5f, filter, c.path, c.parents, c.costs, MAX_POLYS);
+		break;
+	}
+}
+
+// Runs the job synchronously on the given query and checks that the pool gave the same results.
+void checkJob(const dtNavMeshQuery* query, const PoolTestCase& c)
+{
+	const dtQueryJob& job = c.job;
+	REQUIRE(job.isCompleted());
+	REQUIRE(dtStatusSucceed(job.status));
+	dtPolyRef polys[MAX_POLYS];
+	int polyCount = 0;
+	switch (job.type)
+	{
+	case DT_QUERYJOB_FIND_PATH:
+		query->findPath(job.startRef, job.endRef, job.startPos, job.endPos, job.filter, polys, &polyCount, MAX_POLYS);
+		break;
+	case DT_QUERYJOB_RAYCAST:
+	{
+		dtRaycastHit hit;
+		memset(&hit, 0, sizeof(hit));
+		hit.path = polys;
+		hit.maxPath = MAX_POLYS;
+		query->raycast(job.startRef, job.startPos, job.endPos, job.filter, 0, &hit);
+		polyCount = hit.pathCount;
+		CHECK(job.hit.t == hit.t);
+		break;
+	}
+	case DT_QUERYJOB_DISTANCE_TO_WALL:
+	{
+		float hitDist = 0, hitPos[3], hitNormal[3];
+		query->findDistanceToWall(job.startRef, job.startPos, job.radius, job.filter, &hitDist, hitPos, hitNormal);
+		CHECK(job.hitDist == hitDist);
+		CHECK(dtVequal(job.hitPos, hitPos));
+		break;
+	}
+	default:
+		query->findPolysAroundCircle(job.startRef, job.startPos, job.radius, job.filter, polys, 0, 0, &polyCount, MAX_POLYS);
+		break;
+	}
+	REQUIRE(job.polyCount == polyCount);
+	for (int i = 0; i < polyCount; ++i)
+		REQUIRE(job.polys[i] == polys[i]);
+}
+}
+
+TEST_CASE("dtNavMeshQueryPool", "[detour, query, pool]")
+{
+	GridNavMeshDesc desc;
+	desc.tilesX = 4;
+	desc.tilesZ = 4;
+	desc.tileCells = 8;
+	std::vector<char> blocked(desc.gridWidth() * desc.gridHeight(), 0);
+	for (int i = 0; i < (int)blocked.size(); i += 5)
+		blocked[i] = 1;
+	desc.blocked = &blocked;
+
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(dtStatusSucceed(query->init(nav, 2048)));
+	dtQueryFilter filter;
+	const float halfExtents[3] = { 0.4f, 2.0f, 0.4f };
+
+	// Queries between pseudo random open cells.
+	const int caseCount = 400;
+	std::vector<PoolTestCase> cases(caseCount);
+	for (int i = 0; i < caseCount; ++i)
+	{
+		PoolTestCase& c = cases[i];
+		const int a = (i * 131 + 7) % (int)blocked.size();
+		const int b = (i * 197 + 61) % (int)blocked.size();
+		desc.cellCenter(a % desc.gridWidth(), a / desc.gridWidth(), c.startPos);
+		desc.cellCenter(b % desc.gridWidth(), b / desc.gridWidth(), c.endPos);
+		query->findNearestPoly(c.startPos, halfExtents, &filter, &c.startRef, 0);
+		query->findNearestPoly(c.endPos, halfExtents, &filter, &c.endRef, 0);
+		if (!c.startRef)
+		{
+			c.startPos[0] += desc.cellSize;
+			query->findNearestPoly(c.startPos, halfExtents, &filter, &c.startRef, 0);
+		}
+		if (!c.endRef)
+		{
+			c.endPos[0] += desc.cellSize;
+			query->findNearestPoly(c.endPos, halfExtents, &filter, &c.endRef, 0);
+		}
+		REQUIRE(c.startRef);
+		REQUIRE(c.endRef);
+	}
+
+	dtNavMeshQueryPool* pool = dtAllocNavMeshQueryPool();
+	REQUIRE(pool);
+	REQUIRE(dtStatusSucceed(pool->init(nav, 2048, 4)));
+	CHECK(pool->getThreadCount() == 4);
+	CHECK(pool->getNavMesh() == nav);
+
+	SECTION("Jobs give the same results as the synchronous queries")
+	{
+		for (int i = 0; i < caseCount; ++i)
+		{
+			setupJob(cases[i], i, &filter);
+			REQUIRE(dtStatusSucceed(pool->submit(&cases[i].job)));
+		}
+		for (int i = 0; i < caseCount; ++i)
+		{
+			REQUIRE(dtStatusSucceed(pool->wait(&cases[i].job)));
+			checkJob(query, cases[i]);
+		}
+	}
+
+	SECTION("Jobs can be submitted from several threads and completed through callbacks")
+	{
+		std::atomic<int> completed(0);
+		const int producerCount = 4;
+		std::vector<std::thread> producers;
+		for (int p = 0; p < producerCount; ++p)
+		{
+			producers.push_back(std::thread([&, p]() {
+				for (int i = p; i < caseCount; i += producerCount)
+				{
+					setupJob(cases[i], i, &filter);
+					cases[i].job.setCallback(countCompleted, &completed);
+					pool->submit(&cases[i].job);
+				}
+			}));
+		}
+		for (int p = 0; p < producerCount; ++p)
+			producers[p].join();
+		pool->waitAll();
+
+		CHECK(completed.load() == caseCount);
+		for (int i = 0; i < caseCount; ++i)
+			checkJob(query, cases[i]);
+	}
+
+	SECTION("Completed jobs can be submitted again")
+	{
+		PoolTestCase& c = cases[0];
+		setupJob(c, 0, &filter);
+		for (int i = 0; i < 10; ++i)
+		{
+			REQUIRE(dtStatusSucceed(pool->submit(&c.job)));
+			REQUIRE(dtStatusSucceed(pool->wait(&c.job)));
+			checkJob(query, c);
+		}
+	}
+
+	SECTION("Shutdown runs the queued jobs")
+	{
+		for (int i = 0; i < caseCount; ++i)
+		{
+			setupJob(cases[i], i, &filter);
+			REQUIRE(dtStatusSucceed(pool->submit(&cases[i].job)));
+		}
+		pool->shutdown();
+		CHECK(pool->getThreadCount() == 0);
+		for (int i = 0; i < caseCount; ++i)
+			checkJob(query, cases[i]);
+		CHECK(dtStatusFailed(pool->submit(&cases[0].job)));
+	}
+
+	SECTION("Rejects invalid parameters")
+	{
+		dtQueryJob job;
+		CHECK(dtStatusFailed(pool->submit(0)));
+		CHECK(dtStatusFailed(pool->submit(&job)));
+
+		dtNavMeshQueryPool* other = dtAllocNavMeshQueryPool();
+		CHECK(dtStatusFailed(other->init(0, 2048, 1)));
+		CHECK(dtStatusFailed(other->init(nav, 0, 1)));
+		CHECK(dtStatusFailed(other->init(nav, 2048, 0)));
+		dtFreeNavMeshQueryPool(other);
+	}
+
+	dtFreeNavMeshQueryPool(pool);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,130 @@
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourPathCache.h"
+
+#include "GridNavMesh.h"
+
+TEST_CASE("dtPathCache", "[detour, pathcache]")
+{
+	GridNavMeshDesc desc;
+	desc.tilesX = 2;
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav != 0);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(query != 0);
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	dtQueryFilter filter;
+
+	dtPathCache cache;
+	REQUIRE(dtStatusSucceed(cache.init(2, 32)));
+
+	float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	float pos[4][3];
+	dtPolyRef refs[4];
+	const int cells[4][2] = { { 1, 1 }, { 14, 6 }, { 2, 6 }, { 9, 2 } };
+	for (int i = 0; i < 4; ++i)
+	{
+		desc.cellCenter(cells[i][0], cells[i][1], pos[i]);
+		REQUIRE(dtStatusSucceed(query->findNearestPoly(pos[i], halfExtents, &filter, &refs[i], 0)));
+		REQUIRE(refs[i] != 0);
+	}
+
+	dtPolyRef path[32];
+	int pathCount = 0;
+	dtPolyRef expected[32];
+	int expectedCount = 0;
+	REQUIRE(dtStatusSucceed(query->findPath(refs[0], refs[1], pos[0], pos[1], &filter, expected, &expectedCount, 32)));
+
+	SECTION("Complete paths are cached")
+	{
+		REQUIRE(dtStatusSucceed(cache.findPath(query, refs[0], refs[1], pos[0], pos[1], &filter, path, &pathCount, 32)));
+		REQUIRE(!cache.find(query, refs[1], refs[0], &filter, path, &pathCount, 32));
+		REQUIRE(cache.find(query, refs[0], refs[1], &filter, path, &pathCount, 32));
+		REQUIRE(pathCount == expectedCount);
+		for (int i = 0; i < pathCount; ++i)
+			REQUIRE(path[i] == expected[i]);
+
+		dtPathCacheStats stats;
+		cache.getStats(stats);
+		REQUIRE(stats.lookups == 3);
+		REQUIRE(stats.hits == 1);
+		REQUIRE(stats.stores == 1);
+		REQUIRE(stats.pathCount == 1);
+		REQUIRE(cache.getHitRate() == Catch::Approx(1.0f / 3.0f));
+	}
+
+	SECTION("Paths are looked up with their filter")
+	{
+		cache.store(query, &filter, expected, expectedCount);
+		dtQueryFilter other;
+		other.setAreaCost(0, 2.0f);
+		REQUIRE(!cache.find(query, refs[0], refs[1], &other, path, &pathCount, 32));
+		REQUIRE(cache.find(query, refs[0], refs[1], &filter, path, &pathCount, 32));
+	}
+
+	SECTION("Paths through rebuilt tiles are discarded")
+	{
+		cache.store(query, &filter, expected, expectedCount);
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+		REQUIRE(!cache.find(query, refs[0], refs[1], &filter, path, &pathCount, 32));
+		dtPathCacheStats stats;
+		cache.getStats(stats);
+		REQUIRE(stats.invalidations == 1);
+		REQUIRE(stats.pathCount == 0);
+	}
+
+	SECTION("Paths next to rebuilt tiles are discarded")
+	{
+		// The path stays in the first tile, a shorter path may go through the second one.
+		REQUIRE(dtStatusSucceed(query->findPath(refs[2], refs[0], pos[2], pos[0], &filter, expected, &expectedCount, 32)));
+		for (int i = 0; i < expectedCount; ++i)
+			REQUIRE(nav->decodePolyIdTile(expected[i]) == nav->decodePolyIdTile(refs[0]));
+		cache.store(query, &filter, expected, expectedCount);
+		REQUIRE(cache.find(query, refs[2], refs[0], &filter, path, &pathCount, 32));
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 1, 0)));
+		REQUIRE(!cache.find(query, refs[2], refs[0], &filter, path, &pathCount, 32));
+		dtPathCacheStats stats;
+		cache.getStats(stats);
+		REQUIRE(stats.invalidations == 1);
+	}
+
+	SECTION("Paths through excluded polygons are discarded")
+	{
+		cache.store(query, &filter, expected, expectedCount);
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(expected[expectedCount / 2], 0)));
+		REQUIRE(!cache.find(query, refs[0], refs[1], &filter, path, &pathCount, 32));
+	}
+
+	SECTION("The least recently used path is replaced")
+	{
+		dtPolyRef other[32];
+		int otherCount = 0;
+		REQUIRE(dtStatusSucceed(query->findPath(refs[2], refs[3], pos[2], pos[3], &filter, other, &otherCount, 32)));
+		cache.store(query, &filter, expected, expectedCount);
+		cache.store(query, &filter, other, otherCount);
+		REQUIRE(cache.find(query, refs[0], refs[1], &filter, path, &pathCount, 32));
+
+		const dtPolyRef single[1] = { refs[3] };
+		cache.store(query, &filter, single, 1);
+		REQUIRE(cache.find(query, refs[0], refs[1], &filter, path, &pathCount, 32));
+		REQUIRE(cache.find(query, refs[3], refs[3], &filter, path, &pathCount, 32));
+		REQUIRE(!cache.find(query, refs[2], refs[3], &filter, path, &pathCount, 32));
+		dtPathCacheStats stats;
+		cache.getStats(stats);
+		REQUIRE(stats.evictions == 1);
+		REQUIRE(stats.pathCount == 2);
+	}
+
+	SECTION("Paths longer than the cached paths are not stored")
+	{
+		dtPathCache small;
+		REQUIRE(dtStatusSucceed(small.init(2, 4)));
+		small.store(query, &filter, expected, expectedCount);
+		REQUIRE(!small.find(query, refs[0], refs[1], &filter, path, &pathCount, 32));
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
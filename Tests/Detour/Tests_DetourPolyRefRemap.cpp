@@ -0,0 +1,137 @@
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourPolyRefRemap.h"
+
+#include "GridNavMesh.h"
+
+namespace
+{
+// The polygon of a grid cell, or 0.
+dtPolyRef getCellPoly(const dtNavMesh* nav, const GridNavMeshDesc& desc, int x, int z)
+{
+	const int n = desc.tileCells;
+	const dtMeshTile* tile = nav->getTileAt(x / n, z / n, 0);
+	if (!tile || desc.isBlocked(x, z))
+		return 0;
+	// The polygons are row major in their tile, without the blocked cells.
+	int index = 0;
+	for (int cz = 0; cz < n; ++cz)
+	{
+		for (int cx = 0; cx < n; ++cx)
+		{
+			const int gx = (x / n) * n + cx;
+			const int gz = (z / n) * n + cz;
+			if (gx == x && gz == z)
+				return nav->getPolyRefBase(tile) | (dtPolyRef)index;
+			if (!desc.isBlocked(gx, gz))
+				index++;
+		}
+	}
+	return 0;
+}
+
+void rebuildGridTile(dtNavMesh* nav, dtPolyRefRemap* remap, const GridNavMeshDesc& desc, int tx, int tz)
+{
+	REQUIRE(dtStatusSucceed(remap->beginTileRebuild(nav->getTileRefAt(tx, tz, 0))));
+	REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, tx, tz)));
+	REQUIRE(dtStatusSucceed(remap->endTileRebuild(nav->getTileRefAt(tx, tz, 0))));
+}
+
+// Rebuilds a tile at the same ref, like the incremental rebuilds of the tile cache.
+void spliceGridTile(dtNavMesh* nav, dtPolyRefRemap* remap, const GridNavMeshDesc& desc, int tx, int tz)
+{
+	const dtTileRef ref = nav->getTileRefAt(tx, tz, 0);
+	REQUIRE(dtStatusSucceed(remap->beginTileRebuild(ref)));
+	REQUIRE(dtStatusSucceed(nav->removeTile(ref, 0, 0)));
+	int dataSize = 0;
+	unsigned char* data = createGridNavMeshTileData(desc, tx, tz, &dataSize, 0);
+	REQUIRE(data != 0);
+	REQUIRE(dtStatusSucceed(nav->addTile(data, dataSize, DT_TILE_FREE_DATA, ref, 0)));
+	REQUIRE(nav->getTileRefAt(tx, tz, 0) == ref);
+	REQUIRE(dtStatusSucceed(remap->endTileRebuild(ref)));
+}
+}
+
+TEST_CASE("dtPolyRefRemap", "[detour, remap]")
+{
+	std::vector<char> blocked(16 * 8, 0);
+	GridNavMeshDesc desc;
+	desc.tilesX = 2;
+	desc.blocked = &blocked;
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav != 0);
+
+	dtPolyRefRemap remap;
+	REQUIRE(dtStatusSucceed(remap.init(nav, 4)));
+
+	const dtPolyRef kept = getCellPoly(nav, desc, 6, 6);
+	const dtPolyRef removed = getCellPoly(nav, desc, 2, 2);
+	const dtPolyRef otherTile = getCellPoly(nav, desc, 10, 2);
+	REQUIRE(remap.remap(kept) == 0);
+
+	SECTION("The polygons of a rebuilt tile are replaced by the polygons at the same location")
+	{
+		blocked[2 + 2 * 16] = 1;
+		rebuildGridTile(nav, &remap, desc, 0, 0);
+		REQUIRE(remap.getRebuildCount() == 1);
+		REQUIRE(!nav->isValidPolyRef(kept));
+		REQUIRE(remap.remap(kept) == getCellPoly(nav, desc, 6, 6));
+		REQUIRE(remap.remap(kept) != kept);
+		REQUIRE(remap.remap(removed) == 0);
+		// The polygons of the other tiles were not rebuilt.
+		REQUIRE(remap.remap(otherTile) == 0);
+	}
+
+	SECTION("The later rebuilds are followed")
+	{
+		rebuildGridTile(nav, &remap, desc, 0, 0);
+		blocked[2 + 2 * 16] = 1;
+		rebuildGridTile(nav, &remap, desc, 0, 0);
+		REQUIRE(remap.remap(kept) == getCellPoly(nav, desc, 6, 6));
+		REQUIRE(remap.remap(removed) == 0);
+	}
+
+	SECTION("The oldest rebuilds are forgotten")
+	{
+		for (int i = 0; i < 5; ++i)
+			rebuildGridTile(nav, &remap, desc, 0, 0);
+		REQUIRE(remap.getRebuildCount() == 4);
+		REQUIRE(remap.getChangeCount() == 5);
+		REQUIRE(remap.remap(kept) == 0);
+	}
+
+	SECTION("The spliced rebuilds of a tile are composed")
+	{
+		// The last cell of the tile is added by the first splice, after the other polygons.
+		blocked[7 + 7 * 16] = 1;
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 0, 0)));
+		const dtPolyRef before = getCellPoly(nav, desc, 6, 6);
+		blocked[7 + 7 * 16] = 0;
+		spliceGridTile(nav, &remap, desc, 0, 0);
+		const dtPolyRef added = getCellPoly(nav, desc, 7, 7);
+		const dtPolyRef between = getCellPoly(nav, desc, 2, 2);
+		REQUIRE(remap.remap(before) == getCellPoly(nav, desc, 6, 6));
+
+		blocked[2 + 2 * 16] = 1;
+		spliceGridTile(nav, &remap, desc, 0, 0);
+		REQUIRE(remap.getRebuildCount() == 1);
+		REQUIRE(remap.getChangeCount() == 2);
+		REQUIRE(getCellPoly(nav, desc, 6, 6) != before);
+		REQUIRE(remap.remap(before) == getCellPoly(nav, desc, 6, 6));
+		REQUIRE(remap.remap(added) == getCellPoly(nav, desc, 7, 7));
+		REQUIRE(remap.remap(between) == 0);
+	}
+
+	SECTION("The polygons of a removed tile are not replaced")
+	{
+		REQUIRE(dtStatusSucceed(remap.beginTileRebuild(nav->getTileRefAt(0, 0, 0))));
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 0, 0), 0, 0)));
+		REQUIRE(dtStatusSucceed(remap.endTileRebuild(0)));
+		REQUIRE(remap.remap(kept) == 0);
+	}
+
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,166 @@
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourTileDataPool.h"
+
+#include "GridNavMesh.h"
+
+TEST_CASE("dtTileDataPool", "[detour, tiledatapool]")
+{
+	SECTION("Size classes round up sizes")
+	{
+		int prevSize = 0;
+		for (int c = 0; c < DT_TILEDATA_SIZE_CLASSES; ++c)
+		{
+			const int size = dtTileDataPool::getSizeClassSize(c);
+			REQUIRE(size > prevSize);
+			REQUIRE(dtTileDataPool::getSizeClass(size) == c);
+			REQUIRE(dtTileDataPool::getSizeClass(prevSize + 1) == c);
+			// At most 25% larger than the requested size.
+			REQUIRE((c == 0 || (size - prevSize - 1) * 4 <= prevSize + 1));
+			prevSize = size;
+		}
+		REQUIRE(dtTileDataPool::getSizeClass(prevSize + 1) == -1);
+	}
+
+	SECTION("Released buffers are reused")
+	{
+		dtTileDataPool pool;
+		unsigned char* a = pool.allocate(1000);
+		REQUIRE(a != 0);
+		REQUIRE(((size_t)a & 15) == 0);
+		memset(a, 0xff, 1000);
+
+		dtTileDataPoolStats stats;
+		pool.getStats(stats);
+		REQUIRE(stats.allocCount == 1);
+		REQUIRE(stats.liveCount == 1);
+		REQUIRE(stats.liveBytes == 1000);
+		REQUIRE(stats.reservedBytes == (size_t)dtTileDataPool::getSizeClassSize(dtTileDataPool::getSizeClass(1000)));
+
+		dtTileDataPool::release(a);
+		pool.getStats(stats);
+		REQUIRE(stats.liveCount == 0);
+		REQUIRE(stats.freeCount == 1);
+		REQUIRE(stats.fragmentation == 1.0f);
+
+		// Same size class.
+		unsigned char* b = pool.allocate(900);
+		REQUIRE(b == a);
+		pool.getStats(stats);
+		REQUIRE(stats.reuseCount == 1);
+		REQUIRE(stats.freeCount == 0);
+		dtTileDataPool::release(b);
+
+		// Larger buffers are not pooled.
+		unsigned char* c = pool.allocate(32 << 20);
+		REQUIRE(c != 0);
+		dtTileDataPool::release(c);
+		pool.getStats(stats);
+		REQUIRE(stats.freeCount == 1);
+		REQUIRE(stats.peakReservedBytes >= (32 << 20));
+
+		pool.trim();
+		pool.getStats(stats);
+		REQUIRE(stats.freeCount == 0);
+		REQUIRE(stats.reservedBytes == 0);
+	}
+
+	SECTION("Free buffers are limited")
+	{
+		dtTileDataPool pool(4096);
+		unsigned char* bufs[4];
+		for (int i = 0; i < 4; ++i)
+			bufs[i] = pool.allocate(2048);
+		for (int i = 0; i < 4; ++i)
+			dtTileDataPool::release(bufs[i]);
+
+		dtTileDataPoolStats stats;
+		pool.getStats(stats);
+		REQUIRE(stats.freeCount == 2);
+		REQUIRE(stats.reservedBytes == 4096);
+	}
+
+	SECTION("Rebuilt navmesh tiles recycle their buffers")
+	{
+		GridNavMeshDesc desc;
+		desc.tilesX = 4;
+		desc.tilesZ = 4;
+		desc.tileCells = 8;
+
+		dtTileDataPool pool;
+		dtNavMesh* nav = allocGridNavMesh(desc);
+		REQUIRE(nav != 0);
+		for (int z = 0; z < desc.tilesZ; ++z)
+			for (int x = 0; x < desc.tilesX; ++x)
+				REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, x, z, &pool)));
+
+		dtTileDataPoolStats stats;
+		pool.getStats(stats);
+		REQUIRE(stats.liveCount == desc.tilesX * desc.tilesZ);
+		const size_t reserved = stats.reservedBytes;
+
+		// Replacing the tiles reuses the buffers of the removed ones.
+		for (int round = 0; round < 3; ++round)
+		{
+			for (int z = 0; z < desc.tilesZ; ++z)
+				for (int x = 0; x < desc.tilesX; ++x)
+					REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, x, z, &pool)));
+		}
+		pool.getStats(stats);
+		REQUIRE(stats.liveCount == desc.tilesX * desc.tilesZ);
+		REQUIRE(stats.allocCount == 4 * desc.tilesX * desc.tilesZ);
+		REQUIRE(stats.reuseCount == 3 * desc.tilesX * desc.tilesZ);
+		REQUIRE(stats.reservedBytes == reserved);
+		REQUIRE(stats.peakReservedBytes == reserved);
+
+		// The navmesh owns the data.
+		unsigned char* data = 0;
+		REQUIRE(dtStatusSucceed(nav->removeTile(nav->getTileRefAt(0, 0, 0), &data, 0)));
+		REQUIRE(data == 0);
+
+		dtFreeNavMesh(nav);
+		pool.getStats(stats);
+		REQUIRE(stats.liveCount == 0);
+		REQUIRE(stats.liveBytes == 0);
+		REQUIRE(stats.freeCount == desc.tilesX * desc.tilesZ);
+	}
+
+	SECTION("Threads share the pool")
+	{
+		dtTileDataPool pool;
+		const int threadCount = 4;
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; ++t)
+		{
+			threads.push_back(std::thread([&pool, t]() {
+				unsigned char* live[8] = { 0 };
+				for (int i = 0; i < 2000; ++i)
+				{
+					const int slot = (i * 7 + t) % 8;
+					dtTileDataPool::release(live[slot]);
+					const int size = 200 + ((i * 2654435761u + t) % 20000);
+					live[slot] = pool.allocate(size);
+					live[slot][0] = (unsigned char)t;
+					live[slot][size-1] = (unsigned char)t;
+				}
+				for (int i = 0; i < 8; ++i)
+					dtTileDataPool::release(live[i]);
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); ++i)
+			threads[i].join();
+
+		dtTileDataPoolStats stats;
+		pool.getStats(stats);
+		REQUIRE(stats.liveCount == 0);
+		REQUIRE(stats.liveBytes == 0);
+		REQUIRE(stats.allocCount == threadCount * 2000);
+		REQUIRE(stats.reuseCount > 0);
+		REQUIRE(stats.reservedBytes <= stats.peakReservedBytes);
+	}
+}
@@ -1,6 +1,9 @@
 #include "catch2/catch_all.hpp"
 
 #include "DetourPathCorridor.h"
+#include "DetourPolyRefRemap.h"
+
+#include "../Detour/GridNavMesh.h"
 
 TEST_CASE("dtMergeCorridorStartMoved")
 {
@@ -117,3 +120,161 @@ TEST_CASE("dtMergeCorridorStartMoved")
         CHECK_THAT(path, Catch::Matchers::RangeEquals(expectedPath));
     }
 }
+
+TEST_CASE("dtPathCorridor::remapInvalidPath")
+{
+	std::vector<char> blocked(16 * 8, 0);
+	GridNavMeshDesc desc;
+	desc.tilesX = 2;
+	desc.blocked = &blocked;
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav != 0);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(query != 0);
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	const dtQueryFilter filter;
+	dtPolyRefRemap remap;
+	REQUIRE(dtStatusSucceed(remap.init(nav, 4)));
+
+	// A straight corridor over the cells of the row z = 3, across both tiles.
+	const int z = 3;
+	dtPolyRef path[14];
+	for (int x = 1; x < 15; ++x)
+	{
+		const dtMeshTile* tile = nav->getTileAt(x / 8, 0, 0);
+		path[x - 1] = nav->getPolyRefBase(tile) | (dtPolyRef)(x % 8 + z * 8);
+	}
+	float start[3];
+	float target[3];
+	desc.cellCenter(1, z, start);
+	desc.cellCenter(14, z, target);
+	start[1] = target[1] = 1.0f;
+	dtPathCorridor corridor;
+	REQUIRE(corridor.init(64));
+	corridor.reset(path[0], start);
+	corridor.setCorridor(target, path, 14);
+
+	SECTION("Valid corridors are not changed")
+	{
+		REQUIRE(!corridor.remapInvalidPath(remap, query, &filter));
+		REQUIRE(corridor.getPathCount() == 14);
+	}
+
+	SECTION("The polygons of a rebuilt tile are replaced")
+	{
+		REQUIRE(dtStatusSucceed(remap.beginTileRebuild(nav->getTileRefAt(0, 0, 0))));
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 0, 0)));
+		REQUIRE(dtStatusSucceed(remap.endTileRebuild(nav->getTileRefAt(0, 0, 0))));
+		REQUIRE(!corridor.isValid(14, query, &filter));
+
+		REQUIRE(corridor.remapInvalidPath(remap, query, &filter));
+		REQUIRE(corridor.isValid(14, query, &filter));
+		REQUIRE(corridor.getPathCount() == 14);
+		const dtMeshTile* tile = nav->getTileAt(0, 0, 0);
+		REQUIRE(corridor.getFirstPoly() == (nav->getPolyRefBase(tile) | (dtPolyRef)(1 + z * 8)));
+		REQUIRE(corridor.getLastPoly() == path[13]);
+		REQUIRE(corridor.getPos()[0] == start[0]);
+		REQUIRE(corridor.getPos()[2] == start[2]);
+	}
+
+	SECTION("The corridor is not changed when a polygon is not replaced")
+	{
+		blocked[5 + z * 16] = 1;
+		REQUIRE(dtStatusSucceed(remap.beginTileRebuild(nav->getTileRefAt(0, 0, 0))));
+		REQUIRE(dtStatusSucceed(addGridNavMeshTile(nav, desc, 0, 0)));
+		REQUIRE(dtStatusSucceed(remap.endTileRebuild(nav->getTileRefAt(0, 0, 0))));
+
+		REQUIRE(!corridor.remapInvalidPath(remap, query, &filter));
+		REQUIRE(corridor.getPathCount() == 14);
+		REQUIRE(corridor.getFirstPoly() == path[0]);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
+
+TEST_CASE("dtPathCorridor::repairInvalidPath")
+{
+	GridNavMeshDesc desc;
+	desc.tilesX = 2;
+	dtNavMesh* nav = createGridNavMesh(desc);
+	REQUIRE(nav != 0);
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(query != 0);
+	REQUIRE(dtStatusSucceed(query->init(nav, 256)));
+	const dtQueryFilter filter;
+
+	struct Cell
+	{
+		static dtPolyRef poly(const dtNavMesh* nav, int x, int z)
+		{
+			return nav->getPolyRefBase(nav->getTileAt(x / 8, 0, 0)) | (dtPolyRef)(x % 8 + z * 8);
+		}
+	};
+
+	// A straight corridor over the cells of the row z = 3, across both tiles.
+	const int z = 3;
+	dtPolyRef path[14];
+	for (int x = 1; x < 15; ++x)
+		path[x - 1] = Cell::poly(nav, x, z);
+	float start[3];
+	float target[3];
+	desc.cellCenter(1, z, start);
+	desc.cellCenter(14, z, target);
+	start[1] = target[1] = 1.0f;
+	dtPathCorridor corridor;
+	REQUIRE(corridor.init(64));
+	corridor.reset(path[0], start);
+	corridor.setCorridor(target, path, 14);
+
+	SECTION("Valid corridors are not changed")
+	{
+		REQUIRE(corridor.repairInvalidPath(64, query, &filter));
+		REQUIRE(corridor.getPathCount() == 14);
+	}
+
+	SECTION("Invalid sections are replaced with a detour")
+	{
+		// Disable two sections of the corridor.
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(Cell::poly(nav, 4, z), 0)));
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(Cell::poly(nav, 9, z), 0)));
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(Cell::poly(nav, 10, z), 0)));
+		REQUIRE(!corridor.isValid(14, query, &filter));
+
+		REQUIRE(corridor.repairInvalidPath(256, query, &filter));
+		REQUIRE(corridor.isValid(corridor.getPathCount(), query, &filter));
+		// Each detour goes around through the next row.
+		REQUIRE(corridor.getPathCount() == 14 + 2 + 2);
+		REQUIRE(corridor.getFirstPoly() == path[0]);
+		REQUIRE(corridor.getLastPoly() == path[13]);
+		const dtMeshTile* tile = 0;
+		const dtPoly* poly = 0;
+		for (int i = 0; i + 1 < corridor.getPathCount(); ++i)
+		{
+			nav->getTileAndPolyByRefUnsafe(corridor.getPath()[i], &tile, &poly);
+			bool connected = false;
+			for (unsigned int k = poly->firstLink; k != DT_NULL_LINK; k = tile->links[k].next)
+				connected |= tile->links[k].ref == corridor.getPath()[i + 1];
+			REQUIRE(connected);
+		}
+	}
+
+	SECTION("Sections without a local path are not replaced")
+	{
+		// Disable a whole column.
+		for (int cz = 0; cz < 8; ++cz)
+			REQUIRE(dtStatusSucceed(nav->setPolyFlags(Cell::poly(nav, 5, cz), 0)));
+		REQUIRE(!corridor.repairInvalidPath(256, query, &filter));
+		REQUIRE(corridor.getPathCount() == 14);
+	}
+
+	SECTION("The search is bounded")
+	{
+		REQUIRE(dtStatusSucceed(nav->setPolyFlags(Cell::poly(nav, 4, z), 0)));
+		REQUIRE(!corridor.repairInvalidPath(1, query, &filter));
+		REQUIRE(corridor.getPathCount() == 14);
+	}
+
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(nav);
+}
@@ -0,0 +1,525 @@
+#include <string.h>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "DetourNavMesh.h"
+#include "DetourNavMeshBuilder.h"
+#include "DetourNavMeshQuery.h"
+#include "DetourPolyRefRemap.h"
+#include "DetourTileCache.h"
+#include "DetourTileCacheBuilder.h"
+
+namespace
+{
+/// Stores the layers uncompressed.
+struct CopyCompressor : public dtTileCacheCompressor
+{
+	virtual int maxCompressedSize(const int bufferSize) { return bufferSize; }
+	virtual dtStatus compress(const unsigned char* buffer, const int bufferSize,
+							  unsigned char* compressed, const int /*maxCompressedSize*/, int* compressedSize)
+	{
+		memcpy(compressed, buffer, bufferSize);
+		*compressedSize = bufferSize;
+		return DT_SUCCESS;
+	}
+	virtual dtStatus decompress(const unsigned char* compressed, const int compressedSize,
+								unsigned char* buffer, const int maxBufferSize, int* bufferSize)
+	{
+		if (compressedSize > maxBufferSize)
+			return DT_FAILURE;
+		memcpy(buffer, compressed, compressedSize);
+		*bufferSize = compressedSize;
+		return DT_SUCCESS;
+	}
+};
+
+const int LAYER_SIZE = 32;
+
+/// Builds a flat layer at height 0, with the cells of @p areas, 0 for not walkable.
+unsigned char* buildFlatLayer(dtTileCacheCompressor* comp, const unsigned char* areas, int* dataSize)
+{
+	const int w = LAYER_SIZE;
+	const int h = LAYER_SIZE;
+
+	dtTileCacheLayerHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = DT_TILECACHE_MAGIC;
+	header.version = DT_TILECACHE_VERSION;
+	header.bmax[0] = (float)w;
+	header.bmax[1] = 10.0f;
+	header.bmax[2] = (float)h;
+	header.width = (unsigned char)w;
+	header.height = (unsigned char)h;
+	header.maxx = (unsigned char)(w-1);
+	header.maxy = (unsigned char)(h-1);
+
+	unsigned char heights[LAYER_SIZE*LAYER_SIZE];
+	unsigned char cons[LAYER_SIZE*LAYER_SIZE];
+	memset(heights, 0, sizeof(heights));
+	const int dx[4] = { -1, 0, 1, 0 };
+	const int dy[4] = { 0, 1, 0, -1 };
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = 0; x < w; ++x)
+		{
+			unsigned char con = 0;
+			for (int dir = 0; dir < 4; ++dir)
+			{
+				const int nx = x + dx[dir];
+				const int ny = y + dy[dir];
+				if (nx >= 0 && ny >= 0 && nx < w && ny < h && areas[nx + ny*w] != DT_TILECACHE_NULL_AREA)
+					con |= (unsigned char)(1 << dir);
+			}
+			cons[x + y*w] = con;
+		}
+	}
+
+	unsigned char* data = 0;
+	if (dtStatusFailed(dtBuildTileCacheLayer(comp, &header, heights, areas, cons, &data, dataSize)))
+		return 0;
+	return data;
+}
+
+/// Decompresses a layer built by buildFlatLayer and builds its regions.
+int buildRegionCount(dtTileCacheAlloc* alloc, dtTileCacheCompressor* comp, const unsigned char* areas)
+{
+	int dataSize = 0;
+	unsigned char* data = buildFlatLayer(comp, areas, &dataSize);
+	REQUIRE(data != 0);
+
+	dtTileCacheLayer* layer = 0;
+	REQUIRE(dtStatusSucceed(dtDecompressTileCacheLayer(alloc, comp, data, dataSize, &layer)));
+	REQUIRE(dtStatusSucceed(dtBuildTileCacheRegions(alloc, *layer, 1)));
+
+	// Every walkable cell has a region, and the ids are compact.
+	for (int i = 0; i < LAYER_SIZE*LAYER_SIZE; ++i)
+	{
+		if (areas[i] == DT_TILECACHE_NULL_AREA)
+			REQUIRE(layer->regs[i] == 0xff);
+		else
+			REQUIRE(layer->regs[i] < layer->regCount);
+	}
+
+	const int regCount = (int)layer->regCount;
+	dtFreeTileCacheLayer(alloc, layer);
+	dtFree(data);
+	alloc->reset();
+	return regCount;
+}
+
+/// Makes all the polygons walkable.
+struct WalkableMeshProcess : public dtTileCacheMeshProcess
+{
+	virtual void process(struct dtNavMeshCreateParams* params, unsigned char* /*polyAreas*/, unsigned short* polyFlags)
+	{
+		for (int i = 0; i < params->polyCount; ++i)
+			polyFlags[i] = 1;
+	}
+};
+
+/// Returns the x of the center of a polygon.
+float getPolyCenterX(const dtMeshTile* tile, const dtPoly* poly)
+{
+	float x = 0.0f;
+	for (int i = 0; i < poly->vertCount; ++i)
+		x += tile->verts[poly->verts[i]*3];
+	return x / poly->vertCount;
+}
+
+/// Returns the number of vertices of a tile used by its polygons.
+int countUsedVerts(const dtMeshTile* tile)
+{
+	std::vector<bool> used(tile->header->vertCount, false);
+	int count = 0;
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const dtPoly* poly = &tile->polys[i];
+		for (int j = 0; j < poly->vertCount; ++j)
+		{
+			if (!used[poly->verts[j]])
+				count++;
+			used[poly->verts[j]] = true;
+		}
+	}
+	return count;
+}
+}
+
+TEST_CASE("dtTileCacheArena", "[detourtilecache]")
+{
+	SECTION("Allocations are aligned and grow the arena")
+	{
+		dtTileCacheArena arena(256);
+		void* a = arena.alloc(10);
+		void* b = arena.alloc(1000);
+		void* c = arena.alloc(3);
+		REQUIRE(a != 0);
+		REQUIRE(b != 0);
+		REQUIRE(c != 0);
+		REQUIRE(((size_t)a & 15) == 0);
+		REQUIRE(((size_t)b & 15) == 0);
+		REQUIRE(((size_t)c & 15) == 0);
+		memset(b, 0xff, 1000);
+		REQUIRE(arena.getUsedSize() == 16 + 1008 + 16);
+
+		// After a reset, the same allocations fit in a single block.
+		arena.reset();
+		REQUIRE(arena.getUsedSize() == 0);
+		REQUIRE(arena.getPeakSize() == 16 + 1008 + 16);
+		const size_t capacity = arena.getCapacity();
+		REQUIRE(capacity >= arena.getPeakSize());
+		arena.alloc(10);
+		arena.alloc(1000);
+		arena.alloc(3);
+		REQUIRE(arena.getCapacity() == capacity);
+	}
+
+	SECTION("Freeing the last allocation releases it")
+	{
+		dtTileCacheArena arena;
+		void* a = arena.alloc(64);
+		void* b = arena.alloc(64);
+		arena.free(a);
+		REQUIRE(arena.getUsedSize() == 128);
+		arena.free(b);
+		REQUIRE(arena.getUsedSize() == 64);
+		REQUIRE(arena.alloc(32) == b);
+	}
+}
+
+TEST_CASE("dtBuildTileCacheRegions", "[detourtilecache]")
+{
+	dtTileCacheArena arena;
+	CopyCompressor comp;
+	unsigned char areas[LAYER_SIZE*LAYER_SIZE];
+
+	SECTION("Empty layer")
+	{
+		memset(areas, DT_TILECACHE_NULL_AREA, sizeof(areas));
+		REQUIRE(buildRegionCount(&arena, &comp, areas) == 0);
+	}
+
+	SECTION("Full layer")
+	{
+		memset(areas, DT_TILECACHE_WALKABLE_AREA, sizeof(areas));
+		REQUIRE(buildRegionCount(&arena, &comp, areas) == 1);
+	}
+
+	SECTION("Separated and different areas")
+	{
+		// Two halves separated by a wall, the right one with two areas.
+		memset(areas, DT_TILECACHE_WALKABLE_AREA, sizeof(areas));
+		for (int y = 0; y < LAYER_SIZE; ++y)
+		{
+			areas[LAYER_SIZE/2 + y*LAYER_SIZE] = DT_TILECACHE_NULL_AREA;
+			if (y >= LAYER_SIZE/2)
+			{
+				for (int x = LAYER_SIZE/2+1; x < LAYER_SIZE; ++x)
+					areas[x + y*LAYER_SIZE] = 1;
+			}
+		}
+		REQUIRE(buildRegionCount(&arena, &comp, areas) == 3);
+	}
+
+	SECTION("Regions under a hole are merged")
+	{
+		// A hole in the middle splits the sweeps, which are merged back into as few regions as possible.
+		memset(areas, DT_TILECACHE_WALKABLE_AREA, sizeof(areas));
+		for (int y = 10; y < 20; ++y)
+			for (int x = 10; x < 20; ++x)
+				areas[x + y*LAYER_SIZE] = DT_TILECACHE_NULL_AREA;
+		const int regCount = buildRegionCount(&arena, &comp, areas);
+		REQUIRE(regCount >= 1);
+		REQUIRE(regCount < 4);
+	}
+}
+
+TEST_CASE("dtTileCache obstacle updates", "[detourtilecache]")
+{
+	dtTileCacheArena arena;
+	CopyCompressor comp;
+
+	dtTileCacheParams tcparams;
+	memset(&tcparams, 0, sizeof(tcparams));
+	tcparams.cs = 1.0f;
+	tcparams.ch = 0.5f;
+	tcparams.width = LAYER_SIZE;
+	tcparams.height = LAYER_SIZE;
+	tcparams.walkableHeight = 2.0f;
+	tcparams.walkableRadius = 0.5f;
+	tcparams.walkableClimb = 0.9f;
+	tcparams.maxSimplificationError = 1.3f;
+	tcparams.maxTiles = 4;
+	tcparams.maxObstacles = 8;
+	dtTileCache* tileCache = dtAllocTileCache();
+	REQUIRE(tileCache != 0);
+	REQUIRE(dtStatusSucceed(tileCache->init(&tcparams, &arena, &comp, 0)));
+
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = (float)LAYER_SIZE;
+	params.tileHeight = (float)LAYER_SIZE;
+	params.maxTiles = 4;
+	params.maxPolys = 1024;
+	dtNavMesh* navmesh = dtAllocNavMesh();
+	REQUIRE(navmesh != 0);
+	REQUIRE(dtStatusSucceed(navmesh->init(&params)));
+
+	unsigned char areas[LAYER_SIZE*LAYER_SIZE];
+	memset(areas, DT_TILECACHE_WALKABLE_AREA, sizeof(areas));
+	int dataSize = 0;
+	unsigned char* data = buildFlatLayer(&comp, areas, &dataSize);
+	REQUIRE(data != 0);
+	dtCompressedTileRef tileRef = 0;
+	REQUIRE(dtStatusSucceed(tileCache->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, &tileRef)));
+	REQUIRE(dtStatusSucceed(tileCache->buildNavMeshTilesAt(0, 0, navmesh)));
+	const dtTileRef builtRef = navmesh->getTileRefAt(0, 0, 0);
+	REQUIRE(builtRef != 0);
+
+	struct Update
+	{
+		static void run(dtTileCache* tc, dtNavMesh* nm)
+		{
+			bool upToDate = false;
+			for (int i = 0; i < 16 && !upToDate; ++i)
+				REQUIRE(dtStatusSucceed(tc->update(0, nm, &upToDate)));
+			REQUIRE(upToDate);
+		}
+	};
+
+	SECTION("Obstacles which do not change the walkable cells do not rebuild the tile")
+	{
+		// Inside the bounds of the layer, but above its cells.
+		const float bmin[3] = { 8.0f, 5.0f, 8.0f };
+		const float bmax[3] = { 12.0f, 6.0f, 12.0f };
+		dtObstacleRef ob = 0;
+		REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(bmin, bmax, &ob)));
+		Update::run(tileCache, navmesh);
+		REQUIRE(navmesh->getTileRefAt(0, 0, 0) == builtRef);
+
+		REQUIRE(dtStatusSucceed(tileCache->removeObstacle(ob)));
+		Update::run(tileCache, navmesh);
+		REQUIRE(navmesh->getTileRefAt(0, 0, 0) == builtRef);
+	}
+
+	SECTION("Obstacles which change the walkable cells rebuild the tile")
+	{
+		const float bmin[3] = { 8.0f, -1.0f, 8.0f };
+		const float bmax[3] = { 12.0f, 1.0f, 12.0f };
+		dtObstacleRef ob = 0;
+		REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(bmin, bmax, &ob)));
+		Update::run(tileCache, navmesh);
+		const dtTileRef blockedRef = navmesh->getTileRefAt(0, 0, 0);
+		REQUIRE(blockedRef != 0);
+		REQUIRE(blockedRef != builtRef);
+		// The hole splits the square in several polygons.
+		REQUIRE(navmesh->getTileByRef(blockedRef)->header->polyCount > 1);
+
+		REQUIRE(dtStatusSucceed(tileCache->removeObstacle(ob)));
+		Update::run(tileCache, navmesh);
+		REQUIRE(navmesh->getTileRefAt(0, 0, 0) != blockedRef);
+	}
+
+	SECTION("A navmesh tile removed outside of the tile cache is rebuilt")
+	{
+		REQUIRE(dtStatusSucceed(navmesh->removeTile(builtRef, 0, 0)));
+		const float bmin[3] = { 8.0f, 5.0f, 8.0f };
+		const float bmax[3] = { 12.0f, 6.0f, 12.0f };
+		dtObstacleRef ob = 0;
+		REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(bmin, bmax, &ob)));
+		Update::run(tileCache, navmesh);
+		REQUIRE(navmesh->getTileRefAt(0, 0, 0) != 0);
+	}
+
+	SECTION("A navmesh tile replaced outside of the tile cache at the same reference is rebuilt")
+	{
+		// The tile frees its data when removed, add a copy of it.
+		const dtMeshTile* builtTile = navmesh->getTileByRef(builtRef);
+		const int tileDataSize = builtTile->dataSize;
+		unsigned char* tileData = (unsigned char*)dtAlloc(tileDataSize, DT_ALLOC_PERM);
+		REQUIRE(tileData != 0);
+		memcpy(tileData, builtTile->data, tileDataSize);
+		REQUIRE(dtStatusSucceed(navmesh->removeTile(builtRef, 0, 0)));
+		dtTileRef replacedRef = 0;
+		REQUIRE(dtStatusSucceed(navmesh->addTile(tileData, tileDataSize, DT_TILE_FREE_DATA, builtRef, &replacedRef)));
+		REQUIRE(replacedRef == builtRef);
+		const unsigned int changeCount = navmesh->getTileByRef(builtRef)->changeCount;
+
+		// The obstacle does not change the walkable cells, but the tile is not the one the tile cache built.
+		const float bmin[3] = { 8.0f, 5.0f, 8.0f };
+		const float bmax[3] = { 12.0f, 6.0f, 12.0f };
+		dtObstacleRef ob = 0;
+		REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(bmin, bmax, &ob)));
+		Update::run(tileCache, navmesh);
+		const dtMeshTile* rebuilt = navmesh->getTileAt(0, 0, 0);
+		REQUIRE(rebuilt != 0);
+		REQUIRE(rebuilt->changeCount != changeCount);
+	}
+
+	SECTION("Explicit builds always rebuild the tile")
+	{
+		REQUIRE(dtStatusSucceed(tileCache->buildNavMeshTile(tileRef, navmesh)));
+		REQUIRE(navmesh->getTileRefAt(0, 0, 0) != builtRef);
+	}
+
+	dtFreeNavMesh(navmesh);
+	dtFreeTileCache(tileCache);
+}
+
+TEST_CASE("dtTileCache partial rebuilds", "[detourtilecache]")
+{
+	dtTileCacheArena arena;
+	CopyCompressor comp;
+	WalkableMeshProcess meshProcess;
+
+	dtTileCacheParams tcparams;
+	memset(&tcparams, 0, sizeof(tcparams));
+	tcparams.cs = 1.0f;
+	tcparams.ch = 0.5f;
+	tcparams.width = LAYER_SIZE;
+	tcparams.height = LAYER_SIZE;
+	tcparams.walkableHeight = 2.0f;
+	tcparams.walkableRadius = 0.5f;
+	tcparams.walkableClimb = 0.9f;
+	tcparams.maxSimplificationError = 1.3f;
+	tcparams.maxTiles = 4;
+	tcparams.maxObstacles = 8;
+	dtTileCache* tileCache = dtAllocTileCache();
+	REQUIRE(tileCache != 0);
+	REQUIRE(dtStatusSucceed(tileCache->init(&tcparams, &arena, &comp, &meshProcess)));
+
+	dtNavMeshParams params;
+	memset(&params, 0, sizeof(params));
+	params.tileWidth = (float)LAYER_SIZE;
+	params.tileHeight = (float)LAYER_SIZE;
+	params.maxTiles = 4;
+	params.maxPolys = 1024;
+	dtNavMesh* navmesh = dtAllocNavMesh();
+	REQUIRE(navmesh != 0);
+	REQUIRE(dtStatusSucceed(navmesh->init(&params)));
+	dtNavMeshQuery* query = dtAllocNavMeshQuery();
+	REQUIRE(query != 0);
+	REQUIRE(dtStatusSucceed(query->init(navmesh, 64)));
+	dtQueryFilter filter;
+
+	// Four strips of different areas, each strip is a region.
+	unsigned char areas[LAYER_SIZE*LAYER_SIZE];
+	for (int y = 0; y < LAYER_SIZE; ++y)
+		for (int x = 0; x < LAYER_SIZE; ++x)
+			areas[x + y*LAYER_SIZE] = (unsigned char)(1 + x*4/LAYER_SIZE);
+	int dataSize = 0;
+	unsigned char* data = buildFlatLayer(&comp, areas, &dataSize);
+	REQUIRE(data != 0);
+	REQUIRE(dtStatusSucceed(tileCache->addTile(data, dataSize, DT_COMPRESSEDTILE_FREE_DATA, 0)));
+	REQUIRE(dtStatusSucceed(tileCache->buildNavMeshTilesAt(0, 0, navmesh)));
+	const dtTileRef builtRef = navmesh->getTileRefAt(0, 0, 0);
+	REQUIRE(builtRef != 0);
+
+	// The refs of the polygons of the first and last strips.
+	dtPolyRef firstRefs[16];
+	dtPolyRef lastRefs[16];
+	float lastCenters[16];
+	int nfirst = 0;
+	int nlast = 0;
+	const dtMeshTile* tile = navmesh->getTileByRef(builtRef);
+	for (int i = 0; i < tile->header->polyCount; ++i)
+	{
+		const float x = getPolyCenterX(tile, &tile->polys[i]);
+		if (x < LAYER_SIZE/4 && nfirst < 16)
+			firstRefs[nfirst++] = navmesh->getPolyRefBase(tile) | (dtPolyRef)i;
+		else if (x > LAYER_SIZE*3/4 && nlast < 16)
+		{
+			lastCenters[nlast] = x;
+			lastRefs[nlast++] = navmesh->getPolyRefBase(tile) | (dtPolyRef)i;
+		}
+	}
+	REQUIRE(nfirst > 0);
+	REQUIRE(nlast > 0);
+
+	dtPolyRefRemap remap;
+	REQUIRE(dtStatusSucceed(remap.init(navmesh, 4)));
+	tileCache->setPolyRefRemap(&remap);
+
+	// Blocks a corner of the first strip.
+	const float bmin[3] = { 1.0f, -1.0f, 1.0f };
+	const float bmax[3] = { 4.0f, 1.0f, 4.0f };
+	dtObstacleRef ob = 0;
+	REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(bmin, bmax, &ob)));
+	bool upToDate = false;
+	for (int i = 0; i < 16 && !upToDate; ++i)
+		REQUIRE(dtStatusSucceed(tileCache->update(0, navmesh, &upToDate)));
+	REQUIRE(upToDate);
+
+	// The tile keeps its ref, and the polygons away from the obstacle keep theirs.
+	REQUIRE(navmesh->getTileRefAt(0, 0, 0) == builtRef);
+	tile = navmesh->getTileByRef(builtRef);
+	for (int i = 0; i < nlast; ++i)
+	{
+		REQUIRE(query->isValidPolyRef(lastRefs[i], &filter));
+		const dtMeshTile* polyTile = 0;
+		const dtPoly* poly = 0;
+		REQUIRE(dtStatusSucceed(navmesh->getTileAndPolyByRef(lastRefs[i], &polyTile, &poly)));
+		REQUIRE(getPolyCenterX(polyTile, poly) == lastCenters[i]);
+	}
+
+	// The polygons under the obstacle cannot be used anymore.
+	bool firstChanged = false;
+	for (int i = 0; i < nfirst; ++i)
+		firstChanged |= !query->isValidPolyRef(firstRefs[i], &filter);
+	REQUIRE(firstChanged);
+	// The refs of the changed polygons are remapped to the polygons which replaced them.
+	REQUIRE(remap.getRebuildCount() == 1);
+	for (int i = 0; i < nfirst; ++i)
+	{
+		if (query->isValidPolyRef(firstRefs[i], &filter))
+			continue;
+		const dtPolyRef newRef = remap.remap(firstRefs[i]);
+		REQUIRE(newRef != 0);
+		REQUIRE(query->isValidPolyRef(newRef, &filter));
+	}
+	dtPolyRef blockedRef = 0;
+	const float center[3] = { 2.5f, 0.0f, 2.5f };
+	const float halfExtents[3] = { 0.5f, 1.0f, 0.5f };
+	float nearest[3];
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, &filter, &blockedRef, nearest)));
+	REQUIRE(blockedRef == 0);
+
+	// Removing the obstacle makes the cells walkable again.
+	REQUIRE(dtStatusSucceed(tileCache->removeObstacle(ob)));
+	upToDate = false;
+	for (int i = 0; i < 16 && !upToDate; ++i)
+		REQUIRE(dtStatusSucceed(tileCache->update(0, navmesh, &upToDate)));
+	REQUIRE(upToDate);
+	REQUIRE(dtStatusSucceed(query->findNearestPoly(center, halfExtents, &filter, &blockedRef, nearest)));
+	REQUIRE(blockedRef != 0);
+
+	// The spliced tiles only keep the vertices of their polygons, they do not grow with each splice.
+	dtObstacleRef moved = 0;
+	int splices = 0;
+	for (int i = 0; i < 8; ++i)
+	{
+		const float offset = (float)(i % 2) * 8.0f;
+		const float movedMin[3] = { bmin[0] + offset, bmin[1], bmin[2] + offset };
+		const float movedMax[3] = { bmax[0] + offset, bmax[1], bmax[2] + offset };
+		const dtTileRef ref = navmesh->getTileRefAt(0, 0, 0);
+		dtObstacleRef next = 0;
+		REQUIRE(dtStatusSucceed(tileCache->addBoxObstacle(movedMin, movedMax, &next)));
+		if (moved)
+			REQUIRE(dtStatusSucceed(tileCache->removeObstacle(moved)));
+		moved = next;
+		upToDate = false;
+		for (int j = 0; j < 16 && !upToDate; ++j)
+			REQUIRE(dtStatusSucceed(tileCache->update(0, navmesh, &upToDate)));
+		tile = navmesh->getTileAt(0, 0, 0);
+		if (navmesh->getTileRef(tile) == ref)
+			splices++;
+		REQUIRE(countUsedVerts(tile) == tile->header->vertCount);
+	}
+	REQUIRE(splices >= 2);
+
+	tileCache->setPolyRefRemap(0);
+	dtFreeNavMeshQuery(query);
+	dtFreeNavMesh(navmesh);
+	dtFreeTileCache(tileCache);
+}
@@ -0,0 +1,256 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+namespace
+{
+int64_t nowNanos()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Rolling terrain with rows of floating platforms, so that some columns have several spans.
+struct Terrain
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+	std::vector<unsigned char> areas;
+	float bmin[3];
+	float bmax[3];
+
+	void addQuad(const float* a, const float* b, const float* c, const float* d, unsigned char area)
+	{
+		const int base = (int)verts.size() / 3;
+		verts.insert(verts.end(), a, a + 3);
+		verts.insert(verts.end(), b, b + 3);
+		verts.insert(verts.end(), c, c + 3);
+		verts.insert(verts.end(), d, d + 3);
+		const int t[] = { base, base + 2, base + 1, base, base + 3, base + 2 };
+		tris.insert(tris.end(), t, t + 6);
+		areas.push_back(area);
+		areas.push_back(area);
+	}
+
+	void build(const int gridSize, const float size)
+	{
+		const float step = size / gridSize;
+		for (int z = 0; z < gridSize; ++z)
+		{
+			for (int x = 0; x < gridSize; ++x)
+			{
+				float v[4][3];
+				for (int i = 0; i < 4; ++i)
+				{
+					const float px = (x + (i == 1 || i == 2)) * step;
+					const float pz = (z + (i >= 2)) * step;
+					v[i][0] = px;
+					v[i][1] = 3.0f + 2.0f * sinf(px * 0.11f) * cosf(pz * 0.07f);
+					v[i][2] = pz;
+				}
+				addQuad(v[0], v[1], v[2], v[3], RC_WALKABLE_AREA);
+			}
+		}
+		for (int i = 0; i < 8; ++i)
+		{
+			const float z0 = size * (i + 0.25f) / 8;
+			const float z1 = z0 + size / 32;
+			const float y = 8.0f + i;
+			const float a[] = { size * 0.1f, y, z0 }, b[] = { size * 0.9f, y, z0 };
+			const float c[] = { size * 0.9f, y, z1 }, d[] = { size * 0.1f, y, z1 };
+			addQuad(a, b, c, d, (unsigned char)(i % 2 ? RC_WALKABLE_AREA : 7));
+		}
+		bmin[0] = 0; bmin[1] = 0; bmin[2] = 0;
+		bmax[0] = size; bmax[1] = 20; bmax[2] = size;
+	}
+
+	bool rasterize(rcContext* context, rcHeightfield& heightfield, const float cellSize, const float cellHeight) const
+	{
+		int width, height;
+		rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+		return rcCreateHeightfield(context, heightfield, width, height, bmin, bmax, cellSize, cellHeight) &&
+			rcRasterizeTriangles(context, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), heightfield, 1);
+	}
+};
+
+bool sameSpans(const rcHeightfield& a, const rcHeightfield& b)
+{
+	if (a.width != b.width || a.height != b.height || memcmp(a.bmin, b.bmin, sizeof(a.bmin)) != 0 || a.cs != b.cs || a.ch != b.ch)
+		return false;
+	for (int i = 0; i < a.width * a.height; ++i)
+	{
+		const rcSpan* sa = a.spans[i];
+		const rcSpan* sb = b.spans[i];
+		for (; sa && sb; sa = sa->next, sb = sb->next)
+		{
+			if (sa->smin != sb->smin || sa->smax != sb->smax || sa->area != sb->area)
+				return false;
+		}
+		if (sa || sb)
+			return false;
+	}
+	return true;
+}
+
+bool sameCompactHeightfields(const rcCompactHeightfield& a, const rcCompactHeightfield& b)
+{
+	return a.width == b.width && a.height == b.height && a.spanCount == b.spanCount &&
+		memcmp(a.cells, b.cells, sizeof(rcCompactCell) * a.width * a.height) == 0 &&
+		memcmp(a.spans, b.spans, sizeof(rcCompactSpan) * a.spanCount) == 0 &&
+		memcmp(a.areas, b.areas, a.spanCount) == 0;
+}
+
+size_t heightfieldMemory(const rcHeightfield& heightfield)
+{
+	size_t size = sizeof(rcSpan*) * heightfield.width * heightfield.height;
+	for (const rcSpanPool* pool = heightfield.pools; pool; pool = pool->next)
+		size += sizeof(rcSpanPool);
+	return size;
+}
+}
+
+TEST_CASE("rcPackedHeightfield", "[recast, packedheightfield]")
+{
+	rcContext context(false);
+	Terrain terrain;
+	terrain.build(32, 40.0f);
+	rcHeightfield heightfield;
+	REQUIRE(terrain.rasterize(&context, heightfield, 0.3f, 0.2f));
+
+	rcPackedHeightfield packed;
+	REQUIRE(rcPackHeightfield(&context, heightfield, packed));
+	REQUIRE(packed.width == heightfield.width);
+	REQUIRE(packed.columns[packed.width * packed.height] == (unsigned int)packed.spanCount);
+
+	SECTION("Packed spans")
+	{
+		const unsigned int span = rcPackSpan(RC_SPAN_MAX_HEIGHT - 1, RC_SPAN_MAX_HEIGHT, RC_WALKABLE_AREA);
+		REQUIRE(rcGetPackedSpanMin(span) == RC_SPAN_MAX_HEIGHT - 1);
+		REQUIRE(rcGetPackedSpanMax(span) == RC_SPAN_MAX_HEIGHT);
+		REQUIRE(rcGetPackedSpanArea(span) == RC_WALKABLE_AREA);
+	}
+
+	SECTION("Unpacking restores the heightfield")
+	{
+		rcHeightfield unpacked;
+		REQUIRE(rcUnpackHeightfield(&context, packed, unpacked));
+		REQUIRE(sameSpans(heightfield, unpacked));
+
+		// Unpacking again reuses the spans.
+		const rcSpanPool* pools = unpacked.pools;
+		REQUIRE(rcUnpackHeightfield(&context, packed, unpacked));
+		REQUIRE(unpacked.pools == pools);
+		REQUIRE(sameSpans(heightfield, unpacked));
+	}
+
+	SECTION("Compression round trip")
+	{
+		const int size = rcGetPackedHeightfieldMemory(packed);
+		std::vector<unsigned int> columns(packed.columns, packed.columns + packed.width * packed.height + 1);
+		std::vector<unsigned int> spans(packed.spans, packed.spans + packed.spanCount);
+
+		REQUIRE(rcCompressPackedHeightfield(&context, packed));
+		REQUIRE(packed.columns == 0);
+		REQUIRE(rcGetPackedHeightfieldMemory(packed) < size / 4);
+
+		rcHeightfield unpacked;
+		REQUIRE_FALSE(rcUnpackHeightfield(&context, packed, unpacked));
+
+		REQUIRE(rcDecompressPackedHeightfield(&context, packed));
+		REQUIRE(packed.compressed == 0);
+		REQUIRE(std::equal(columns.begin(), columns.end(), packed.columns));
+		REQUIRE(std::equal(spans.begin(), spans.end(), packed.spans));
+
+		// Corrupted data is rejected.
+		REQUIRE(rcCompressPackedHeightfield(&context, packed));
+		packed.compressedSize /= 2;
+		REQUIRE_FALSE(rcDecompressPackedHeightfield(&context, packed));
+		REQUIRE(packed.compressed != 0);
+	}
+
+	SECTION("Compact heightfields are the same")
+	{
+		rcCompactHeightfield expected;
+		rcCompactHeightfield compact;
+		REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, heightfield, expected));
+		REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, packed, compact));
+		REQUIRE(sameCompactHeightfields(expected, compact));
+	}
+
+	SECTION("Empty heightfield")
+	{
+		rcHeightfield empty;
+		REQUIRE(rcCreateHeightfield(&context, empty, 4, 4, terrain.bmin, terrain.bmax, 1.0f, 1.0f));
+		REQUIRE(rcPackHeightfield(&context, empty, packed));
+		REQUIRE(packed.spanCount == 0);
+		REQUIRE(rcCompressPackedHeightfield(&context, packed));
+		REQUIRE(rcDecompressPackedHeightfield(&context, packed));
+		rcHeightfield unpacked;
+		REQUIRE(rcUnpackHeightfield(&context, packed, unpacked));
+		REQUIRE(sameSpans(empty, unpacked));
+	}
+}
+
+TEST_CASE("Bench packed heightfield memory and conversions", "[recast, packedheightfield, bench]")
+{
+	rcContext context(false);
+	Terrain terrain;
+	terrain.build(128, 120.0f);
+	rcHeightfield heightfield;
+	REQUIRE(terrain.rasterize(&context, heightfield, 0.3f, 0.2f));
+
+	rcPackedHeightfield packed;
+	REQUIRE(rcPackHeightfield(&context, heightfield, packed));
+	const int packedSize = rcGetPackedHeightfieldMemory(packed);
+	REQUIRE(rcCompressPackedHeightfield(&context, packed));
+	const int compressedSize = rcGetPackedHeightfieldMemory(packed);
+	REQUIRE(rcDecompressPackedHeightfield(&context, packed));
+
+	printf("BM_PackedHeightfield %dx%d cells, %d spans: heightfield %zu bytes, packed %d bytes, compressed %d bytes\n",
+		   heightfield.width, heightfield.height, packed.spanCount, heightfieldMemory(heightfield), packedSize, compressedSize);
+	CHECK((size_t)packedSize < heightfieldMemory(heightfield) / 2);
+
+	const int iterations = 10;
+	int64_t nanos[6] = { 0 };
+	rcHeightfield unpacked;
+	for (int i = 0; i < iterations; ++i)
+	{
+		int64_t t = nowNanos();
+		REQUIRE(rcPackHeightfield(&context, heightfield, packed));
+		nanos[0] += nowNanos() - t;
+
+		t = nowNanos();
+		REQUIRE(rcUnpackHeightfield(&context, packed, unpacked));
+		nanos[1] += nowNanos() - t;
+
+		t = nowNanos();
+		REQUIRE(rcCompressPackedHeightfield(&context, packed));
+		nanos[2] += nowNanos() - t;
+
+		t = nowNanos();
+		REQUIRE(rcDecompressPackedHeightfield(&context, packed));
+		nanos[3] += nowNanos() - t;
+
+		rcCompactHeightfield fromHeightfield;
+		t = nowNanos();
+		REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, heightfield, fromHeightfield));
+		nanos[4] += nowNanos() - t;
+
+		rcCompactHeightfield fromPacked;
+		t = nowNanos();
+		REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, packed, fromPacked));
+		nanos[5] += nowNanos() - t;
+	}
+
+	const char* names[] = { "pack", "unpack", "compress", "decompress", "compact from heightfield", "compact from packed" };
+	for (int i = 0; i < 6; ++i)
+		printf("BM_PackedHeightfield %-26s %10.2f micros\n", names[i], nanos[i] / 1000.0 / iterations);
+}
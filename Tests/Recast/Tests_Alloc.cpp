@@ -5,6 +5,7 @@
 
 #include "RecastAlloc.h"
 #include "RecastAssert.h"
+#include "Recast.h"
 
 /// Used to verify that rcVector constructs/destroys objects correctly.
 struct Incrementor {
@@ -258,3 +259,188 @@ TEST_CASE("rcVector", "[recast, alloc]")
 		v.clear();
 	}
 }
+
+static int g_blockAllocs = 0;
+static int g_blockFrees = 0;
+
+static void* CountingAlloc(size_t size, rcAllocHint)
+{
+	g_blockAllocs++;
+	return malloc(size);
+}
+
+static void CountingFree(void* ptr)
+{
+	g_blockFrees++;
+	free(ptr);
+}
+
+static int g_arenaAsserts = 0;
+
+static void CountingAssertFail(const char*, const char*, int)
+{
+	g_arenaAsserts++;
+}
+
+#ifdef RC_DISABLE_ASSERTS
+static const int ASSERTS_PER_FAILURE = 0;
+#else
+static const int ASSERTS_PER_FAILURE = 1;
+#endif
+
+TEST_CASE("rcArena", "[recast, alloc]")
+{
+	SECTION("Allocations are aligned and bump allocated")
+	{
+		rcArena arena(1024);
+		void* a = arena.allocate(1);
+		void* b = arena.allocate(20);
+		REQUIRE(a != NULL);
+		REQUIRE(b != NULL);
+		REQUIRE(((size_t)a & 15) == 0);
+		REQUIRE(((size_t)b & 15) == 0);
+		REQUIRE((char*)b - (char*)a == 16);
+		REQUIRE(arena.getUsedSize() == 48);
+		REQUIRE(arena.owns(a));
+		REQUIRE(arena.owns(b));
+
+		int local;
+		REQUIRE(!arena.owns(&local));
+
+		// Only the last allocation is released.
+		arena.deallocate(a);
+		REQUIRE(arena.getUsedSize() == 48);
+		arena.deallocate(b);
+		REQUIRE(arena.getUsedSize() == 16);
+		REQUIRE(arena.allocate(8) == b);
+	}
+
+	SECTION("Reset merges the blocks")
+	{
+		rcArena arena(256);
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(arena.allocate(200) != NULL);
+		REQUIRE(arena.allocate(1000) != NULL);
+		REQUIRE(arena.getBlockCount() == 11);
+		const size_t peak = arena.getPeakSize();
+		REQUIRE(peak == 10*208 + 1008);
+
+		arena.reset();
+		REQUIRE(arena.getUsedSize() == 0);
+		REQUIRE(arena.getBlockCount() == 1);
+		REQUIRE(arena.getCapacity() >= peak);
+
+		for (int i = 0; i < 10; ++i)
+			REQUIRE(arena.allocate(200) != NULL);
+		REQUIRE(arena.allocate(1000) != NULL);
+		REQUIRE(arena.getBlockCount() == 1);
+		REQUIRE(arena.getPeakSize() == peak);
+	}
+
+	SECTION("Scoped arena routes rcAlloc and rcFree")
+	{
+		g_blockAllocs = 0;
+		g_blockFrees = 0;
+		rcAllocSetCustom(CountingAlloc, CountingFree);
+
+		void* before = rcAlloc(32, RC_ALLOC_PERM);
+		REQUIRE(g_blockAllocs == 1);
+
+		rcArena arena;
+		for (int tile = 0; tile < 3; ++tile)
+		{
+			rcScopedArena scope(&arena);
+
+			rcContext ctx(false);
+			rcHeightfield* solid = rcAllocHeightfield();
+			REQUIRE(solid != NULL);
+			const float bmin[3] = { 0, 0, 0 };
+			const float bmax[3] = { 10, 10, 10 };
+			REQUIRE(rcCreateHeightfield(&ctx, *solid, 10, 10, bmin, bmax, 1, 1));
+			const float verts[] = { 0,1,0, 0,1,10, 10,1,0 };
+			REQUIRE(rcRasterizeTriangle(&ctx, &verts[0], &verts[3], &verts[6], RC_WALKABLE_AREA, *solid));
+			REQUIRE(arena.owns(solid));
+			REQUIRE(arena.owns(solid->spans));
+			rcFreeHeightField(solid);
+
+			{
+				// Allocates outside of the arena.
+				rcScopedArena noArena(0);
+				void* outside = rcAlloc(16, RC_ALLOC_TEMP);
+				REQUIRE(!arena.owns(outside));
+				rcFree(outside);
+			}
+
+			// Memory allocated before the scope can be freed in it.
+			if (tile == 0)
+				rcFree(before);
+		}
+		// One arena block, two allocations outside of it.
+		REQUIRE(g_blockAllocs == 1 + 1 + 3);
+		REQUIRE(g_blockFrees == 1 + 3);
+		REQUIRE(arena.getUsedSize() == 0);
+		REQUIRE(arena.getPeakSize() > 0);
+
+		rcAllocSetCustom(NULL, NULL);
+	}
+
+	SECTION("Memory of an enclosing arena can be freed in a nested scope")
+	{
+		rcArena outer;
+		rcArena inner;
+		rcScopedArena outerScope(&outer);
+		void* ptr = rcAlloc(64, RC_ALLOC_TEMP);
+		REQUIRE(outer.owns(ptr));
+		{
+			rcScopedArena innerScope(&inner);
+			rcScopedArena noArena(0);
+			rcFree(ptr);
+		}
+		REQUIRE(outer.getUsedSize() == 0);
+	}
+
+	SECTION("Arena memory freed outside of its scope is leaked")
+	{
+		g_arenaAsserts = 0;
+		rcAssertFailSetCustom(CountingAssertFail);
+		g_blockFrees = 0;
+		rcAllocSetCustom(CountingAlloc, CountingFree);
+
+		rcArena arena;
+		void* ptr = 0;
+		{
+			rcScopedArena scope(&arena);
+			ptr = rcAlloc(64, RC_ALLOC_TEMP);
+		}
+		// The memory is leaked rather than given to the system allocator.
+		rcFree(ptr);
+		REQUIRE(g_arenaAsserts == ASSERTS_PER_FAILURE);
+		REQUIRE(g_blockFrees == 0);
+
+		// The arena was reset since the memory was allocated.
+		void* second = 0;
+		{
+			rcScopedArena scope(&arena);
+			rcAlloc(64, RC_ALLOC_TEMP);
+			second = rcAlloc(64, RC_ALLOC_TEMP);
+		}
+		{
+			rcScopedArena scope(&arena);
+			rcFree(second);
+			REQUIRE(g_arenaAsserts == 2*ASSERTS_PER_FAILURE);
+
+			// The header of the memory was overwritten by a later allocation.
+			void* later = rcAlloc(256, RC_ALLOC_TEMP);
+			memset(later, 0, 256);
+			rcFree(second);
+			REQUIRE(g_arenaAsserts == 3*ASSERTS_PER_FAILURE);
+			REQUIRE(arena.getUsedSize() > 0);
+			rcFree(later);
+			REQUIRE(arena.getUsedSize() == 0);
+		}
+		REQUIRE(g_blockFrees == 0);
+
+		rcAllocSetCustom(NULL, NULL);
+		rcAssertFailSetCustom(NULL);
+	}
+}
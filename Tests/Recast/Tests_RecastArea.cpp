@@ -0,0 +1,141 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+namespace
+{
+// Builds a compact heightfield of a field with a second floor over half of it.
+void buildTwoFloors(rcContext& context, const float size, rcCompactHeightfield& chf)
+{
+	const float half = size * 0.5f;
+	const float verts[] = {
+		0, 0, 0, 0, 0, size, size, 0, size, size, 0, 0,
+		0, 3, 0, 0, 3, half, size, 3, half, size, 3, 0
+	};
+	const int tris[] = { 0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7 };
+	const unsigned char areas[] = { RC_WALKABLE_AREA, RC_WALKABLE_AREA, RC_WALKABLE_AREA, RC_WALKABLE_AREA };
+
+	const float bmin[] = { 0, -1, 0 };
+	const float bmax[] = { size, 6, size };
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	int width, height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&context, solid, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(rcRasterizeTriangles(&context, verts, 8, tris, areas, 4, solid, 1));
+	REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, solid, chf));
+}
+
+// Makes unit blocks on both floors, some of them overlapping and some outside of the heightfield.
+void makeBlocks(const float size, const int count, std::vector<float>& mins, std::vector<float>& maxs, std::vector<unsigned char>& areaIds)
+{
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; ++i)
+	{
+		seed = seed * 1103515245u + 12345u;
+		const float x = (float)((seed >> 8) % (unsigned int)(size + 2)) - 0.5f;
+		seed = seed * 1103515245u + 12345u;
+		const float z = (float)((seed >> 8) % (unsigned int)(size + 2)) - 0.5f;
+		const float y = (i % 3) == 0 ? 3.5f : 0.5f;
+		const float center[] = { x + (i % 2) * 0.25f, y, z };
+		const float blockMin[] = { center[0] - 0.5f, center[1] - 0.5f, center[2] - 0.5f };
+		const float blockMax[] = { center[0] + 0.5f, center[1] + 1.0f, center[2] + 0.5f };
+		mins.insert(mins.end(), blockMin, blockMin + 3);
+		maxs.insert(maxs.end(), blockMax, blockMax + 3);
+		areaIds.push_back((unsigned char)(i % 7 == 0 ? RC_NULL_AREA : 1 + i % 5));
+	}
+}
+
+// Marks a block the way the blocks were marked before rcMarkBoxAreas, with a subdivided square.
+void markBlockPoly(rcContext& context, const float* blockMin, const float* blockMax, const unsigned char areaId, rcCompactHeightfield& chf)
+{
+	const float cx = (blockMin[0] + blockMax[0]) * 0.5f;
+	const float cz = (blockMin[2] + blockMax[2]) * 0.5f;
+	const float verts[] = {
+		blockMin[0], 0, blockMin[2], cx, 0, blockMin[2], blockMax[0], 0, blockMin[2], blockMax[0], 0, cz,
+		blockMax[0], 0, blockMax[2], cx, 0, blockMax[2], blockMin[0], 0, blockMax[2], blockMin[0], 0, cz
+	};
+	rcMarkConvexPolyArea(&context, verts, 8, blockMin[1], blockMax[1], areaId, chf);
+}
+
+int64_t nowNanos()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+TEST_CASE("rcMarkBoxAreas", "[recast, area]")
+{
+	rcContext context(false);
+	rcCompactHeightfield chf;
+	buildTwoFloors(context, 30.0f, chf);
+	std::vector<unsigned char> initialAreas(chf.areas, chf.areas + chf.spanCount);
+
+	SECTION("Blocks mark the same spans as subdivided polygons")
+	{
+		std::vector<float> mins;
+		std::vector<float> maxs;
+		std::vector<unsigned char> areaIds;
+		makeBlocks(30.0f, 2000, mins, maxs, areaIds);
+
+		for (int i = 0; i < (int)areaIds.size(); ++i)
+			markBlockPoly(context, &mins[i * 3], &maxs[i * 3], areaIds[i], chf);
+		std::vector<unsigned char> expected(chf.areas, chf.areas + chf.spanCount);
+
+		memcpy(chf.areas, &initialAreas[0], chf.spanCount);
+		REQUIRE(rcMarkBoxAreas(&context, &mins[0], &maxs[0], &areaIds[0], (int)areaIds.size(), chf));
+		REQUIRE(memcmp(chf.areas, &expected[0], chf.spanCount) == 0);
+
+		int marked = 0;
+		for (int i = 0; i < chf.spanCount; ++i)
+			marked += chf.areas[i] != initialAreas[i];
+		REQUIRE(marked > 0);
+	}
+
+	SECTION("Boxes outside of the heightfield mark nothing")
+	{
+		const float mins[] = { -10, 0, -10, 40, 0, 5 };
+		const float maxs[] = { -5, 5, 40, 50, 5, 10 };
+		const unsigned char areaIds[] = { 3, 4 };
+		REQUIRE(rcMarkBoxAreas(&context, mins, maxs, areaIds, 2, chf));
+		REQUIRE(rcMarkBoxAreas(&context, mins, maxs, areaIds, 0, chf));
+		REQUIRE(memcmp(chf.areas, &initialAreas[0], chf.spanCount) == 0);
+	}
+}
+
+TEST_CASE("Bench rcMarkBoxAreas blocks", "[recast, area, bench]")
+{
+	rcContext context(false);
+	rcCompactHeightfield chf;
+	buildTwoFloors(context, 120.0f, chf);
+
+	std::vector<float> mins;
+	std::vector<float> maxs;
+	std::vector<unsigned char> areaIds;
+	makeBlocks(120.0f, 50000, mins, maxs, areaIds);
+
+	const int iterations = 3;
+	int64_t begin = nowNanos();
+	for (int j = 0; j < iterations; ++j)
+	{
+		for (int i = 0; i < (int)areaIds.size(); ++i)
+			markBlockPoly(context, &mins[i * 3], &maxs[i * 3], areaIds[i], chf);
+	}
+	printf("BM_MarkBlocks %d blocks, convex polygons: %10.2f micros\n",
+		   (int)areaIds.size(), (nowNanos() - begin) / 1000.0 / iterations);
+
+	begin = nowNanos();
+	for (int j = 0; j < iterations; ++j)
+		REQUIRE(rcMarkBoxAreas(&context, &mins[0], &maxs[0], &areaIds[0], (int)areaIds.size(), chf));
+	printf("BM_MarkBlocks %d blocks, box areas: %10.2f micros\n",
+		   (int)areaIds.size(), (nowNanos() - begin) / 1000.0 / iterations);
+}
@@ -0,0 +1,201 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastAlloc.h"
+
+namespace
+{
+// Builds the regions of a hilly terrain with pillars in it, which leave holes in the regions.
+void buildTerrainRegions(rcContext& context, const float size, rcCompactHeightfield& chf)
+{
+	const int gridSize = (int)size;
+	std::vector<float> verts;
+	std::vector<int> tris;
+	for (int z = 0; z <= gridSize; ++z)
+	{
+		for (int x = 0; x <= gridSize; ++x)
+		{
+			const float px = x * size / gridSize;
+			const float pz = z * size / gridSize;
+			verts.push_back(px);
+			verts.push_back(2.0f + 1.5f * sinf(px * 0.21f) * cosf(pz * 0.17f));
+			verts.push_back(pz);
+		}
+	}
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			const int i = x + z * (gridSize + 1);
+			const int t[] = { i, i + gridSize + 1, i + 1, i + 1, i + gridSize + 1, i + gridSize + 2 };
+			tris.insert(tris.end(), t, t + 6);
+		}
+	}
+	std::vector<unsigned char> areas(tris.size() / 3, RC_WALKABLE_AREA);
+
+	const float bmin[] = { 0, -1, 0 };
+	const float bmax[] = { size, 8, size };
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	int width, height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&context, solid, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(rcRasterizeTriangles(&context, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), solid, 1));
+	REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, solid, chf));
+	REQUIRE(rcErodeWalkableArea(&context, 2, chf));
+	for (float z = 4.0f; z < size - 4.0f; z += 9.0f)
+	{
+		for (float x = 4.0f; x < size - 4.0f; x += 11.0f)
+		{
+			const float pos[] = { x, -1, z };
+			rcMarkCylinderArea(&context, pos, 0.8f, 9, RC_NULL_AREA, chf);
+		}
+	}
+	REQUIRE(rcBuildDistanceField(&context, chf));
+	REQUIRE(rcBuildRegions(&context, chf, 0, 8, 20));
+}
+
+// Replaces the regions by square blocks of cells, which have the pillars as holes.
+void assignBlockRegions(rcCompactHeightfield& chf, const int blockSize)
+{
+	const int blocksX = (chf.width + blockSize - 1) / blockSize;
+	chf.maxRegions = 0;
+	for (int y = 0; y < chf.height; ++y)
+	{
+		for (int x = 0; x < chf.width; ++x)
+		{
+			const rcCompactCell& c = chf.cells[x + y * chf.width];
+			for (int i = (int)c.index, ni = (int)(c.index + c.count); i < ni; ++i)
+			{
+				chf.spans[i].reg = 0;
+				if (chf.areas[i] == RC_NULL_AREA)
+					continue;
+				chf.spans[i].reg = (unsigned short)(1 + x / blockSize + (y / blockSize) * blocksX);
+				chf.maxRegions = rcMax(chf.maxRegions, chf.spans[i].reg);
+			}
+		}
+	}
+}
+
+bool sameContourSets(const rcContourSet& a, const rcContourSet& b)
+{
+	if (a.nconts != b.nconts)
+		return false;
+	for (int i = 0; i < a.nconts; ++i)
+	{
+		const rcContour& ca = a.conts[i];
+		const rcContour& cb = b.conts[i];
+		if (ca.nverts != cb.nverts || ca.nrverts != cb.nrverts || ca.reg != cb.reg || ca.area != cb.area)
+			return false;
+		if ((ca.nverts > 0 && memcmp(ca.verts, cb.verts, sizeof(int) * 4 * ca.nverts) != 0) ||
+			(ca.nrverts > 0 && memcmp(ca.rverts, cb.rverts, sizeof(int) * 4 * ca.nrverts) != 0))
+			return false;
+	}
+	return true;
+}
+
+int64_t nowNanos()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+TEST_CASE("rcBuildContours", "[recast, contour]")
+{
+	rcContext context(false);
+	rcCompactHeightfield chf;
+	buildTerrainRegions(context, 60.0f, chf);
+
+	rcContourSet serial;
+	REQUIRE(rcBuildContours(&context, chf, 1.3f, 12, serial));
+	REQUIRE(serial.nconts > 8);
+
+	SECTION("Threads build the same contours")
+	{
+		const int threadCounts[] = { 2, 3, 8, 1000 };
+		for (int i = 0; i < 4; ++i)
+		{
+			rcContourSet parallel;
+			REQUIRE(rcBuildContours(&context, chf, 1.3f, 12, parallel, RC_CONTOUR_TESS_WALL_EDGES, threadCounts[i]));
+			REQUIRE(sameContourSets(serial, parallel));
+		}
+	}
+
+	SECTION("Holes are merged into the outlines")
+	{
+		assignBlockRegions(chf, 40);
+		rcContourSet blocks;
+		REQUIRE(rcBuildContours(&context, chf, 1.3f, 12, blocks));
+
+		// The merged holes are left empty, and each region keeps a single contour.
+		std::vector<int> regionContours(chf.maxRegions + 1, 0);
+		int nmerged = 0;
+		for (int i = 0; i < blocks.nconts; ++i)
+		{
+			if (blocks.conts[i].nverts == 0)
+				nmerged++;
+			else
+				regionContours[blocks.conts[i].reg]++;
+		}
+		REQUIRE(nmerged > 0);
+		for (size_t i = 0; i < regionContours.size(); ++i)
+			REQUIRE(regionContours[i] <= 1);
+
+		rcContourSet parallel;
+		REQUIRE(rcBuildContours(&context, chf, 1.3f, 12, parallel, RC_CONTOUR_TESS_WALL_EDGES, 4));
+		REQUIRE(sameContourSets(blocks, parallel));
+	}
+
+	SECTION("Holes are merged with threads when the contours come from an arena")
+	{
+		// Many small regions with holes, so that all the threads merge some.
+		rcCompactHeightfield large;
+		buildTerrainRegions(context, 150.0f, large);
+		assignBlockRegions(large, 16);
+		rcContourSet blocks;
+		REQUIRE(rcBuildContours(&context, large, 1.3f, 12, blocks));
+
+		// The contours traced by the calling thread are allocated from the arena, and freed by the merges.
+		// Which thread merges them varies, so the build is repeated.
+		rcArena arena;
+		for (int i = 0; i < 16; ++i)
+		{
+			rcScopedArena scope(&arena);
+			rcContourSet parallel;
+			REQUIRE(rcBuildContours(&context, large, 1.3f, 12, parallel, RC_CONTOUR_TESS_WALL_EDGES, 4));
+			REQUIRE(sameContourSets(blocks, parallel));
+		}
+	}
+}
+
+TEST_CASE("Bench rcBuildContours threads", "[recast, contour, bench]")
+{
+	rcContext context(false);
+	rcCompactHeightfield chf;
+	buildTerrainRegions(context, 200.0f, chf);
+
+	const int threadCounts[] = { 1, 2, 4, 8 };
+	for (int i = 0; i < 4; ++i)
+	{
+		const int iterations = 5;
+		int nconts = 0;
+		const int64_t begin = nowNanos();
+		for (int j = 0; j < iterations; ++j)
+		{
+			rcContourSet cset;
+			REQUIRE(rcBuildContours(&context, chf, 1.3f, 12, cset, RC_CONTOUR_TESS_WALL_EDGES, threadCounts[i]));
+			nconts = cset.nconts;
+		}
+		printf("BM_Contours %d regions, %d contours, %d threads: %10.2f micros\n",
+			   chf.maxRegions, nconts, threadCounts[i], (nowNanos() - begin) / 1000.0 / iterations);
+	}
+}
@@ -0,0 +1,247 @@
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+namespace
+{
+struct TriangleSet
+{
+	std::vector<float> verts;
+	std::vector<int> tris;
+	std::vector<unsigned char> areas;
+
+	void addQuad(float x0, float z0, float x1, float z1, float y0, float y1)
+	{
+		const int base = (int)verts.size() / 3;
+		const float v[] = { x0, y0, z0,  x1, y0, z0,  x1, y1, z1,  x0, y1, z1 };
+		verts.insert(verts.end(), v, v + 12);
+		const int t[] = { base, base + 2, base + 1,  base, base + 3, base + 2 };
+		tris.insert(tris.end(), t, t + 6);
+		areas.push_back(RC_WALKABLE_AREA);
+		areas.push_back(RC_WALKABLE_AREA);
+	}
+
+	// An axis aligned box, rasterized as its top and its sides.
+	void addBox(float x0, float z0, float x1, float z1, float y0, float y1)
+	{
+		addQuad(x0, z0, x1, z1, y1, y1);
+		addQuad(x0, z0, x1, z0, y0, y1);
+		addQuad(x0, z1, x1, z1, y0, y1);
+	}
+
+	bool rasterize(rcContext* context, rcHeightfield& heightfield) const
+	{
+		return rcRasterizeTriangles(context, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), heightfield, 1);
+	}
+};
+
+bool sameSpans(const rcHeightfield& a, const rcHeightfield& b)
+{
+	if (a.width != b.width || a.height != b.height)
+	{
+		return false;
+	}
+	for (int i = 0; i < a.width * a.height; ++i)
+	{
+		const rcSpan* sa = a.spans[i];
+		const rcSpan* sb = b.spans[i];
+		for (; sa && sb; sa = sa->next, sb = sb->next)
+		{
+			if (sa->smin != sb->smin || sa->smax != sb->smax || sa->area != sb->area)
+			{
+				return false;
+			}
+		}
+		if (sa || sb)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+}
+
+TEST_CASE("rcEditableHeightfield", "[recast, heightfieldedit]")
+{
+	rcContext context(false);
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 20, 10, 20 };
+	const float cellSize = 0.5f;
+	const float cellHeight = 0.25f;
+	int width, height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	TriangleSet ground;
+	ground.addQuad(0, 0, 20, 20, 1, 2);
+	ground.addBox(8, 8, 12, 12, 0, 4);
+
+	TriangleSet meshes[4];
+	meshes[0].addBox(2, 2, 5, 6, 1, 3);
+	meshes[1].addBox(4, 4, 9, 7, 0.5f, 5);
+	meshes[2].addQuad(11, 1, 19, 9, 3, 6);
+	meshes[3].addBox(1.2f, 13.7f, 18.3f, 15.1f, 2, 2.5f);
+
+	rcEditableHeightfield* editable = rcAllocEditableHeightfield();
+	REQUIRE(editable != 0);
+	REQUIRE(rcCreateEditableHeightfield(&context, *editable, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(ground.rasterize(&context, editable->base));
+	REQUIRE(rcUpdateEditableHeightfield(&context, *editable));
+
+	// Builds the expected heightfield by rasterizing the ground and then the listed triangle sets.
+	const auto expect = [&](const std::vector<int>& ids) {
+		rcHeightfield expected;
+		REQUIRE(rcCreateHeightfield(&context, expected, width, height, bmin, bmax, cellSize, cellHeight));
+		REQUIRE(ground.rasterize(&context, expected));
+		for (size_t i = 0; i < ids.size(); ++i)
+			REQUIRE(meshes[ids[i]].rasterize(&context, expected));
+		REQUIRE(sameSpans(editable->solid, expected));
+	};
+
+	SECTION("Static geometry only")
+	{
+		expect(std::vector<int>());
+	}
+
+	SECTION("Adding and removing triangle sets only composes their columns again")
+	{
+		for (int i = 0; i < 4; ++i)
+			REQUIRE(rcAddEditMesh(&context, *editable, 100 + i, &meshes[i].verts[0], (int)meshes[i].verts.size() / 3,
+								  &meshes[i].tris[0], &meshes[i].areas[0], (int)meshes[i].areas.size()));
+		REQUIRE_FALSE(rcAddEditMesh(&context, *editable, 100, &meshes[0].verts[0], (int)meshes[0].verts.size() / 3,
+									&meshes[0].tris[0], &meshes[0].areas[0], (int)meshes[0].areas.size()));
+		REQUIRE(rcUpdateEditableHeightfield(&context, *editable));
+		expect({ 0, 1, 2, 3 });
+
+		REQUIRE(rcRemoveEditMesh(*editable, 101));
+		REQUIRE_FALSE(rcRemoveEditMesh(*editable, 101));
+		int dirtyBounds[4];
+		REQUIRE(rcUpdateEditableHeightfield(&context, *editable, dirtyBounds));
+		REQUIRE(dirtyBounds[0] <= (int)(4 / cellSize));
+		REQUIRE(dirtyBounds[2] >= (int)(9 / cellSize) - 1);
+		REQUIRE(dirtyBounds[2] <= (int)(9 / cellSize) + 1);
+		REQUIRE(dirtyBounds[3] <= (int)(7 / cellSize) + 1);
+		expect({ 0, 2, 3 });
+
+		// Nothing to do.
+		REQUIRE(rcUpdateEditableHeightfield(&context, *editable, dirtyBounds));
+		REQUIRE(dirtyBounds[0] > dirtyBounds[2]);
+
+		REQUIRE(rcAddEditMesh(&context, *editable, 101, &meshes[1].verts[0], (int)meshes[1].verts.size() / 3,
+							  &meshes[1].tris[0], &meshes[1].areas[0], (int)meshes[1].areas.size()));
+		REQUIRE(rcRemoveEditMesh(*editable, 100));
+		REQUIRE(rcUpdateEditableHeightfield(&context, *editable));
+		expect({ 2, 3, 1 });
+
+		REQUIRE(rcRemoveEditMesh(*editable, 101));
+		REQUIRE(rcRemoveEditMesh(*editable, 102));
+		REQUIRE(rcRemoveEditMesh(*editable, 103));
+		REQUIRE(rcUpdateEditableHeightfield(&context, *editable));
+		expect(std::vector<int>());
+	}
+
+	SECTION("Changes of the static geometry")
+	{
+		TriangleSet pillar;
+		pillar.addBox(14, 14, 16, 16, 0, 8);
+		REQUIRE(rcAddEditMesh(&context, *editable, 1, &meshes[3].verts[0], (int)meshes[3].verts.size() / 3,
+							  &meshes[3].tris[0], &meshes[3].areas[0], (int)meshes[3].areas.size()));
+		REQUIRE(pillar.rasterize(&context, editable->base));
+		rcMarkEditableHeightfieldDirty(*editable, (int)(14 / cellSize) - 1, (int)(14 / cellSize) - 1, (int)(16 / cellSize) + 1, (int)(16 / cellSize) + 1);
+		REQUIRE(rcUpdateEditableHeightfield(&context, *editable));
+
+		rcHeightfield expected;
+		REQUIRE(rcCreateHeightfield(&context, expected, width, height, bmin, bmax, cellSize, cellHeight));
+		REQUIRE(ground.rasterize(&context, expected));
+		REQUIRE(pillar.rasterize(&context, expected));
+		REQUIRE(meshes[3].rasterize(&context, expected));
+		REQUIRE(sameSpans(editable->solid, expected));
+	}
+
+	SECTION("Copies")
+	{
+		rcHeightfield copy;
+		REQUIRE(rcCopyHeightfield(&context, editable->solid, copy));
+		REQUIRE(sameSpans(editable->solid, copy));
+		REQUIRE(rcAddEditMesh(&context, *editable, 1, &meshes[0].verts[0], (int)meshes[0].verts.size() / 3,
+							  &meshes[0].tris[0], &meshes[0].areas[0], (int)meshes[0].areas.size()));
+		REQUIRE(rcUpdateEditableHeightfield(&context, *editable));
+		REQUIRE_FALSE(sameSpans(editable->solid, copy));
+
+		// Copying again reuses the spans of the previous copy.
+		REQUIRE(rcCopyHeightfield(&context, editable->solid, copy));
+		REQUIRE(sameSpans(editable->solid, copy));
+		const rcSpanPool* pools = copy.pools;
+		REQUIRE(rcCopyHeightfield(&context, editable->solid, copy));
+		REQUIRE(copy.pools == pools);
+		REQUIRE(sameSpans(editable->solid, copy));
+	}
+
+	rcFreeEditableHeightfield(editable);
+}
+
+TEST_CASE("rcEditableHeightfield merges the spans in the order of the triangles", "[recast, heightfieldedit]")
+{
+	rcContext context(false);
+	const float bmin[] = { 0, 0, 0 };
+	const float bmax[] = { 4, 10, 4 };
+	const float cellSize = 0.5f;
+	const float cellHeight = 0.25f;
+	int width, height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	// Flat quads rasterized as the spans [10,11], [11,12] and [12,13] of each column.
+	TriangleSet ground;
+	ground.addQuad(0, 0, 4, 4, 2.5f, 2.5f);
+	TriangleSet lower;
+	lower.addQuad(0, 0, 4, 4, 2.75f, 2.75f);
+	TriangleSet upper;
+	upper.addQuad(0, 0, 4, 4, 3, 3);
+	TriangleSet both = lower;
+	both.addQuad(0, 0, 4, 4, 3, 3);
+	lower.areas.assign(lower.areas.size(), RC_NULL_AREA);
+	upper.areas.assign(upper.areas.size(), RC_NULL_AREA);
+	both.areas.assign(both.areas.size(), RC_NULL_AREA);
+
+	rcEditableHeightfield* editable = rcAllocEditableHeightfield();
+	REQUIRE(editable != 0);
+	REQUIRE(rcCreateEditableHeightfield(&context, *editable, width, height, bmin, bmax, cellSize, cellHeight, 1));
+	REQUIRE(ground.rasterize(&context, editable->base));
+
+	rcHeightfield expected;
+	REQUIRE(rcCreateHeightfield(&context, expected, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(ground.rasterize(&context, expected));
+
+	SECTION("Overlapping spans of two triangle sets")
+	{
+		REQUIRE(rcAddEditMesh(&context, *editable, 1, &lower.verts[0], (int)lower.verts.size() / 3,
+							  &lower.tris[0], &lower.areas[0], (int)lower.areas.size()));
+		REQUIRE(rcAddEditMesh(&context, *editable, 2, &upper.verts[0], (int)upper.verts.size() / 3,
+							  &upper.tris[0], &upper.areas[0], (int)upper.areas.size()));
+		REQUIRE(lower.rasterize(&context, expected));
+		REQUIRE(upper.rasterize(&context, expected));
+	}
+
+	SECTION("Overlapping spans of the triangles of a triangle set")
+	{
+		REQUIRE(rcAddEditMesh(&context, *editable, 1, &both.verts[0], (int)both.verts.size() / 3,
+							  &both.tris[0], &both.areas[0], (int)both.areas.size()));
+		REQUIRE(both.rasterize(&context, expected));
+	}
+
+	REQUIRE(rcUpdateEditableHeightfield(&context, *editable));
+	REQUIRE(sameSpans(editable->solid, expected));
+	// Each span is merged within the threshold of the span below it, which keeps the walkable area.
+	for (int i = 0; i < width * height; ++i)
+	{
+		const rcSpan* span = editable->solid.spans[i];
+		REQUIRE(span != 0);
+		REQUIRE(span->smin == 10);
+		REQUIRE(span->smax == 13);
+		REQUIRE(span->area == RC_WALKABLE_AREA);
+		REQUIRE(span->next == 0);
+	}
+
+	rcFreeEditableHeightfield(editable);
+}
@@ -0,0 +1,137 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+namespace
+{
+// Builds the contours of a flat open field with pillars in it, as a single region.
+// The pillars are merged as holes into the outline, which makes one large contour.
+void buildOpenFieldContours(rcContext& context, const float size, const float pillarSpacing, rcContourSet& cset)
+{
+	const float verts[] = { 0, 0, 0, 0, 0, size, size, 0, size, size, 0, 0 };
+	const int tris[] = { 0, 1, 2, 0, 2, 3 };
+	const unsigned char areas[] = { RC_WALKABLE_AREA, RC_WALKABLE_AREA };
+
+	const float bmin[] = { 0, -1, 0 };
+	const float bmax[] = { size, 4, size };
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	int width, height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&context, solid, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(rcRasterizeTriangles(&context, verts, 4, tris, areas, 2, solid, 1));
+	rcCompactHeightfield chf;
+	REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, solid, chf));
+	int n = 0;
+	for (float z = pillarSpacing * 0.5f; z < size - 2.0f; z += pillarSpacing)
+	{
+		for (float x = pillarSpacing * 0.5f; x < size - 2.0f; x += pillarSpacing, ++n)
+		{
+			const float pos[] = { x + (n % 3) * 0.4f, -1, z + (n % 5) * 0.3f };
+			rcMarkCylinderArea(&context, pos, 0.5f + (n % 4) * 0.2f, 6, RC_NULL_AREA, chf);
+		}
+	}
+
+	chf.maxRegions = 1;
+	for (int i = 0; i < chf.spanCount; ++i)
+		chf.spans[i].reg = chf.areas[i] == RC_NULL_AREA ? 0 : 1;
+
+	REQUIRE(rcBuildContours(&context, chf, 1.3f, 12, cset));
+}
+
+// Returns twice the area of the polygons of the mesh, or -1 if a polygon is not convex.
+long long polyMeshArea(const rcPolyMesh& mesh)
+{
+	long long area = 0;
+	for (int i = 0; i < mesh.npolys; ++i)
+	{
+		const unsigned short* p = &mesh.polys[i * mesh.nvp * 2];
+		int n = 0;
+		while (n < mesh.nvp && p[n] != RC_MESH_NULL_IDX)
+			n++;
+		for (int j = 0; j < n; ++j)
+		{
+			const unsigned short* a = &mesh.verts[p[j] * 3];
+			const unsigned short* b = &mesh.verts[p[(j + 1) % n] * 3];
+			const unsigned short* c = &mesh.verts[p[(j + 2) % n] * 3];
+			const int cross = ((int)b[0] - (int)a[0]) * ((int)c[2] - (int)a[2]) - ((int)c[0] - (int)a[0]) * ((int)b[2] - (int)a[2]);
+			if (cross > 0)
+				return -1;
+		}
+		for (int j = 2; j < n; ++j)
+		{
+			const unsigned short* a = &mesh.verts[p[0] * 3];
+			const unsigned short* b = &mesh.verts[p[j - 1] * 3];
+			const unsigned short* c = &mesh.verts[p[j] * 3];
+			area -= ((int)b[0] - (int)a[0]) * ((int)c[2] - (int)a[2]) - ((int)c[0] - (int)a[0]) * ((int)b[2] - (int)a[2]);
+		}
+	}
+	return area;
+}
+
+int64_t nowNanos()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+TEST_CASE("rcBuildPolyMesh", "[recast, polymesh]")
+{
+	rcContext context(false);
+	rcContourSet cset;
+	buildOpenFieldContours(context, 40.0f, 6.0f, cset);
+
+	int largest = 0;
+	for (int i = 0; i < cset.nconts; ++i)
+		largest = rcMax(largest, cset.conts[i].nverts);
+	REQUIRE(largest > 200);
+
+	SECTION("Large contours are triangulated and merged into convex polygons")
+	{
+		rcPolyMesh triangles;
+		REQUIRE(rcBuildPolyMesh(&context, cset, 3, triangles));
+		rcPolyMesh polygons;
+		REQUIRE(rcBuildPolyMesh(&context, cset, 6, polygons));
+
+		REQUIRE(polygons.npolys < triangles.npolys);
+		REQUIRE(polygons.nverts == triangles.nverts);
+		const long long area = polyMeshArea(triangles);
+		REQUIRE(area > 0);
+		REQUIRE(polyMeshArea(polygons) == area);
+	}
+}
+
+TEST_CASE("Bench rcBuildPolyMesh open field", "[recast, polymesh, bench]")
+{
+	rcContext context(false);
+	const float sizes[] = { 20.0f, 40.0f, 80.0f, 160.0f };
+	for (int i = 0; i < 4; ++i)
+	{
+		rcContourSet cset;
+		buildOpenFieldContours(context, sizes[i], 5.0f, cset);
+		int nverts = 0;
+		for (int j = 0; j < cset.nconts; ++j)
+			nverts += cset.conts[j].nverts;
+
+		const int iterations = 3;
+		int npolys = 0;
+		const int64_t begin = nowNanos();
+		for (int j = 0; j < iterations; ++j)
+		{
+			rcPolyMesh mesh;
+			REQUIRE(rcBuildPolyMesh(&context, cset, 6, mesh));
+			npolys = mesh.npolys;
+		}
+		printf("BM_PolyMesh %d contour verts, %d polys: %10.2f micros\n",
+			   nverts, npolys, (nowNanos() - begin) / 1000.0 / iterations);
+	}
+}
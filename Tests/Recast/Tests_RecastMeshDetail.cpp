@@ -0,0 +1,214 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+
+namespace
+{
+// Builds the polygon mesh of a hilly terrain with a few obstacles in it.
+void buildTerrainPolyMesh(rcContext& context, const int gridSize, rcCompactHeightfield& chf, rcPolyMesh& pmesh)
+{
+	const float size = 60.0f;
+	std::vector<float> verts;
+	std::vector<int> tris;
+	for (int z = 0; z <= gridSize; ++z)
+	{
+		for (int x = 0; x <= gridSize; ++x)
+		{
+			const float px = x * size / gridSize;
+			const float pz = z * size / gridSize;
+			verts.push_back(px);
+			verts.push_back(2.0f + 1.5f * sinf(px * 0.21f) * cosf(pz * 0.17f));
+			verts.push_back(pz);
+		}
+	}
+	for (int z = 0; z < gridSize; ++z)
+	{
+		for (int x = 0; x < gridSize; ++x)
+		{
+			const int i = x + z * (gridSize + 1);
+			const int t[] = { i, i + gridSize + 1, i + 1, i + 1, i + gridSize + 1, i + gridSize + 2 };
+			tris.insert(tris.end(), t, t + 6);
+		}
+	}
+	std::vector<unsigned char> areas(tris.size() / 3, RC_WALKABLE_AREA);
+
+	const float bmin[] = { 0, -1, 0 };
+	const float bmax[] = { size, 8, size };
+	const float cellSize = 0.3f;
+	const float cellHeight = 0.2f;
+	int width, height;
+	rcCalcGridSize(bmin, bmax, cellSize, &width, &height);
+
+	rcHeightfield solid;
+	REQUIRE(rcCreateHeightfield(&context, solid, width, height, bmin, bmax, cellSize, cellHeight));
+	REQUIRE(rcRasterizeTriangles(&context, &verts[0], (int)verts.size() / 3, &tris[0], &areas[0], (int)areas.size(), solid, 1));
+	REQUIRE(rcBuildCompactHeightfield(&context, 10, 4, solid, chf));
+	REQUIRE(rcErodeWalkableArea(&context, 2, chf));
+	for (int i = 0; i < 12; ++i)
+	{
+		const float bx = 5.0f + (i % 4) * 14.0f;
+		const float bz = 5.0f + (i / 4) * 18.0f;
+		const float boxMin[] = { bx, -1, bz };
+		const float boxMax[] = { bx + 3.0f + i % 3, 8, bz + 2.0f };
+		rcMarkBoxArea(&context, boxMin, boxMax, RC_NULL_AREA, chf);
+	}
+	REQUIRE(rcBuildDistanceField(&context, chf));
+	REQUIRE(rcBuildRegions(&context, chf, 0, 8, 20));
+	rcContourSet cset;
+	REQUIRE(rcBuildContours(&context, chf, 1.3f, 12, cset));
+	REQUIRE(rcBuildPolyMesh(&context, cset, 6, pmesh));
+	REQUIRE(pmesh.npolys > 50);
+}
+
+bool sameDetailMeshes(const rcPolyMeshDetail& a, const rcPolyMeshDetail& b)
+{
+	return a.nmeshes == b.nmeshes && a.nverts == b.nverts && a.ntris == b.ntris &&
+		memcmp(a.meshes, b.meshes, sizeof(unsigned int) * 4 * a.nmeshes) == 0 &&
+		memcmp(a.verts, b.verts, sizeof(float) * 3 * a.nverts) == 0 &&
+		memcmp(a.tris, b.tris, 4 * a.ntris) == 0;
+}
+
+// Checks that the detail triangles of each polygon have the winding of the polygon, and cover it.
+bool detailMeshCoversPolygons(const rcPolyMesh& pmesh, const rcPolyMeshDetail& dmesh)
+{
+	for (int i = 0; i < pmesh.npolys; ++i)
+	{
+		const unsigned short* p = &pmesh.polys[i * pmesh.nvp * 2];
+		float polyArea = 0;
+		for (int j = 2; j < pmesh.nvp && p[j] != RC_MESH_NULL_IDX; ++j)
+		{
+			const unsigned short* a = &pmesh.verts[p[0] * 3];
+			const unsigned short* b = &pmesh.verts[p[j - 1] * 3];
+			const unsigned short* c = &pmesh.verts[p[j] * 3];
+			polyArea += (float)((b[0] - a[0]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[0] - a[0])) * pmesh.cs * pmesh.cs;
+		}
+
+		const unsigned int* m = &dmesh.meshes[i * 4];
+		const float* verts = &dmesh.verts[m[0] * 3];
+		float detailArea = 0;
+		for (unsigned int j = 0; j < m[3]; ++j)
+		{
+			const unsigned char* t = &dmesh.tris[(m[2] + j) * 4];
+			if (t[0] >= m[1] || t[1] >= m[1] || t[2] >= m[1])
+				return false;
+			const float* a = &verts[t[0] * 3];
+			const float* b = &verts[t[1] * 3];
+			const float* c = &verts[t[2] * 3];
+			const float area = (b[0] - a[0]) * (c[2] - a[2]) - (b[2] - a[2]) * (c[0] - a[0]);
+			if (area * polyArea <= 0)
+				return false;
+			detailArea += area;
+		}
+		if (fabsf(detailArea - polyArea) > fabsf(polyArea) * 1e-3f)
+			return false;
+	}
+	return true;
+}
+
+int64_t nowNanos()
+{
+	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+TEST_CASE("rcBuildPolyMeshDetail", "[recast, meshdetail]")
+{
+	rcContext context(false);
+	rcCompactHeightfield chf;
+	rcPolyMesh pmesh;
+	buildTerrainPolyMesh(context, 60, chf, pmesh);
+
+	rcPolyMeshDetail serial;
+	REQUIRE(rcBuildPolyMeshDetail(&context, pmesh, chf, 0.6f, 0.2f, serial));
+	REQUIRE(serial.nmeshes == pmesh.npolys);
+	REQUIRE(serial.ntris >= pmesh.npolys);
+
+	SECTION("Threads build the same detail mesh")
+	{
+		const int threadCounts[] = { 2, 3, 8, 1000 };
+		for (int i = 0; i < 4; ++i)
+		{
+			rcPolyMeshDetail parallel;
+			REQUIRE(rcBuildPolyMeshDetail(&context, pmesh, chf, 0.6f, 0.2f, parallel, threadCounts[i]));
+			REQUIRE(sameDetailMeshes(serial, parallel));
+		}
+	}
+
+	SECTION("Submeshes are contiguous")
+	{
+		unsigned int nverts = 0, ntris = 0;
+		for (int i = 0; i < serial.nmeshes; ++i)
+		{
+			REQUIRE(serial.meshes[i*4+0] == nverts);
+			REQUIRE(serial.meshes[i*4+2] == ntris);
+			nverts += serial.meshes[i*4+1];
+			ntris += serial.meshes[i*4+3];
+		}
+		REQUIRE((int)nverts == serial.nverts);
+		REQUIRE((int)ntris == serial.ntris);
+	}
+
+	SECTION("Detail triangles cover the polygons")
+	{
+		REQUIRE(detailMeshCoversPolygons(pmesh, serial));
+
+		// Dense sampling adds many vertices to each polygon.
+		rcPolyMeshDetail dense;
+		REQUIRE(rcBuildPolyMeshDetail(&context, pmesh, chf, 0.3f, 0.01f, dense));
+		REQUIRE(dense.nverts > serial.nverts * 2);
+		REQUIRE(detailMeshCoversPolygons(pmesh, dense));
+	}
+}
+
+TEST_CASE("Bench rcBuildPolyMeshDetail threads", "[recast, meshdetail, bench]")
+{
+	rcContext context(false);
+	rcCompactHeightfield chf;
+	rcPolyMesh pmesh;
+	buildTerrainPolyMesh(context, 120, chf, pmesh);
+
+	const int threadCounts[] = { 1, 2, 4, 8 };
+	for (int i = 0; i < 4; ++i)
+	{
+		const int iterations = 5;
+		const int64_t begin = nowNanos();
+		for (int j = 0; j < iterations; ++j)
+		{
+			rcPolyMeshDetail dmesh;
+			REQUIRE(rcBuildPolyMeshDetail(&context, pmesh, chf, 0.3f, 0.2f, dmesh, threadCounts[i]));
+		}
+		printf("BM_PolyMeshDetail %d polys, %d threads: %10.2f micros\n",
+			   pmesh.npolys, threadCounts[i], (nowNanos() - begin) / 1000.0 / iterations);
+	}
+}
+
+TEST_CASE("Bench rcBuildPolyMeshDetail sampling", "[recast, meshdetail, bench]")
+{
+	rcContext context(false);
+	rcCompactHeightfield chf;
+	rcPolyMesh pmesh;
+	buildTerrainPolyMesh(context, 60, chf, pmesh);
+
+	const float maxErrors[] = { 0.4f, 0.2f, 0.1f, 0.05f };
+	for (int i = 0; i < 4; ++i)
+	{
+		const int iterations = 3;
+		int ntris = 0;
+		const int64_t begin = nowNanos();
+		for (int j = 0; j < iterations; ++j)
+		{
+			rcPolyMeshDetail dmesh;
+			REQUIRE(rcBuildPolyMeshDetail(&context, pmesh, chf, 0.3f, maxErrors[i], dmesh));
+			ntris = dmesh.ntris;
+		}
+		printf("BM_PolyMeshDetailSampling max error %.2f, %d tris: %10.2f micros\n",
+			   maxErrors[i], ntris, (nowNanos() - begin) / 1000.0 / iterations);
+	}
+}
@@ -0,0 +1,178 @@
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch2/catch_all.hpp"
+
+#include "Recast.h"
+#include "RecastDump.h"
+#include "RecastProfiler.h"
+
+namespace
+{
+struct StringFileIO : public duFileIO
+{
+	std::string text;
+	virtual bool isWriting() const { return true; }
+	virtual bool isReading() const { return false; }
+	virtual bool write(const void* ptr, const size_t size) { text.append((const char*)ptr, size); return true; }
+	virtual bool read(void*, const size_t) { return false; }
+};
+
+std::vector<duProfileSpan> getSpans(const duProfiler& profiler, int thread)
+{
+	std::vector<duProfileSpan> spans(profiler.getSpans(thread, 0, 0));
+	profiler.getSpans(thread, spans.data(), (int)spans.size());
+	return spans;
+}
+}
+
+TEST_CASE("duProfiler", "[recast, profiler]")
+{
+	SECTION("Nested spans are recorded with their depth and tile")
+	{
+		duProfiler profiler;
+		profiler.setTile(3, 4);
+		profiler.beginSpan("Tile");
+		profiler.beginSpan("Stage");
+		profiler.endSpan();
+		profiler.setTile(-1, -1);
+		profiler.beginSpan("Stage");
+		profiler.endSpan();
+		profiler.endSpan();
+
+		REQUIRE(profiler.getThreadCount() == 1);
+		const std::vector<duProfileSpan> spans = getSpans(profiler, 0);
+		REQUIRE(spans.size() == 3);
+
+		// Spans are recorded when they end.
+		REQUIRE(strcmp(spans[0].name, "Stage") == 0);
+		REQUIRE(spans[0].depth == 1);
+		REQUIRE(spans[0].tileX == 3);
+		REQUIRE(spans[0].tileY == 4);
+		REQUIRE(spans[1].depth == 1);
+		REQUIRE(spans[1].tileX == -1);
+		REQUIRE(strcmp(spans[2].name, "Tile") == 0);
+		REQUIRE(spans[2].depth == 0);
+		REQUIRE(spans[2].tileX == 3);
+		REQUIRE(spans[2].start <= spans[0].start);
+		REQUIRE(spans[2].start + spans[2].duration >= spans[1].start + spans[1].duration);
+
+		duProfileTileStats tile;
+		REQUIRE(profiler.getTileStats(&tile, 1) == 1);
+		REQUIRE(tile.tileX == 3);
+		REQUIRE(tile.tileY == 4);
+		REQUIRE(tile.spanCount == 1);
+		REQUIRE(tile.total == spans[2].duration);
+	}
+
+	SECTION("Full ring buffers keep the latest spans")
+	{
+		duProfiler profiler(4);
+		static const char* names[] = { "0", "1", "2", "3", "4", "5" };
+		for (int i = 0; i < 6; ++i)
+		{
+			profiler.beginSpan(names[i]);
+			profiler.endSpan();
+		}
+
+		const std::vector<duProfileSpan> spans = getSpans(profiler, 0);
+		REQUIRE(spans.size() == 4);
+		for (int i = 0; i < 4; ++i)
+			REQUIRE(strcmp(spans[i].name, names[i + 2]) == 0);
+		REQUIRE(profiler.getDroppedSpanCount() == 2);
+
+		profiler.reset();
+		REQUIRE(profiler.getSpans(0, 0, 0) == 0);
+		REQUIRE(profiler.getDroppedSpanCount() == 0);
+	}
+
+	SECTION("Stats are grouped by name")
+	{
+		duProfiler profiler;
+		for (int i = 0; i < 100; ++i)
+		{
+			profiler.beginSpan("A");
+			profiler.endSpan();
+		}
+		std::string name = "B";
+		profiler.beginSpan(name.c_str());
+		profiler.endSpan();
+		// Names are compared by value.
+		profiler.beginSpan("B");
+		profiler.endSpan();
+
+		duProfileStats stats[4];
+		const int count = profiler.getStats(stats, 4);
+		REQUIRE(count == 2);
+		for (int i = 0; i < count; ++i)
+		{
+			const duProfileStats& s = stats[i];
+			REQUIRE(s.count == (strcmp(s.name, "A") == 0 ? 100 : 2));
+			REQUIRE(s.min <= s.p50);
+			REQUIRE(s.p50 <= s.p90);
+			REQUIRE(s.p90 <= s.p99);
+			REQUIRE(s.p99 <= s.max);
+			REQUIRE(s.total >= s.max);
+		}
+		REQUIRE(stats[0].total >= stats[1].total);
+	}
+
+	SECTION("Threads record into separate buffers")
+	{
+		duProfiler profiler;
+		duProfilerContext ctx(&profiler);
+		const int threadCount = 4;
+		const int tilesPerThread = 50;
+
+		std::vector<std::thread> threads;
+		for (int t = 0; t < threadCount; ++t)
+		{
+			threads.push_back(std::thread([&ctx, t]() {
+				for (int i = 0; i < tilesPerThread; ++i)
+				{
+					ctx.setTile(i, t);
+					rcScopedTimer total(&ctx, RC_TIMER_TOTAL);
+					ctx.startTimer(RC_TIMER_RASTERIZE_TRIANGLES);
+					ctx.stopTimer(RC_TIMER_RASTERIZE_TRIANGLES);
+				}
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); ++i)
+			threads[i].join();
+
+		REQUIRE(profiler.getThreadCount() == threadCount);
+		for (int t = 0; t < threadCount; ++t)
+		{
+			const std::vector<duProfileSpan> spans = getSpans(profiler, t);
+			REQUIRE(spans.size() == tilesPerThread * 2);
+			for (size_t i = 0; i < spans.size(); i += 2)
+			{
+				REQUIRE(spans[i].label == RC_TIMER_RASTERIZE_TRIANGLES);
+				REQUIRE(spans[i].depth == 1);
+				REQUIRE(spans[i+1].label == RC_TIMER_TOTAL);
+				REQUIRE(spans[i+1].tileX == spans[i].tileX);
+				REQUIRE(spans[i+1].tileY == spans[i].tileY);
+			}
+		}
+		REQUIRE(profiler.getTileStats(0, 0) == threadCount * tilesPerThread);
+		REQUIRE(ctx.getAccumulatedTime(RC_TIMER_TOTAL) >= 0);
+		REQUIRE(ctx.getAccumulatedTime(RC_TIMER_BUILD_REGIONS) == -1);
+	}
+
+	SECTION("Chrome trace")
+	{
+		duProfiler profiler;
+		profiler.setTile(1, 2);
+		profiler.beginSpan("Quote\"d");
+		profiler.endSpan();
+
+		StringFileIO io;
+		REQUIRE(duDumpChromeTrace(profiler, &io));
+		REQUIRE(io.text.find("{\"traceEvents\":[") == 0);
+		REQUIRE(io.text.find("\"name\":\"Quote\\\"d\"") != std::string::npos);
+		REQUIRE(io.text.find("\"ph\":\"X\"") != std::string::npos);
+		REQUIRE(io.text.find("\"args\":{\"tileX\":1,\"tileY\":2}") != std::string::npos);
+	}
+}